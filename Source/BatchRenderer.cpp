@@ -0,0 +1,384 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchrenderer.cpp
+// ============
+// render a camera path into a framebuffer object and write every frame
+// to disk
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BatchRenderer.h"
+
+#include "SceneManager.h"
+#include "ViewManager.h"
+#include "FrameTimeTrace.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// declaration of global variables
+namespace
+{
+	// orbit of the turntable used when no cameras are given, around
+	// the point the default view looks at
+	const glm::vec3 g_TurntableTarget(0.0f, 2.0f, 0.0f);
+	const float g_TurntableRadius = 12.0f;
+	const float g_TurntableHeight = 5.0f;
+	const float g_DefaultFieldOfView = 80.0f;
+
+	// frames whose GPU render time is still being measured - the
+	// oldest result is read once this many later frames are queued
+	const int g_TimedFrameCount = 4;
+
+	// get the milliseconds between two points in time
+	double GetMilliseconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+	{
+		return(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	// get the milliseconds between two GPU timestamp queries, waiting
+	// for the GPU to reach the second one if it has not yet
+	double GetQueryMilliseconds(GLuint startQuery, GLuint endQuery)
+	{
+		GLuint64 startTime = 0;
+		GLuint64 endTime = 0;
+		glGetQueryObjectui64v(startQuery, GL_QUERY_RESULT, &startTime);
+		glGetQueryObjectui64v(endQuery, GL_QUERY_RESULT, &endTime);
+		return (endTime > startTime) ? (double)(endTime - startTime) / 1.0e6 : 0.0;
+	}
+}
+
+/***********************************************************
+ *  BatchRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+BatchRenderer::BatchRenderer()
+{
+	m_width = 1000;
+	m_height = 800;
+	m_outputDirectory = "frames";
+	m_captureFormat = FrameCapture::FORMAT_PNG;
+	m_framebufferID = 0;
+	m_colorBufferID = 0;
+	m_depthBufferID = 0;
+}
+
+/***********************************************************
+ *  ~BatchRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+BatchRenderer::~BatchRenderer()
+{
+	DestroyFramebuffer();
+}
+
+/***********************************************************
+ *  LoadCameras()
+ *
+ *  This method is used for reading the camera keys of the
+ *  path.  Anything after a '#' is a comment, and a key
+ *  without a field of view keeps the default one.
+ ***********************************************************/
+bool BatchRenderer::LoadCameras(const char* filename)
+{
+	std::ifstream input(filename);
+	if (!input)
+	{
+		std::cout << "Could not open camera file:" << filename << std::endl;
+		return(false);
+	}
+
+	std::vector<CAMERA_KEY> cameras;
+	std::string text;
+	int lineNumber = 0;
+	while (std::getline(input, text))
+	{
+		lineNumber++;
+		size_t comment = text.find('#');
+		if (comment != std::string::npos)
+		{
+			text.erase(comment);
+		}
+
+		std::istringstream line(text);
+		std::string kind;
+		if (!(line >> kind))
+		{
+			continue;
+		}
+
+		CAMERA_KEY camera;
+		camera.fieldOfView = g_DefaultFieldOfView;
+		bool bLineValid = (kind == "camera") &&
+			(line >> camera.position.x >> camera.position.y >> camera.position.z) &&
+			(line >> camera.target.x >> camera.target.y >> camera.target.z);
+		if (bLineValid == true)
+		{
+			float fieldOfView = 0.0f;
+			if (line >> fieldOfView)
+			{
+				camera.fieldOfView = fieldOfView;
+			}
+			cameras.push_back(camera);
+		}
+		else
+		{
+			std::cout << "Invalid camera on line " << lineNumber << " of " << filename << std::endl;
+			return(false);
+		}
+	}
+
+	if (cameras.empty() == true)
+	{
+		std::cout << "No cameras in camera file:" << filename << std::endl;
+		return(false);
+	}
+
+	m_cameras.swap(cameras);
+	return(true);
+}
+
+/***********************************************************
+ *  SetFrameSize()
+ *
+ *  This method is used for setting the size of the frames.
+ ***********************************************************/
+void BatchRenderer::SetFrameSize(int width, int height)
+{
+	if ((width > 0) && (height > 0))
+	{
+		m_width = width;
+		m_height = height;
+	}
+}
+
+/***********************************************************
+ *  SetOutputDirectory()
+ *
+ *  This method is used for setting where the frames go.
+ ***********************************************************/
+void BatchRenderer::SetOutputDirectory(const char* directory)
+{
+	m_outputDirectory = directory;
+}
+
+/***********************************************************
+ *  SetCaptureFormat()
+ *
+ *  This method is used for setting how the frames are kept.
+ ***********************************************************/
+void BatchRenderer::SetCaptureFormat(FrameCapture::CAPTURE_FORMAT format)
+{
+	m_captureFormat = format;
+}
+
+/***********************************************************
+ *  GetFrameCamera()
+ *
+ *  This method is used for getting the camera of a frame.
+ *  The frames are spread evenly from the first key to the
+ *  last, moving in a straight line between each pair, so a
+ *  single key renders a still.  Without keys the camera
+ *  makes one full turn around the scene.
+ ***********************************************************/
+BatchRenderer::CAMERA_KEY BatchRenderer::GetFrameCamera(int frameIndex, int frameCount) const
+{
+	CAMERA_KEY camera;
+	if (m_cameras.empty() == true)
+	{
+		float angle = 6.2831853f * (float)frameIndex / (float)frameCount;
+		camera.position = g_TurntableTarget +
+			glm::vec3(std::sin(angle) * g_TurntableRadius, g_TurntableHeight - g_TurntableTarget.y, std::cos(angle) * g_TurntableRadius);
+		camera.target = g_TurntableTarget;
+		camera.fieldOfView = g_DefaultFieldOfView;
+		return(camera);
+	}
+
+	if ((m_cameras.size() == 1) || (frameCount <= 1))
+	{
+		return(m_cameras[0]);
+	}
+
+	float path = (float)frameIndex * (float)(m_cameras.size() - 1) / (float)(frameCount - 1);
+	int key = (int)path;
+	if (key >= (int)m_cameras.size() - 1)
+	{
+		return(m_cameras.back());
+	}
+	float blend = path - (float)key;
+	const CAMERA_KEY& from = m_cameras[key];
+	const CAMERA_KEY& to = m_cameras[key + 1];
+	camera.position = from.position + (to.position - from.position) * blend;
+	camera.target = from.target + (to.target - from.target) * blend;
+	camera.fieldOfView = from.fieldOfView + (to.fieldOfView - from.fieldOfView) * blend;
+	return(camera);
+}
+
+/***********************************************************
+ *  CreateFramebuffer()
+ *
+ *  This method is used for creating the framebuffer object
+ *  the frames are drawn into, with 8 bit color the readback
+ *  can copy without converting, and binding it for the
+ *  rest of the run.
+ ***********************************************************/
+bool BatchRenderer::CreateFramebuffer()
+{
+	glGenRenderbuffers(1, &m_colorBufferID);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_colorBufferID);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_width, m_height);
+
+	glGenRenderbuffers(1, &m_depthBufferID);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBufferID);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_width, m_height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_framebufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBufferID);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBufferID);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ERROR: Offscreen framebuffer is incomplete: 0x" << std::hex << status << std::dec << std::endl;
+		DestroyFramebuffer();
+		return(false);
+	}
+
+	glViewport(0, 0, m_width, m_height);
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyFramebuffer()
+ *
+ *  This method is used for releasing the framebuffer object
+ *  and its buffers.
+ ***********************************************************/
+void BatchRenderer::DestroyFramebuffer()
+{
+	if (m_framebufferID != 0)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &m_framebufferID);
+		m_framebufferID = 0;
+	}
+	if (m_colorBufferID != 0)
+	{
+		glDeleteRenderbuffers(1, &m_colorBufferID);
+		m_colorBufferID = 0;
+	}
+	if (m_depthBufferID != 0)
+	{
+		glDeleteRenderbuffers(1, &m_depthBufferID);
+		m_depthBufferID = 0;
+	}
+}
+
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for rendering the frames as fast as
+ *  the machine allows.  Nothing paces the loop or waits for
+ *  the GPU, so frames pipeline with their readbacks.  The
+ *  render time of each frame is measured on the GPU with a
+ *  pair of timestamp queries, read a few frames later, and
+ *  the capture time is what starting its readback and
+ *  handing on earlier ones cost this thread.  The times of
+ *  every frame are also written next to the frames.
+ ***********************************************************/
+bool BatchRenderer::Run(SceneManager* pSceneManager, ViewManager* pViewManager, int frameCount)
+{
+	if ((NULL == pSceneManager) || (NULL == pViewManager) || (frameCount <= 0))
+	{
+		return(false);
+	}
+
+	FrameCapture frameCapture;
+	if ((frameCapture.Begin(m_outputDirectory.c_str(), m_captureFormat) == false) ||
+		(CreateFramebuffer() == false))
+	{
+		return(false);
+	}
+
+	std::cout << "Rendering " << frameCount << " frames of " << m_width << "x" << m_height
+		<< " into " << m_outputDirectory << std::endl;
+
+	FrameTimeTrace renderTrace("GPU render");
+	FrameTimeTrace captureTrace("Capture");
+	const float aspectRatio = (float)m_width / (float)m_height;
+
+	// a start and end timestamp query for each frame being timed
+	GLuint timerQueries[g_TimedFrameCount * 2];
+	glGenQueries(g_TimedFrameCount * 2, timerQueries);
+
+	auto runStart = std::chrono::steady_clock::now();
+	for (int frameIndex = 0; frameIndex < frameCount; frameIndex++)
+	{
+		PROFILE_SCOPE("Frame");
+		CAMERA_KEY camera = GetFrameCamera(frameIndex, frameCount);
+
+		pViewManager->PrepareCameraView(camera.position, camera.target, camera.fieldOfView, aspectRatio);
+		pSceneManager->SetViewPosition(pViewManager->GetViewPosition());
+		pSceneManager->SetViewProjection(pViewManager->GetProjectionMatrix() * pViewManager->GetViewMatrix());
+
+		// the queries of this slot were read when the frame that used
+		// them last was timed
+		const GLuint* pQueries = &timerQueries[(frameIndex % g_TimedFrameCount) * 2];
+		if (frameIndex >= g_TimedFrameCount)
+		{
+			renderTrace.AddFrame(GetQueryMilliseconds(pQueries[0], pQueries[1]), frameIndex - g_TimedFrameCount);
+		}
+
+		{
+			PROFILE_GPU_SCOPE("Frame");
+			glQueryCounter(pQueries[0], GL_TIMESTAMP);
+			glEnable(GL_DEPTH_TEST);
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			pSceneManager->RenderScene();
+			glQueryCounter(pQueries[1], GL_TIMESTAMP);
+		}
+
+		frameCapture.CaptureFrame(m_width, m_height);
+		PROFILE_GPU_FRAME();
+
+		captureTrace.AddFrame(frameCapture.GetLastCaptureMilliseconds(), frameIndex);
+	}
+	double renderSeconds = GetMilliseconds(runStart, std::chrono::steady_clock::now()) / 1000.0;
+
+	// read the render times of the frames still being timed
+	for (int frameIndex = std::max(0, frameCount - g_TimedFrameCount); frameIndex < frameCount; frameIndex++)
+	{
+		const GLuint* pQueries = &timerQueries[(frameIndex % g_TimedFrameCount) * 2];
+		renderTrace.AddFrame(GetQueryMilliseconds(pQueries[0], pQueries[1]), frameIndex);
+	}
+	glDeleteQueries(g_TimedFrameCount * 2, timerQueries);
+
+	// the last frames are still being read back and written
+	frameCapture.Finish();
+	double runSeconds = GetMilliseconds(runStart, std::chrono::steady_clock::now()) / 1000.0;
+	DestroyFramebuffer();
+
+	renderTrace.PrintSummary();
+	captureTrace.PrintSummary();
+	frameCapture.PrintStatistics();
+	std::cout << std::fixed << std::setprecision(2)
+		<< "Rendered " << frameCount << " frames in " << renderSeconds << " s, "
+		<< (renderSeconds > 0.0 ? frameCount / renderSeconds : 0.0) << " frames per second, "
+		<< runSeconds << " s until the last frame was written" << std::endl;
+
+	renderTrace.WriteCSV((m_outputDirectory + "/render_times.csv").c_str());
+	captureTrace.WriteCSV((m_outputDirectory + "/capture_times.csv").c_str());
+	return(true);
+}
@@ -0,0 +1,86 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchrenderer.h
+// ============
+// render a camera path into a framebuffer object and write every frame
+// to disk
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameCapture.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+class SceneManager;
+class ViewManager;
+
+/***********************************************************
+ *  BatchRenderer
+ *
+ *  This class renders frames without a window for stills
+ *  and turntables.  The cameras come from a list of keys
+ *  the frames are spread along, or orbit the scene when no
+ *  list is given.  Each frame is drawn into a framebuffer
+ *  object and handed to a FrameCapture, which reads it back
+ *  without stalling and writes it on worker threads.  The
+ *  render and capture times are recorded separately, so
+ *  the render time is not hidden behind the readback.
+ ***********************************************************/
+class BatchRenderer
+{
+public:
+	// a camera of the path, with the field of view in degrees
+	struct CAMERA_KEY
+	{
+		glm::vec3 position;
+		glm::vec3 target;
+		float fieldOfView;
+	};
+
+	// constructor
+	BatchRenderer();
+	// destructor
+	~BatchRenderer();
+
+	// read the camera keys from a text file with one line of
+	// "camera px py pz tx ty tz [fov]" per key
+	bool LoadCameras(const char* filename);
+	// set the size of the frames in pixels
+	void SetFrameSize(int width, int height);
+	// set the directory the frames are written into
+	void SetOutputDirectory(const char* directory);
+	// set whether the frames are written as PNG files or a raw stream
+	void SetCaptureFormat(FrameCapture::CAPTURE_FORMAT format);
+
+	// render and write the passed in number of frames, returning
+	// false when the framebuffer could not be created
+	bool Run(SceneManager* pSceneManager, ViewManager* pViewManager, int frameCount);
+
+private:
+	std::vector<CAMERA_KEY> m_cameras;
+	int m_width;
+	int m_height;
+	std::string m_outputDirectory;
+	FrameCapture::CAPTURE_FORMAT m_captureFormat;
+
+	// framebuffer object and its color and depth buffers
+	GLuint m_framebufferID;
+	GLuint m_colorBufferID;
+	GLuint m_depthBufferID;
+
+	// get the camera of a frame along the path
+	CAMERA_KEY GetFrameCamera(int frameIndex, int frameCount) const;
+	// create and bind the framebuffer object
+	bool CreateFramebuffer();
+	// release the framebuffer object
+	void DestroyFramebuffer();
+
+	// batch renderers cannot be copied
+	BatchRenderer(const BatchRenderer&);
+	BatchRenderer& operator=(const BatchRenderer&);
+};
@@ -0,0 +1,403 @@
+///////////////////////////////////////////////////////////////////////////////
+// boundingvolumehierarchy.cpp
+// ============
+// a tree of boxes around the scene objects for culling whole groups of
+// objects with one test
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BoundingVolumeHierarchy.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// deeper than a median split tree of any object count can grow
+	const int g_MaxTraversalDepth = 128;
+
+	// subtrees per thread a parallel cull is split into
+	const int g_CullSubtreesPerThread = 8;
+
+	// grow a box to hold another
+	void MergeBox(BoundingVolumeHierarchy::BOUNDING_BOX& box, const BoundingVolumeHierarchy::BOUNDING_BOX& other)
+	{
+		box.minimum = glm::min(box.minimum, other.minimum);
+		box.maximum = glm::max(box.maximum, other.maximum);
+	}
+
+	// compare two boxes exactly
+	bool SameBox(const BoundingVolumeHierarchy::BOUNDING_BOX& a, const BoundingVolumeHierarchy::BOUNDING_BOX& b)
+	{
+		return (a.minimum.x == b.minimum.x) && (a.minimum.y == b.minimum.y) && (a.minimum.z == b.minimum.z) &&
+			(a.maximum.x == b.maximum.x) && (a.maximum.y == b.maximum.y) && (a.maximum.z == b.maximum.z);
+	}
+}
+
+/***********************************************************
+ *  BoundingVolumeHierarchy()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+BoundingVolumeHierarchy::BoundingVolumeHierarchy()
+{
+	m_lastRefitCount = 0;
+}
+
+/***********************************************************
+ *  TransformBox()
+ *
+ *  This method is used for getting the world box around an
+ *  object space box.  The center is moved by the matrix and
+ *  each world extent is the sum of the object extents
+ *  scaled by the absolute matrix terms, which is the box
+ *  around the eight moved corners.
+ ***********************************************************/
+BoundingVolumeHierarchy::BOUNDING_BOX BoundingVolumeHierarchy::TransformBox(const BOUNDING_BOX& box, const glm::mat4& model)
+{
+	glm::vec3 center = (box.minimum + box.maximum) * 0.5f;
+	glm::vec3 extent = (box.maximum - box.minimum) * 0.5f;
+
+	glm::vec3 worldCenter = glm::vec3(model[3]);
+	glm::vec3 worldExtent(0.0f);
+	for (int column = 0; column < 3; column++)
+	{
+		glm::vec3 axis = glm::vec3(model[column]);
+		worldCenter += axis * center[column];
+		worldExtent += glm::vec3(std::fabs(axis.x), std::fabs(axis.y), std::fabs(axis.z)) * extent[column];
+	}
+
+	BOUNDING_BOX result;
+	result.minimum = worldCenter - worldExtent;
+	result.maximum = worldCenter + worldExtent;
+	return(result);
+}
+
+/***********************************************************
+ *  GetRangeBounds()
+ *
+ *  This method is used for getting the box around a range
+ *  of the objects in leaf order.
+ ***********************************************************/
+BoundingVolumeHierarchy::BOUNDING_BOX BoundingVolumeHierarchy::GetRangeBounds(int firstObject, int objectCount) const
+{
+	BOUNDING_BOX bounds = m_objectBounds[m_objectOrder[firstObject]];
+	for (int i = 1; i < objectCount; i++)
+	{
+		MergeBox(bounds, m_objectBounds[m_objectOrder[firstObject + i]]);
+	}
+	return(bounds);
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the tree from the
+ *  bounds of the objects.  Each node with too many objects
+ *  is split in two at the median center along the longest
+ *  axis of its centers, which keeps the tree balanced and
+ *  is found in linear time with nth_element.  The node boxes
+ *  are filled in afterwards from the leaves up, since every
+ *  child comes after its parent.
+ ***********************************************************/
+void BoundingVolumeHierarchy::Build(const BOUNDING_BOX* pBounds, int objectCount)
+{
+	m_objectBounds.assign(pBounds, pBounds + objectCount);
+	m_objectOrder.resize(objectCount);
+	m_objectLeaves.assign(objectCount, 0);
+	m_nodes.clear();
+	m_dirtyLeaves.clear();
+	m_lastRefitCount = 0;
+	if (objectCount == 0)
+	{
+		m_leafDirty.clear();
+		return;
+	}
+
+	// the objects are split with their centers next to their
+	// indices, so partitioning does not chase the indices
+	struct BUILD_ENTRY
+	{
+		glm::vec3 center;
+		uint32_t objectIndex;
+	};
+	std::vector<BUILD_ENTRY> entries(objectCount);
+	for (int i = 0; i < objectCount; i++)
+	{
+		entries[i].center = m_objectBounds[i].minimum + m_objectBounds[i].maximum;
+		entries[i].objectIndex = (uint32_t)i;
+	}
+
+	m_nodes.reserve(2 * (objectCount / MAX_LEAF_OBJECTS + 1));
+	BVH_NODE root;
+	root.firstChild = -1;
+	root.parent = -1;
+	root.firstObject = 0;
+	root.objectCount = objectCount;
+	m_nodes.push_back(root);
+
+	std::vector<int32_t> pending;
+	pending.push_back(0);
+	while (pending.empty() == false)
+	{
+		int32_t nodeIndex = pending.back();
+		pending.pop_back();
+
+		const int firstObject = m_nodes[nodeIndex].firstObject;
+		const int nodeObjects = m_nodes[nodeIndex].objectCount;
+		if (nodeObjects <= MAX_LEAF_OBJECTS)
+		{
+			for (int i = firstObject; i < firstObject + nodeObjects; i++)
+			{
+				m_objectOrder[i] = entries[i].objectIndex;
+				m_objectLeaves[entries[i].objectIndex] = nodeIndex;
+			}
+			continue;
+		}
+
+		// split along the longest axis of the object centers
+		glm::vec3 centerMin(1.0e30f);
+		glm::vec3 centerMax(-1.0e30f);
+		for (int i = firstObject; i < firstObject + nodeObjects; i++)
+		{
+			const glm::vec3& center = entries[i].center;
+			centerMin = glm::min(centerMin, center);
+			centerMax = glm::max(centerMax, center);
+		}
+		glm::vec3 size = centerMax - centerMin;
+		int axis = 0;
+		if (size.y > size.x)
+		{
+			axis = 1;
+		}
+		if (size.z > size[axis])
+		{
+			axis = 2;
+		}
+
+		const int leftCount = nodeObjects / 2;
+		std::nth_element(
+			entries.begin() + firstObject,
+			entries.begin() + firstObject + leftCount,
+			entries.begin() + firstObject + nodeObjects,
+			[axis](const BUILD_ENTRY& a, const BUILD_ENTRY& b)
+			{
+				return a.center[axis] < b.center[axis];
+			});
+
+		int32_t firstChild = (int32_t)m_nodes.size();
+		for (int side = 0; side < 2; side++)
+		{
+			BVH_NODE child;
+			child.firstChild = -1;
+			child.parent = nodeIndex;
+			child.firstObject = (side == 0) ? firstObject : firstObject + leftCount;
+			child.objectCount = (side == 0) ? leftCount : nodeObjects - leftCount;
+			m_nodes.push_back(child);
+			pending.push_back(firstChild + side);
+		}
+		m_nodes[nodeIndex].firstChild = firstChild;
+	}
+
+	for (int nodeIndex = (int)m_nodes.size() - 1; nodeIndex >= 0; nodeIndex--)
+	{
+		BVH_NODE& node = m_nodes[nodeIndex];
+		if (node.firstChild < 0)
+		{
+			node.bounds = GetRangeBounds(node.firstObject, node.objectCount);
+		}
+		else
+		{
+			node.bounds = m_nodes[node.firstChild].bounds;
+			MergeBox(node.bounds, m_nodes[node.firstChild + 1].bounds);
+		}
+	}
+
+	m_leafDirty.assign(m_nodes.size(), 0);
+}
+
+/***********************************************************
+ *  UpdateBounds()
+ *
+ *  This method is used for changing the bounds of a moved
+ *  object.  Its leaf is queued, once, for the next refit.
+ ***********************************************************/
+void BoundingVolumeHierarchy::UpdateBounds(int objectIndex, const BOUNDING_BOX& bounds)
+{
+	m_objectBounds[objectIndex] = bounds;
+
+	int32_t leaf = m_objectLeaves[objectIndex];
+	if (m_leafDirty[leaf] == 0)
+	{
+		m_leafDirty[leaf] = 1;
+		m_dirtyLeaves.push_back(leaf);
+	}
+}
+
+/***********************************************************
+ *  Refit()
+ *
+ *  This method is used for bringing the boxes above the
+ *  queued leaves up to date.  Each leaf box is rebuilt from
+ *  its objects, then each parent from its two children,
+ *  stopping as soon as a box does not change, since the
+ *  boxes above it already hold it.
+ ***********************************************************/
+void BoundingVolumeHierarchy::Refit()
+{
+	m_lastRefitCount = 0;
+	for (int32_t leaf : m_dirtyLeaves)
+	{
+		m_leafDirty[leaf] = 0;
+
+		BVH_NODE& leafNode = m_nodes[leaf];
+		BOUNDING_BOX bounds = GetRangeBounds(leafNode.firstObject, leafNode.objectCount);
+		if (SameBox(bounds, leafNode.bounds) == true)
+		{
+			continue;
+		}
+		leafNode.bounds = bounds;
+		m_lastRefitCount++;
+
+		int32_t nodeIndex = leafNode.parent;
+		while (nodeIndex >= 0)
+		{
+			BVH_NODE& node = m_nodes[nodeIndex];
+			bounds = m_nodes[node.firstChild].bounds;
+			MergeBox(bounds, m_nodes[node.firstChild + 1].bounds);
+			if (SameBox(bounds, node.bounds) == true)
+			{
+				break;
+			}
+			node.bounds = bounds;
+			m_lastRefitCount++;
+			nodeIndex = node.parent;
+		}
+	}
+	m_dirtyLeaves.clear();
+}
+
+/***********************************************************
+ *  CullNode()
+ *
+ *  This method is used for finding the objects below a node
+ *  that may be seen in the frustum.  Nodes outside it are
+ *  skipped with everything below them, and all the objects
+ *  of a node fully inside are taken without further tests.
+ *  Objects in leaves that cross the frustum are tested one
+ *  by one.
+ ***********************************************************/
+void BoundingVolumeHierarchy::CullNode(const Frustum& frustum, int32_t nodeIndex, std::vector<uint32_t>& visibleObjects) const
+{
+	int32_t pending[g_MaxTraversalDepth];
+	int pendingCount = 0;
+	pending[pendingCount++] = nodeIndex;
+	while (pendingCount > 0)
+	{
+		const BVH_NODE& node = m_nodes[pending[--pendingCount]];
+
+		Frustum::TEST_RESULT result = frustum.TestBox(node.bounds.minimum, node.bounds.maximum);
+		if (result == Frustum::TEST_OUTSIDE)
+		{
+			continue;
+		}
+
+		if (result == Frustum::TEST_INSIDE)
+		{
+			visibleObjects.insert(visibleObjects.end(),
+				m_objectOrder.begin() + node.firstObject,
+				m_objectOrder.begin() + node.firstObject + node.objectCount);
+		}
+		else if (node.firstChild < 0)
+		{
+			for (int i = 0; i < node.objectCount; i++)
+			{
+				uint32_t objectIndex = m_objectOrder[node.firstObject + i];
+				const BOUNDING_BOX& box = m_objectBounds[objectIndex];
+				if (frustum.TestBox(box.minimum, box.maximum) != Frustum::TEST_OUTSIDE)
+				{
+					visibleObjects.push_back(objectIndex);
+				}
+			}
+		}
+		else
+		{
+			pending[pendingCount++] = node.firstChild;
+			pending[pendingCount++] = node.firstChild + 1;
+		}
+	}
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for finding the objects that may be
+ *  seen in the frustum.  With a job system, the nodes near
+ *  the root are tested here, breadth first, until enough
+ *  subtrees that cross the frustum are left to give every
+ *  thread a few, and the subtrees are culled as jobs into
+ *  lists of their own that are joined afterwards.
+ ***********************************************************/
+void BoundingVolumeHierarchy::Cull(const Frustum& frustum, std::vector<uint32_t>& visibleObjects, JobSystem* pJobSystem) const
+{
+	visibleObjects.clear();
+	if (m_nodes.empty() == true)
+	{
+		return;
+	}
+
+	if ((NULL == pJobSystem) || (pJobSystem->GetThreadCount() == 1))
+	{
+		CullNode(frustum, 0, visibleObjects);
+		return;
+	}
+
+	const size_t subtreeCount = (size_t)pJobSystem->GetThreadCount() * g_CullSubtreesPerThread;
+	m_cullRoots.clear();
+	m_cullRoots.push_back(0);
+	size_t firstRoot = 0;
+	while ((firstRoot < m_cullRoots.size()) && (m_cullRoots.size() - firstRoot < subtreeCount))
+	{
+		const BVH_NODE& node = m_nodes[m_cullRoots[firstRoot]];
+		if (node.firstChild >= 0)
+		{
+			Frustum::TEST_RESULT result = frustum.TestBox(node.bounds.minimum, node.bounds.maximum);
+			if (result == Frustum::TEST_INSIDE)
+			{
+				visibleObjects.insert(visibleObjects.end(),
+					m_objectOrder.begin() + node.firstObject,
+					m_objectOrder.begin() + node.firstObject + node.objectCount);
+			}
+			else if (result == Frustum::TEST_INTERSECTING)
+			{
+				m_cullRoots.push_back(node.firstChild);
+				m_cullRoots.push_back(node.firstChild + 1);
+			}
+		}
+		else
+		{
+			CullNode(frustum, m_cullRoots[firstRoot], visibleObjects);
+		}
+		firstRoot++;
+	}
+
+	const int rootCount = (int)(m_cullRoots.size() - firstRoot);
+	if ((int)m_cullLists.size() < rootCount)
+	{
+		m_cullLists.resize(rootCount);
+	}
+	pJobSystem->ParallelFor(rootCount, 1, [this, &frustum, firstRoot](int first, int count)
+		{
+			for (int i = first; i < first + count; i++)
+			{
+				m_cullLists[i].clear();
+				CullNode(frustum, m_cullRoots[firstRoot + i], m_cullLists[i]);
+			}
+		});
+
+	for (int i = 0; i < rootCount; i++)
+	{
+		visibleObjects.insert(visibleObjects.end(), m_cullLists[i].begin(), m_cullLists[i].end());
+	}
+}
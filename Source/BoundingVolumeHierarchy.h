@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// boundingvolumehierarchy.h
+// ============
+// a tree of boxes around the scene objects for culling whole groups of
+// objects with one test
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Frustum.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+/***********************************************************
+ *  BoundingVolumeHierarchy
+ *
+ *  This class builds a binary tree of axis aligned boxes
+ *  over the bounds of a set of objects.  The objects are
+ *  split at the median of their centers along the longest
+ *  axis until a few are left in each leaf, so every node
+ *  covers a contiguous range of the reordered objects.
+ *  Culling walks down from the root, skipping nodes outside
+ *  the frustum and taking every object of a node that is
+ *  fully inside without testing them.  When objects move,
+ *  their new bounds are written to their leaves and only
+ *  the boxes above those leaves are refit, so the tree
+ *  keeps its shape without being rebuilt.  With a job
+ *  system, the tree is split near the root into subtrees
+ *  that are culled on its threads.
+ ***********************************************************/
+class BoundingVolumeHierarchy
+{
+public:
+	// constructor
+	BoundingVolumeHierarchy();
+
+	struct BOUNDING_BOX
+	{
+		glm::vec3 minimum;
+		glm::vec3 maximum;
+	};
+
+	// the most objects kept in one leaf
+	static const int MAX_LEAF_OBJECTS = 4;
+
+	// build the tree over the bounds of the objects
+	void Build(const BOUNDING_BOX* pBounds, int objectCount);
+	// change the bounds of an object, to be applied by Refit
+	void UpdateBounds(int objectIndex, const BOUNDING_BOX& bounds);
+	// refit the boxes above every object updated since the last refit
+	void Refit();
+	// replace the passed in list with the objects the frustum may
+	// see, on the threads of the job system if one is passed in
+	void Cull(const Frustum& frustum, std::vector<uint32_t>& visibleObjects, JobSystem* pJobSystem = NULL) const;
+
+	int GetObjectCount() const { return (int)m_objectBounds.size(); }
+	int GetNodeCount() const { return (int)m_nodes.size(); }
+	// number of boxes changed by the last refit
+	int GetLastRefitCount() const { return m_lastRefitCount; }
+
+	// get the world box around an object space box moved by the matrix
+	static BOUNDING_BOX TransformBox(const BOUNDING_BOX& box, const glm::mat4& model);
+
+private:
+	struct BVH_NODE
+	{
+		BOUNDING_BOX bounds;
+		// first of the two children, which are next to each other,
+		// or -1 for a leaf
+		int32_t firstChild;
+		int32_t parent;
+		// range of m_objectOrder covered by the node
+		int32_t firstObject;
+		int32_t objectCount;
+	};
+
+	std::vector<BVH_NODE> m_nodes;
+	// bounds of every object, by object index
+	std::vector<BOUNDING_BOX> m_objectBounds;
+	// object indices in leaf order
+	std::vector<uint32_t> m_objectOrder;
+	// leaf holding each object
+	std::vector<int32_t> m_objectLeaves;
+	// leaves whose objects moved since the last refit
+	std::vector<int32_t> m_dirtyLeaves;
+	std::vector<uint8_t> m_leafDirty;
+	int m_lastRefitCount;
+	// subtrees culled by the jobs of a parallel cull and the objects
+	// each found, kept so culling does not allocate every frame
+	mutable std::vector<int32_t> m_cullRoots;
+	mutable std::vector<std::vector<uint32_t>> m_cullLists;
+
+	// get the box around the objects of a range of m_objectOrder
+	BOUNDING_BOX GetRangeBounds(int firstObject, int objectCount) const;
+	// add the objects the frustum may see below a node to the list
+	void CullNode(const Frustum& frustum, int32_t nodeIndex, std::vector<uint32_t>& visibleObjects) const;
+};
@@ -0,0 +1,169 @@
+///////////////////////////////////////////////////////////////////////////////
+// compressedtexture.cpp
+// ============
+// read and write block compressed (BC1/BC3/BC7) texture mip chains
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CompressedTexture.h"
+
+#include <cstring>
+#include <fstream>
+
+// declaration of global variables
+namespace
+{
+	const uint32_t g_CompressedMagic = 0x32544342; // "BCT2"
+
+	// fixed size header at the start of every compressed texture
+	// file, followed directly by the blocks of every level
+	struct COMPRESSED_HEADER
+	{
+		uint32_t magic;
+		uint32_t format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t levelCount;
+		uint32_t reserved;
+		uint64_t sourceSize;
+		int64_t sourceModifiedTime;
+		uint64_t blockByteCount;
+	};
+}
+
+/***********************************************************
+ *  CompressedTexture()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CompressedTexture::CompressedTexture()
+{
+	m_format = FORMAT_NONE;
+	m_width = 0;
+	m_height = 0;
+	m_levelCount = 0;
+	m_sourceSize = 0;
+	m_sourceModifiedTime = 0;
+	m_pBlocks = NULL;
+}
+
+/***********************************************************
+ *  GetBlockBytes()
+ *
+ *  This method is used for getting the size of one 4x4
+ *  block in the passed in format.
+ ***********************************************************/
+int CompressedTexture::GetBlockBytes(BLOCK_FORMAT format)
+{
+	return (format == FORMAT_BC1) ? 8 : 16;
+}
+
+/***********************************************************
+ *  GetLevelSize()
+ *
+ *  This method is used for getting the bytes of one level
+ *  with the passed in size, rounded up to whole blocks.
+ ***********************************************************/
+size_t CompressedTexture::GetLevelSize(BLOCK_FORMAT format, int width, int height)
+{
+	size_t blocksWide = (size_t)((width + 3) / 4);
+	size_t blocksHigh = (size_t)((height + 3) / 4);
+	return blocksWide * blocksHigh * GetBlockBytes(format);
+}
+
+/***********************************************************
+ *  GetMipChainSize()
+ *
+ *  This method is used for getting the bytes of every level
+ *  of a compressed mip chain.
+ ***********************************************************/
+size_t CompressedTexture::GetMipChainSize(BLOCK_FORMAT format, int width, int height, int levelCount)
+{
+	size_t byteCount = 0;
+	for (int level = 0; level < levelCount; level++)
+	{
+		byteCount += GetLevelSize(format, width, height);
+		width = (width > 1) ? width / 2 : 1;
+		height = (height > 1) ? height / 2 : 1;
+	}
+	return(byteCount);
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping a compressed texture
+ *  file and checking that its header is consistent.
+ ***********************************************************/
+bool CompressedTexture::Open(const char* filename)
+{
+	if (m_file.Open(filename) == false)
+	{
+		return(false);
+	}
+
+	COMPRESSED_HEADER header;
+	bool bValid = (m_file.GetSize() >= sizeof(COMPRESSED_HEADER));
+	if (bValid == true)
+	{
+		memcpy(&header, m_file.GetData(), sizeof(COMPRESSED_HEADER));
+		bValid = (header.magic == g_CompressedMagic) &&
+			((header.format == FORMAT_BC1) || (header.format == FORMAT_BC3) || (header.format == FORMAT_BC7)) &&
+			(header.levelCount > 0) &&
+			(header.blockByteCount == GetMipChainSize((BLOCK_FORMAT)header.format, header.width, header.height, header.levelCount)) &&
+			(sizeof(COMPRESSED_HEADER) + header.blockByteCount <= m_file.GetSize());
+	}
+	if (bValid == false)
+	{
+		m_file.Close();
+		return(false);
+	}
+
+	m_format = (int)header.format;
+	m_width = (int)header.width;
+	m_height = (int)header.height;
+	m_levelCount = (int)header.levelCount;
+	m_sourceSize = header.sourceSize;
+	m_sourceModifiedTime = header.sourceModifiedTime;
+	m_pBlocks = m_file.GetData() + sizeof(COMPRESSED_HEADER);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Write()
+ *
+ *  This method is used for writing a compressed mip chain
+ *  and its header into the passed in file.
+ ***********************************************************/
+bool CompressedTexture::Write(
+	const char* filename,
+	BLOCK_FORMAT format,
+	int width,
+	int height,
+	int levelCount,
+	uint64_t sourceSize,
+	int64_t sourceModifiedTime,
+	const std::vector<unsigned char>& blocks)
+{
+	COMPRESSED_HEADER header;
+	memset(&header, 0, sizeof(COMPRESSED_HEADER));
+	header.magic = g_CompressedMagic;
+	header.format = (uint32_t)format;
+	header.width = (uint32_t)width;
+	header.height = (uint32_t)height;
+	header.levelCount = (uint32_t)levelCount;
+	header.sourceSize = sourceSize;
+	header.sourceModifiedTime = sourceModifiedTime;
+	header.blockByteCount = (uint64_t)blocks.size();
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		return(false);
+	}
+	file.write((const char*)&header, sizeof(COMPRESSED_HEADER));
+	file.write((const char*)blocks.data(), (std::streamsize)blocks.size());
+
+	return (bool)file;
+}
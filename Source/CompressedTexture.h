@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// compressedtexture.h
+// ============
+// read and write block compressed (BC1/BC3/BC7) texture mip chains
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  CompressedTexture
+ *
+ *  This class maps a .bctex file written by the offline
+ *  TextureCompressor tool.  The file holds the complete mip
+ *  chain of one image in a single block compression format,
+ *  largest level first, ready for glCompressedTexImage2D.
+ *  It does not depend on OpenGL so the tool can use it too.
+ ***********************************************************/
+class CompressedTexture
+{
+public:
+	enum BLOCK_FORMAT
+	{
+		FORMAT_NONE = 0,
+		FORMAT_BC1 = 1,
+		FORMAT_BC3 = 3,
+		FORMAT_BC7 = 7
+	};
+
+	// constructor
+	CompressedTexture();
+
+	// map the passed in compressed texture file
+	bool Open(const char* filename);
+	// write a compressed mip chain into the passed in file
+	static bool Write(
+		const char* filename,
+		BLOCK_FORMAT format,
+		int width,
+		int height,
+		int levelCount,
+		uint64_t sourceSize,
+		int64_t sourceModifiedTime,
+		const std::vector<unsigned char>& blocks);
+
+	// get the bytes in each 4x4 block of the format
+	static int GetBlockBytes(BLOCK_FORMAT format);
+	// get the bytes of one compressed level
+	static size_t GetLevelSize(BLOCK_FORMAT format, int width, int height);
+	// get the bytes of a compressed mip chain
+	static size_t GetMipChainSize(BLOCK_FORMAT format, int width, int height, int levelCount);
+
+	BLOCK_FORMAT GetFormat() const { return (BLOCK_FORMAT)m_format; }
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+	int GetLevelCount() const { return m_levelCount; }
+	// get the size of the image file the texture was compressed from
+	uint64_t GetSourceSize() const { return m_sourceSize; }
+	// get the modification time of the image file it was compressed from
+	int64_t GetSourceModifiedTime() const { return m_sourceModifiedTime; }
+	// get the compressed blocks of every level
+	const unsigned char* GetBlocks() const { return m_pBlocks; }
+
+private:
+	// mapped compressed texture file
+	MappedFile m_file;
+	// values read from the file header
+	int m_format;
+	int m_width;
+	int m_height;
+	int m_levelCount;
+	uint64_t m_sourceSize;
+	int64_t m_sourceModifiedTime;
+	// compressed blocks of every level
+	const unsigned char* m_pBlocks;
+};
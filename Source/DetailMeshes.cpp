@@ -0,0 +1,135 @@
+///////////////////////////////////////////////////////////////////////////////
+// detailmeshes.cpp
+// ============
+// draw the curved basic meshes at each of their levels of detail
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DetailMeshes.h"
+#include "InstancedMeshes.h"
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+/***********************************************************
+ *  DetailMeshes()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DetailMeshes::DetailMeshes()
+{
+	memset(m_meshes, 0, sizeof(m_meshes));
+}
+
+/***********************************************************
+ *  ~DetailMeshes()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DetailMeshes::~DetailMeshes()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for generating every level of the
+ *  mesh types with more than one level of detail and
+ *  creating a vertex array for each.
+ ***********************************************************/
+bool DetailMeshes::Create()
+{
+	Destroy();
+
+	std::vector<MeshGeometry::MESH_VERTEX> vertices;
+	std::vector<uint32_t> indices;
+	int meshCount = 0;
+
+	for (int meshType = 0; meshType < SceneFile::MESH_TYPE_COUNT; meshType++)
+	{
+		const int levelCount = MeshGeometry::GetLevelCount((SceneFile::MESH_TYPE)meshType);
+		if (levelCount <= 1)
+		{
+			continue;
+		}
+
+		for (int level = 0; level < levelCount; level++)
+		{
+			MeshGeometry::Build((SceneFile::MESH_TYPE)meshType, vertices, indices, level);
+
+			MESH_BUFFERS& mesh = m_meshes[meshType][level];
+			mesh.indexCount = (GLsizei)indices.size();
+
+			glGenVertexArrays(1, &mesh.vertexArrayID);
+			glBindVertexArray(mesh.vertexArrayID);
+
+			glGenBuffers(1, &mesh.vertexBufferID);
+			glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBufferID);
+			glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(MeshGeometry::MESH_VERTEX), vertices.data(), GL_STATIC_DRAW);
+			InstancedMeshes::EnableVertexAttributes();
+
+			glGenBuffers(1, &mesh.indexBufferID);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBufferID);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+
+			glBindVertexArray(0);
+			meshCount++;
+		}
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	std::cout << "Created " << meshCount << " level of detail meshes" << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for deleting the vertex arrays and
+ *  buffers of every level.
+ ***********************************************************/
+void DetailMeshes::Destroy()
+{
+	for (int meshType = 0; meshType < SceneFile::MESH_TYPE_COUNT; meshType++)
+	{
+		for (int level = 0; level < MeshGeometry::LEVEL_COUNT; level++)
+		{
+			MESH_BUFFERS& mesh = m_meshes[meshType][level];
+			if (mesh.vertexArrayID != 0)
+			{
+				glDeleteVertexArrays(1, &mesh.vertexArrayID);
+				glDeleteBuffers(1, &mesh.vertexBufferID);
+				glDeleteBuffers(1, &mesh.indexBufferID);
+			}
+		}
+	}
+	memset(m_meshes, 0, sizeof(m_meshes));
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method is used for drawing one copy of a mesh type
+ *  at a level of detail.
+ ***********************************************************/
+bool DetailMeshes::Draw(SceneFile::MESH_TYPE meshType, int level)
+{
+	if ((meshType < 0) || (meshType >= SceneFile::MESH_TYPE_COUNT) ||
+		(level < 0) || (level >= MeshGeometry::LEVEL_COUNT))
+	{
+		return(false);
+	}
+
+	const MESH_BUFFERS& mesh = m_meshes[meshType][level];
+	if (mesh.vertexArrayID == 0)
+	{
+		return(false);
+	}
+
+	glBindVertexArray(mesh.vertexArrayID);
+	glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0);
+	glBindVertexArray(0);
+	return(true);
+}
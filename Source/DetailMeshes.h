@@ -0,0 +1,56 @@
+///////////////////////////////////////////////////////////////////////////////
+// detailmeshes.h
+// ============
+// draw the curved basic meshes at each of their levels of detail
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshGeometry.h"
+#include "SceneFile.h"
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  DetailMeshes
+ *
+ *  This class keeps a vertex array for every level of
+ *  detail of the mesh types that have more than one, built
+ *  once from MeshGeometry.  The single draws of the scene
+ *  use it in place of the one tessellation of ShapeMeshes,
+ *  with the model matrix and material already set as
+ *  uniforms.
+ ***********************************************************/
+class DetailMeshes
+{
+public:
+	// constructor
+	DetailMeshes();
+	// destructor
+	~DetailMeshes();
+
+	// create the vertex arrays and buffers of every level
+	bool Create();
+	// delete the vertex arrays and buffers
+	void Destroy();
+
+	// draw a mesh type at a level, returning false when it has no
+	// vertex array
+	bool Draw(SceneFile::MESH_TYPE meshType, int level);
+
+private:
+	// detail meshes cannot be copied
+	DetailMeshes(const DetailMeshes&);
+	DetailMeshes& operator=(const DetailMeshes&);
+
+	struct MESH_BUFFERS
+	{
+		GLuint vertexArrayID;
+		GLuint vertexBufferID;
+		GLuint indexBufferID;
+		GLsizei indexCount;
+	};
+
+	MESH_BUFFERS m_meshes[SceneFile::MESH_TYPE_COUNT][MeshGeometry::LEVEL_COUNT];
+};
@@ -0,0 +1,612 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.cpp
+// ============
+// read rendered frames back through a ring of pixel buffer objects and
+// encode them to disk on worker threads
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameCapture.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// how long to wait on a fence before checking it again
+	const GLuint64 g_FenceTimeoutNanoseconds = 1000000;
+	// frames each worker may have queued before capturing waits
+	const int g_QueuedFramesPerWorker = 2;
+	// largest block of stored data in a deflate stream
+	const size_t g_MaxStoredBlock = 65535;
+
+	// get the elapsed milliseconds since the passed in time
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	// table of the CRC-32 of every byte value, built once on first use
+	struct CRC_TABLE
+	{
+		uint32_t values[256];
+
+		CRC_TABLE()
+		{
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t value = i;
+				for (int bit = 0; bit < 8; bit++)
+				{
+					value = (value & 1) ? (0xEDB88320u ^ (value >> 1)) : (value >> 1);
+				}
+				values[i] = value;
+			}
+		}
+	};
+
+	// get the CRC-32 of a PNG chunk
+	uint32_t GetCrc(const unsigned char* pData, size_t size)
+	{
+		static const CRC_TABLE table;
+		uint32_t crc = 0xFFFFFFFFu;
+		for (size_t i = 0; i < size; i++)
+		{
+			crc = table.values[(crc ^ pData[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return(~crc);
+	}
+
+	// get the Adler-32 of a zlib stream, taking the modulo only as
+	// often as the sums could overflow
+	uint32_t GetAdler(const unsigned char* pData, size_t size)
+	{
+		const size_t maxRun = 5552;
+		uint32_t a = 1;
+		uint32_t b = 0;
+		while (size > 0)
+		{
+			size_t run = std::min(size, maxRun);
+			for (size_t i = 0; i < run; i++)
+			{
+				a += pData[i];
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+			pData += run;
+			size -= run;
+		}
+		return((b << 16) | a);
+	}
+
+	// append a 32 bit big endian value
+	void AppendBigEndian(std::vector<unsigned char>& output, uint32_t value)
+	{
+		output.push_back((unsigned char)(value >> 24));
+		output.push_back((unsigned char)(value >> 16));
+		output.push_back((unsigned char)(value >> 8));
+		output.push_back((unsigned char)value);
+	}
+
+	// start a PNG chunk of the passed in type, its length filled
+	// in by CloseChunk
+	size_t OpenChunk(std::vector<unsigned char>& output, const char* type)
+	{
+		size_t chunkStart = output.size();
+		AppendBigEndian(output, 0);
+		output.insert(output.end(), type, type + 4);
+		return(chunkStart);
+	}
+
+	// fill in the length of the chunk started at chunkStart and
+	// append its CRC
+	void CloseChunk(std::vector<unsigned char>& output, size_t chunkStart)
+	{
+		uint32_t dataSize = (uint32_t)(output.size() - chunkStart - 8);
+		output[chunkStart + 0] = (unsigned char)(dataSize >> 24);
+		output[chunkStart + 1] = (unsigned char)(dataSize >> 16);
+		output[chunkStart + 2] = (unsigned char)(dataSize >> 8);
+		output[chunkStart + 3] = (unsigned char)dataSize;
+		AppendBigEndian(output, GetCrc(&output[chunkStart + 4], dataSize + 4));
+	}
+
+	/***********************************************************
+	 *  BuildPng()
+	 *
+	 *  Builds an 8 bit RGB PNG of a frame whose RGBA rows run
+	 *  from the bottom.  The scanlines are not filtered and
+	 *  are kept in stored deflate blocks, which costs file
+	 *  size but makes encoding little more than a copy, so a
+	 *  worker keeps up with the render loop.
+	 ***********************************************************/
+	void BuildPng(const unsigned char* pPixels, int width, int height,
+		std::vector<unsigned char>& scanlines, std::vector<unsigned char>& output)
+	{
+		// each scanline starts with its filter type, then the
+		// color of each pixel without its alpha
+		const size_t rowBytes = (size_t)width * 3 + 1;
+		scanlines.resize(rowBytes * height);
+		for (int y = 0; y < height; y++)
+		{
+			const unsigned char* pSource = pPixels + (size_t)(height - 1 - y) * width * 4;
+			unsigned char* pRow = &scanlines[y * rowBytes];
+			pRow[0] = 0;
+			for (int x = 0; x < width; x++)
+			{
+				pRow[1 + x * 3 + 0] = pSource[x * 4 + 0];
+				pRow[1 + x * 3 + 1] = pSource[x * 4 + 1];
+				pRow[1 + x * 3 + 2] = pSource[x * 4 + 2];
+			}
+		}
+
+		output.clear();
+		output.reserve(scanlines.size() + (scanlines.size() / g_MaxStoredBlock + 1) * 5 + 64);
+		const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		output.insert(output.end(), signature, signature + 8);
+
+		size_t chunkStart = OpenChunk(output, "IHDR");
+		AppendBigEndian(output, (uint32_t)width);
+		AppendBigEndian(output, (uint32_t)height);
+		// 8 bits per channel, RGB, deflate, no filtering, no interlace
+		const unsigned char header[5] = { 8, 2, 0, 0, 0 };
+		output.insert(output.end(), header, header + 5);
+		CloseChunk(output, chunkStart);
+
+		chunkStart = OpenChunk(output, "IDAT");
+		// zlib header for a deflate stream with the smallest window
+		output.push_back(0x78);
+		output.push_back(0x01);
+		size_t offset = 0;
+		while (offset < scanlines.size())
+		{
+			size_t blockSize = std::min(scanlines.size() - offset, g_MaxStoredBlock);
+			output.push_back((offset + blockSize == scanlines.size()) ? 1 : 0);
+			output.push_back((unsigned char)blockSize);
+			output.push_back((unsigned char)(blockSize >> 8));
+			output.push_back((unsigned char)~blockSize);
+			output.push_back((unsigned char)(~blockSize >> 8));
+			output.insert(output.end(), scanlines.begin() + offset, scanlines.begin() + offset + blockSize);
+			offset += blockSize;
+		}
+		AppendBigEndian(output, GetAdler(scanlines.data(), scanlines.size()));
+		CloseChunk(output, chunkStart);
+
+		chunkStart = OpenChunk(output, "IEND");
+		CloseChunk(output, chunkStart);
+	}
+}
+
+/***********************************************************
+ *  FrameCapture()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameCapture::FrameCapture(int pixelBufferCount, int workerCount)
+{
+	m_workerCount = workerCount;
+	if (m_workerCount < 0)
+	{
+		m_workerCount = (int)std::thread::hardware_concurrency() / 2;
+	}
+	if (m_workerCount <= 0)
+	{
+		m_workerCount = 1;
+	}
+	m_format = FORMAT_PNG;
+	m_pixelBuffers.resize(std::max(pixelBufferCount, 1));
+	for (size_t i = 0; i < m_pixelBuffers.size(); i++)
+	{
+		m_pixelBuffers[i].bufferID = 0;
+		m_pixelBuffers[i].capacity = 0;
+		m_pixelBuffers[i].fence = 0;
+		m_pixelBuffers[i].width = 0;
+		m_pixelBuffers[i].height = 0;
+		m_pixelBuffers[i].frameIndex = -1;
+	}
+	m_nextPixelBuffer = 0;
+	m_frameCount = 0;
+	m_busyFrames = 0;
+	m_bStopping = false;
+	m_pRawFile = NULL;
+	m_rawWidth = 0;
+	m_rawHeight = 0;
+	m_lastCaptureMilliseconds = 0.0;
+	m_captureMilliseconds = 0.0;
+	m_fenceWaitCount = 0;
+	m_encoderWaitCount = 0;
+	m_writtenFrames = 0;
+	m_droppedFrames = 0;
+	m_encodeMilliseconds = 0.0;
+	m_writtenBytes = 0;
+}
+
+/***********************************************************
+ *  ~FrameCapture()
+ *
+ *  The destructor for the class - the OpenGL context must
+ *  still be current
+ ***********************************************************/
+FrameCapture::~FrameCapture()
+{
+	Finish();
+}
+
+/***********************************************************
+ *  Begin()
+ *
+ *  This method is used for creating the pixel buffers and
+ *  starting the workers.  PNG frames are written one file
+ *  each, and a raw stream goes into capture.rgba.
+ ***********************************************************/
+bool FrameCapture::Begin(const char* directory, CAPTURE_FORMAT format)
+{
+	if (IsCapturing() == true)
+	{
+		return(false);
+	}
+
+	m_directory = directory;
+	m_format = format;
+	std::error_code error;
+	std::filesystem::create_directories(m_directory, error);
+
+	int workerCount = m_workerCount;
+	if (m_format == FORMAT_RAW)
+	{
+		std::string rawFilename = m_directory + "/capture.rgba";
+		m_pRawFile = fopen(rawFilename.c_str(), "wb");
+		if (NULL == m_pRawFile)
+		{
+			std::cout << "Could not write frame capture:" << rawFilename << std::endl;
+			return(false);
+		}
+		workerCount = 1;
+	}
+
+	for (size_t i = 0; i < m_pixelBuffers.size(); i++)
+	{
+		glGenBuffers(1, &m_pixelBuffers[i].bufferID);
+	}
+
+	m_bStopping = false;
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&FrameCapture::EncodeWorker, this));
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  CaptureFrame()
+ *
+ *  This method is used for starting the readback of a frame.
+ *  The readbacks that finished since the last frame are
+ *  handed on first, oldest first so a raw stream stays in
+ *  order, then glReadPixels copies the frame into the next
+ *  buffer of the ring and returns without waiting for it.
+ *  Only when that buffer still holds a readback in flight
+ *  does the render thread wait for it.
+ ***********************************************************/
+void FrameCapture::CaptureFrame(int width, int height)
+{
+	if ((IsCapturing() == false) || (width <= 0) || (height <= 0))
+	{
+		return;
+	}
+
+	PROFILE_SCOPE("CaptureFrame");
+
+	Clock::time_point captureStart = Clock::now();
+	const int bufferCount = (int)m_pixelBuffers.size();
+	for (int i = 0; i < bufferCount; i++)
+	{
+		PIXEL_BUFFER& pixelBuffer = m_pixelBuffers[(m_nextPixelBuffer + i) % bufferCount];
+		if (0 == pixelBuffer.fence)
+		{
+			continue;
+		}
+		GLenum status = glClientWaitSync(pixelBuffer.fence, 0, 0);
+		if ((status != GL_ALREADY_SIGNALED) && (status != GL_CONDITION_SATISFIED))
+		{
+			break;
+		}
+		RetireReadback(pixelBuffer, false);
+	}
+
+	PIXEL_BUFFER& pixelBuffer = m_pixelBuffers[m_nextPixelBuffer];
+	if (0 != pixelBuffer.fence)
+	{
+		m_fenceWaitCount++;
+		RetireReadback(pixelBuffer, true);
+	}
+
+	size_t byteCount = (size_t)width * height * 4;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffer.bufferID);
+	if (pixelBuffer.capacity < byteCount)
+	{
+		glBufferData(GL_PIXEL_PACK_BUFFER, byteCount, NULL, GL_STREAM_READ);
+		pixelBuffer.capacity = byteCount;
+	}
+
+	// with a pixel pack buffer bound the pixel pointer is a buffer offset
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+	pixelBuffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	pixelBuffer.width = width;
+	pixelBuffer.height = height;
+	pixelBuffer.frameIndex = m_frameCount++;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_nextPixelBuffer = (m_nextPixelBuffer + 1) % bufferCount;
+	m_lastCaptureMilliseconds = MillisecondsSince(captureStart);
+	m_captureMilliseconds += m_lastCaptureMilliseconds;
+}
+
+/***********************************************************
+ *  RetireReadback()
+ *
+ *  This method is used for handing a finished readback to
+ *  the workers.  A frame is taken from the pool, waiting
+ *  while the workers hold as many as they may, and the
+ *  mapped buffer is copied into it so the buffer can be
+ *  reused at once.
+ ***********************************************************/
+void FrameCapture::RetireReadback(PIXEL_BUFFER& pixelBuffer, bool bWait)
+{
+	if (bWait == true)
+	{
+		GLenum result = glClientWaitSync(pixelBuffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT, g_FenceTimeoutNanoseconds);
+		while (result == GL_TIMEOUT_EXPIRED)
+		{
+			result = glClientWaitSync(pixelBuffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT, g_FenceTimeoutNanoseconds);
+		}
+	}
+	glDeleteSync(pixelBuffer.fence);
+	pixelBuffer.fence = 0;
+
+	CAPTURED_FRAME frame;
+	frame.width = pixelBuffer.width;
+	frame.height = pixelBuffer.height;
+	frame.frameIndex = pixelBuffer.frameIndex;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		const int frameLimit = (int)m_workers.size() * g_QueuedFramesPerWorker;
+		if ((int)m_pendingFrames.size() + m_busyFrames >= frameLimit)
+		{
+			m_encoderWaitCount++;
+			m_doneCondition.wait(lock, [this, frameLimit]()
+				{
+					return (int)m_pendingFrames.size() + m_busyFrames < frameLimit;
+				});
+		}
+		if (m_freeFrames.empty() == true)
+		{
+			frame.pPixels = new std::vector<unsigned char>();
+		}
+		else
+		{
+			frame.pPixels = m_freeFrames.back();
+			m_freeFrames.pop_back();
+		}
+	}
+
+	size_t byteCount = (size_t)frame.width * frame.height * 4;
+	frame.pPixels->resize(byteCount);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffer.bufferID);
+	const void* pMapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, byteCount, GL_MAP_READ_BIT);
+	if (NULL != pMapped)
+	{
+		memcpy(frame.pPixels->data(), pMapped, byteCount);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (NULL != pMapped)
+		{
+			m_pendingFrames.push_back(frame);
+		}
+		else
+		{
+			m_freeFrames.push_back(frame.pPixels);
+			m_droppedFrames++;
+		}
+	}
+	m_frameCondition.notify_one();
+}
+
+/***********************************************************
+ *  Finish()
+ *
+ *  This method is used for handing on the readbacks still
+ *  in flight, letting the workers write every queued frame
+ *  and releasing the buffers.
+ ***********************************************************/
+void FrameCapture::Finish()
+{
+	if (IsCapturing() == true)
+	{
+		const int bufferCount = (int)m_pixelBuffers.size();
+		for (int i = 0; i < bufferCount; i++)
+		{
+			PIXEL_BUFFER& pixelBuffer = m_pixelBuffers[(m_nextPixelBuffer + i) % bufferCount];
+			if (0 != pixelBuffer.fence)
+			{
+				RetireReadback(pixelBuffer, true);
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_bStopping = true;
+		}
+		m_frameCondition.notify_all();
+		for (size_t i = 0; i < m_workers.size(); i++)
+		{
+			m_workers[i].join();
+		}
+		m_workers.clear();
+	}
+
+	for (size_t i = 0; i < m_pixelBuffers.size(); i++)
+	{
+		if (0 != m_pixelBuffers[i].bufferID)
+		{
+			glDeleteBuffers(1, &m_pixelBuffers[i].bufferID);
+			m_pixelBuffers[i].bufferID = 0;
+			m_pixelBuffers[i].capacity = 0;
+		}
+	}
+	for (size_t i = 0; i < m_freeFrames.size(); i++)
+	{
+		delete m_freeFrames[i];
+	}
+	m_freeFrames.clear();
+
+	if (NULL != m_pRawFile)
+	{
+		fclose(m_pRawFile);
+		m_pRawFile = NULL;
+	}
+}
+
+/***********************************************************
+ *  EncodeWorker()
+ *
+ *  This method runs on each worker thread, writing the next
+ *  queued frame and returning it to the pool, until the
+ *  capture is finished and the queue is empty.
+ ***********************************************************/
+void FrameCapture::EncodeWorker()
+{
+	PROFILE_THREAD_NAME("Frame encoder");
+
+	std::vector<unsigned char> scanlines;
+	std::vector<unsigned char> encoded;
+	while (true)
+	{
+		CAPTURED_FRAME frame;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_frameCondition.wait(lock, [this]()
+				{
+					return m_bStopping || (m_pendingFrames.empty() == false);
+				});
+			if (m_pendingFrames.empty() == true)
+			{
+				return;
+			}
+			frame = m_pendingFrames.front();
+			m_pendingFrames.pop_front();
+			m_busyFrames++;
+		}
+
+		Clock::time_point encodeStart = Clock::now();
+		size_t byteCount = EncodeFrame(frame, scanlines, encoded);
+		double encodeMilliseconds = MillisecondsSince(encodeStart);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_busyFrames--;
+			m_freeFrames.push_back(frame.pPixels);
+			m_encodeMilliseconds += encodeMilliseconds;
+			if (byteCount > 0)
+			{
+				m_writtenFrames++;
+				m_writtenBytes += byteCount;
+			}
+			else
+			{
+				m_droppedFrames++;
+			}
+		}
+		m_doneCondition.notify_all();
+	}
+}
+
+/***********************************************************
+ *  EncodeFrame()
+ *
+ *  This method is used for writing one frame.  A raw stream
+ *  takes the frames top row first at the size of its first
+ *  frame, and frames of another size are dropped from it.
+ ***********************************************************/
+size_t FrameCapture::EncodeFrame(const CAPTURED_FRAME& frame, std::vector<unsigned char>& scanlines, std::vector<unsigned char>& encoded)
+{
+	PROFILE_SCOPE("EncodeFrame");
+
+	const unsigned char* pPixels = frame.pPixels->data();
+	if (m_format == FORMAT_RAW)
+	{
+		if (m_rawWidth == 0)
+		{
+			m_rawWidth = frame.width;
+			m_rawHeight = frame.height;
+		}
+		if ((frame.width != m_rawWidth) || (frame.height != m_rawHeight))
+		{
+			return(0);
+		}
+
+		const size_t rowBytes = (size_t)frame.width * 4;
+		for (int y = frame.height - 1; y >= 0; y--)
+		{
+			fwrite(pPixels + y * rowBytes, 1, rowBytes, m_pRawFile);
+		}
+		return((ferror(m_pRawFile) == 0) ? rowBytes * frame.height : 0);
+	}
+
+	BuildPng(pPixels, frame.width, frame.height, scanlines, encoded);
+	char name[32];
+	snprintf(name, sizeof(name), "/frame_%05d.png", frame.frameIndex);
+	std::string filename = m_directory + name;
+	FILE* pFile = fopen(filename.c_str(), "wb");
+	if (NULL == pFile)
+	{
+		return(0);
+	}
+	fwrite(encoded.data(), 1, encoded.size(), pFile);
+	bool bWritten = (ferror(pFile) == 0);
+	fclose(pFile);
+	return(bWritten ? encoded.size() : 0);
+}
+
+/***********************************************************
+ *  PrintStatistics()
+ *
+ *  This method is used for reporting the frames written and
+ *  what capturing them cost the render thread and the
+ *  workers.
+ ***********************************************************/
+void FrameCapture::PrintStatistics() const
+{
+	if (m_frameCount == 0)
+	{
+		return;
+	}
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< "Frame capture: " << m_writtenFrames << " of " << m_frameCount << " frames written as "
+		<< ((m_format == FORMAT_RAW) ? "raw RGBA" : "PNG") << " into " << m_directory << ", "
+		<< (m_writtenBytes / (1024.0 * 1024.0)) << " MB" << std::endl;
+	std::cout << "  render thread " << (m_captureMilliseconds / m_frameCount) << " ms per frame, "
+		<< m_fenceWaitCount << " waits for readbacks, " << m_encoderWaitCount << " waits for encoders" << std::endl;
+	std::cout << "  encoding " << (m_encodeMilliseconds / m_frameCount) << " ms per frame on "
+		<< ((m_format == FORMAT_RAW) ? 1 : m_workerCount) << " workers, "
+		<< m_droppedFrames << " frames dropped" << std::endl;
+	if ((m_format == FORMAT_RAW) && (m_rawWidth > 0))
+	{
+		std::cout << "  raw stream is rgba " << m_rawWidth << "x" << m_rawHeight << ", top row first" << std::endl;
+	}
+}
@@ -0,0 +1,130 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.h
+// ============
+// read rendered frames back through a ring of pixel buffer objects and
+// encode them to disk on worker threads
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  FrameCapture
+ *
+ *  This class captures frames without stalling the render
+ *  loop.  Each captured frame is read from the bound read
+ *  framebuffer into the next pixel pack buffer of a ring,
+ *  which returns at once, and a fence marks when the copy
+ *  is done.  Buffers whose fence has passed are mapped a
+ *  few frames later, copied into a frame from a pool and
+ *  handed to worker threads that flip the rows and write
+ *  each frame as a PNG, or append it to one raw RGBA video
+ *  stream.  The render thread only waits when the ring or
+ *  the encoders fall behind, and those waits are counted.
+ ***********************************************************/
+class FrameCapture
+{
+public:
+	enum CAPTURE_FORMAT
+	{
+		FORMAT_PNG,
+		FORMAT_RAW
+	};
+
+	// constructor - a negative worker count means half the CPU cores
+	FrameCapture(int pixelBufferCount = 3, int workerCount = -1);
+	// destructor
+	~FrameCapture();
+
+	// start writing frames into the directory - a raw stream is
+	// written by one worker so its frames stay in order
+	bool Begin(const char* directory, CAPTURE_FORMAT format);
+	// read the bound read framebuffer into the ring - call after
+	// drawing and before swapping
+	void CaptureFrame(int width, int height);
+	// wait for every captured frame to be written and stop the workers
+	void Finish();
+
+	bool IsCapturing() const { return(m_workers.empty() == false); }
+	// get the render thread time of the last CaptureFrame
+	double GetLastCaptureMilliseconds() const { return m_lastCaptureMilliseconds; }
+	// print the frames written and the cost of capturing them
+	void PrintStatistics() const;
+
+private:
+	struct PIXEL_BUFFER
+	{
+		GLuint bufferID;
+		size_t capacity;
+		// fence of the readback in flight, or zero when free
+		GLsync fence;
+		int width;
+		int height;
+		int frameIndex;
+	};
+
+	struct CAPTURED_FRAME
+	{
+		// pixels with rows from the bottom, from the frame pool
+		std::vector<unsigned char>* pPixels;
+		int width;
+		int height;
+		int frameIndex;
+	};
+
+	int m_workerCount;
+	CAPTURE_FORMAT m_format;
+	std::string m_directory;
+	// ring of pixel pack buffers and the next one to read into
+	std::vector<PIXEL_BUFFER> m_pixelBuffers;
+	int m_nextPixelBuffer;
+	int m_frameCount;
+
+	// worker threads and the state they share with the render thread
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_frameCondition;
+	std::condition_variable m_doneCondition;
+	std::deque<CAPTURED_FRAME> m_pendingFrames;
+	std::vector<std::vector<unsigned char>*> m_freeFrames;
+	// frames handed to the workers and not yet written
+	int m_busyFrames;
+	bool m_bStopping;
+	// raw stream and the size of its frames
+	FILE* m_pRawFile;
+	int m_rawWidth;
+	int m_rawHeight;
+
+	// statistics, the encoding ones guarded by the mutex
+	double m_lastCaptureMilliseconds;
+	double m_captureMilliseconds;
+	int m_fenceWaitCount;
+	int m_encoderWaitCount;
+	int m_writtenFrames;
+	int m_droppedFrames;
+	double m_encodeMilliseconds;
+	unsigned long long m_writtenBytes;
+
+	// map the buffer, whose readback has finished or is waited on,
+	// and queue its pixels for the workers
+	void RetireReadback(PIXEL_BUFFER& pixelBuffer, bool bWait);
+	// write queued frames until the capture is finished
+	void EncodeWorker();
+	// write one frame in the capture format, returning the bytes -
+	// the vectors are the worker's, reused from frame to frame
+	size_t EncodeFrame(const CAPTURED_FRAME& frame, std::vector<unsigned char>& scanlines, std::vector<unsigned char>& encoded);
+
+	// frame captures cannot be copied
+	FrameCapture(const FrameCapture&);
+	FrameCapture& operator=(const FrameCapture&);
+};
@@ -0,0 +1,196 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepacer.cpp
+// ============
+// decide when the render loop draws a frame, and wait for events while
+// nothing changes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FramePacer.h"
+
+#include "GLFW/glfw3.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <iomanip>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// longest wait for an event, so the loop still looks at the
+	// window now and then when no event arrives
+	const double g_IdleWaitSeconds = 0.5;
+
+	/***********************************************************
+	 *  GetProcessCpuSeconds()
+	 *
+	 *  Gets the user and kernel time used by every thread of
+	 *  the process so far.
+	 ***********************************************************/
+	double GetProcessCpuSeconds()
+	{
+#ifdef _WIN32
+		FILETIME creationTime;
+		FILETIME exitTime;
+		FILETIME kernelTime;
+		FILETIME userTime;
+		if (GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime) == 0)
+		{
+			return(0.0);
+		}
+		ULARGE_INTEGER kernel;
+		ULARGE_INTEGER user;
+		kernel.LowPart = kernelTime.dwLowDateTime;
+		kernel.HighPart = kernelTime.dwHighDateTime;
+		user.LowPart = userTime.dwLowDateTime;
+		user.HighPart = userTime.dwHighDateTime;
+		// the times are in 100 nanosecond units
+		return((double)(kernel.QuadPart + user.QuadPart) * 1.0e-7);
+#else
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0)
+		{
+			return(0.0);
+		}
+		return((double)usage.ru_utime.tv_sec + (double)usage.ru_utime.tv_usec * 1.0e-6 +
+			(double)usage.ru_stime.tv_sec + (double)usage.ru_stime.tv_usec * 1.0e-6);
+#endif
+	}
+}
+
+/***********************************************************
+ *  FramePacer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FramePacer::FramePacer()
+{
+	m_bOnDemand = false;
+	// the first pass always draws
+	m_bRedrawRequested = true;
+	m_bDrawing = false;
+	m_passCount = 0;
+	m_drawnFrames = 0;
+	m_waitCount = 0;
+	m_startSeconds = glfwGetTime();
+	m_startCpuSeconds = GetProcessCpuSeconds();
+	m_passSeconds = m_startSeconds;
+	m_passCpuSeconds = m_startCpuSeconds;
+	m_idleSeconds = 0.0;
+	m_idleCpuSeconds = 0.0;
+}
+
+/***********************************************************
+ *  SetOnDemandMode()
+ *
+ *  This method is used for choosing whether frames are only
+ *  drawn when something asked for a redraw.
+ ***********************************************************/
+void FramePacer::SetOnDemandMode(bool bEnable)
+{
+	m_bOnDemand = bEnable;
+	m_bRedrawRequested = true;
+}
+
+/***********************************************************
+ *  RequestRedraw()
+ *
+ *  This method is used for asking for a frame to be drawn
+ *  by the next pass of the loop.
+ ***********************************************************/
+void FramePacer::RequestRedraw()
+{
+	m_bRedrawRequested = true;
+}
+
+/***********************************************************
+ *  BeginPass()
+ *
+ *  This method is used for starting a pass of the loop and
+ *  deciding whether it draws.  The time since the start of
+ *  the last pass is counted as idle when that pass drew
+ *  nothing, which takes in the wait that ended it.
+ ***********************************************************/
+bool FramePacer::BeginPass()
+{
+	double seconds = glfwGetTime();
+	double cpuSeconds = GetProcessCpuSeconds();
+	if ((m_passCount > 0) && (m_bDrawing == false))
+	{
+		m_idleSeconds += seconds - m_passSeconds;
+		m_idleCpuSeconds += cpuSeconds - m_passCpuSeconds;
+	}
+	m_passSeconds = seconds;
+	m_passCpuSeconds = cpuSeconds;
+	m_passCount++;
+
+	m_bDrawing = (m_bOnDemand == false) || (m_bRedrawRequested == true);
+	m_bRedrawRequested = false;
+	if (m_bDrawing == true)
+	{
+		m_drawnFrames++;
+	}
+	return(m_bDrawing);
+}
+
+/***********************************************************
+ *  WaitForEvents()
+ *
+ *  This method is used for handling the window events at
+ *  the end of a pass.  A pass that drew keeps the loop
+ *  running, since whatever changed may still be changing,
+ *  while a pass that drew nothing sleeps until an event
+ *  arrives or the idle wait runs out.
+ ***********************************************************/
+bool FramePacer::WaitForEvents()
+{
+	if ((m_bOnDemand == false) || (m_bDrawing == true) || (m_bRedrawRequested == true))
+	{
+		glfwPollEvents();
+		return(false);
+	}
+
+	glfwWaitEventsTimeout(g_IdleWaitSeconds);
+	m_waitCount++;
+	return(true);
+}
+
+/***********************************************************
+ *  PrintStatistics()
+ *
+ *  This method is used for printing how many passes of the
+ *  loop drew a frame, and the share of a core the process
+ *  used overall and while it was idle.
+ ***********************************************************/
+void FramePacer::PrintStatistics() const
+{
+	double seconds = glfwGetTime() - m_startSeconds;
+	double cpuSeconds = GetProcessCpuSeconds() - m_startCpuSeconds;
+	if ((m_passCount == 0) || (seconds <= 0.0))
+	{
+		return;
+	}
+
+	std::cout << std::fixed << std::setprecision(1)
+		<< (m_bOnDemand ? "On-demand" : "Continuous") << " rendering over " << seconds << " s: "
+		<< m_drawnFrames << " frames drawn in " << m_passCount << " passes, "
+		<< m_waitCount << " waits for events, "
+		<< (100.0 * cpuSeconds / seconds) << "% CPU";
+	if (m_idleSeconds > 0.0)
+	{
+		std::cout << ", " << (100.0 * m_idleCpuSeconds / m_idleSeconds) << "% CPU over "
+			<< m_idleSeconds << " s idle";
+	}
+	std::cout << std::endl;
+}
@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepacer.h
+// ============
+// decide when the render loop draws a frame, and wait for events while
+// nothing changes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/***********************************************************
+ *  FramePacer
+ *
+ *  This class paces the render loop.  In continuous mode
+ *  every pass of the loop draws a frame, as fast as the
+ *  swap allows.  In on-demand mode a pass only draws when
+ *  something asked for a redraw, such as the camera moving,
+ *  the window being exposed or the scene changing, and a
+ *  pass that drew nothing blocks in glfwWaitEventsTimeout
+ *  until the next event, leaving the last frame on screen.
+ *  The passes, frames drawn and the CPU time used overall
+ *  and while idle are kept for the statistics.
+ ***********************************************************/
+class FramePacer
+{
+public:
+	// constructor
+	FramePacer();
+
+	// choose whether frames are only drawn when something changed
+	void SetOnDemandMode(bool bEnable);
+	bool IsOnDemandMode() const { return m_bOnDemand; }
+
+	// ask for the next pass of the loop to draw a frame
+	void RequestRedraw();
+	// start a pass of the loop, returning true when it draws a frame
+	bool BeginPass();
+	// end the pass by polling the events, or by waiting for one when
+	// the pass drew nothing - returns true when it waited
+	bool WaitForEvents();
+
+	// get the number of frames drawn so far
+	long long GetDrawnFrameCount() const { return m_drawnFrames; }
+	// print the frames drawn and skipped and the CPU time used
+	void PrintStatistics() const;
+
+private:
+	bool m_bOnDemand;
+	bool m_bRedrawRequested;
+	// true when the current pass draws a frame
+	bool m_bDrawing;
+
+	long long m_passCount;
+	long long m_drawnFrames;
+	long long m_waitCount;
+	// wall and process CPU time at the start and at the current pass
+	double m_startSeconds;
+	double m_startCpuSeconds;
+	double m_passSeconds;
+	double m_passCpuSeconds;
+	// wall and CPU time of the passes that drew nothing
+	double m_idleSeconds;
+	double m_idleCpuSeconds;
+};
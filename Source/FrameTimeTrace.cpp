@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////
+// frametimetrace.cpp
+// ============
+// record the time of every frame and write it out for comparison
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameTimeTrace.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+/***********************************************************
+ *  FrameTimeTrace()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameTimeTrace::FrameTimeTrace(const char* label)
+{
+	m_label = label;
+}
+
+/***********************************************************
+ *  AddFrame()
+ *
+ *  This method is used for recording the duration of one
+ *  frame and the value that goes with it.
+ ***********************************************************/
+void FrameTimeTrace::AddFrame(double frameMilliseconds, int value)
+{
+	FRAME_SAMPLE sample;
+	sample.frameMilliseconds = frameMilliseconds;
+	sample.value = value;
+	m_frames.push_back(sample);
+}
+
+/***********************************************************
+ *  WriteCSV()
+ *
+ *  This method is used for writing one line per recorded
+ *  frame into the passed in file.
+ ***********************************************************/
+bool FrameTimeTrace::WriteCSV(const char* filename) const
+{
+	std::ofstream file(filename);
+	if (!file)
+	{
+		std::cout << "Could not write frame time trace:" << filename << std::endl;
+		return(false);
+	}
+
+	file << "frame,milliseconds,value" << std::endl;
+	for (size_t i = 0; i < m_frames.size(); i++)
+	{
+		file << i << "," << m_frames[i].frameMilliseconds << "," << m_frames[i].value << std::endl;
+	}
+
+	std::cout << "Wrote frame time trace:" << filename << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  PrintSummary()
+ *
+ *  This method is used for reporting the average, 99th
+ *  percentile and worst of the recorded frame times.
+ ***********************************************************/
+void FrameTimeTrace::PrintSummary() const
+{
+	if (m_frames.empty() == true)
+	{
+		return;
+	}
+
+	std::vector<double> sorted;
+	double total = 0.0;
+	for (size_t i = 0; i < m_frames.size(); i++)
+	{
+		sorted.push_back(m_frames[i].frameMilliseconds);
+		total += m_frames[i].frameMilliseconds;
+	}
+	std::sort(sorted.begin(), sorted.end());
+
+	size_t percentile = (sorted.size() * 99) / 100;
+	if (percentile >= sorted.size())
+	{
+		percentile = sorted.size() - 1;
+	}
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< m_label << ": " << m_frames.size() << " frames, average " << total / m_frames.size()
+		<< " ms, 99th percentile " << sorted[percentile] << " ms, worst " << sorted.back() << " ms" << std::endl;
+}
@@ -0,0 +1,47 @@
+///////////////////////////////////////////////////////////////////////////////
+// frametimetrace.h
+// ============
+// record the time of every frame and write it out for comparison
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  FrameTimeTrace
+ *
+ *  This class records the duration of each rendered frame
+ *  together with a caller supplied value, such as the number
+ *  of textures still streaming, and reports the average and
+ *  worst frame times or writes the trace as CSV.
+ ***********************************************************/
+class FrameTimeTrace
+{
+public:
+	// constructor
+	FrameTimeTrace(const char* label);
+
+	// record one frame
+	void AddFrame(double frameMilliseconds, int value);
+	// get the number of recorded frames
+	int GetFrameCount() const { return (int)m_frames.size(); }
+	// write the recorded frames into a CSV file
+	bool WriteCSV(const char* filename) const;
+	// print the average, 99th percentile and worst frame times
+	void PrintSummary() const;
+
+private:
+	struct FRAME_SAMPLE
+	{
+		double frameMilliseconds;
+		int value;
+	};
+
+	// name of the trace used in the report
+	std::string m_label;
+	// every recorded frame
+	std::vector<FRAME_SAMPLE> m_frames;
+};
@@ -0,0 +1,92 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustum.cpp
+// ============
+// the six clipping planes of a view and projection, for visibility tests
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Frustum.h"
+
+#include <cmath>
+
+/***********************************************************
+ *  Frustum()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+Frustum::Frustum()
+{
+	SetViewProjection(glm::mat4(1.0f));
+}
+
+/***********************************************************
+ *  SetViewProjection()
+ *
+ *  This method is used for extracting the planes from the
+ *  rows of the clip space matrix.  A point is inside the
+ *  OpenGL clip volume when -w <= x, y, z <= w, so each plane
+ *  is the fourth row plus or minus one of the others.
+ ***********************************************************/
+void Frustum::SetViewProjection(const glm::mat4& viewProjection)
+{
+	glm::vec4 rows[4];
+	for (int row = 0; row < 4; row++)
+	{
+		rows[row] = glm::vec4(viewProjection[0][row], viewProjection[1][row], viewProjection[2][row], viewProjection[3][row]);
+	}
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		m_planes[axis * 2] = rows[3] + rows[axis];
+		m_planes[axis * 2 + 1] = rows[3] - rows[axis];
+	}
+
+	// normalized planes give true distances, so boxes can be
+	// tested by their extents
+	for (int plane = 0; plane < 6; plane++)
+	{
+		float length = std::sqrt(
+			m_planes[plane].x * m_planes[plane].x +
+			m_planes[plane].y * m_planes[plane].y +
+			m_planes[plane].z * m_planes[plane].z);
+		if (length > 0.0f)
+		{
+			m_planes[plane] = m_planes[plane] * (1.0f / length);
+		}
+	}
+}
+
+/***********************************************************
+ *  TestBox()
+ *
+ *  This method is used for finding whether a box is fully
+ *  outside, fully inside or crossing the frustum.  The box
+ *  is outside when its center is further behind any plane
+ *  than its extent along that plane's normal reaches.  Boxes
+ *  near the corners of the frustum may be reported as
+ *  crossing when they are just outside, which only costs a
+ *  draw.
+ ***********************************************************/
+Frustum::TEST_RESULT Frustum::TestBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const
+{
+	glm::vec3 center = (boxMin + boxMax) * 0.5f;
+	glm::vec3 extent = (boxMax - boxMin) * 0.5f;
+
+	TEST_RESULT result = TEST_INSIDE;
+	for (int plane = 0; plane < 6; plane++)
+	{
+		const glm::vec4& p = m_planes[plane];
+		float distance = p.x * center.x + p.y * center.y + p.z * center.z + p.w;
+		float radius = std::fabs(p.x) * extent.x + std::fabs(p.y) * extent.y + std::fabs(p.z) * extent.z;
+		if (distance < -radius)
+		{
+			return(TEST_OUTSIDE);
+		}
+		if (distance < radius)
+		{
+			result = TEST_INTERSECTING;
+		}
+	}
+
+	return(result);
+}
@@ -0,0 +1,43 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustum.h
+// ============
+// the six clipping planes of a view and projection, for visibility tests
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  Frustum
+ *
+ *  This class holds the left, right, bottom, top, near and
+ *  far planes of the volume a camera sees, extracted from
+ *  the rows of the combined projection and view matrix.
+ *  Each plane faces into the volume, so a point is inside
+ *  when it is in front of all six.
+ ***********************************************************/
+class Frustum
+{
+public:
+	// result of testing a volume against the frustum
+	enum TEST_RESULT
+	{
+		TEST_OUTSIDE = 0,
+		TEST_INTERSECTING,
+		TEST_INSIDE
+	};
+
+	// constructor
+	Frustum();
+
+	// extract the planes of the passed in projection * view matrix
+	void SetViewProjection(const glm::mat4& viewProjection);
+	// test an axis aligned box against the planes
+	TEST_RESULT TestBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+
+private:
+	// plane normals in xyz and distances in w, normalized
+	glm::vec4 m_planes[6];
+};
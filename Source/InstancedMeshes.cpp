@@ -0,0 +1,231 @@
+///////////////////////////////////////////////////////////////////////////////
+// instancedmeshes.cpp
+// ============
+// draw every instance of a basic mesh with one instanced draw call
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "InstancedMeshes.h"
+
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+/***********************************************************
+ *  InstancedMeshes()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+InstancedMeshes::InstancedMeshes()
+{
+	memset(m_meshes, 0, sizeof(m_meshes));
+	m_drawCount = 0;
+	m_instanceCount = 0;
+}
+
+/***********************************************************
+ *  ~InstancedMeshes()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+InstancedMeshes::~InstancedMeshes()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for generating the geometry of every
+ *  mesh type at each of its levels of detail and creating a
+ *  vertex array for each, with the mesh
+ *  vertices in attributes 0 to 2 and the instance values in
+ *  the attributes after them, advancing once per instance.
+ ***********************************************************/
+bool InstancedMeshes::Create()
+{
+	Destroy();
+
+	std::vector<MeshGeometry::MESH_VERTEX> vertices;
+	std::vector<uint32_t> indices;
+
+	for (int meshType = 0; meshType < SceneFile::MESH_TYPE_COUNT; meshType++)
+	{
+		const int levelCount = MeshGeometry::GetLevelCount((SceneFile::MESH_TYPE)meshType);
+		for (int level = 0; level < levelCount; level++)
+		{
+			MeshGeometry::Build((SceneFile::MESH_TYPE)meshType, vertices, indices, level);
+
+			MESH_BUFFERS& mesh = m_meshes[meshType][level];
+			mesh.indexCount = (GLsizei)indices.size();
+
+			glGenVertexArrays(1, &mesh.vertexArrayID);
+			glBindVertexArray(mesh.vertexArrayID);
+
+			glGenBuffers(1, &mesh.vertexBufferID);
+			glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBufferID);
+			glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(MeshGeometry::MESH_VERTEX), vertices.data(), GL_STATIC_DRAW);
+
+			EnableVertexAttributes();
+
+			glGenBuffers(1, &mesh.indexBufferID);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBufferID);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+
+			// the instance buffer is sized by the first draw
+			glGenBuffers(1, &mesh.instanceBufferID);
+			glBindBuffer(GL_ARRAY_BUFFER, mesh.instanceBufferID);
+			mesh.instanceCapacity = 0;
+			EnableInstanceAttributes();
+
+			glBindVertexArray(0);
+		}
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	std::cout << "Created instanced meshes for " << SceneFile::MESH_TYPE_COUNT << " mesh types" << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  EnableVertexAttributes()
+ *
+ *  This method is used for setting up vertex attributes 0 to
+ *  2 of the bound vertex array to read the position, normal
+ *  and texture coordinate of the MeshGeometry vertices.
+ ***********************************************************/
+void InstancedMeshes::EnableVertexAttributes()
+{
+	const GLsizei vertexStride = sizeof(MeshGeometry::MESH_VERTEX);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, vertexStride, (void*)offsetof(MeshGeometry::MESH_VERTEX, position));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, vertexStride, (void*)offsetof(MeshGeometry::MESH_VERTEX, normal));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, vertexStride, (void*)offsetof(MeshGeometry::MESH_VERTEX, textureCoordinate));
+}
+
+/***********************************************************
+ *  EnableInstanceAttributes()
+ *
+ *  This method is used for setting up the instance attributes
+ *  of the bound vertex array to read INSTANCE_DATA values,
+ *  advancing once per instance.
+ ***********************************************************/
+void InstancedMeshes::EnableInstanceAttributes()
+{
+	const GLsizei instanceStride = sizeof(INSTANCE_DATA);
+	const GLuint location = FIRST_INSTANCE_ATTRIBUTE;
+	// a mat4 attribute takes one location per column
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glEnableVertexAttribArray(location + column);
+		glVertexAttribPointer(location + column, 4, GL_FLOAT, GL_FALSE, instanceStride,
+			(void*)(offsetof(INSTANCE_DATA, model) + column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(location + column, 1);
+	}
+	glEnableVertexAttribArray(location + 4);
+	glVertexAttribPointer(location + 4, 4, GL_FLOAT, GL_FALSE, instanceStride, (void*)offsetof(INSTANCE_DATA, color));
+	glVertexAttribDivisor(location + 4, 1);
+	glEnableVertexAttribArray(location + 5);
+	glVertexAttribPointer(location + 5, 2, GL_FLOAT, GL_FALSE, instanceStride, (void*)offsetof(INSTANCE_DATA, uvScale));
+	glVertexAttribDivisor(location + 5, 1);
+	// the texture layer and material index are read as an ivec2
+	glEnableVertexAttribArray(location + 6);
+	glVertexAttribIPointer(location + 6, 2, GL_INT, instanceStride, (void*)offsetof(INSTANCE_DATA, textureLayer));
+	glVertexAttribDivisor(location + 6, 1);
+	// the normal matrix takes one location per column
+	for (GLuint column = 0; column < 3; column++)
+	{
+		glEnableVertexAttribArray(location + 7 + column);
+		glVertexAttribPointer(location + 7 + column, 3, GL_FLOAT, GL_FALSE, instanceStride,
+			(void*)(offsetof(INSTANCE_DATA, normalMatrix) + column * sizeof(glm::vec3)));
+		glVertexAttribDivisor(location + 7 + column, 1);
+	}
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for deleting the vertex arrays and
+ *  buffers of every mesh type and level.
+ ***********************************************************/
+void InstancedMeshes::Destroy()
+{
+	for (int meshType = 0; meshType < SceneFile::MESH_TYPE_COUNT; meshType++)
+	{
+		for (int level = 0; level < MeshGeometry::LEVEL_COUNT; level++)
+		{
+			MESH_BUFFERS& mesh = m_meshes[meshType][level];
+			if (mesh.vertexArrayID != 0)
+			{
+				glDeleteVertexArrays(1, &mesh.vertexArrayID);
+				glDeleteBuffers(1, &mesh.vertexBufferID);
+				glDeleteBuffers(1, &mesh.indexBufferID);
+				glDeleteBuffers(1, &mesh.instanceBufferID);
+			}
+		}
+	}
+	memset(m_meshes, 0, sizeof(m_meshes));
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method is used for uploading the instances into the
+ *  instance buffer of the mesh at the passed in level of
+ *  detail and drawing all of them with one call.  The buffer storage is orphaned before each
+ *  upload, so the driver does not wait for earlier draws
+ *  that still read the old instances.
+ ***********************************************************/
+void InstancedMeshes::Draw(SceneFile::MESH_TYPE meshType, int level, const INSTANCE_DATA* pInstances, int instanceCount)
+{
+	if ((meshType < 0) || (meshType >= SceneFile::MESH_TYPE_COUNT) ||
+		(level < 0) || (level >= MeshGeometry::LEVEL_COUNT) || (instanceCount <= 0))
+	{
+		return;
+	}
+
+	MESH_BUFFERS& mesh = m_meshes[meshType][level];
+	if (mesh.vertexArrayID == 0)
+	{
+		return;
+	}
+
+	// grow to the next power of two so a growing scene does not
+	// reallocate every frame
+	if (instanceCount > mesh.instanceCapacity)
+	{
+		int capacity = (mesh.instanceCapacity > 0) ? mesh.instanceCapacity : 64;
+		while (capacity < instanceCount)
+		{
+			capacity *= 2;
+		}
+		mesh.instanceCapacity = capacity;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.instanceBufferID);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)mesh.instanceCapacity * sizeof(INSTANCE_DATA), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)instanceCount * sizeof(INSTANCE_DATA), pInstances);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindVertexArray(mesh.vertexArrayID);
+	glDrawElementsInstanced(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0, instanceCount);
+	glBindVertexArray(0);
+
+	m_drawCount++;
+	m_instanceCount += instanceCount;
+}
+
+/***********************************************************
+ *  ResetCounts()
+ *
+ *  This method is used for restarting the draw and instance
+ *  counts, once per frame.
+ ***********************************************************/
+void InstancedMeshes::ResetCounts()
+{
+	m_drawCount = 0;
+	m_instanceCount = 0;
+}
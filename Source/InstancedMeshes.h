@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////
+// instancedmeshes.h
+// ============
+// draw every instance of a basic mesh with one instanced draw call
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshGeometry.h"
+#include "SceneFile.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+/***********************************************************
+ *  InstancedMeshes
+ *
+ *  This class keeps a vertex array for each scene mesh type
+ *  along with a buffer of per-instance values.  The values
+ *  that single draws set as uniforms - the model matrix,
+ *  color, UV scale, texture layer and material index - are
+ *  read by the vertex shader from instance attributes,
+ *  along with a precomputed normal matrix, so
+ *  any number of objects sharing a mesh are drawn with one
+ *  glDrawElementsInstanced call.  Each level of detail of a
+ *  mesh type has a vertex array of its own.
+ ***********************************************************/
+class InstancedMeshes
+{
+public:
+	// must match the first instance attribute location in the vertex shader
+	static const GLuint FIRST_INSTANCE_ATTRIBUTE = 3;
+
+	// the values of one instance, in instance attribute order
+	struct INSTANCE_DATA
+	{
+		glm::mat4 model;
+		glm::vec4 color;
+		glm::vec2 uvScale;
+		// texture array layer, or -1 to use the color
+		int32_t textureLayer;
+		// index of the material within the bound material page
+		int32_t materialIndex;
+		// inverse transpose of the model rotation and scale
+		glm::mat3 normalMatrix;
+	};
+
+	// constructor
+	InstancedMeshes();
+	// destructor
+	~InstancedMeshes();
+
+	// create the vertex arrays and buffers of every mesh type and level
+	bool Create();
+	// delete the vertex arrays and buffers
+	void Destroy();
+
+	// upload the instances and draw them with the mesh at a level of detail
+	void Draw(SceneFile::MESH_TYPE meshType, int level, const INSTANCE_DATA* pInstances, int instanceCount);
+
+	// point the vertex attributes of the bound vertex array at the
+	// MeshGeometry vertices in the bound array buffer
+	static void EnableVertexAttributes();
+	// point the instance attributes of the bound vertex array at the
+	// instances in the bound array buffer
+	static void EnableInstanceAttributes();
+
+	// get the draw calls and instances of the draws since the last reset
+	int GetDrawCount() const { return m_drawCount; }
+	int GetInstanceCount() const { return m_instanceCount; }
+	void ResetCounts();
+
+private:
+	// instanced meshes cannot be copied
+	InstancedMeshes(const InstancedMeshes&);
+	InstancedMeshes& operator=(const InstancedMeshes&);
+
+	struct MESH_BUFFERS
+	{
+		GLuint vertexArrayID;
+		GLuint vertexBufferID;
+		GLuint indexBufferID;
+		GLuint instanceBufferID;
+		GLsizei indexCount;
+		// number of instances the instance buffer has room for
+		int instanceCapacity;
+	};
+
+	MESH_BUFFERS m_meshes[SceneFile::MESH_TYPE_COUNT][MeshGeometry::LEVEL_COUNT];
+	int m_drawCount;
+	int m_instanceCount;
+};
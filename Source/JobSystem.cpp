@@ -0,0 +1,425 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.cpp
+// ============
+// run small jobs on a pool of threads that steal work from each other,
+// for splitting the per-frame scene work over the CPU cores
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// the job system a worker thread belongs to and its queue -
+	// every other thread uses queue 0
+	thread_local const JobSystem* g_pWorkerJobSystem = NULL;
+	thread_local int g_WorkerQueueIndex = 0;
+
+	// the most chunks per thread a parallel loop is split into, so
+	// there are spare chunks to steal when one runs long
+	const int g_ChunksPerThread = 4;
+}
+
+/***********************************************************
+ *  JobSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+JobSystem::JobSystem(int threadCount)
+{
+	m_threadCount = threadCount;
+	if (m_threadCount <= 0)
+	{
+		m_threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+	m_pQueues = new JOB_QUEUE[m_threadCount];
+	m_queuedJobCount = 0;
+	m_bStopping = false;
+	m_jobCount = 0;
+	m_stealCount = 0;
+
+	// the owning thread is the first thread, so one fewer is started
+	for (int i = 1; i < m_threadCount; i++)
+	{
+		m_workers.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+	}
+}
+
+/***********************************************************
+ *  ~JobSystem()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_bStopping = true;
+	}
+	m_wakeCondition.notify_all();
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+
+	delete[] m_pQueues;
+	m_pQueues = NULL;
+}
+
+/***********************************************************
+ *  GetQueueIndex()
+ *
+ *  This method is used for finding the queue of the calling
+ *  thread.  Threads that are not workers of this job system
+ *  share the owner's queue.
+ ***********************************************************/
+int JobSystem::GetQueueIndex() const
+{
+	return (g_pWorkerJobSystem == this) ? g_WorkerQueueIndex : 0;
+}
+
+/***********************************************************
+ *  PushJob()
+ *
+ *  This method is used for adding a job to the back of a
+ *  queue, where its owner takes it from.
+ ***********************************************************/
+void JobSystem::PushJob(int queueIndex, const JOB& job)
+{
+	JOB_QUEUE& queue = m_pQueues[queueIndex];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(job);
+	}
+	m_queuedJobCount++;
+}
+
+/***********************************************************
+ *  WakeWorkers()
+ *
+ *  This method is used for waking idle workers after jobs
+ *  were queued.  The sleep mutex is taken first, so a worker
+ *  that just found nothing to do is either still checking
+ *  the count or already waiting for the notification.
+ ***********************************************************/
+void JobSystem::WakeWorkers(bool bAll)
+{
+	if (m_workers.empty() == true)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+	}
+	if (bAll == true)
+	{
+		m_wakeCondition.notify_all();
+	}
+	else
+	{
+		m_wakeCondition.notify_one();
+	}
+}
+
+/***********************************************************
+ *  TakeJob()
+ *
+ *  This method is used for getting the next job for a
+ *  thread.  The newest job of its own queue is taken first,
+ *  then the other queues are tried in turn from the next
+ *  one on, stealing their oldest job, which is the one their
+ *  owners would get to last.
+ ***********************************************************/
+bool JobSystem::TakeJob(int queueIndex, JOB& job)
+{
+	{
+		JOB_QUEUE& queue = m_pQueues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.jobs.empty() == false)
+		{
+			job = queue.jobs.back();
+			queue.jobs.pop_back();
+			m_queuedJobCount--;
+			return(true);
+		}
+	}
+
+	for (int i = 1; i < m_threadCount; i++)
+	{
+		JOB_QUEUE& victim = m_pQueues[(queueIndex + i) % m_threadCount];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (victim.jobs.empty() == false)
+		{
+			job = victim.jobs.front();
+			victim.jobs.pop_front();
+			m_queuedJobCount--;
+			m_stealCount++;
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  ExecuteJob()
+ *
+ *  This method is used for running a job and counting it as
+ *  done against its counter.
+ ***********************************************************/
+void JobSystem::ExecuteJob(JOB& job)
+{
+	{
+		PROFILE_SCOPE("Job");
+		job.function();
+	}
+	m_jobCount++;
+	FinishJob(job.pCounter);
+}
+
+/***********************************************************
+ *  FinishJob()
+ *
+ *  This method is used for counting a job as done.  When it
+ *  was the last job of its counter, the jobs held back on
+ *  the counter are queued.  The counter is only read under
+ *  its mutex, so a thread waiting on it cannot see it done
+ *  and free it while it is still being used here.
+ ***********************************************************/
+void JobSystem::FinishJob(JOB_COUNTER* pCounter)
+{
+	if (NULL == pCounter)
+	{
+		return;
+	}
+
+	std::vector<JOB> releasedJobs;
+	{
+		std::lock_guard<std::mutex> lock(pCounter->mutex);
+		pCounter->pending--;
+		if (pCounter->pending == 0)
+		{
+			releasedJobs.swap(pCounter->dependentJobs);
+		}
+	}
+
+	if (releasedJobs.empty() == false)
+	{
+		const int queueIndex = GetQueueIndex();
+		for (const JOB& job : releasedJobs)
+		{
+			PushJob(queueIndex, job);
+		}
+		WakeWorkers(releasedJobs.size() > 1);
+	}
+}
+
+/***********************************************************
+ *  IsDone()
+ *
+ *  This method is used for checking whether every job
+ *  counted against a counter is done.
+ ***********************************************************/
+bool JobSystem::IsDone(JOB_COUNTER* pCounter)
+{
+	std::lock_guard<std::mutex> lock(pCounter->mutex);
+	return(pCounter->pending == 0);
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for queueing a job on the queue of
+ *  the calling thread, where it is run next unless another
+ *  thread steals it first.
+ ***********************************************************/
+void JobSystem::Run(const JobFunction& function, JOB_COUNTER* pCounter)
+{
+	JOB job;
+	job.function = function;
+	job.pCounter = pCounter;
+	if (NULL != pCounter)
+	{
+		std::lock_guard<std::mutex> lock(pCounter->mutex);
+		pCounter->pending++;
+	}
+
+	PushJob(GetQueueIndex(), job);
+	WakeWorkers(false);
+}
+
+/***********************************************************
+ *  RunAfter()
+ *
+ *  This method is used for queueing a job that must not
+ *  start before the jobs of another counter are done.  The
+ *  job is counted against its own counter straight away,
+ *  so waiting on that counter also waits for the
+ *  dependency, and it is kept on the dependency until the
+ *  last of its jobs finishes.
+ ***********************************************************/
+void JobSystem::RunAfter(JOB_COUNTER* pDependency, const JobFunction& function, JOB_COUNTER* pCounter)
+{
+	if (NULL == pDependency)
+	{
+		Run(function, pCounter);
+		return;
+	}
+
+	JOB job;
+	job.function = function;
+	job.pCounter = pCounter;
+	if (NULL != pCounter)
+	{
+		std::lock_guard<std::mutex> lock(pCounter->mutex);
+		pCounter->pending++;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(pDependency->mutex);
+		if (pDependency->pending > 0)
+		{
+			pDependency->dependentJobs.push_back(job);
+			return;
+		}
+	}
+
+	PushJob(GetQueueIndex(), job);
+	WakeWorkers(false);
+}
+
+/***********************************************************
+ *  Wait()
+ *
+ *  This method is used for blocking until the jobs of a
+ *  counter are done.  The waiting thread runs queued jobs,
+ *  its own first, instead of sleeping, so a single thread
+ *  still gets through all of them.
+ ***********************************************************/
+void JobSystem::Wait(JOB_COUNTER* pCounter)
+{
+	if (NULL == pCounter)
+	{
+		return;
+	}
+
+	const int queueIndex = GetQueueIndex();
+	while (IsDone(pCounter) == false)
+	{
+		JOB job;
+		if (TakeJob(queueIndex, job) == true)
+		{
+			ExecuteJob(job);
+		}
+		else
+		{
+			// the remaining jobs are running on other threads
+			std::this_thread::yield();
+		}
+	}
+}
+
+/***********************************************************
+ *  ParallelFor()
+ *
+ *  This method is used for running a function over a range
+ *  of items split into chunks.  There are a few chunks per
+ *  thread, each at least the grain size, so the threads
+ *  that finish early can steal the remaining chunks.  A
+ *  range that fits in one chunk runs straight away on the
+ *  calling thread.
+ ***********************************************************/
+void JobSystem::ParallelFor(int itemCount, int grainSize, const RangeFunction& function)
+{
+	if (itemCount <= 0)
+	{
+		return;
+	}
+
+	const int maxChunkCount = m_threadCount * g_ChunksPerThread;
+	const int chunkSize = std::max(std::max(grainSize, 1), (itemCount + maxChunkCount - 1) / maxChunkCount);
+	if ((chunkSize >= itemCount) || (m_threadCount == 1))
+	{
+		function(0, itemCount);
+		m_jobCount++;
+		return;
+	}
+
+	JOB_COUNTER counter;
+	const int queueIndex = GetQueueIndex();
+	for (int first = 0; first < itemCount; first += chunkSize)
+	{
+		const int count = std::min(chunkSize, itemCount - first);
+		JOB job;
+		job.function = [&function, first, count]()
+			{
+				function(first, count);
+			};
+		job.pCounter = &counter;
+		{
+			std::lock_guard<std::mutex> lock(counter.mutex);
+			counter.pending++;
+		}
+		PushJob(queueIndex, job);
+	}
+	WakeWorkers(true);
+
+	Wait(&counter);
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method runs on each worker thread, taking and
+ *  stealing jobs while there are any and sleeping while
+ *  there are none.  A worker only exits once the job system
+ *  is stopped and every queue is empty.
+ ***********************************************************/
+void JobSystem::WorkerLoop(int queueIndex)
+{
+	g_pWorkerJobSystem = this;
+	g_WorkerQueueIndex = queueIndex;
+	PROFILE_THREAD_NAME("Job worker");
+
+	while (true)
+	{
+		JOB job;
+		if (TakeJob(queueIndex, job) == true)
+		{
+			ExecuteJob(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_wakeCondition.wait(lock, [this]()
+			{
+				return m_bStopping || (m_queuedJobCount > 0);
+			});
+		if ((m_bStopping == true) && (m_queuedJobCount == 0))
+		{
+			break;
+		}
+	}
+}
+
+/***********************************************************
+ *  PrintStatistics()
+ *
+ *  This method is used for printing the threads of the job
+ *  system and how many jobs they ran and stole.
+ ***********************************************************/
+void JobSystem::PrintStatistics() const
+{
+	const long long jobCount = m_jobCount;
+	const long long stealCount = m_stealCount;
+	std::cout << "Job system: " << m_threadCount << " threads ran " << jobCount << " jobs, "
+		<< stealCount << " of them stolen from another thread" << std::endl;
+}
@@ -0,0 +1,132 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.h
+// ============
+// run small jobs on a pool of threads that steal work from each other,
+// for splitting the per-frame scene work over the CPU cores
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  JobSystem
+ *
+ *  This class runs jobs on a pool of worker threads.  Every
+ *  thread has its own queue of jobs.  A thread takes the job
+ *  it queued last from its own queue, while it is still hot
+ *  in the cache, and when its queue is empty it steals the
+ *  oldest job of another thread's queue, so the work spreads
+ *  itself over the threads without a central queue.  Each
+ *  job counts against a counter, which a thread can wait on
+ *  until the jobs are done, running jobs itself meanwhile,
+ *  and jobs can be held back until another counter is done
+ *  to express what depends on what.  The thread that owns
+ *  the job system counts as one of its threads, so with a
+ *  single thread every job runs on the caller while it
+ *  waits.
+ ***********************************************************/
+class JobSystem
+{
+public:
+	typedef std::function<void()> JobFunction;
+	// called with the first index and the count of a range of items
+	typedef std::function<void(int, int)> RangeFunction;
+
+	struct JOB_COUNTER;
+
+	struct JOB
+	{
+		JobFunction function;
+		// counter the job is counted against, or NULL
+		JOB_COUNTER* pCounter;
+	};
+
+	// the number of jobs of a group that are not done yet, and the
+	// jobs held back until they are
+	struct JOB_COUNTER
+	{
+		JOB_COUNTER() : pending(0) {}
+
+		std::mutex mutex;
+		int pending;
+		std::vector<JOB> dependentJobs;
+	};
+
+	// constructor - zero threads means one per CPU core, and the
+	// calling thread counts as one of them
+	JobSystem(int threadCount = 0);
+	// destructor
+	~JobSystem();
+
+	// get the number of threads running jobs, including the caller
+	int GetThreadCount() const { return m_threadCount; }
+
+	// queue a job counted against the counter, which may be NULL
+	void Run(const JobFunction& function, JOB_COUNTER* pCounter);
+	// queue a job counted against the counter once every job counted
+	// against the dependency is done
+	void RunAfter(JOB_COUNTER* pDependency, const JobFunction& function, JOB_COUNTER* pCounter);
+	// run jobs until every job counted against the counter is done
+	void Wait(JOB_COUNTER* pCounter);
+	// split a range of items into chunks of at least the grain size,
+	// run them as jobs and wait until they are done
+	void ParallelFor(int itemCount, int grainSize, const RangeFunction& function);
+
+	// get the number of jobs run, and of those taken from the queue
+	// of another thread
+	long long GetJobCount() const { return m_jobCount; }
+	long long GetStealCount() const { return m_stealCount; }
+	// print the threads and the jobs they ran and stole
+	void PrintStatistics() const;
+
+private:
+	struct JOB_QUEUE
+	{
+		std::mutex mutex;
+		std::deque<JOB> jobs;
+	};
+
+	int m_threadCount;
+	// one queue per thread - the owning thread uses queue 0
+	JOB_QUEUE* m_pQueues;
+	std::vector<std::thread> m_workers;
+
+	// idle workers sleep until jobs are queued
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wakeCondition;
+	std::atomic<int> m_queuedJobCount;
+	bool m_bStopping;
+
+	std::atomic<long long> m_jobCount;
+	std::atomic<long long> m_stealCount;
+
+	// get the queue of the calling thread
+	int GetQueueIndex() const;
+	// add a job to a queue without waking a worker
+	void PushJob(int queueIndex, const JOB& job);
+	// wake one idle worker, or all of them
+	void WakeWorkers(bool bAll);
+	// take a job from a queue, or steal one from another
+	bool TakeJob(int queueIndex, JOB& job);
+	// run a job and count it as done
+	void ExecuteJob(JOB& job);
+	// count a job of the counter as done, releasing the jobs held
+	// back on it when it was the last
+	void FinishJob(JOB_COUNTER* pCounter);
+	// true once every job counted against the counter is done
+	bool IsDone(JOB_COUNTER* pCounter);
+	// run jobs until the job system is stopped
+	void WorkerLoop(int queueIndex);
+
+	// job systems cannot be copied
+	JobSystem(const JobSystem&);
+	JobSystem& operator=(const JobSystem&);
+};
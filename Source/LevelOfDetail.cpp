@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+// levelofdetail.cpp
+// ============
+// choose how finely to draw each curved object from its size on screen
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LevelOfDetail.h"
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// screen size below which each level gives way to the next,
+	// as a radius over half the screen height
+	const float g_LevelScreenSizes[] = { 0.2f, 0.05f };
+	const int g_LevelThresholdCount = sizeof(g_LevelScreenSizes) / sizeof(g_LevelScreenSizes[0]);
+	// share of a threshold an object has to pass it by to change level
+	const float g_LevelHysteresis = 0.2f;
+}
+
+/***********************************************************
+ *  LevelOfDetail()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LevelOfDetail::LevelOfDetail()
+{
+	m_depthRow = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	m_projectionScale = 1.0f;
+	m_levelChangeCount = 0;
+}
+
+/***********************************************************
+ *  SetViewProjection()
+ *
+ *  This method is used for taking the view depth and the
+ *  vertical scale of the projection from the clip space
+ *  matrix.  The clip w of a point is its depth in front of
+ *  the camera, and since the view matrix does not scale,
+ *  the length of the clip y row is the projection's scale.
+ ***********************************************************/
+void LevelOfDetail::SetViewProjection(const glm::mat4& viewProjection)
+{
+	m_depthRow = glm::vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+	m_projectionScale = std::sqrt(
+		viewProjection[0][1] * viewProjection[0][1] +
+		viewProjection[1][1] * viewProjection[1][1] +
+		viewProjection[2][1] * viewProjection[2][1]);
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used for sizing the levels for a scene,
+ *  with every object waiting for its first level.
+ ***********************************************************/
+void LevelOfDetail::Reset(int objectCount)
+{
+	m_levels.assign(objectCount, (uint8_t)NO_LEVEL);
+	m_levelChangeCount = 0;
+}
+
+/***********************************************************
+ *  GetScreenSize()
+ *
+ *  This method is used for getting the projected radius of
+ *  a sphere over half the screen height.  A sphere reaching
+ *  the camera is as large as the screen.
+ ***********************************************************/
+float LevelOfDetail::GetScreenSize(const glm::vec3& center, float radius) const
+{
+	float depth = m_depthRow.x * center.x + m_depthRow.y * center.y + m_depthRow.z * center.z + m_depthRow.w;
+	if (depth <= radius)
+	{
+		return(1.0f);
+	}
+	return(radius * m_projectionScale / depth);
+}
+
+/***********************************************************
+ *  SelectLevel()
+ *
+ *  This method is used for choosing the level an object is
+ *  drawn with.  An object with a level keeps it until its
+ *  size grows past the threshold above it, or shrinks past
+ *  the threshold below it, by the hysteresis margin.  The
+ *  first level of an object is taken straight from the
+ *  thresholds.  Only the level of the object is written
+ *  when the change is counted by the caller.
+ ***********************************************************/
+int LevelOfDetail::SelectLevel(int objectIndex, const glm::vec3& center, float radius, int levelCount, long long* pChangeCount)
+{
+	if (levelCount <= 1)
+	{
+		return(0);
+	}
+
+	const float size = GetScreenSize(center, radius);
+	const int lastLevel = std::min(levelCount, g_LevelThresholdCount + 1) - 1;
+
+	int level = m_levels[objectIndex];
+	if (level == NO_LEVEL)
+	{
+		level = 0;
+		while ((level < lastLevel) && (size < g_LevelScreenSizes[level]))
+		{
+			level++;
+		}
+		m_levels[objectIndex] = (uint8_t)level;
+		return(level);
+	}
+
+	const int previousLevel = level;
+	level = std::min(level, lastLevel);
+	while ((level > 0) && (size > g_LevelScreenSizes[level - 1] * (1.0f + g_LevelHysteresis)))
+	{
+		level--;
+	}
+	while ((level < lastLevel) && (size < g_LevelScreenSizes[level] * (1.0f - g_LevelHysteresis)))
+	{
+		level++;
+	}
+
+	if (level != previousLevel)
+	{
+		m_levels[objectIndex] = (uint8_t)level;
+		if (NULL != pChangeCount)
+		{
+			(*pChangeCount)++;
+		}
+		else
+		{
+			m_levelChangeCount++;
+		}
+	}
+	return(level);
+}
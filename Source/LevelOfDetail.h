@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+// levelofdetail.h
+// ============
+// choose how finely to draw each curved object from its size on screen
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  LevelOfDetail
+ *
+ *  This class picks a level of detail for each object from
+ *  the size its bounding sphere is projected to, measured as
+ *  a fraction of half the screen height so it does not
+ *  depend on the window size.  The level an object was drawn
+ *  with is kept, and it only moves to another level once its
+ *  size is past the threshold by a margin, so an object
+ *  resting near a threshold does not flicker between two
+ *  meshes.
+ ***********************************************************/
+class LevelOfDetail
+{
+public:
+	// constructor
+	LevelOfDetail();
+
+	// set the projection * view matrix the sizes are measured with
+	void SetViewProjection(const glm::mat4& viewProjection);
+	// forget the levels of every object and make room for the count
+	void Reset(int objectCount);
+	// choose the level of an object with a world bounding sphere,
+	// out of the levels its mesh has - a change of level is counted
+	// into pChangeCount when it is given, for threads choosing the
+	// levels of different objects at once
+	int SelectLevel(int objectIndex, const glm::vec3& center, float radius, int levelCount, long long* pChangeCount = NULL);
+	// add changes of level counted by the callers of SelectLevel
+	void AddLevelChanges(long long changeCount) { m_levelChangeCount += changeCount; }
+	// get the radius of a sphere on screen over half the screen height
+	float GetScreenSize(const glm::vec3& center, float radius) const;
+
+	// get the level an object was last drawn with
+	int GetLevel(int objectIndex) const { return (m_levels[objectIndex] == NO_LEVEL) ? 0 : m_levels[objectIndex]; }
+	// get the number of times an object changed level since the last reset
+	long long GetLevelChangeCount() const { return m_levelChangeCount; }
+
+private:
+	// marks an object not yet given a level
+	static const uint8_t NO_LEVEL = 0xFF;
+
+	// fourth row of the matrix, giving the view depth of a point
+	glm::vec4 m_depthRow;
+	// half the screen height over the view depth, per world unit
+	float m_projectionScale;
+	std::vector<uint8_t> m_levels;
+	long long m_levelChangeCount;
+};
@@ -1,5 +1,7 @@
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
+#include <string>           // stress scene file name
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -13,6 +15,14 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "SceneBenchmarks.h"
+#include "FrameTimeTrace.h"
+#include "FramePacer.h"
+#include "OffscreenContext.h"
+#include "BatchRenderer.h"
+#include "FrameCapture.h"
+#include "ThreadedRenderer.h"
+#include "Profiler.h"
 
 // Namespace for declaring global variables
 namespace
@@ -35,6 +45,7 @@ namespace
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
 bool InitializeGLEW();
+void DestroyManagers();
 
 
 /***********************************************************
@@ -45,8 +56,172 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// the CPU benchmarks run without creating a window
+	if ((argc > 1) && (strcmp(argv[1], "--benchmark") == 0))
+	{
+		bool bFound = RunSceneBenchmarks((argc > 2) ? argv[2] : NULL);
+		return(bFound ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	// read the rendering options from the command line
+	bool bUseTextureArray = false;
+	size_t textureBudgetBytes = 0;
+	int streamTestTextures = 0;
+	bool bUsePixelBufferUploads = true;
+	bool bUseCompressedTextures = true;
+	const char* sceneFilename = NULL;
+	bool bUseInstancing = false;
+	bool bUseMultiDrawIndirect = false;
+	bool bUsePersistentRing = false;
+	int stressSceneObjects = 0;
+	bool bUseFrustumCulling = true;
+	bool bUseOcclusionCulling = false;
+	bool bUseLevelOfDetail = true;
+	bool bRenderOnDemand = false;
+	int headlessFrames = 0;
+	const char* cameraFilename = NULL;
+	const char* outputDirectory = NULL;
+	int frameWidth = 0;
+	int frameHeight = 0;
+	const char* captureDirectory = NULL;
+	FrameCapture::CAPTURE_FORMAT captureFormat = FrameCapture::FORMAT_PNG;
+	bool bUseRenderThread = false;
+	int jobThreadCount = -1;
+	const char* profileFilename = NULL;
+	for (int i = 1; i < argc; i++)
+	{
+		// pack the scene textures into one texture array
+		if (strcmp(argv[i], "--texture-array") == 0)
+		{
+			bUseTextureArray = true;
+		}
+		// limit the resident texture memory in megabytes
+		else if ((strcmp(argv[i], "--texture-budget-mb") == 0) && (i + 1 < argc))
+		{
+			textureBudgetBytes = (size_t)atoi(argv[++i]) * 1024 * 1024;
+		}
+		// stream textures in during rendering and trace the frame times
+		else if ((strcmp(argv[i], "--stream-test") == 0) && (i + 1 < argc))
+		{
+			streamTestTextures = atoi(argv[++i]);
+		}
+		// upload streamed textures synchronously instead of through PBOs
+		else if (strcmp(argv[i], "--stream-sync") == 0)
+		{
+			bUsePixelBufferUploads = false;
+		}
+		// decode the source images even when compressed ones exist
+		else if (strcmp(argv[i], "--uncompressed-textures") == 0)
+		{
+			bUseCompressedTextures = false;
+		}
+		// load another text scene file instead of the desk scene
+		else if ((strcmp(argv[i], "--scene") == 0) && (i + 1 < argc))
+		{
+			sceneFilename = argv[++i];
+		}
+		// draw all objects that share a mesh with one instanced draw
+		else if (strcmp(argv[i], "--instancing") == 0)
+		{
+			bUseInstancing = true;
+		}
+		// draw from one shared mesh buffer with multi-draw-indirect
+		else if (strcmp(argv[i], "--multi-draw-indirect") == 0)
+		{
+			bUseMultiDrawIndirect = true;
+		}
+		// write the draw data into a persistently mapped ring buffer
+		else if (strcmp(argv[i], "--persistent-ring") == 0)
+		{
+			bUsePersistentRing = true;
+		}
+		// generate and load a scene of this many boxes and spheres
+		else if ((strcmp(argv[i], "--stress-scene") == 0) && (i + 1 < argc))
+		{
+			stressSceneObjects = atoi(argv[++i]);
+		}
+		// draw every object, even those outside the view
+		else if (strcmp(argv[i], "--no-culling") == 0)
+		{
+			bUseFrustumCulling = false;
+		}
+		// skip objects hidden behind large objects, tested on the CPU
+		else if (strcmp(argv[i], "--occlusion-culling") == 0)
+		{
+			bUseOcclusionCulling = true;
+		}
+		// draw spheres and cylinders with full detail at any distance
+		else if (strcmp(argv[i], "--no-lod") == 0)
+		{
+			bUseLevelOfDetail = false;
+		}
+		// only draw a frame when the view or the scene changed
+		else if (strcmp(argv[i], "--on-demand") == 0)
+		{
+			bRenderOnDemand = true;
+		}
+		// render this many frames offscreen and write them to disk
+		else if ((strcmp(argv[i], "--headless") == 0) && (i + 1 < argc))
+		{
+			headlessFrames = atoi(argv[++i]);
+		}
+		// place the headless frames along the cameras of this file
+		else if ((strcmp(argv[i], "--cameras") == 0) && (i + 1 < argc))
+		{
+			cameraFilename = argv[++i];
+		}
+		// write the headless frames into this directory
+		else if ((strcmp(argv[i], "--output") == 0) && (i + 1 < argc))
+		{
+			outputDirectory = argv[++i];
+		}
+		// size of the headless frames in pixels
+		else if ((strcmp(argv[i], "--size") == 0) && (i + 2 < argc))
+		{
+			frameWidth = atoi(argv[++i]);
+			frameHeight = atoi(argv[++i]);
+		}
+		// write every frame drawn in the window into this directory
+		else if ((strcmp(argv[i], "--capture") == 0) && (i + 1 < argc))
+		{
+			captureDirectory = argv[++i];
+		}
+		// write captured frames as "png" files or one "raw" RGBA stream
+		else if ((strcmp(argv[i], "--capture-format") == 0) && (i + 1 < argc))
+		{
+			captureFormat = (strcmp(argv[++i], "raw") == 0) ? FrameCapture::FORMAT_RAW : FrameCapture::FORMAT_PNG;
+		}
+		// update the scene on this thread and draw it on a second one
+		else if (strcmp(argv[i], "--render-thread") == 0)
+		{
+			bUseRenderThread = true;
+		}
+		// split the scene update into jobs on this many threads, 0 for
+		// one per CPU core
+		else if ((strcmp(argv[i], "--jobs") == 0) && (i + 1 < argc))
+		{
+			jobThreadCount = atoi(argv[++i]);
+		}
+		// record the frame profile and write it to this trace file at
+		// exit, or when F12 is pressed
+		else if ((strcmp(argv[i], "--profile") == 0) && (i + 1 < argc))
+		{
+			profileFilename = argv[++i];
+		}
+	}
+
+	// a headless run draws through an offscreen context instead
+	// of the display window
+	OffscreenContext offscreenContext;
+	if (headlessFrames > 0)
+	{
+		if (offscreenContext.Create() == false)
+		{
+			return(EXIT_FAILURE);
+		}
+	}
 	// if GLFW fails initialization, then terminate the application
-	if (InitializeGLFW() == false)
+	else if (InitializeGLFW() == false)
 	{
 		return(EXIT_FAILURE);
 	}
@@ -58,7 +233,10 @@ int main(int argc, char* argv[])
 		g_ShaderManager);
 
 	// try to create the main display window
-	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	if (headlessFrames == 0)
+	{
+		g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	}
 
 	// if GLEW fails initialization, then terminate the application
 	if (InitializeGLEW() == false)
@@ -66,41 +244,216 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
+	// the GPU scopes need the OpenGL functions, so the profile
+	// starts once they are loaded
+	if (NULL != profileFilename)
+	{
+		PROFILE_ENABLE(profileFilename);
+		PROFILE_THREAD_NAME("Main");
+	}
+
 	// load the shader code from the external GLSL files
 	g_ShaderManager->LoadShaders(
-		"../../Utilities/shaders/vertexShader.glsl",
-		"../../Utilities/shaders/fragmentShader.glsl");
+		"resources/shaders/vertexShader.glsl",
+		"resources/shaders/fragmentShader.glsl");
 	g_ShaderManager->use();
 
 	// try to create a new scene manager object and prepare the 3D scene
 	g_SceneManager = new SceneManager(g_ShaderManager);
+	g_SceneManager->SetTextureArrayMode(bUseTextureArray);
+	g_SceneManager->SetTextureMemoryBudget(textureBudgetBytes);
+	g_SceneManager->SetTextureUploadMode(bUsePixelBufferUploads);
+	g_SceneManager->SetCompressedTextureMode(bUseCompressedTextures);
+	g_SceneManager->SetInstancingMode(bUseInstancing);
+	g_SceneManager->SetMultiDrawIndirectMode(bUseMultiDrawIndirect);
+	g_SceneManager->SetPersistentRingMode(bUsePersistentRing);
+	g_SceneManager->SetFrustumCullingMode(bUseFrustumCulling);
+	g_SceneManager->SetOcclusionCullingMode(bUseOcclusionCulling);
+	g_SceneManager->SetLevelOfDetailMode(bUseLevelOfDetail);
+	if (jobThreadCount >= 0)
+	{
+		g_SceneManager->SetJobThreadCount(jobThreadCount);
+	}
+	std::string stressSceneFilename;
+	if (stressSceneObjects > 0)
+	{
+		stressSceneFilename = "resources/scenes/stress" + std::to_string(stressSceneObjects) + ".scene";
+		if (WriteStressScene(stressSceneFilename.c_str(), stressSceneObjects) == true)
+		{
+			sceneFilename = stressSceneFilename.c_str();
+		}
+	}
+	if (NULL != sceneFilename)
+	{
+		g_SceneManager->SetSceneFile(sceneFilename);
+	}
 	g_SceneManager->PrepareScene();
 
+	// render the headless frames and leave without a render loop
+	if (headlessFrames > 0)
+	{
+		BatchRenderer batchRenderer;
+		bool bRendered = ((NULL == cameraFilename) || (batchRenderer.LoadCameras(cameraFilename) == true));
+		if (bRendered == true)
+		{
+			batchRenderer.SetFrameSize(frameWidth, frameHeight);
+			batchRenderer.SetCaptureFormat(captureFormat);
+			if (NULL != outputDirectory)
+			{
+				batchRenderer.SetOutputDirectory(outputDirectory);
+			}
+			bRendered = batchRenderer.Run(g_SceneManager, g_ViewManager, headlessFrames);
+		}
+		g_SceneManager->PrintRenderStatistics();
+		DestroyManagers();
+		offscreenContext.Destroy();
+		return(bRendered ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	// the streaming test starts once the first frames are out of the
+	// way, and its trace ends a little after the last texture arrives
+	const int STREAM_TEST_START_FRAME = 30;
+	const int STREAM_TEST_SETTLE_FRAMES = 30;
+	FrameTimeTrace* pStreamTrace = NULL;
+	int frameIndex = 0;
+	int settleFrames = 0;
+	double lastFrameTime = glfwGetTime();
+	FramePacer framePacer;
+	framePacer.SetOnDemandMode(bRenderOnDemand);
+	FrameCapture frameCapture;
+	if (NULL != captureDirectory)
+	{
+		frameCapture.Begin(captureDirectory, captureFormat);
+	}
+
+	// the threaded loop returns once the window is closed, which
+	// skips the single threaded loop below
+	if (bUseRenderThread == true)
+	{
+		ThreadedRenderer threadedRenderer(g_Window, g_SceneManager, g_ViewManager, &frameCapture);
+		threadedRenderer.Run();
+		threadedRenderer.PrintStatistics();
+	}
+
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
 	while (!glfwWindowShouldClose(g_Window))
 	{
-		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
+		PROFILE_SCOPE("Frame");
+
+		if ((streamTestTextures > 0) && (frameIndex == STREAM_TEST_START_FRAME))
+		{
+			pStreamTrace = new FrameTimeTrace(bUsePixelBufferUploads ? "PBO streaming" : "Synchronous streaming");
+			g_SceneManager->StartTextureStreamingTest(streamTestTextures);
+		}
 
-		// Clear the frame and z buffers
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		// upload any textures that are streaming in
+		int pendingTextures = g_SceneManager->UpdateTextureStreaming();
 
 		// convert from 3D object space to 2D view
 		g_ViewManager->PrepareSceneView();
+		g_SceneManager->SetViewPosition(g_ViewManager->GetViewPosition());
+		g_SceneManager->SetViewProjection(g_ViewManager->GetProjectionMatrix() * g_ViewManager->GetViewMatrix());
 
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
+		// in on-demand mode the last frame stays on screen until the
+		// view or the scene changes
+		if ((g_ViewManager->HasViewChanged() == true) || (g_SceneManager->NeedsRedraw() == true))
+		{
+			framePacer.RequestRedraw();
+		}
 
+		if (framePacer.BeginPass() == true)
+		{
+			{
+				// the GPU scope ends before the swap, so the frame's
+				// time does not include it
+				PROFILE_GPU_SCOPE("Frame");
 
-		// Flips the the back buffer with the front buffer every frame.
-		glfwSwapBuffers(g_Window);
+				// Enable z-depth
+				glEnable(GL_DEPTH_TEST);
 
-		// query the latest GLFW events
-		glfwPollEvents();
+				// Clear the frame and z buffers
+				glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+				// refresh the 3D scene
+				g_SceneManager->RenderScene();
+
+				// start reading the frame back before it is swapped away
+				if (frameCapture.IsCapturing() == true)
+				{
+					int framebufferWidth = 0;
+					int framebufferHeight = 0;
+					glfwGetFramebufferSize(g_Window, &framebufferWidth, &framebufferHeight);
+					frameCapture.CaptureFrame(framebufferWidth, framebufferHeight);
+				}
+			}
+
+			// Flips the the back buffer with the front buffer every frame.
+			PROFILE_SCOPE("SwapBuffers");
+			glfwSwapBuffers(g_Window);
+		}
+		PROFILE_GPU_FRAME();
+
+		// query the latest GLFW events, sleeping until the next one
+		// when nothing needs to be drawn
+		{
+			PROFILE_SCOPE("WaitForEvents");
+			if (framePacer.WaitForEvents() == true)
+			{
+				g_ViewManager->ResetFrameTimer();
+			}
+		}
+
+		double frameTime = glfwGetTime();
+		if (NULL != pStreamTrace)
+		{
+			pStreamTrace->AddFrame((frameTime - lastFrameTime) * 1000.0, pendingTextures);
+			if ((pendingTextures == 0) && (++settleFrames >= STREAM_TEST_SETTLE_FRAMES))
+			{
+				pStreamTrace->PrintSummary();
+				pStreamTrace->WriteCSV(bUsePixelBufferUploads ? "frametimes_pbo.csv" : "frametimes_sync.csv");
+				delete pStreamTrace;
+				pStreamTrace = NULL;
+			}
+		}
+		lastFrameTime = frameTime;
+		frameIndex++;
+	}
+
+	if (NULL != pStreamTrace)
+	{
+		delete pStreamTrace;
+		pStreamTrace = NULL;
 	}
 
+	framePacer.PrintStatistics();
+	frameCapture.Finish();
+	frameCapture.PrintStatistics();
+
+	if (NULL != g_SceneManager)
+	{
+		g_SceneManager->PrintTextureMemoryStatistics();
+		g_SceneManager->PrintRenderStatistics();
+	}
+	DestroyManagers();
+
+	// Terminates the program successfully
+	exit(EXIT_SUCCESS); 
+}
+
+/***********************************************************
+ *	DestroyManagers()
+ *
+ *  This function is used to clear the allocated manager
+ *  objects from memory.
+ ***********************************************************/
+void DestroyManagers()
+{
+	// the trace is written and the GPU queries freed while the
+	// context is still current
+	PROFILE_SHUTDOWN();
+
 	// clear the allocated manager objects from memory
 	if (NULL != g_SceneManager)
 	{
@@ -117,9 +470,6 @@ int main(int argc, char* argv[])
 		delete g_ShaderManager;
 		g_ShaderManager = NULL;
 	}
-
-	// Terminates the program successfully
-	exit(EXIT_SUCCESS); 
 }
 
 /***********************************************************
@@ -162,6 +512,14 @@ bool InitializeGLEW()
 
 	// try to initialize the GLEW library
 	GLEWInitResult = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	// GLEW looks for a GLX display after loading the OpenGL
+	// functions, and a surfaceless EGL context has none
+	if (GLEW_ERROR_NO_GLX_DISPLAY == GLEWInitResult)
+	{
+		GLEWInitResult = GLEW_OK;
+	}
+#endif
 	if (GLEW_OK != GLEWInitResult)
 	{
 		std::cerr << glewGetErrorString(GLEWInitResult) << std::endl;
@@ -0,0 +1,150 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.cpp
+// ============
+// map a whole file read-only into memory
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/***********************************************************
+ *  MappedFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MappedFile::MappedFile()
+{
+	m_pData = NULL;
+	m_size = 0;
+#ifdef _WIN32
+	m_fileHandle = NULL;
+	m_mappingHandle = NULL;
+#endif
+}
+
+/***********************************************************
+ *  ~MappedFile()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping the passed in file into
+ *  memory.  Empty files cannot be mapped.
+ ***********************************************************/
+bool MappedFile::Open(const char* filename)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(
+		filename,
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		NULL,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return(false);
+	}
+
+	LARGE_INTEGER fileSize;
+	if ((GetFileSizeEx(file, &fileSize) == FALSE) || (fileSize.QuadPart == 0))
+	{
+		CloseHandle(file);
+		return(false);
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		CloseHandle(file);
+		return(false);
+	}
+
+	void* pView = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (pView == NULL)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return(false);
+	}
+
+	m_fileHandle = file;
+	m_mappingHandle = mapping;
+	m_pData = (const unsigned char*)pView;
+	m_size = (size_t)fileSize.QuadPart;
+#else
+	int file = open(filename, O_RDONLY);
+	if (file < 0)
+	{
+		return(false);
+	}
+
+	struct stat fileInfo;
+	if ((fstat(file, &fileInfo) != 0) || (fileInfo.st_size == 0))
+	{
+		close(file);
+		return(false);
+	}
+
+	void* pView = mmap(NULL, (size_t)fileInfo.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	// the mapping stays valid after the descriptor is closed
+	close(file);
+	if (pView == MAP_FAILED)
+	{
+		return(false);
+	}
+
+	m_pData = (const unsigned char*)pView;
+	m_size = (size_t)fileInfo.st_size;
+#endif
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the file from memory.
+ ***********************************************************/
+void MappedFile::Close()
+{
+	if (NULL != m_pData)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(m_pData);
+		CloseHandle((HANDLE)m_mappingHandle);
+		CloseHandle((HANDLE)m_fileHandle);
+		m_mappingHandle = NULL;
+		m_fileHandle = NULL;
+#else
+		munmap((void*)m_pData, m_size);
+#endif
+	}
+	m_pData = NULL;
+	m_size = 0;
+}
@@ -0,0 +1,51 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.h
+// ============
+// map a whole file read-only into memory
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+/***********************************************************
+ *  MappedFile
+ *
+ *  This class maps a file read-only into the address space
+ *  of the process so its contents can be used in place
+ *  without being read into a separate buffer.
+ ***********************************************************/
+class MappedFile
+{
+public:
+	// constructor
+	MappedFile();
+	// destructor
+	~MappedFile();
+
+	// map the passed in file into memory
+	bool Open(const char* filename);
+	// unmap the file from memory
+	void Close();
+
+	// get the mapped file contents
+	const unsigned char* GetData() const { return m_pData; }
+	// get the size of the mapped file in bytes
+	size_t GetSize() const { return m_size; }
+
+private:
+	// mapped files cannot be copied
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	// start of the mapped file contents
+	const unsigned char* m_pData;
+	// size of the mapped file contents
+	size_t m_size;
+#ifdef _WIN32
+	// operating system handles for the file and its mapping
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#endif
+};
@@ -0,0 +1,151 @@
+///////////////////////////////////////////////////////////////////////////////
+// materialbuffer.cpp
+// ============
+// keep every object material in one std140 uniform buffer
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MaterialBuffer.h"
+
+#include <cstddef>
+#include <iostream>
+
+// the C++ layout must match std140 exactly
+static_assert(sizeof(MaterialBuffer::GPU_MATERIAL) == 48, "GPU_MATERIAL must match the std140 Material stride");
+static_assert(offsetof(MaterialBuffer::GPU_MATERIAL, diffuseColor) == 16, "diffuseColor must be at its std140 offset");
+static_assert(offsetof(MaterialBuffer::GPU_MATERIAL, specularColor) == 32, "specularColor must be at its std140 offset");
+static_assert(offsetof(MaterialBuffer::GPU_MATERIAL, shininess) == 44, "shininess must be at its std140 offset");
+
+// declaration of global variables
+namespace
+{
+	// bytes of one page - a multiple of 256, the largest uniform
+	// buffer offset alignment drivers ask for
+	const GLsizeiptr g_PageBytes = MaterialBuffer::MATERIALS_PER_PAGE * sizeof(MaterialBuffer::GPU_MATERIAL);
+}
+
+/***********************************************************
+ *  MaterialBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MaterialBuffer::MaterialBuffer()
+{
+	m_bufferID = 0;
+	m_uploadedCount = 0;
+	m_boundPage = -1;
+}
+
+/***********************************************************
+ *  ~MaterialBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MaterialBuffer::~MaterialBuffer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  AddMaterial()
+ *
+ *  This method is used for adding a material to be uploaded
+ *  by the next call to Upload().
+ ***********************************************************/
+int MaterialBuffer::AddMaterial(
+	glm::vec3 ambientColor,
+	float ambientStrength,
+	glm::vec3 diffuseColor,
+	glm::vec3 specularColor,
+	float shininess)
+{
+	GPU_MATERIAL material;
+	material.ambientColor = ambientColor;
+	material.ambientStrength = ambientStrength;
+	material.diffuseColor = diffuseColor;
+	material.padding = 0.0f;
+	material.specularColor = specularColor;
+	material.shininess = shininess;
+	m_materials.push_back(material);
+
+	return (int)m_materials.size() - 1;
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for uploading the added materials
+ *  into the uniform buffer.  The buffer is sized in whole
+ *  pages so the last page can always be bound in full.
+ ***********************************************************/
+bool MaterialBuffer::Upload()
+{
+	if (m_materials.empty() == true)
+	{
+		return(false);
+	}
+
+	int pageCount = ((int)m_materials.size() + MATERIALS_PER_PAGE - 1) / MATERIALS_PER_PAGE;
+	std::vector<GPU_MATERIAL> pages = m_materials;
+	pages.resize((size_t)pageCount * MATERIALS_PER_PAGE);
+
+	if (m_bufferID == 0)
+	{
+		glGenBuffers(1, &m_bufferID);
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, m_bufferID);
+	glBufferData(GL_UNIFORM_BUFFER, g_PageBytes * pageCount, pages.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	m_uploadedCount = (int)m_materials.size();
+	m_boundPage = -1;
+
+	std::cout << "Uploaded " << m_uploadedCount << " materials in " << pageCount << " uniform buffer page(s)" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for deleting the uniform buffer and
+ *  forgetting the added materials.
+ ***********************************************************/
+void MaterialBuffer::Destroy()
+{
+	if (m_bufferID != 0)
+	{
+		glDeleteBuffers(1, &m_bufferID);
+		m_bufferID = 0;
+	}
+	m_materials.clear();
+	m_uploadedCount = 0;
+	m_boundPage = -1;
+}
+
+/***********************************************************
+ *  BindMaterial()
+ *
+ *  This method is used for making a material visible to the
+ *  shader.  The page holding it is bound to the binding
+ *  point only when a different page is bound, so drawing
+ *  with a material is usually just the index uniform.
+ *  Returns the index to pass to the shader, or -1 if the
+ *  material is not in the buffer.
+ ***********************************************************/
+int MaterialBuffer::BindMaterial(int materialIndex)
+{
+	if ((materialIndex < 0) || (materialIndex >= m_uploadedCount))
+	{
+		return(-1);
+	}
+
+	int page = materialIndex / MATERIALS_PER_PAGE;
+	if (page != m_boundPage)
+	{
+		glBindBufferRange(GL_UNIFORM_BUFFER, BINDING_POINT, m_bufferID, g_PageBytes * page, g_PageBytes);
+		m_boundPage = page;
+	}
+
+	return(materialIndex - page * MATERIALS_PER_PAGE);
+}
@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// materialbuffer.h
+// ============
+// keep every object material in one std140 uniform buffer
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  MaterialBuffer
+ *
+ *  This class uploads the scene materials once into a
+ *  uniform buffer laid out as the std140 MaterialBlock of
+ *  the fragment shader.  The shader sees one page of
+ *  MATERIALS_PER_PAGE materials at a time, so any number
+ *  of materials can be stored; selecting a material only
+ *  rebinds the buffer range when its page changes, and the
+ *  shader is passed the index of the material in the page.
+ ***********************************************************/
+class MaterialBuffer
+{
+public:
+	// must match MATERIALS_PER_PAGE in the fragment shader
+	static const int MATERIALS_PER_PAGE = 256;
+	// must match the binding of MaterialBlock in the fragment shader
+	static const GLuint BINDING_POINT = 0;
+
+	// one material in the std140 layout of the shader Material struct
+	struct GPU_MATERIAL
+	{
+		glm::vec3 ambientColor;
+		float ambientStrength;
+		glm::vec3 diffuseColor;
+		float padding;
+		glm::vec3 specularColor;
+		float shininess;
+	};
+
+	// constructor
+	MaterialBuffer();
+	// destructor
+	~MaterialBuffer();
+
+	// add a material, returning its index in the buffer
+	int AddMaterial(
+		glm::vec3 ambientColor,
+		float ambientStrength,
+		glm::vec3 diffuseColor,
+		glm::vec3 specularColor,
+		float shininess);
+	// upload the added materials into the uniform buffer
+	bool Upload();
+	// delete the uniform buffer and the added materials
+	void Destroy();
+
+	// bind the page holding the material, returning its index in the page
+	int BindMaterial(int materialIndex);
+	// get the number of materials in the uploaded buffer
+	int GetMaterialCount() const { return m_uploadedCount; }
+
+private:
+	// material buffers cannot be copied
+	MaterialBuffer(const MaterialBuffer&);
+	MaterialBuffer& operator=(const MaterialBuffer&);
+
+	// materials waiting to be uploaded
+	std::vector<GPU_MATERIAL> m_materials;
+	// OpenGL uniform buffer holding every page
+	GLuint m_bufferID;
+	// number of materials in the uniform buffer
+	int m_uploadedCount;
+	// page currently bound to the binding point, or -1
+	int m_boundPage;
+};
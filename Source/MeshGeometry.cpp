@@ -0,0 +1,401 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshgeometry.cpp
+// ============
+// generate the vertices and indices of the basic scene meshes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshGeometry.h"
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	const float g_Pi = 3.14159265358979f;
+
+	// tessellation of the curved meshes at the finest level of detail
+	const int g_SphereStacks = 16;
+	const int g_SphereSlices = 32;
+	const int g_CylinderSlices = 32;
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for generating the vertices and
+ *  indices of the passed in mesh type.  Every triangle is
+ *  wound counterclockwise when seen from outside the mesh.
+ *  Each level of detail past the first halves the slices
+ *  and stacks of the curved meshes.
+ ***********************************************************/
+void MeshGeometry::Build(
+	SceneFile::MESH_TYPE meshType,
+	std::vector<MESH_VERTEX>& vertices,
+	std::vector<uint32_t>& indices,
+	int level)
+{
+	vertices.clear();
+	indices.clear();
+
+	level = std::max(0, std::min(level, GetLevelCount(meshType) - 1));
+
+	switch (meshType)
+	{
+	case SceneFile::MESH_PLANE:
+		BuildPlane(vertices, indices);
+		break;
+	case SceneFile::MESH_BOX:
+		BuildBox(vertices, indices);
+		break;
+	case SceneFile::MESH_PRISM:
+		BuildPrism(vertices, indices);
+		break;
+	case SceneFile::MESH_SPHERE:
+		BuildSphere(vertices, indices, g_SphereStacks >> level, g_SphereSlices >> level);
+		break;
+	case SceneFile::MESH_CYLINDER:
+		BuildCylinder(vertices, indices, g_CylinderSlices >> level);
+		break;
+	default:
+		break;
+	}
+}
+
+/***********************************************************
+ *  GetLevelCount()
+ *
+ *  This method is used for getting the number of levels of
+ *  detail of the passed in mesh type.
+ ***********************************************************/
+int MeshGeometry::GetLevelCount(SceneFile::MESH_TYPE meshType)
+{
+	if ((meshType == SceneFile::MESH_SPHERE) || (meshType == SceneFile::MESH_CYLINDER))
+	{
+		return(LEVEL_COUNT);
+	}
+	return(1);
+}
+
+/***********************************************************
+ *  GetBounds()
+ *
+ *  This method is used for getting the box around the
+ *  vertices of the passed in mesh type, without building
+ *  the mesh.
+ ***********************************************************/
+void MeshGeometry::GetBounds(
+	SceneFile::MESH_TYPE meshType,
+	glm::vec3& boundsMin,
+	glm::vec3& boundsMax)
+{
+	switch (meshType)
+	{
+	case SceneFile::MESH_PLANE:
+		boundsMin = glm::vec3(-1.0f, 0.0f, -1.0f);
+		boundsMax = glm::vec3(1.0f, 0.0f, 1.0f);
+		break;
+	case SceneFile::MESH_SPHERE:
+		boundsMin = glm::vec3(-1.0f);
+		boundsMax = glm::vec3(1.0f);
+		break;
+	case SceneFile::MESH_CYLINDER:
+		boundsMin = glm::vec3(-1.0f, 0.0f, -1.0f);
+		boundsMax = glm::vec3(1.0f, 1.0f, 1.0f);
+		break;
+	default:
+		// the box and prism fill the unit cube
+		boundsMin = glm::vec3(-0.5f);
+		boundsMax = glm::vec3(0.5f);
+		break;
+	}
+}
+
+/***********************************************************
+ *  GetInnerBounds()
+ *
+ *  This method is used for getting a box that the passed in
+ *  mesh type fully covers, so nothing behind the box can be
+ *  seen through the mesh.  The round meshes are cut a little
+ *  inside their true radius to stay within their flat
+ *  facets at every level of detail.
+ ***********************************************************/
+void MeshGeometry::GetInnerBounds(
+	SceneFile::MESH_TYPE meshType,
+	glm::vec3& boundsMin,
+	glm::vec3& boundsMax)
+{
+	switch (meshType)
+	{
+	case SceneFile::MESH_SPHERE:
+		// the cube inside a unit sphere has half sides of 1/sqrt(3)
+		boundsMin = glm::vec3(-0.5f);
+		boundsMax = glm::vec3(0.5f);
+		break;
+	case SceneFile::MESH_CYLINDER:
+		// the square inside a unit circle has half sides of 1/sqrt(2)
+		boundsMin = glm::vec3(-0.68f, 0.0f, -0.68f);
+		boundsMax = glm::vec3(0.68f, 1.0f, 0.68f);
+		break;
+	case SceneFile::MESH_PRISM:
+		// the rectangle under the middle of the triangle
+		boundsMin = glm::vec3(-0.25f, -0.5f, -0.5f);
+		boundsMax = glm::vec3(0.25f, 0.0f, 0.5f);
+		break;
+	default:
+		// the box and plane are their own inner boxes
+		GetBounds(meshType, boundsMin, boundsMax);
+		break;
+	}
+}
+
+/***********************************************************
+ *  AddVertex()
+ *
+ *  This method is used for adding one vertex to the mesh.
+ ***********************************************************/
+uint32_t MeshGeometry::AddVertex(
+	std::vector<MESH_VERTEX>& vertices,
+	float x, float y, float z,
+	float nx, float ny, float nz,
+	float u, float v)
+{
+	MESH_VERTEX vertex = { { x, y, z }, { nx, ny, nz }, { u, v } };
+	vertices.push_back(vertex);
+	return (uint32_t)(vertices.size() - 1);
+}
+
+/***********************************************************
+ *  AddQuad()
+ *
+ *  This method is used for adding the two triangles of a
+ *  quad whose four vertices were added in counterclockwise
+ *  order, starting at the passed in index.
+ ***********************************************************/
+void MeshGeometry::AddQuad(std::vector<uint32_t>& indices, uint32_t first)
+{
+	const uint32_t quad[6] = { 0, 1, 2, 0, 2, 3 };
+	for (int i = 0; i < 6; i++)
+	{
+		indices.push_back(first + quad[i]);
+	}
+}
+
+/***********************************************************
+ *  BuildPlane()
+ *
+ *  This method is used for generating a 2x2 plane in XZ
+ *  facing up.
+ ***********************************************************/
+void MeshGeometry::BuildPlane(std::vector<MESH_VERTEX>& vertices, std::vector<uint32_t>& indices)
+{
+	uint32_t first = AddVertex(vertices, -1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f);
+	AddVertex(vertices, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f);
+	AddVertex(vertices, 1.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f);
+	AddVertex(vertices, -1.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f);
+	AddQuad(indices, first);
+}
+
+/***********************************************************
+ *  BuildBox()
+ *
+ *  This method is used for generating a unit box centered on
+ *  the origin, with its own vertices and normal per face so
+ *  the edges stay sharp.
+ ***********************************************************/
+void MeshGeometry::BuildBox(std::vector<MESH_VERTEX>& vertices, std::vector<uint32_t>& indices)
+{
+	// the normal, and the right and up directions across each face
+	const float faces[6][9] =
+	{
+		{ 0.0f, 0.0f, 1.0f,   1.0f, 0.0f, 0.0f,   0.0f, 1.0f, 0.0f },
+		{ 0.0f, 0.0f, -1.0f, -1.0f, 0.0f, 0.0f,   0.0f, 1.0f, 0.0f },
+		{ 1.0f, 0.0f, 0.0f,   0.0f, 0.0f, -1.0f,  0.0f, 1.0f, 0.0f },
+		{ -1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f,   0.0f, 1.0f, 0.0f },
+		{ 0.0f, 1.0f, 0.0f,   1.0f, 0.0f, 0.0f,   0.0f, 0.0f, -1.0f },
+		{ 0.0f, -1.0f, 0.0f,  1.0f, 0.0f, 0.0f,   0.0f, 0.0f, 1.0f },
+	};
+	const float corners[4][2] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+
+	for (int face = 0; face < 6; face++)
+	{
+		const float* n = faces[face];
+		const float* right = faces[face] + 3;
+		const float* up = faces[face] + 6;
+
+		uint32_t first = (uint32_t)vertices.size();
+		for (int corner = 0; corner < 4; corner++)
+		{
+			float s = corners[corner][0] * 0.5f;
+			float t = corners[corner][1] * 0.5f;
+			AddVertex(vertices,
+				n[0] * 0.5f + right[0] * s + up[0] * t,
+				n[1] * 0.5f + right[1] * s + up[1] * t,
+				n[2] * 0.5f + right[2] * s + up[2] * t,
+				n[0], n[1], n[2],
+				s + 0.5f, t + 0.5f);
+		}
+		AddQuad(indices, first);
+	}
+}
+
+/***********************************************************
+ *  BuildPrism()
+ *
+ *  This method is used for generating a unit triangular
+ *  prism centered on the origin, with its triangular faces
+ *  toward Z and its ridge along the top.
+ ***********************************************************/
+void MeshGeometry::BuildPrism(std::vector<MESH_VERTEX>& vertices, std::vector<uint32_t>& indices)
+{
+	// the triangle in XY, counterclockwise when seen from +Z
+	const float triangle[3][2] = { { -0.5f, -0.5f }, { 0.5f, -0.5f }, { 0.0f, 0.5f } };
+
+	// front and back faces
+	uint32_t first = (uint32_t)vertices.size();
+	for (int i = 0; i < 3; i++)
+	{
+		AddVertex(vertices, triangle[i][0], triangle[i][1], 0.5f, 0.0f, 0.0f, 1.0f, triangle[i][0] + 0.5f, triangle[i][1] + 0.5f);
+	}
+	indices.push_back(first);
+	indices.push_back(first + 1);
+	indices.push_back(first + 2);
+
+	first = (uint32_t)vertices.size();
+	for (int i = 0; i < 3; i++)
+	{
+		AddVertex(vertices, triangle[i][0], triangle[i][1], -0.5f, 0.0f, 0.0f, -1.0f, 0.5f - triangle[i][0], triangle[i][1] + 0.5f);
+	}
+	indices.push_back(first);
+	indices.push_back(first + 2);
+	indices.push_back(first + 1);
+
+	// a quad along each edge of the triangle
+	for (int i = 0; i < 3; i++)
+	{
+		const float* a = triangle[i];
+		const float* b = triangle[(i + 1) % 3];
+		float nx = b[1] - a[1];
+		float ny = a[0] - b[0];
+		float length = sqrtf(nx * nx + ny * ny);
+		nx /= length;
+		ny /= length;
+
+		first = AddVertex(vertices, a[0], a[1], 0.5f, nx, ny, 0.0f, 0.0f, 0.0f);
+		AddVertex(vertices, a[0], a[1], -0.5f, nx, ny, 0.0f, 1.0f, 0.0f);
+		AddVertex(vertices, b[0], b[1], -0.5f, nx, ny, 0.0f, 1.0f, 1.0f);
+		AddVertex(vertices, b[0], b[1], 0.5f, nx, ny, 0.0f, 0.0f, 1.0f);
+		AddQuad(indices, first);
+	}
+}
+
+/***********************************************************
+ *  BuildSphere()
+ *
+ *  This method is used for generating a sphere of radius 1
+ *  from rings of latitude, with the texture wrapped once
+ *  around it.
+ ***********************************************************/
+void MeshGeometry::BuildSphere(std::vector<MESH_VERTEX>& vertices, std::vector<uint32_t>& indices, int stacks, int slices)
+{
+	uint32_t first = (uint32_t)vertices.size();
+	for (int stack = 0; stack <= stacks; stack++)
+	{
+		float v = (float)stack / stacks;
+		float latitude = g_Pi * v;
+		for (int slice = 0; slice <= slices; slice++)
+		{
+			float u = (float)slice / slices;
+			float longitude = 2.0f * g_Pi * u;
+			float x = sinf(latitude) * sinf(longitude);
+			float y = -cosf(latitude);
+			float z = sinf(latitude) * cosf(longitude);
+			AddVertex(vertices, x, y, z, x, y, z, u, v);
+		}
+	}
+
+	const uint32_t rowLength = slices + 1;
+	for (int stack = 0; stack < stacks; stack++)
+	{
+		for (int slice = 0; slice < slices; slice++)
+		{
+			uint32_t bottom = first + stack * rowLength + slice;
+			uint32_t top = bottom + rowLength;
+			// the rings at the poles collapse to a point, so only one
+			// of the two triangles next to a pole has any area
+			if (stack > 0)
+			{
+				indices.push_back(bottom);
+				indices.push_back(bottom + 1);
+				indices.push_back(top + 1);
+			}
+			if (stack < stacks - 1)
+			{
+				indices.push_back(bottom);
+				indices.push_back(top + 1);
+				indices.push_back(top);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  BuildCylinder()
+ *
+ *  This method is used for generating a closed cylinder of
+ *  radius 1 standing on the origin, 1 unit tall.
+ ***********************************************************/
+void MeshGeometry::BuildCylinder(std::vector<MESH_VERTEX>& vertices, std::vector<uint32_t>& indices, int slices)
+{
+	// side
+	uint32_t first = (uint32_t)vertices.size();
+	for (int slice = 0; slice <= slices; slice++)
+	{
+		float u = (float)slice / slices;
+		float angle = 2.0f * g_Pi * u;
+		float x = sinf(angle);
+		float z = cosf(angle);
+		AddVertex(vertices, x, 0.0f, z, x, 0.0f, z, u, 0.0f);
+		AddVertex(vertices, x, 1.0f, z, x, 0.0f, z, u, 1.0f);
+	}
+	for (int slice = 0; slice < slices; slice++)
+	{
+		uint32_t bottom = first + slice * 2;
+		indices.push_back(bottom);
+		indices.push_back(bottom + 2);
+		indices.push_back(bottom + 3);
+		indices.push_back(bottom);
+		indices.push_back(bottom + 3);
+		indices.push_back(bottom + 1);
+	}
+
+	// top and bottom caps, as fans around a center vertex
+	for (int cap = 0; cap < 2; cap++)
+	{
+		float y = (cap == 0) ? 1.0f : 0.0f;
+		float ny = (cap == 0) ? 1.0f : -1.0f;
+		uint32_t center = AddVertex(vertices, 0.0f, y, 0.0f, 0.0f, ny, 0.0f, 0.5f, 0.5f);
+		for (int slice = 0; slice <= slices; slice++)
+		{
+			float angle = 2.0f * g_Pi * slice / slices;
+			float x = sinf(angle);
+			float z = cosf(angle);
+			AddVertex(vertices, x, y, z, 0.0f, ny, 0.0f, 0.5f + x * 0.5f, 0.5f - z * 0.5f * ny);
+		}
+		for (int slice = 0; slice < slices; slice++)
+		{
+			indices.push_back(center);
+			if (cap == 0)
+			{
+				indices.push_back(center + 1 + slice);
+				indices.push_back(center + 2 + slice);
+			}
+			else
+			{
+				indices.push_back(center + 2 + slice);
+				indices.push_back(center + 1 + slice);
+			}
+		}
+	}
+}
@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshgeometry.h
+// ============
+// generate the vertices and indices of the basic scene meshes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneFile.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  MeshGeometry
+ *
+ *  This class generates indexed triangle lists for the mesh
+ *  types of the scene file, in the same object space as the
+ *  ShapeMeshes primitives - a 2x2 plane in XZ, a unit box
+ *  and prism centered on the origin, a sphere of radius 1
+ *  and a cylinder of radius 1 from Y 0 to 1.  Vertices use
+ *  the attribute layout of the vertex shader.  The sphere
+ *  and cylinder have several levels of detail, each with
+ *  half the slices and stacks of the level before, for
+ *  drawing objects that cover few pixels.
+ ***********************************************************/
+class MeshGeometry
+{
+public:
+	// one vertex, matching vertex shader attributes 0 to 2
+	struct MESH_VERTEX
+	{
+		float position[3];
+		float normal[3];
+		float textureCoordinate[2];
+	};
+
+	// the most levels of detail of any mesh type
+	static const int LEVEL_COUNT = 3;
+
+	// replace the vertices and indices with those of the mesh type
+	// at a level of detail, where level 0 is the finest
+	static void Build(
+		SceneFile::MESH_TYPE meshType,
+		std::vector<MESH_VERTEX>& vertices,
+		std::vector<uint32_t>& indices,
+		int level = 0);
+	// get the number of levels of detail of the mesh type - meshes
+	// with only flat faces have just one
+	static int GetLevelCount(SceneFile::MESH_TYPE meshType);
+	// get the object space box that holds the mesh type
+	static void GetBounds(
+		SceneFile::MESH_TYPE meshType,
+		glm::vec3& boundsMin,
+		glm::vec3& boundsMax);
+	// get an object space box that lies inside the mesh type, for
+	// hiding the objects behind it
+	static void GetInnerBounds(
+		SceneFile::MESH_TYPE meshType,
+		glm::vec3& boundsMin,
+		glm::vec3& boundsMax);
+
+private:
+	static void BuildPlane(std::vector<MESH_VERTEX>& vertices, std::vector<uint32_t>& indices);
+	static void BuildBox(std::vector<MESH_VERTEX>& vertices, std::vector<uint32_t>& indices);
+	static void BuildPrism(std::vector<MESH_VERTEX>& vertices, std::vector<uint32_t>& indices);
+	static void BuildSphere(std::vector<MESH_VERTEX>& vertices, std::vector<uint32_t>& indices, int stacks, int slices);
+	static void BuildCylinder(std::vector<MESH_VERTEX>& vertices, std::vector<uint32_t>& indices, int slices);
+
+	// add a vertex, returning its index
+	static uint32_t AddVertex(
+		std::vector<MESH_VERTEX>& vertices,
+		float x, float y, float z,
+		float nx, float ny, float nz,
+		float u, float v);
+	// add a quad of four vertices given counterclockwise from the front
+	static void AddQuad(std::vector<uint32_t>& indices, uint32_t first);
+};
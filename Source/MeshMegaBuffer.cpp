@@ -0,0 +1,394 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshmegabuffer.cpp
+// ============
+// keep every basic mesh in one shared vertex and index buffer and submit
+// the draws of a frame with multi-draw-indirect
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshMegaBuffer.h"
+#include "MeshGeometry.h"
+
+#include <cstring>
+#include <iostream>
+
+/***********************************************************
+ *  MeshMegaBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MeshMegaBuffer::MeshMegaBuffer()
+{
+	memset(m_meshRanges, 0, sizeof(m_meshRanges));
+	m_vertexArrayID = 0;
+	m_vertexBufferID = 0;
+	m_indexBufferID = 0;
+	m_instanceBufferID = 0;
+	m_indirectBufferID = 0;
+	m_instanceBufferSize = 0;
+	m_indirectBufferSize = 0;
+	m_commandCount = 0;
+	m_instanceCount = 0;
+	m_submitCount = 0;
+	m_bUsePersistentRing = false;
+	m_attachedRingID = 0;
+	m_pRingInstances = NULL;
+	m_pRingCommands = NULL;
+	m_ringInstanceCapacity = 0;
+	m_ringCommandCapacity = 0;
+	m_ringBaseInstance = 0;
+	m_indirectOffset = 0;
+	m_bRingFrame = false;
+}
+
+/***********************************************************
+ *  ~MeshMegaBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MeshMegaBuffer::~MeshMegaBuffer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking that the context has
+ *  indirect draws with a base instance, which are core in
+ *  OpenGL 4.3 and available in Mesa's software renderer.
+ ***********************************************************/
+bool MeshMegaBuffer::IsSupported()
+{
+	return (GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect) ? true : false;
+}
+
+/***********************************************************
+ *  SetPersistentRingMode()
+ *
+ *  This method is used for choosing whether the instances
+ *  and commands of each frame are written into a triple
+ *  buffered, persistently mapped ring buffer, so no buffer
+ *  uploads are issued per frame.
+ ***********************************************************/
+void MeshMegaBuffer::SetPersistentRingMode(bool bEnable)
+{
+	m_bUsePersistentRing = bEnable;
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for generating the geometry of every
+ *  mesh type and appending it to the shared vertex and index
+ *  buffers.  The indices of each mesh stay relative to its
+ *  own first vertex, which each command passes as its base
+ *  vertex.
+ ***********************************************************/
+bool MeshMegaBuffer::Create()
+{
+	Destroy();
+
+	if (IsSupported() == false)
+	{
+		std::cout << "Multi-draw-indirect is not supported by this OpenGL context" << std::endl;
+		return(false);
+	}
+	if ((m_bUsePersistentRing == true) && (PersistentRingBuffer::IsSupported() == false))
+	{
+		std::cout << "Persistently mapped buffers are not supported, uploading draw data per frame" << std::endl;
+		m_bUsePersistentRing = false;
+	}
+
+	std::vector<MeshGeometry::MESH_VERTEX> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<MeshGeometry::MESH_VERTEX> meshVertices;
+	std::vector<uint32_t> meshIndices;
+
+	for (int meshType = 0; meshType < SceneFile::MESH_TYPE_COUNT; meshType++)
+	{
+		const int levelCount = MeshGeometry::GetLevelCount((SceneFile::MESH_TYPE)meshType);
+		for (int level = 0; level < levelCount; level++)
+		{
+			MeshGeometry::Build((SceneFile::MESH_TYPE)meshType, meshVertices, meshIndices, level);
+
+			MESH_RANGE& range = m_meshRanges[meshType][level];
+			range.firstIndex = (GLuint)indices.size();
+			range.indexCount = (GLuint)meshIndices.size();
+			range.baseVertex = (GLint)vertices.size();
+
+			vertices.insert(vertices.end(), meshVertices.begin(), meshVertices.end());
+			indices.insert(indices.end(), meshIndices.begin(), meshIndices.end());
+		}
+	}
+
+	glGenVertexArrays(1, &m_vertexArrayID);
+	glBindVertexArray(m_vertexArrayID);
+
+	glGenBuffers(1, &m_vertexBufferID);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferID);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(MeshGeometry::MESH_VERTEX), vertices.data(), GL_STATIC_DRAW);
+	InstancedMeshes::EnableVertexAttributes();
+
+	glGenBuffers(1, &m_indexBufferID);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBufferID);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+
+	// the instance and indirect buffers are sized by the first upload
+	glGenBuffers(1, &m_instanceBufferID);
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBufferID);
+	InstancedMeshes::EnableInstanceAttributes();
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glGenBuffers(1, &m_indirectBufferID);
+
+	std::cout << "Created mesh megabuffer: " << vertices.size() << " vertices, "
+		<< indices.size() << " indices for " << SceneFile::MESH_TYPE_COUNT << " mesh types" << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for deleting the vertex array and
+ *  every buffer.
+ ***********************************************************/
+void MeshMegaBuffer::Destroy()
+{
+	if (m_vertexArrayID != 0)
+	{
+		glDeleteVertexArrays(1, &m_vertexArrayID);
+		glDeleteBuffers(1, &m_vertexBufferID);
+		glDeleteBuffers(1, &m_indexBufferID);
+		glDeleteBuffers(1, &m_instanceBufferID);
+		glDeleteBuffers(1, &m_indirectBufferID);
+	}
+	m_ring.Destroy();
+	m_attachedRingID = 0;
+	m_vertexArrayID = 0;
+	m_vertexBufferID = 0;
+	m_indexBufferID = 0;
+	m_instanceBufferID = 0;
+	m_indirectBufferID = 0;
+	m_instanceBufferSize = 0;
+	m_indirectBufferSize = 0;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for removing the commands and
+ *  instances of the last frame.  In persistent ring mode it
+ *  waits for the next ring region and reserves room in it
+ *  for the frame's instances and commands, pointing the
+ *  instance attributes at the ring if it was created again.
+ *  When the ring cannot be grown or has no room, the frame
+ *  is uploaded instead.
+ ***********************************************************/
+void MeshMegaBuffer::BeginFrame(int maxInstances, int maxCommands)
+{
+	m_commands.clear();
+	m_instances.clear();
+	m_commandCount = 0;
+	m_instanceCount = 0;
+	m_submitCount = 0;
+	m_pRingInstances = NULL;
+	m_pRingCommands = NULL;
+	m_ringInstanceCapacity = 0;
+	m_ringCommandCapacity = 0;
+	m_indirectOffset = 0;
+	m_bRingFrame = false;
+
+	if ((m_bUsePersistentRing == false) || (m_vertexArrayID == 0))
+	{
+		return;
+	}
+
+	const size_t instanceStride = sizeof(InstancedMeshes::INSTANCE_DATA);
+	size_t instanceBytes = (size_t)maxInstances * instanceStride;
+	size_t commandBytes = (size_t)maxCommands * sizeof(DRAW_ELEMENTS_COMMAND);
+	// room for aligning both allocations
+	if (m_ring.BeginFrame(instanceBytes + commandBytes + instanceStride + sizeof(GLuint)) == false)
+	{
+		UseUploadedInstances();
+		return;
+	}
+
+	if (m_ring.GetBufferID() != m_attachedRingID)
+	{
+		glBindVertexArray(m_vertexArrayID);
+		glBindBuffer(GL_ARRAY_BUFFER, m_ring.GetBufferID());
+		InstancedMeshes::EnableInstanceAttributes();
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		m_attachedRingID = m_ring.GetBufferID();
+	}
+
+	// the instances start on a whole instance, so their position in
+	// the ring can be passed to the shader as a base instance
+	size_t instanceOffset = 0;
+	m_pRingInstances = (InstancedMeshes::INSTANCE_DATA*)m_ring.Allocate(instanceBytes, instanceStride, instanceOffset);
+	m_pRingCommands = (DRAW_ELEMENTS_COMMAND*)m_ring.Allocate(commandBytes, sizeof(GLuint), m_indirectOffset);
+	if ((NULL != m_pRingInstances) && (NULL != m_pRingCommands))
+	{
+		m_ringInstanceCapacity = maxInstances;
+		m_ringCommandCapacity = maxCommands;
+		m_ringBaseInstance = (GLuint)(instanceOffset / instanceStride);
+		m_bRingFrame = true;
+	}
+	else
+	{
+		m_indirectOffset = 0;
+		UseUploadedInstances();
+	}
+}
+
+/***********************************************************
+ *  UseUploadedInstances()
+ *
+ *  This method is used for pointing the instance attributes
+ *  back at the uploaded instance buffer for a frame whose
+ *  draw data could not be written into the ring.
+ ***********************************************************/
+void MeshMegaBuffer::UseUploadedInstances()
+{
+	if (m_attachedRingID == 0)
+	{
+		return;
+	}
+
+	glBindVertexArray(m_vertexArrayID);
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBufferID);
+	InstancedMeshes::EnableInstanceAttributes();
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	m_attachedRingID = 0;
+}
+
+/***********************************************************
+ *  AddDraw()
+ *
+ *  This method is used for adding a command that draws the
+ *  passed in instances with the mesh at a level of detail.
+ *  The instances are
+ *  appended to those of the frame and the command's base
+ *  instance points at the first of them.
+ ***********************************************************/
+int MeshMegaBuffer::AddDraw(SceneFile::MESH_TYPE meshType, int level, const InstancedMeshes::INSTANCE_DATA* pInstances, int instanceCount)
+{
+	if ((meshType < 0) || (meshType >= SceneFile::MESH_TYPE_COUNT) ||
+		(level < 0) || (level >= MeshGeometry::LEVEL_COUNT) || (instanceCount <= 0))
+	{
+		return(-1);
+	}
+
+	const MESH_RANGE& range = m_meshRanges[meshType][level];
+	DRAW_ELEMENTS_COMMAND command;
+	command.count = range.indexCount;
+	command.instanceCount = (GLuint)instanceCount;
+	command.firstIndex = range.firstIndex;
+	command.baseVertex = range.baseVertex;
+	command.baseInstance = (GLuint)m_instanceCount;
+
+	if (m_bRingFrame == true)
+	{
+		if ((m_instanceCount + instanceCount > m_ringInstanceCapacity) ||
+			(m_commandCount + 1 > m_ringCommandCapacity))
+		{
+			return(-1);
+		}
+
+		// written straight into the mapped memory the GPU reads
+		memcpy(m_pRingInstances + m_instanceCount, pInstances, instanceCount * sizeof(InstancedMeshes::INSTANCE_DATA));
+		command.baseInstance += m_ringBaseInstance;
+		m_pRingCommands[m_commandCount] = command;
+	}
+	else
+	{
+		m_instances.insert(m_instances.end(), pInstances, pInstances + instanceCount);
+		m_commands.push_back(command);
+	}
+
+	m_instanceCount += instanceCount;
+	return(m_commandCount++);
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for uploading the instances and
+ *  commands of the frame.  Each buffer only grows, and its
+ *  storage is orphaned before the upload so the driver does
+ *  not wait for the last frame's draws.  Nothing needs to
+ *  be uploaded for a frame written into the ring.
+ ***********************************************************/
+void MeshMegaBuffer::Upload()
+{
+	if ((m_vertexArrayID == 0) || (m_commands.empty() == true))
+	{
+		return;
+	}
+
+	size_t instanceBytes = m_instances.size() * sizeof(InstancedMeshes::INSTANCE_DATA);
+	if (instanceBytes > m_instanceBufferSize)
+	{
+		m_instanceBufferSize = instanceBytes + instanceBytes / 2;
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBufferID);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)m_instanceBufferSize, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)instanceBytes, m_instances.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	size_t commandBytes = m_commands.size() * sizeof(DRAW_ELEMENTS_COMMAND);
+	if (commandBytes > m_indirectBufferSize)
+	{
+		m_indirectBufferSize = commandBytes + commandBytes / 2;
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBufferID);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, (GLsizeiptr)m_indirectBufferSize, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, (GLsizeiptr)commandBytes, m_commands.data());
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method is used for submitting a range of the
+ *  uploaded commands with one multi-draw-indirect call.
+ ***********************************************************/
+void MeshMegaBuffer::Draw(int firstCommand, int commandCount)
+{
+	if ((m_vertexArrayID == 0) || (commandCount <= 0))
+	{
+		return;
+	}
+
+	glBindVertexArray(m_vertexArrayID);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, (m_bRingFrame == true) ? m_ring.GetBufferID() : m_indirectBufferID);
+	glMultiDrawElementsIndirect(
+		GL_TRIANGLES,
+		GL_UNSIGNED_INT,
+		(const void*)(m_indirectOffset + firstCommand * sizeof(DRAW_ELEMENTS_COMMAND)),
+		commandCount,
+		0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+
+	m_submitCount++;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for fencing the ring region written
+ *  this frame, after every draw reading it was submitted.
+ ***********************************************************/
+void MeshMegaBuffer::EndFrame()
+{
+	if (m_bUsePersistentRing == true)
+	{
+		m_ring.EndFrame();
+	}
+}
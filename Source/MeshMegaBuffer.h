@@ -0,0 +1,138 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshmegabuffer.h
+// ============
+// keep every basic mesh in one shared vertex and index buffer and submit
+// the draws of a frame with multi-draw-indirect
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "InstancedMeshes.h"
+#include "MeshGeometry.h"
+#include "PersistentRingBuffer.h"
+#include "SceneFile.h"
+
+#include <GL/glew.h>
+
+#include <vector>
+
+/***********************************************************
+ *  MeshMegaBuffer
+ *
+ *  This class sub-allocates the geometry of every scene
+ *  mesh type from one vertex buffer and one index buffer,
+ *  which a single vertex array reads along with one shared
+ *  instance buffer, so no vertex state changes between
+ *  draws.  Draws are added as indirect commands whose base
+ *  vertex, first index and base instance select the mesh
+ *  and level of detail and its instances, and ranges of
+ *  commands are submitted
+ *  with glMultiDrawElementsIndirect.  In persistent ring
+ *  mode the instances and commands are written straight
+ *  into a persistently mapped ring buffer instead of being
+ *  uploaded each frame, falling back to the upload for any
+ *  frame the ring has no room for.
+ ***********************************************************/
+class MeshMegaBuffer
+{
+public:
+	// one command, in the layout glMultiDrawElementsIndirect reads
+	struct DRAW_ELEMENTS_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// constructor
+	MeshMegaBuffer();
+	// destructor
+	~MeshMegaBuffer();
+
+	// true when the context can draw with multi-draw-indirect
+	static bool IsSupported();
+
+	// choose whether the draw data is written into a persistently
+	// mapped ring buffer - must be set before Create
+	void SetPersistentRingMode(bool bEnable);
+	bool IsPersistentRingMode() const { return m_bUsePersistentRing; }
+
+	// build every mesh type, at each level of detail, into the
+	// shared buffers
+	bool Create();
+	// delete the vertex array and buffers
+	void Destroy();
+
+	// start a frame of at most the passed in instances and commands
+	void BeginFrame(int maxInstances, int maxCommands);
+	// add a command drawing the instances with the mesh at a level of
+	// detail, returning its index
+	int AddDraw(SceneFile::MESH_TYPE meshType, int level, const InstancedMeshes::INSTANCE_DATA* pInstances, int instanceCount);
+	// upload the commands and instances added this frame
+	void Upload();
+	// submit a range of the uploaded commands with one call
+	void Draw(int firstCommand, int commandCount);
+	// finish the frame once all of its draws are submitted
+	void EndFrame();
+
+	// get the multi-draw calls, commands and instances of the frame
+	int GetSubmitCount() const { return m_submitCount; }
+	int GetCommandCount() const { return m_commandCount; }
+	int GetInstanceCount() const { return m_instanceCount; }
+	// get the number of frames that waited for the GPU to free a ring region
+	int GetRingWaitCount() const { return m_ring.GetWaitCount(); }
+
+private:
+	// mesh buffers cannot be copied
+	MeshMegaBuffer(const MeshMegaBuffer&);
+	MeshMegaBuffer& operator=(const MeshMegaBuffer&);
+
+	// point the instance attributes at the uploaded instance buffer
+	void UseUploadedInstances();
+
+	// where a mesh lives in the shared buffers
+	struct MESH_RANGE
+	{
+		GLuint firstIndex;
+		GLuint indexCount;
+		GLint baseVertex;
+	};
+
+	MESH_RANGE m_meshRanges[SceneFile::MESH_TYPE_COUNT][MeshGeometry::LEVEL_COUNT];
+	GLuint m_vertexArrayID;
+	GLuint m_vertexBufferID;
+	GLuint m_indexBufferID;
+	GLuint m_instanceBufferID;
+	GLuint m_indirectBufferID;
+	// sizes of the instance and indirect buffers, in bytes
+	size_t m_instanceBufferSize;
+	size_t m_indirectBufferSize;
+
+	// commands and instances of the frame
+	std::vector<DRAW_ELEMENTS_COMMAND> m_commands;
+	std::vector<InstancedMeshes::INSTANCE_DATA> m_instances;
+	int m_commandCount;
+	int m_instanceCount;
+	int m_submitCount;
+
+	// true when the draw data is written into the ring buffer
+	bool m_bUsePersistentRing;
+	PersistentRingBuffer m_ring;
+	// true when this frame's draw data went into the ring - when no
+	// ring region could be reserved it is uploaded like without one
+	bool m_bRingFrame;
+	// ring buffer the vertex array reads its instances from
+	GLuint m_attachedRingID;
+	// where this frame's instances and commands go in the ring
+	InstancedMeshes::INSTANCE_DATA* m_pRingInstances;
+	DRAW_ELEMENTS_COMMAND* m_pRingCommands;
+	int m_ringInstanceCapacity;
+	int m_ringCommandCapacity;
+	// index of the frame's first instance in the ring
+	GLuint m_ringBaseInstance;
+	// byte offset of the frame's commands in the indirect buffer
+	size_t m_indirectOffset;
+};
@@ -0,0 +1,642 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionbuffer.cpp
+// ============
+// rasterize large occluders into a small depth buffer on the CPU and
+// test the bounds of other objects against it
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OcclusionBuffer.h"
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define OCCLUSION_BUFFER_SSE2
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// corners closer to the eye than this are treated as crossing
+	// the near plane
+	const float g_MinimumW = 1.0e-3f;
+	// the most worker threads started, beyond which the tiles of a
+	// small buffer do not go further
+	const int g_MaxWorkerCount = 7;
+
+	// the six faces of a box as corner indices, where bit 0 of a
+	// corner selects the maximum X, bit 1 Y and bit 2 Z - each face
+	// is counterclockwise seen from outside the box
+	const int g_BoxFaces[6][4] =
+	{
+		{ 0, 4, 6, 2 },
+		{ 1, 3, 7, 5 },
+		{ 0, 1, 5, 4 },
+		{ 2, 6, 7, 3 },
+		{ 0, 2, 3, 1 },
+		{ 4, 5, 7, 6 }
+	};
+
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	// get the eight corners of a box in clip space
+	void GetClipCorners(const glm::mat4& matrix, const glm::vec3& boxMin, const glm::vec3& boxMax, glm::vec4 corners[8])
+	{
+		for (int i = 0; i < 8; i++)
+		{
+			glm::vec4 corner(
+				(i & 1) ? boxMax.x : boxMin.x,
+				(i & 2) ? boxMax.y : boxMin.y,
+				(i & 4) ? boxMax.z : boxMin.z,
+				1.0f);
+			corners[i] = matrix * corner;
+		}
+	}
+}
+
+/***********************************************************
+ *  OcclusionBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+OcclusionBuffer::OcclusionBuffer(int width, int height, int workerCount)
+{
+	m_tilesX = std::max(1, (width + TILE_WIDTH - 1) / TILE_WIDTH);
+	m_tilesY = std::max(1, (height + TILE_HEIGHT - 1) / TILE_HEIGHT);
+	m_width = m_tilesX * TILE_WIDTH;
+	m_height = m_tilesY * TILE_HEIGHT;
+	m_depth.assign((size_t)m_width * m_height, 0.0f);
+	m_tileTriangles.resize(m_tilesX * m_tilesY);
+	m_viewProjection = glm::mat4(1.0f);
+	m_pJobSystem = NULL;
+	m_frameNumber = 0;
+	m_finishedWorkers = 0;
+	m_bStopping = false;
+	m_nextTile = 0;
+	m_bTesting = false;
+	memset(&m_currentFrame, 0, sizeof(m_currentFrame));
+	m_lastFrame = m_currentFrame;
+	m_totals = m_currentFrame;
+	m_frameCount = 0;
+
+	// the calling thread rasterizes too, so it takes one core
+	if (workerCount < 0)
+	{
+		workerCount = (int)std::thread::hardware_concurrency() - 1;
+	}
+	workerCount = std::min(workerCount, g_MaxWorkerCount);
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&OcclusionBuffer::RasterizeWorker, this));
+	}
+}
+
+/***********************************************************
+ *  ~OcclusionBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+OcclusionBuffer::~OcclusionBuffer()
+{
+	StopWorkers();
+}
+
+/***********************************************************
+ *  StopWorkers()
+ *
+ *  This method is used for waking the worker threads to
+ *  stop and waiting until they have.
+ ***********************************************************/
+void OcclusionBuffer::StopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+	m_startCondition.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+}
+
+/***********************************************************
+ *  SetJobSystem()
+ *
+ *  This method is used for rasterizing the tiles as jobs
+ *  alongside the rest of the frame's work, rather than on
+ *  threads of the buffer's own competing for the same
+ *  cores.  The worker threads are stopped for good.
+ ***********************************************************/
+void OcclusionBuffer::SetJobSystem(JobSystem* pJobSystem)
+{
+	m_pJobSystem = pJobSystem;
+	if (NULL != m_pJobSystem)
+	{
+		StopWorkers();
+	}
+}
+
+/***********************************************************
+ *  GetThreadCount()
+ *
+ *  This method is used for getting the number of threads
+ *  the tiles are rasterized on, including the caller.
+ ***********************************************************/
+int OcclusionBuffer::GetThreadCount() const
+{
+	if (NULL != m_pJobSystem)
+	{
+		return(m_pJobSystem->GetThreadCount());
+	}
+	return((int)m_workers.size() + 1);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for clearing the buffer to nothing
+ *  drawn and forgetting the occluders of the last frame.
+ ***********************************************************/
+void OcclusionBuffer::BeginFrame(const glm::mat4& viewProjection)
+{
+	m_viewProjection = viewProjection;
+	std::fill(m_depth.begin(), m_depth.end(), 0.0f);
+	m_triangles.clear();
+	for (std::vector<uint32_t>& tile : m_tileTriangles)
+	{
+		tile.clear();
+	}
+	m_bTesting = false;
+	memset(&m_currentFrame, 0, sizeof(m_currentFrame));
+}
+
+/***********************************************************
+ *  AddOccluder()
+ *
+ *  This method is used for adding the front faces of an
+ *  occluder box.  An occluder with a corner behind the eye
+ *  is skipped rather than clipped, which only loses some
+ *  occlusion.  A mirroring model matrix turns the faces
+ *  inside out, so their winding is flipped back.
+ ***********************************************************/
+void OcclusionBuffer::AddOccluder(const glm::mat4& model, const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+	glm::vec4 corners[8];
+	GetClipCorners(m_viewProjection * model, boxMin, boxMax, corners);
+	for (int i = 0; i < 8; i++)
+	{
+		if (corners[i].w < g_MinimumW)
+		{
+			return;
+		}
+	}
+
+	glm::vec3 axisX = glm::vec3(model[0]);
+	glm::vec3 axisY = glm::vec3(model[1]);
+	glm::vec3 axisZ = glm::vec3(model[2]);
+	bool bMirrored = (glm::dot(glm::cross(axisX, axisY), axisZ) < 0.0f);
+	for (int face = 0; face < 6; face++)
+	{
+		const int* pCorners = g_BoxFaces[face];
+		if (bMirrored == true)
+		{
+			AddTriangle(corners[pCorners[0]], corners[pCorners[2]], corners[pCorners[1]]);
+			AddTriangle(corners[pCorners[0]], corners[pCorners[3]], corners[pCorners[2]]);
+		}
+		else
+		{
+			AddTriangle(corners[pCorners[0]], corners[pCorners[1]], corners[pCorners[2]]);
+			AddTriangle(corners[pCorners[0]], corners[pCorners[2]], corners[pCorners[3]]);
+		}
+	}
+	m_currentFrame.occluderCount++;
+}
+
+/***********************************************************
+ *  AddTriangle()
+ *
+ *  This method is used for projecting a triangle to pixels,
+ *  dropping it when it faces away or is off the screen, and
+ *  adding it to the tiles it touches.  The edge functions
+ *  and 1/w are set up to be evaluated at pixel centers from
+ *  whole pixel coordinates.  1/w is linear across the
+ *  screen, so it is interpolated without correction.
+ ***********************************************************/
+void OcclusionBuffer::AddTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+{
+	const glm::vec4* pCorners[3] = { &a, &b, &c };
+	float x[3];
+	float y[3];
+	float z[3];
+	for (int i = 0; i < 3; i++)
+	{
+		z[i] = 1.0f / pCorners[i]->w;
+		x[i] = (pCorners[i]->x * z[i] * 0.5f + 0.5f) * m_width;
+		y[i] = (pCorners[i]->y * z[i] * 0.5f + 0.5f) * m_height;
+	}
+
+	// counterclockwise triangles face the eye
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (area <= 0.0f)
+	{
+		return;
+	}
+
+	SCREEN_TRIANGLE triangle;
+	triangle.minX = std::max(0, (int)std::floor(std::min(x[0], std::min(x[1], x[2]))));
+	triangle.minY = std::max(0, (int)std::floor(std::min(y[0], std::min(y[1], y[2]))));
+	triangle.maxX = std::min(m_width - 1, (int)std::ceil(std::max(x[0], std::max(x[1], x[2]))));
+	triangle.maxY = std::min(m_height - 1, (int)std::ceil(std::max(y[0], std::max(y[1], y[2]))));
+	if ((triangle.minX > triangle.maxX) || (triangle.minY > triangle.maxY))
+	{
+		return;
+	}
+
+	for (int edge = 0; edge < 3; edge++)
+	{
+		int next = (edge + 1) % 3;
+		triangle.edgeA[edge] = y[edge] - y[next];
+		triangle.edgeB[edge] = x[next] - x[edge];
+		triangle.edgeC[edge] = -(triangle.edgeA[edge] * x[edge] + triangle.edgeB[edge] * y[edge]) +
+			0.5f * (triangle.edgeA[edge] + triangle.edgeB[edge]);
+	}
+
+	triangle.depthA = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+	triangle.depthB = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+	triangle.depthC = z[0] - triangle.depthA * x[0] - triangle.depthB * y[0] +
+		0.5f * (triangle.depthA + triangle.depthB);
+
+	uint32_t triangleIndex = (uint32_t)m_triangles.size();
+	m_triangles.push_back(triangle);
+	for (int tileY = triangle.minY / TILE_HEIGHT; tileY <= triangle.maxY / TILE_HEIGHT; tileY++)
+	{
+		for (int tileX = triangle.minX / TILE_WIDTH; tileX <= triangle.maxX / TILE_WIDTH; tileX++)
+		{
+			m_tileTriangles[tileY * m_tilesX + tileX].push_back(triangleIndex);
+		}
+	}
+	m_currentFrame.triangleCount++;
+}
+
+/***********************************************************
+ *  Rasterize()
+ *
+ *  This method is used for rasterizing the tiles of the
+ *  frame, as jobs when there is a job system, or else by
+ *  waking the workers to share them with the calling thread
+ *  and waiting until every worker is done.
+ ***********************************************************/
+void OcclusionBuffer::Rasterize()
+{
+	Clock::time_point start = Clock::now();
+
+	if (NULL != m_pJobSystem)
+	{
+		m_pJobSystem->ParallelFor(m_tilesX * m_tilesY, 1, [this](int first, int count)
+			{
+				for (int tileIndex = first; tileIndex < first + count; tileIndex++)
+				{
+					RasterizeTile(tileIndex);
+				}
+			});
+		m_currentFrame.rasterMilliseconds = MillisecondsSince(start);
+		return;
+	}
+
+	m_nextTile = 0;
+	if (m_workers.empty() == false)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_finishedWorkers = 0;
+			m_frameNumber++;
+		}
+		m_startCondition.notify_all();
+	}
+
+	RasterizeTiles();
+
+	if (m_workers.empty() == false)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_doneCondition.wait(lock, [this]()
+			{
+				return m_finishedWorkers == (int)m_workers.size();
+			});
+	}
+
+	m_currentFrame.rasterMilliseconds = MillisecondsSince(start);
+}
+
+/***********************************************************
+ *  RasterizeWorker()
+ *
+ *  This method runs on each worker thread, rasterizing
+ *  tiles of every frame it is woken for until the buffer is
+ *  destroyed.
+ ***********************************************************/
+void OcclusionBuffer::RasterizeWorker()
+{
+	int lastFrame = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_startCondition.wait(lock, [this, lastFrame]()
+				{
+					return m_bStopping || (m_frameNumber != lastFrame);
+				});
+			if (m_bStopping == true)
+			{
+				return;
+			}
+			lastFrame = m_frameNumber;
+		}
+
+		RasterizeTiles();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_finishedWorkers++;
+		}
+		m_doneCondition.notify_one();
+	}
+}
+
+/***********************************************************
+ *  RasterizeTiles()
+ *
+ *  This method is used for taking tiles one at a time until
+ *  none are left.  Each tile is only ever written by the
+ *  thread that took it.
+ ***********************************************************/
+void OcclusionBuffer::RasterizeTiles()
+{
+	const int tileCount = m_tilesX * m_tilesY;
+	int tileIndex = m_nextTile++;
+	while (tileIndex < tileCount)
+	{
+		RasterizeTile(tileIndex);
+		tileIndex = m_nextTile++;
+	}
+}
+
+/***********************************************************
+ *  RasterizeTile()
+ *
+ *  This method is used for drawing the triangles of one
+ *  tile, keeping the nearest 1/w of each pixel.  The rows of
+ *  each triangle are walked four pixels at a time from an
+ *  aligned start, so the groups never leave the tile.
+ ***********************************************************/
+void OcclusionBuffer::RasterizeTile(int tileIndex)
+{
+	const int tileX0 = (tileIndex % m_tilesX) * TILE_WIDTH;
+	const int tileY0 = (tileIndex / m_tilesX) * TILE_HEIGHT;
+
+	for (uint32_t triangleIndex : m_tileTriangles[tileIndex])
+	{
+		const SCREEN_TRIANGLE& triangle = m_triangles[triangleIndex];
+		const int startX = std::max(triangle.minX, tileX0) & ~3;
+		const int endX = std::min(triangle.maxX, tileX0 + TILE_WIDTH - 1);
+		const int startY = std::max(triangle.minY, tileY0);
+		const int endY = std::min(triangle.maxY, tileY0 + TILE_HEIGHT - 1);
+
+		for (int y = startY; y <= endY; y++)
+		{
+			float* pRow = m_depth.data() + (size_t)y * m_width;
+			const float fy = (float)y;
+
+#ifdef OCCLUSION_BUFFER_SSE2
+			const __m128 offsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+			const __m128 zero = _mm_setzero_ps();
+			__m128 xs = _mm_add_ps(_mm_set1_ps((float)startX), offsets);
+			__m128 edges[3];
+			__m128 edgeSteps[3];
+			for (int edge = 0; edge < 3; edge++)
+			{
+				edges[edge] = _mm_add_ps(
+					_mm_mul_ps(_mm_set1_ps(triangle.edgeA[edge]), xs),
+					_mm_set1_ps(triangle.edgeB[edge] * fy + triangle.edgeC[edge]));
+				edgeSteps[edge] = _mm_set1_ps(triangle.edgeA[edge] * 4.0f);
+			}
+			__m128 depth = _mm_add_ps(
+				_mm_mul_ps(_mm_set1_ps(triangle.depthA), xs),
+				_mm_set1_ps(triangle.depthB * fy + triangle.depthC));
+			const __m128 depthStep = _mm_set1_ps(triangle.depthA * 4.0f);
+
+			for (int x = startX; x <= endX; x += 4)
+			{
+				__m128 inside = _mm_and_ps(
+					_mm_and_ps(_mm_cmpgt_ps(edges[0], zero), _mm_cmpgt_ps(edges[1], zero)),
+					_mm_cmpgt_ps(edges[2], zero));
+				if (_mm_movemask_ps(inside) != 0)
+				{
+					__m128 previous = _mm_loadu_ps(pRow + x);
+					__m128 nearest = _mm_max_ps(previous, depth);
+					_mm_storeu_ps(pRow + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, previous)));
+				}
+				edges[0] = _mm_add_ps(edges[0], edgeSteps[0]);
+				edges[1] = _mm_add_ps(edges[1], edgeSteps[1]);
+				edges[2] = _mm_add_ps(edges[2], edgeSteps[2]);
+				depth = _mm_add_ps(depth, depthStep);
+			}
+#else
+			for (int x = startX; x <= endX; x++)
+			{
+				const float fx = (float)x;
+				if ((triangle.edgeA[0] * fx + triangle.edgeB[0] * fy + triangle.edgeC[0] > 0.0f) &&
+					(triangle.edgeA[1] * fx + triangle.edgeB[1] * fy + triangle.edgeC[1] > 0.0f) &&
+					(triangle.edgeA[2] * fx + triangle.edgeB[2] * fy + triangle.edgeC[2] > 0.0f))
+				{
+					float depth = triangle.depthA * fx + triangle.depthB * fy + triangle.depthC;
+					pRow[x] = std::max(pRow[x], depth);
+				}
+			}
+#endif
+		}
+	}
+}
+
+/***********************************************************
+ *  IsOccluded()
+ *
+ *  This method is used for testing a world box against the
+ *  buffer and counting the test in the frame.
+ ***********************************************************/
+bool OcclusionBuffer::IsOccluded(const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+	BeginTests();
+	bool bOccluded = TestBox(boxMin, boxMax);
+	CountTests(1, (bOccluded == true) ? 1 : 0);
+	return(bOccluded);
+}
+
+/***********************************************************
+ *  BeginTests()
+ *
+ *  This method is used for reading the time of the first
+ *  test of the frame.
+ ***********************************************************/
+void OcclusionBuffer::BeginTests()
+{
+	if (m_bTesting == false)
+	{
+		m_testStart = Clock::now();
+		m_bTesting = true;
+	}
+}
+
+/***********************************************************
+ *  CountTests()
+ *
+ *  This method is used for adding tests to the counts of
+ *  the frame.
+ ***********************************************************/
+void OcclusionBuffer::CountTests(int testedCount, int occludedCount)
+{
+	m_currentFrame.testedCount += testedCount;
+	m_currentFrame.occludedCount += occludedCount;
+}
+
+/***********************************************************
+ *  TestBox()
+ *
+ *  This method is used for testing a world box against the
+ *  buffer.  The box is hidden when every pixel of its screen
+ *  rectangle holds an occluder nearer than its nearest
+ *  corner.  The rectangle is grown to whole groups of four
+ *  pixels, which can only make the box more visible, and a
+ *  box crossing the near plane is always visible.  Nothing
+ *  is written, so the boxes can be tested on any thread.
+ ***********************************************************/
+bool OcclusionBuffer::TestBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const
+{
+	glm::vec4 corners[8];
+	GetClipCorners(m_viewProjection, boxMin, boxMax, corners);
+
+	float minX = 1.0e30f;
+	float minY = 1.0e30f;
+	float maxX = -1.0e30f;
+	float maxY = -1.0e30f;
+	float nearest = 0.0f;
+	bool bOccluded = true;
+	for (int i = 0; i < 8; i++)
+	{
+		if (corners[i].w < g_MinimumW)
+		{
+			bOccluded = false;
+			break;
+		}
+		float z = 1.0f / corners[i].w;
+		float x = (corners[i].x * z * 0.5f + 0.5f) * m_width;
+		float y = (corners[i].y * z * 0.5f + 0.5f) * m_height;
+		minX = std::min(minX, x);
+		minY = std::min(minY, y);
+		maxX = std::max(maxX, x);
+		maxY = std::max(maxY, y);
+		nearest = std::max(nearest, z);
+	}
+
+	int startX = std::max(0, (int)std::floor(minX)) & ~3;
+	int endX = std::min(m_width - 1, (int)std::floor(maxX));
+	int startY = std::max(0, (int)std::floor(minY));
+	int endY = std::min(m_height - 1, (int)std::floor(maxY));
+	// boxes off the screen are left to the frustum culling
+	if ((startX > endX) || (startY > endY))
+	{
+		bOccluded = false;
+	}
+
+	for (int y = startY; (y <= endY) && (bOccluded == true); y++)
+	{
+		const float* pRow = m_depth.data() + (size_t)y * m_width;
+#ifdef OCCLUSION_BUFFER_SSE2
+		const __m128 boxDepth = _mm_set1_ps(nearest);
+		for (int x = startX; x <= endX; x += 4)
+		{
+			if (_mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(pRow + x), boxDepth)) != 0)
+			{
+				bOccluded = false;
+				break;
+			}
+		}
+#else
+		for (int x = startX; x <= endX; x++)
+		{
+			if (pRow[x] <= nearest)
+			{
+				bOccluded = false;
+				break;
+			}
+		}
+#endif
+	}
+
+	return(bOccluded);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for closing the counts of the frame.
+ ***********************************************************/
+void OcclusionBuffer::EndFrame()
+{
+	if (m_bTesting == true)
+	{
+		m_currentFrame.testMilliseconds = MillisecondsSince(m_testStart);
+		m_bTesting = false;
+	}
+	m_lastFrame = m_currentFrame;
+	m_totals.occluderCount += m_currentFrame.occluderCount;
+	m_totals.triangleCount += m_currentFrame.triangleCount;
+	m_totals.testedCount += m_currentFrame.testedCount;
+	m_totals.occludedCount += m_currentFrame.occludedCount;
+	m_totals.rasterMilliseconds += m_currentFrame.rasterMilliseconds;
+	m_totals.testMilliseconds += m_currentFrame.testMilliseconds;
+	m_frameCount++;
+}
+
+/***********************************************************
+ *  PrintStatistics()
+ *
+ *  This method is used for printing the occluders drawn,
+ *  the share of tested objects found hidden and the CPU
+ *  time of rasterizing and testing per frame.
+ ***********************************************************/
+void OcclusionBuffer::PrintStatistics() const
+{
+	if (m_frameCount == 0)
+	{
+		return;
+	}
+
+	std::cout << std::fixed << std::setprecision(3)
+		<< "Occlusion culling per frame over " << m_frameCount << " frames: "
+		<< ((double)m_totals.occluderCount / m_frameCount) << " occluders ("
+		<< ((double)m_totals.triangleCount / m_frameCount) << " triangles) at "
+		<< m_width << "x" << m_height << " on " << GetThreadCount() << " threads, "
+		<< ((double)m_totals.occludedCount / m_frameCount) << " of "
+		<< ((double)m_totals.testedCount / m_frameCount) << " objects hidden ("
+		<< (m_totals.testedCount > 0 ? 100.0 * m_totals.occludedCount / m_totals.testedCount : 0.0) << "%), "
+		<< (m_totals.rasterMilliseconds / m_frameCount) << " ms rasterizing, "
+		<< (m_totals.testMilliseconds / m_frameCount) << " ms testing" << std::endl;
+}
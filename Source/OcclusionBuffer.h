@@ -0,0 +1,163 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionbuffer.h
+// ============
+// rasterize large occluders into a small depth buffer on the CPU and
+// test the bounds of other objects against it
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+/***********************************************************
+ *  OcclusionBuffer
+ *
+ *  This class finds objects hidden behind large occluders
+ *  without the GPU.  Each frame the boxes of the chosen
+ *  occluders are transformed, their front facing triangles
+ *  are binned into screen tiles, and the tiles are
+ *  rasterized on the threads of a job system, or on a
+ *  pool of its own worker threads, into a low
+ *  resolution buffer holding the nearest 1/w of every
+ *  pixel, four pixels at a time with SSE2.  The screen box
+ *  of another object is then tested against the buffer: it
+ *  is hidden when every pixel it covers holds an occluder
+ *  nearer than the nearest point of the object.  Occluder
+ *  boxes must lie inside the meshes they stand for, so an
+ *  object is never hidden by empty space.
+ ***********************************************************/
+class OcclusionBuffer
+{
+public:
+	// size of the tiles the threads rasterize, in pixels
+	static const int TILE_WIDTH = 32;
+	static const int TILE_HEIGHT = 16;
+
+	// counts and CPU time of one frame
+	struct FRAME_STATISTICS
+	{
+		int occluderCount;
+		int triangleCount;
+		int testedCount;
+		int occludedCount;
+		double rasterMilliseconds;
+		double testMilliseconds;
+	};
+
+	// constructor - the width and height are rounded up to whole
+	// tiles, and a negative worker count means one per extra CPU core
+	OcclusionBuffer(int width = 256, int height = 128, int workerCount = -1);
+	// destructor
+	~OcclusionBuffer();
+
+	// clear the buffer and start a frame seen through the matrix
+	void BeginFrame(const glm::mat4& viewProjection);
+	// add the box of an occluder in object space, placed by the model
+	// matrix - occluders crossing the near plane are skipped
+	void AddOccluder(const glm::mat4& model, const glm::vec3& boxMin, const glm::vec3& boxMax);
+	// rasterize the tiles as jobs on the threads of a job system,
+	// stopping the worker threads of the buffer
+	void SetJobSystem(JobSystem* pJobSystem);
+	// rasterize every added occluder into the buffer
+	void Rasterize();
+	// test a world space box, returning true when it is hidden
+	bool IsOccluded(const glm::vec3& boxMin, const glm::vec3& boxMax);
+	// test a world space box without counting it, which several
+	// threads can do at once once the buffer is rasterized
+	bool TestBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+	// start the test time of the frame, if no test has yet
+	void BeginTests();
+	// count the tests made with TestBox
+	void CountTests(int testedCount, int occludedCount);
+	// close the counts of the frame - the test time runs from the
+	// first test of the frame to here
+	void EndFrame();
+
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+	int GetThreadCount() const;
+	// get the nearest occluder 1/w of each pixel, rows from the bottom
+	const float* GetDepth() const { return m_depth.data(); }
+	FRAME_STATISTICS GetLastFrameStatistics() const { return m_lastFrame; }
+	// print the average hit rate and cost per frame
+	void PrintStatistics() const;
+
+private:
+	// a front facing triangle in pixel coordinates, set up for
+	// stepping its edge functions and depth across the screen
+	struct SCREEN_TRIANGLE
+	{
+		// edge function i at a pixel is edgeC + edgeA * x + edgeB * y
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		// 1/w at a pixel is depthC + depthA * x + depthB * y
+		float depthA;
+		float depthB;
+		float depthC;
+		// pixel bounds, inclusive
+		int minX;
+		int minY;
+		int maxX;
+		int maxY;
+	};
+
+	int m_width;
+	int m_height;
+	int m_tilesX;
+	int m_tilesY;
+	// nearest 1/w of each pixel, zero where nothing was drawn
+	std::vector<float> m_depth;
+	glm::mat4 m_viewProjection;
+	std::vector<SCREEN_TRIANGLE> m_triangles;
+	// triangles touching each tile
+	std::vector<std::vector<uint32_t>> m_tileTriangles;
+
+	// job system the tiles are rasterized on, or NULL to use the
+	// worker threads
+	JobSystem* m_pJobSystem;
+	// worker threads, started once and woken for every frame
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_startCondition;
+	std::condition_variable m_doneCondition;
+	int m_frameNumber;
+	int m_finishedWorkers;
+	bool m_bStopping;
+	std::atomic<int> m_nextTile;
+
+	// time of the first test of the frame, read once rather than
+	// around every test
+	std::chrono::steady_clock::time_point m_testStart;
+	bool m_bTesting;
+	FRAME_STATISTICS m_currentFrame;
+	FRAME_STATISTICS m_lastFrame;
+	FRAME_STATISTICS m_totals;
+	int m_frameCount;
+
+	// add a triangle whose corners are in clip space
+	void AddTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+	// rasterize tiles until every tile of the frame is taken
+	void RasterizeTiles();
+	// rasterize the triangles of one tile
+	void RasterizeTile(int tileIndex);
+	// wait for frames and rasterize their tiles
+	void RasterizeWorker();
+	// stop and join the worker threads
+	void StopWorkers();
+
+	// occlusion buffers cannot be copied
+	OcclusionBuffer(const OcclusionBuffer&);
+	OcclusionBuffer& operator=(const OcclusionBuffer&);
+};
@@ -0,0 +1,212 @@
+///////////////////////////////////////////////////////////////////////////////
+// offscreencontext.cpp
+// ============
+// create an OpenGL context without a window on screen, for rendering
+// frames in batch
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OffscreenContext.h"
+
+#if defined(__linux__)
+#define OFFSCREEN_CONTEXT_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// minor versions of OpenGL 4 to ask for, newest first, since
+	// llvmpipe stops at 4.5
+	const int g_ContextMinorVersions[] = { 6, 5 };
+	const int g_ContextVersionCount = sizeof(g_ContextMinorVersions) / sizeof(g_ContextMinorVersions[0]);
+}
+
+/***********************************************************
+ *  OffscreenContext()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+OffscreenContext::OffscreenContext()
+{
+	m_eglDisplay = NULL;
+	m_eglContext = NULL;
+	m_pHiddenWindow = NULL;
+}
+
+/***********************************************************
+ *  ~OffscreenContext()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+OffscreenContext::~OffscreenContext()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the context and making
+ *  it current on the calling thread.
+ ***********************************************************/
+bool OffscreenContext::Create()
+{
+	if (CreateSurfaceless() == true)
+	{
+		std::cout << "INFO: Rendering offscreen through a surfaceless EGL context" << std::endl;
+		return(true);
+	}
+	if (CreateHiddenWindow() == true)
+	{
+		std::cout << "INFO: Rendering offscreen through a hidden window" << std::endl;
+		return(true);
+	}
+
+	std::cout << "ERROR: Failed to create an offscreen OpenGL context" << std::endl;
+	return(false);
+}
+
+/***********************************************************
+ *  CreateSurfaceless()
+ *
+ *  This method is used for creating a core profile context
+ *  on Mesa's surfaceless EGL platform.  The context is made
+ *  current without any surface, which leaves no default
+ *  framebuffer at all.
+ ***********************************************************/
+bool OffscreenContext::CreateSurfaceless()
+{
+#ifdef OFFSCREEN_CONTEXT_EGL
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (NULL == getPlatformDisplay)
+	{
+		return(false);
+	}
+
+	EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	if (EGL_NO_DISPLAY == display)
+	{
+		return(false);
+	}
+	EGLint majorVersion = 0;
+	EGLint minorVersion = 0;
+	if ((eglInitialize(display, &majorVersion, &minorVersion) == EGL_FALSE) ||
+		(eglBindAPI(EGL_OPENGL_API) == EGL_FALSE))
+	{
+		eglTerminate(display);
+		return(false);
+	}
+
+	// the context is never drawn through a surface, so any
+	// config will do, or none where the driver allows it
+	const EGLint configAttributes[] = {
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config = EGL_NO_CONFIG_KHR;
+	EGLint configCount = 0;
+	if ((eglChooseConfig(display, configAttributes, &config, 1, &configCount) == EGL_FALSE) ||
+		(configCount == 0))
+	{
+		config = EGL_NO_CONFIG_KHR;
+	}
+
+	EGLContext context = EGL_NO_CONTEXT;
+	for (int i = 0; (i < g_ContextVersionCount) && (EGL_NO_CONTEXT == context); i++)
+	{
+		const EGLint contextAttributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION_KHR, 4,
+			EGL_CONTEXT_MINOR_VERSION_KHR, g_ContextMinorVersions[i],
+			EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+			EGL_NONE
+		};
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+	}
+	if (EGL_NO_CONTEXT == context)
+	{
+		eglTerminate(display);
+		return(false);
+	}
+	if (eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context) == EGL_FALSE)
+	{
+		eglDestroyContext(display, context);
+		eglTerminate(display);
+		return(false);
+	}
+
+	m_eglDisplay = display;
+	m_eglContext = context;
+	return(true);
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  CreateHiddenWindow()
+ *
+ *  This method is used for creating a window that is never
+ *  shown and making its context current.
+ ***********************************************************/
+bool OffscreenContext::CreateHiddenWindow()
+{
+	if (glfwInit() == GLFW_FALSE)
+	{
+		return(false);
+	}
+
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#ifdef __APPLE__
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	m_pHiddenWindow = glfwCreateWindow(16, 16, "Offscreen", NULL, NULL);
+#else
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	for (int i = 0; (i < g_ContextVersionCount) && (NULL == m_pHiddenWindow); i++)
+	{
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, g_ContextMinorVersions[i]);
+		m_pHiddenWindow = glfwCreateWindow(16, 16, "Offscreen", NULL, NULL);
+	}
+#endif
+	if (NULL == m_pHiddenWindow)
+	{
+		glfwTerminate();
+		return(false);
+	}
+
+	glfwMakeContextCurrent(m_pHiddenWindow);
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for releasing the context and the
+ *  display or window behind it.
+ ***********************************************************/
+void OffscreenContext::Destroy()
+{
+#ifdef OFFSCREEN_CONTEXT_EGL
+	if (NULL != m_eglContext)
+	{
+		eglMakeCurrent((EGLDisplay)m_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext((EGLDisplay)m_eglDisplay, (EGLContext)m_eglContext);
+		eglTerminate((EGLDisplay)m_eglDisplay);
+		m_eglContext = NULL;
+		m_eglDisplay = NULL;
+	}
+#endif
+	if (NULL != m_pHiddenWindow)
+	{
+		glfwDestroyWindow(m_pHiddenWindow);
+		glfwTerminate();
+		m_pHiddenWindow = NULL;
+	}
+}
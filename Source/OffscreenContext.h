@@ -0,0 +1,60 @@
+///////////////////////////////////////////////////////////////////////////////
+// offscreencontext.h
+// ============
+// create an OpenGL context without a window on screen, for rendering
+// frames in batch
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+// GLFW library
+#include "GLFW/glfw3.h"
+
+/***********************************************************
+ *  OffscreenContext
+ *
+ *  This class makes an OpenGL context current without
+ *  showing a window.  On Linux it first asks EGL for a
+ *  surfaceless display, which needs no X server and runs
+ *  on Mesa's llvmpipe on machines without a GPU, and falls
+ *  back to a hidden GLFW window elsewhere.  Either way the
+ *  context has no framebuffer worth drawing into, so the
+ *  caller renders into its own framebuffer object.
+ ***********************************************************/
+class OffscreenContext
+{
+public:
+	// constructor
+	OffscreenContext();
+	// destructor
+	~OffscreenContext();
+
+	// create the context and make it current
+	bool Create();
+	// release the context
+	void Destroy();
+
+	// true when the context came from EGL rather than GLFW
+	bool IsSurfaceless() const { return(NULL != m_eglContext); }
+
+private:
+	// create a surfaceless EGL context, returning false when
+	// the platform or the driver has none
+	bool CreateSurfaceless();
+	// create a hidden GLFW window and use its context
+	bool CreateHiddenWindow();
+
+	// EGL display and context, kept untyped so the EGL headers
+	// stay out of this header
+	void* m_eglDisplay;
+	void* m_eglContext;
+	// hidden window of the GLFW fallback
+	GLFWwindow* m_pHiddenWindow;
+
+	// offscreen contexts cannot be copied
+	OffscreenContext(const OffscreenContext&);
+	OffscreenContext& operator=(const OffscreenContext&);
+};
@@ -0,0 +1,239 @@
+///////////////////////////////////////////////////////////////////////////////
+// persistentringbuffer.cpp
+// ============
+// a persistently mapped buffer split into per-frame regions guarded by
+// fences, for writing dynamic draw data without driver calls
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PersistentRingBuffer.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// how long to wait on a fence before checking it again
+	const GLuint64 g_FenceTimeoutNanoseconds = 1000000;
+}
+
+/***********************************************************
+ *  PersistentRingBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PersistentRingBuffer::PersistentRingBuffer()
+{
+	m_bufferID = 0;
+	m_pMapped = NULL;
+	m_regionSize = 0;
+	m_currentRegion = FRAME_COUNT - 1;
+	m_currentOffset = 0;
+	for (int i = 0; i < FRAME_COUNT; i++)
+	{
+		m_fences[i] = 0;
+	}
+	m_waitCount = 0;
+}
+
+/***********************************************************
+ *  ~PersistentRingBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+PersistentRingBuffer::~PersistentRingBuffer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking that the context has
+ *  immutable buffer storage, which is core in OpenGL 4.4 and
+ *  available in Mesa's software renderer.
+ ***********************************************************/
+bool PersistentRingBuffer::IsSupported()
+{
+	return (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) ? true : false;
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the buffer with room for
+ *  a region of the passed in size per frame in flight, and
+ *  mapping it once.  The mapping is coherent, so writes are
+ *  seen by the GPU without flushing.
+ ***********************************************************/
+bool PersistentRingBuffer::Create(size_t regionSize)
+{
+	Destroy();
+
+	if (IsSupported() == false)
+	{
+		std::cout << "Persistently mapped buffers are not supported by this OpenGL context" << std::endl;
+		return(false);
+	}
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	const GLsizeiptr bufferSize = (GLsizeiptr)(regionSize * FRAME_COUNT);
+
+	glGenBuffers(1, &m_bufferID);
+	glBindBuffer(GL_ARRAY_BUFFER, m_bufferID);
+	glBufferStorage(GL_ARRAY_BUFFER, bufferSize, NULL, flags);
+	m_pMapped = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bufferSize, flags);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (NULL == m_pMapped)
+	{
+		std::cout << "Could not map the persistent ring buffer" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	m_regionSize = regionSize;
+	m_currentRegion = FRAME_COUNT - 1;
+	m_currentOffset = 0;
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for waiting until the GPU is done
+ *  with every region, then unmapping and deleting the
+ *  buffer.
+ ***********************************************************/
+void PersistentRingBuffer::Destroy()
+{
+	for (int i = 0; i < FRAME_COUNT; i++)
+	{
+		WaitForRegion(i);
+	}
+
+	if (m_bufferID != 0)
+	{
+		if (NULL != m_pMapped)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, m_bufferID);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+		glDeleteBuffers(1, &m_bufferID);
+	}
+	m_bufferID = 0;
+	m_pMapped = NULL;
+	m_regionSize = 0;
+	m_currentOffset = 0;
+}
+
+/***********************************************************
+ *  WaitForRegion()
+ *
+ *  This method is used for blocking until the GPU has
+ *  finished the draws that read the region, if it has not
+ *  already.
+ ***********************************************************/
+void PersistentRingBuffer::WaitForRegion(int region)
+{
+	if (m_fences[region] == 0)
+	{
+		return;
+	}
+
+	GLenum result = glClientWaitSync(m_fences[region], 0, 0);
+	if ((result == GL_TIMEOUT_EXPIRED) || (result == GL_WAIT_FAILED))
+	{
+		m_waitCount++;
+		do
+		{
+			result = glClientWaitSync(m_fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, g_FenceTimeoutNanoseconds);
+		} while (result == GL_TIMEOUT_EXPIRED);
+	}
+
+	glDeleteSync(m_fences[region]);
+	m_fences[region] = 0;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for moving on to the next region,
+ *  waiting for the GPU to finish reading it first.  When
+ *  the frame needs more room than a region holds, the
+ *  buffer is created again with regions twice as large.
+ ***********************************************************/
+bool PersistentRingBuffer::BeginFrame(size_t requiredSize)
+{
+	if ((m_bufferID == 0) || (requiredSize > m_regionSize))
+	{
+		size_t regionSize = (m_regionSize > 0) ? m_regionSize : 65536;
+		while (regionSize < requiredSize)
+		{
+			regionSize *= 2;
+		}
+		if (Create(regionSize) == false)
+		{
+			return(false);
+		}
+	}
+
+	m_currentRegion = (m_currentRegion + 1) % FRAME_COUNT;
+	m_currentOffset = 0;
+	WaitForRegion(m_currentRegion);
+	return(true);
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for reserving bytes in the region of
+ *  the current frame.  The offset in the buffer is aligned
+ *  to the passed in alignment, which does not need to be a
+ *  power of two, so vertex data can start on a whole
+ *  element.
+ ***********************************************************/
+void* PersistentRingBuffer::Allocate(size_t byteCount, size_t alignment, size_t& bufferOffset)
+{
+	if (NULL == m_pMapped)
+	{
+		return(NULL);
+	}
+
+	size_t regionStart = m_currentRegion * m_regionSize;
+	size_t offset = regionStart + m_currentOffset;
+	if (alignment > 1)
+	{
+		offset = ((offset + alignment - 1) / alignment) * alignment;
+	}
+	if (offset + byteCount > regionStart + m_regionSize)
+	{
+		return(NULL);
+	}
+
+	m_currentOffset = offset + byteCount - regionStart;
+	bufferOffset = offset;
+	return m_pMapped + offset;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for placing a fence after the draws
+ *  that read the current region, so it is not written again
+ *  until they finish.
+ ***********************************************************/
+void PersistentRingBuffer::EndFrame()
+{
+	if (m_bufferID == 0)
+	{
+		return;
+	}
+
+	if (m_fences[m_currentRegion] != 0)
+	{
+		glDeleteSync(m_fences[m_currentRegion]);
+	}
+	m_fences[m_currentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
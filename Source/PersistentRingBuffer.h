@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////
+// persistentringbuffer.h
+// ============
+// a persistently mapped buffer split into per-frame regions guarded by
+// fences, for writing dynamic draw data without driver calls
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+/***********************************************************
+ *  PersistentRingBuffer
+ *
+ *  This class creates an immutable buffer that stays mapped
+ *  for its whole life with GL_MAP_PERSISTENT_BIT, divided
+ *  into one region per frame in flight.  Each frame writes
+ *  its draw data straight into the next region through the
+ *  mapped pointer, and a fence placed after the frame's
+ *  draws is waited on before the region is written again,
+ *  so the GPU never reads data that is being overwritten.
+ ***********************************************************/
+class PersistentRingBuffer
+{
+public:
+	// the number of frames that can be in flight at once
+	static const int FRAME_COUNT = 3;
+
+	// constructor
+	PersistentRingBuffer();
+	// destructor
+	~PersistentRingBuffer();
+
+	// true when the context supports persistently mapped buffers
+	static bool IsSupported();
+
+	// create the buffer with regions of the passed in size
+	bool Create(size_t regionSize);
+	// wait for the GPU and delete the buffer
+	void Destroy();
+
+	// wait until the next region is free and start writing to it,
+	// growing every region first when it is smaller than the passed
+	// in size - false if the buffer could not be created
+	bool BeginFrame(size_t requiredSize);
+	// reserve bytes in the current region, returning where to write
+	// them and their offset in the buffer, or NULL when it is full
+	void* Allocate(size_t byteCount, size_t alignment, size_t& bufferOffset);
+	// fence the region once the draws reading it are submitted
+	void EndFrame();
+
+	// get the buffer, which changes when the regions grow
+	GLuint GetBufferID() const { return m_bufferID; }
+	// get the number of frames that had to wait for the GPU
+	int GetWaitCount() const { return m_waitCount; }
+
+private:
+	// ring buffers cannot be copied
+	PersistentRingBuffer(const PersistentRingBuffer&);
+	PersistentRingBuffer& operator=(const PersistentRingBuffer&);
+
+	// wait for the fence of a region and delete it
+	void WaitForRegion(int region);
+
+	GLuint m_bufferID;
+	// mapped memory of the whole buffer
+	unsigned char* m_pMapped;
+	size_t m_regionSize;
+	// region being written, and the bytes used in it
+	int m_currentRegion;
+	size_t m_currentOffset;
+	// fence of the last frame that used each region
+	GLsync m_fences[FRAME_COUNT];
+	int m_waitCount;
+};
@@ -0,0 +1,406 @@
+///////////////////////////////////////////////////////////////////////////////
+// profiler.cpp
+// ============
+// scoped CPU timers and GPU timer queries recorded into per-thread rings
+// and written out as a Chrome trace
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Profiler.h"
+
+#ifdef PROFILER_ENABLED
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// events kept per thread - older events are overwritten
+	const uint64_t g_RingCapacity = 1 << 15;
+	// GPU scopes that may wait for their queries at one time
+	const int g_MaxGpuScopes = 256;
+	// frames between matching the GPU clock to the CPU clock
+	const int g_GpuCalibrationFrames = 300;
+
+	struct PROFILE_EVENT
+	{
+		const char* name;
+		uint64_t startTime;
+		uint64_t duration;
+	};
+
+	// the events of one thread, or of the GPU, written only by the
+	// thread owning it - the write count is published after each
+	// event, so a reader sees whole events up to the count
+	struct EVENT_RING
+	{
+		int trackID;
+		std::string name;
+		std::atomic<uint64_t> writeCount;
+		PROFILE_EVENT events[g_RingCapacity];
+	};
+
+	struct GPU_SCOPE
+	{
+		const char* name;
+		// timestamp queries before and after the scope
+		GLuint queries[2];
+	};
+
+	const Clock::time_point g_LoadTime = Clock::now();
+	std::atomic<bool> g_bEnabled(false);
+	std::string g_TraceFilename;
+
+	// every ring made so far, guarded along with their names
+	std::mutex g_RingMutex;
+	std::vector<EVENT_RING*> g_Rings;
+	thread_local EVENT_RING* g_pThreadRing = NULL;
+
+	// GPU scopes, only used on the OpenGL thread
+	EVENT_RING* g_pGpuRing = NULL;
+	std::vector<GPU_SCOPE> g_GpuScopes;
+	std::vector<int> g_FreeGpuScopes;
+	std::deque<int> g_PendingGpuScopes;
+	int64_t g_GpuClockOffset = 0;
+	int g_GpuFramesSinceCalibration = -1;
+	long long g_DroppedGpuScopes = 0;
+
+	// make a ring and add it to the trace
+	EVENT_RING* CreateRing(const char* name)
+	{
+		EVENT_RING* pRing = new EVENT_RING();
+		pRing->writeCount = 0;
+		std::lock_guard<std::mutex> lock(g_RingMutex);
+		pRing->trackID = (int)g_Rings.size() + 1;
+		pRing->name = name;
+		g_Rings.push_back(pRing);
+		return(pRing);
+	}
+
+	// get the ring of the calling thread, making it on first use
+	EVENT_RING* GetThreadRing()
+	{
+		if (NULL == g_pThreadRing)
+		{
+			g_pThreadRing = CreateRing("Thread");
+		}
+		return(g_pThreadRing);
+	}
+
+	// add an event to a ring, from the thread owning it
+	void PushEvent(EVENT_RING* pRing, const char* name, uint64_t startTime, uint64_t endTime)
+	{
+		const uint64_t writeCount = pRing->writeCount.load(std::memory_order_relaxed);
+		PROFILE_EVENT& event = pRing->events[writeCount % g_RingCapacity];
+		event.name = name;
+		event.startTime = startTime;
+		event.duration = (endTime > startTime) ? (endTime - startTime) : 0;
+		pRing->writeCount.store(writeCount + 1, std::memory_order_release);
+	}
+
+	// write a string as a JSON string
+	void WriteJsonString(std::ofstream& file, const char* text)
+	{
+		file << '"';
+		for (const char* p = text; *p != 0; p++)
+		{
+			if ((*p == '"') || (*p == '\\'))
+			{
+				file << '\\';
+			}
+			file << *p;
+		}
+		file << '"';
+	}
+
+	// match the GPU timestamps to the CPU clock of the events
+	void CalibrateGpuClock()
+	{
+		GLint64 gpuTime = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+		g_GpuClockOffset = (int64_t)Profiler::GetTime() - (int64_t)gpuTime;
+		g_GpuFramesSinceCalibration = 0;
+	}
+}
+
+/***********************************************************
+ *  Enable()
+ *
+ *  This method is used for starting to record.  The scopes
+ *  entered from now on are kept, and the trace is written
+ *  to the passed in file on demand and at shutdown.
+ ***********************************************************/
+void Profiler::Enable(const char* traceFilename)
+{
+	{
+		std::lock_guard<std::mutex> lock(g_RingMutex);
+		g_TraceFilename = traceFilename;
+	}
+	g_bEnabled.store(true);
+}
+
+/***********************************************************
+ *  IsEnabled()
+ *
+ *  This method is used for checking whether scopes are
+ *  being recorded.
+ ***********************************************************/
+bool Profiler::IsEnabled()
+{
+	return(g_bEnabled.load(std::memory_order_relaxed));
+}
+
+/***********************************************************
+ *  SetThreadName()
+ *
+ *  This method is used for naming the track of the calling
+ *  thread in the trace.
+ ***********************************************************/
+void Profiler::SetThreadName(const char* name)
+{
+	if (IsEnabled() == false)
+	{
+		return;
+	}
+
+	EVENT_RING* pRing = GetThreadRing();
+	std::lock_guard<std::mutex> lock(g_RingMutex);
+	pRing->name = name;
+}
+
+/***********************************************************
+ *  GetTime()
+ *
+ *  This method is used for reading the clock the events are
+ *  timed with.
+ ***********************************************************/
+uint64_t Profiler::GetTime()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - g_LoadTime).count();
+}
+
+/***********************************************************
+ *  RecordEvent()
+ *
+ *  This method is used for adding a finished CPU scope to
+ *  the ring of the calling thread.
+ ***********************************************************/
+void Profiler::RecordEvent(const char* name, uint64_t startTime, uint64_t endTime)
+{
+	PushEvent(GetThreadRing(), name, startTime, endTime);
+}
+
+/***********************************************************
+ *  BeginGpuScope()
+ *
+ *  This method is used for placing the timestamp query at
+ *  the start of a GPU scope.  The queries of a scope are
+ *  made the first time it is used and reused after that.
+ *  When every scope is still waiting for its queries the
+ *  new scope is dropped and counted, rather than waited for.
+ ***********************************************************/
+int Profiler::BeginGpuScope(const char* name)
+{
+	if (g_GpuFramesSinceCalibration < 0)
+	{
+		CalibrateGpuClock();
+	}
+
+	int scopeIndex = -1;
+	if (g_FreeGpuScopes.empty() == false)
+	{
+		scopeIndex = g_FreeGpuScopes.back();
+		g_FreeGpuScopes.pop_back();
+	}
+	else if ((int)g_GpuScopes.size() < g_MaxGpuScopes)
+	{
+		GPU_SCOPE scope;
+		glGenQueries(2, scope.queries);
+		g_GpuScopes.push_back(scope);
+		scopeIndex = (int)g_GpuScopes.size() - 1;
+	}
+	else
+	{
+		g_DroppedGpuScopes++;
+		return(-1);
+	}
+
+	g_GpuScopes[scopeIndex].name = name;
+	glQueryCounter(g_GpuScopes[scopeIndex].queries[0], GL_TIMESTAMP);
+	return(scopeIndex);
+}
+
+/***********************************************************
+ *  EndGpuScope()
+ *
+ *  This method is used for placing the timestamp query at
+ *  the end of a GPU scope and queueing the scope until its
+ *  results are available.
+ ***********************************************************/
+void Profiler::EndGpuScope(int scopeIndex)
+{
+	glQueryCounter(g_GpuScopes[scopeIndex].queries[1], GL_TIMESTAMP);
+	g_PendingGpuScopes.push_back(scopeIndex);
+}
+
+/***********************************************************
+ *  UpdateGpuScopes()
+ *
+ *  This method is used for collecting the GPU scopes whose
+ *  queries the GPU has reached.  The scopes finish in the
+ *  order they were ended, so the first one still running
+ *  ends the check.  The results are moved onto the CPU
+ *  clock and written to the GPU track.
+ ***********************************************************/
+void Profiler::UpdateGpuScopes()
+{
+	if ((IsEnabled() == false) || (g_GpuFramesSinceCalibration < 0))
+	{
+		return;
+	}
+	if (NULL == g_pGpuRing)
+	{
+		g_pGpuRing = CreateRing("GPU");
+	}
+
+	while (g_PendingGpuScopes.empty() == false)
+	{
+		const int scopeIndex = g_PendingGpuScopes.front();
+		const GPU_SCOPE& scope = g_GpuScopes[scopeIndex];
+
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(scope.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == GL_FALSE)
+		{
+			break;
+		}
+
+		GLuint64 startTime = 0;
+		GLuint64 endTime = 0;
+		glGetQueryObjectui64v(scope.queries[0], GL_QUERY_RESULT, &startTime);
+		glGetQueryObjectui64v(scope.queries[1], GL_QUERY_RESULT, &endTime);
+		PushEvent(g_pGpuRing, scope.name,
+			(uint64_t)std::max<int64_t>(0, (int64_t)startTime + g_GpuClockOffset),
+			(uint64_t)std::max<int64_t>(0, (int64_t)endTime + g_GpuClockOffset));
+
+		g_PendingGpuScopes.pop_front();
+		g_FreeGpuScopes.push_back(scopeIndex);
+	}
+
+	// the two clocks drift apart slowly
+	if (++g_GpuFramesSinceCalibration >= g_GpuCalibrationFrames)
+	{
+		CalibrateGpuClock();
+	}
+}
+
+/***********************************************************
+ *  WriteTrace()
+ *
+ *  This method is used for writing the events in every ring
+ *  to the trace file as Chrome trace events, with a named
+ *  track per ring.  The rings keep being written meanwhile,
+ *  so each is copied and the events that were overwritten
+ *  during the copy are left out.
+ ***********************************************************/
+bool Profiler::WriteTrace()
+{
+	if (IsEnabled() == false)
+	{
+		return(false);
+	}
+
+	std::lock_guard<std::mutex> lock(g_RingMutex);
+	std::ofstream file(g_TraceFilename.c_str(), std::ios::trunc);
+	if (!file)
+	{
+		std::cout << "Could not write profile trace:" << g_TraceFilename << std::endl;
+		return(false);
+	}
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	long long eventCount = 0;
+	bool bFirst = true;
+	std::vector<PROFILE_EVENT> events;
+	for (EVENT_RING* pRing : g_Rings)
+	{
+		file << (bFirst ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << pRing->trackID
+			<< ",\"args\":{\"name\":";
+		WriteJsonString(file, pRing->name.c_str());
+		file << "}}";
+		bFirst = false;
+
+		const uint64_t endCount = pRing->writeCount.load(std::memory_order_acquire);
+		uint64_t firstCount = (endCount > g_RingCapacity) ? (endCount - g_RingCapacity) : 0;
+		events.clear();
+		for (uint64_t i = firstCount; i < endCount; i++)
+		{
+			events.push_back(pRing->events[i % g_RingCapacity]);
+		}
+		const uint64_t laterCount = pRing->writeCount.load(std::memory_order_acquire);
+		const uint64_t overwrittenCount = (laterCount > g_RingCapacity) ? (laterCount - g_RingCapacity) : 0;
+
+		// Chrome traces count in microseconds
+		file << std::fixed << std::setprecision(3);
+		for (uint64_t i = std::max(firstCount, overwrittenCount); i < endCount; i++)
+		{
+			const PROFILE_EVENT& event = events[i - firstCount];
+			file << ",\n{\"name\":";
+			WriteJsonString(file, event.name);
+			file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << pRing->trackID
+				<< ",\"ts\":" << (event.startTime / 1000.0) << ",\"dur\":" << (event.duration / 1000.0) << "}";
+			eventCount++;
+		}
+	}
+	file << "\n]}\n";
+
+	std::cout << "Wrote profile trace of " << eventCount << " events on " << g_Rings.size() << " tracks to "
+		<< g_TraceFilename << std::endl;
+	if (g_DroppedGpuScopes > 0)
+	{
+		std::cout << "  " << g_DroppedGpuScopes << " GPU scopes were dropped while the queries were busy" << std::endl;
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  Shutdown()
+ *
+ *  This method is used for writing the trace at exit and
+ *  freeing the timer queries, which needs the context.
+ ***********************************************************/
+void Profiler::Shutdown()
+{
+	if (IsEnabled() == false)
+	{
+		return;
+	}
+
+	UpdateGpuScopes();
+	WriteTrace();
+	g_bEnabled.store(false);
+
+	for (GPU_SCOPE& scope : g_GpuScopes)
+	{
+		glDeleteQueries(2, scope.queries);
+	}
+	g_GpuScopes.clear();
+	g_FreeGpuScopes.clear();
+	g_PendingGpuScopes.clear();
+	g_GpuFramesSinceCalibration = -1;
+}
+
+#endif
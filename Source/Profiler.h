@@ -0,0 +1,159 @@
+///////////////////////////////////////////////////////////////////////////////
+// profiler.h
+// ============
+// scoped CPU timers and GPU timer queries recorded into per-thread rings
+// and written out as a Chrome trace
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// define PROFILER_DISABLED to compile the profiler out completely -
+// every PROFILE_ macro then expands to nothing
+#ifndef PROFILER_DISABLED
+#define PROFILER_ENABLED
+#endif
+
+#ifdef PROFILER_ENABLED
+
+#include <cstdint>
+
+/***********************************************************
+ *  Profiler
+ *
+ *  This class records how long named scopes take.  A CPU
+ *  scope reads the clock when it is entered and left and
+ *  writes one event into a ring owned by the thread, which
+ *  only that thread writes, so recording takes no lock.  A
+ *  GPU scope places timestamp queries before and after the
+ *  OpenGL commands inside it, and the results are collected
+ *  a few frames later, once the GPU has reached them, so
+ *  the render loop never waits on a query.  The rings hold
+ *  the latest events of each thread, which are written on
+ *  demand or at exit as a Chrome trace that chrome://tracing
+ *  and Perfetto open, with one track per thread and one for
+ *  the GPU.  Nothing is recorded until the profiler is
+ *  enabled, and the PROFILE_ macros below are the only way
+ *  the rest of the code uses it.
+ ***********************************************************/
+class Profiler
+{
+public:
+	// start recording, writing the trace to the passed in file
+	static void Enable(const char* traceFilename);
+	// true once recording has started
+	static bool IsEnabled();
+	// name the calling thread's track in the trace
+	static void SetThreadName(const char* name);
+
+	// get the time in nanoseconds since the profiler was loaded
+	static uint64_t GetTime();
+	// record a CPU event of the calling thread - the name must be
+	// a string literal, since only its address is kept
+	static void RecordEvent(const char* name, uint64_t startTime, uint64_t endTime);
+
+	// place the timestamp queries around a GPU scope - only on the
+	// thread owning the OpenGL context
+	static int BeginGpuScope(const char* name);
+	static void EndGpuScope(int scopeIndex);
+	// collect the GPU scopes whose queries have finished, without
+	// waiting for the others - once a frame on the OpenGL thread
+	static void UpdateGpuScopes();
+
+	// write the events of every ring to the trace file
+	static bool WriteTrace();
+	// write the trace and free the queries, with the context current
+	static void Shutdown();
+
+	/***********************************************************
+	 *  CpuScope
+	 *
+	 *  Records the time from its construction to the end of
+	 *  the enclosing block.
+	 ***********************************************************/
+	class CpuScope
+	{
+	public:
+		CpuScope(const char* name)
+		{
+			m_name = name;
+			m_bRecording = IsEnabled();
+			m_startTime = (m_bRecording == true) ? GetTime() : 0;
+		}
+		~CpuScope()
+		{
+			if (m_bRecording == true)
+			{
+				RecordEvent(m_name, m_startTime, GetTime());
+			}
+		}
+
+	private:
+		const char* m_name;
+		bool m_bRecording;
+		uint64_t m_startTime;
+
+		// scopes cannot be copied
+		CpuScope(const CpuScope&);
+		CpuScope& operator=(const CpuScope&);
+	};
+
+	/***********************************************************
+	 *  GpuScope
+	 *
+	 *  Times the OpenGL commands issued from its construction
+	 *  to the end of the enclosing block on the GPU.
+	 ***********************************************************/
+	class GpuScope
+	{
+	public:
+		GpuScope(const char* name)
+		{
+			m_scopeIndex = IsEnabled() ? BeginGpuScope(name) : -1;
+		}
+		~GpuScope()
+		{
+			if (m_scopeIndex >= 0)
+			{
+				EndGpuScope(m_scopeIndex);
+			}
+		}
+
+	private:
+		int m_scopeIndex;
+
+		// scopes cannot be copied
+		GpuScope(const GpuScope&);
+		GpuScope& operator=(const GpuScope&);
+	};
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+// time the rest of the enclosing block on the CPU
+#define PROFILE_SCOPE(name) Profiler::CpuScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+// time the OpenGL commands of the rest of the enclosing block on the GPU
+#define PROFILE_GPU_SCOPE(name) Profiler::GpuScope PROFILE_CONCAT(profileGpuScope, __LINE__)(name)
+// collect the finished GPU scopes, once a frame on the OpenGL thread
+#define PROFILE_GPU_FRAME() Profiler::UpdateGpuScopes()
+// name the calling thread's track
+#define PROFILE_THREAD_NAME(name) Profiler::SetThreadName(name)
+// start recording into the passed in trace file
+#define PROFILE_ENABLE(traceFilename) Profiler::Enable(traceFilename)
+// write the trace recorded so far
+#define PROFILE_WRITE_TRACE() Profiler::WriteTrace()
+// write the trace and free the GPU queries before the context goes
+#define PROFILE_SHUTDOWN() Profiler::Shutdown()
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_GPU_SCOPE(name)
+#define PROFILE_GPU_FRAME()
+#define PROFILE_THREAD_NAME(name)
+#define PROFILE_ENABLE(traceFilename)
+#define PROFILE_WRITE_TRACE()
+#define PROFILE_SHUTDOWN()
+
+#endif
@@ -0,0 +1,191 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.cpp
+// ============
+// collect the draws of a frame and sort them to minimize state changes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderQueue.h"
+
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	// position and width of each field in the sort key
+	const int g_ShaderShift = 60;
+	const int g_TextureShift = 48;
+	const int g_MaterialShift = 36;
+	const int g_MeshShift = 32;
+	const uint64_t g_ShaderMask = 0xF;
+	const uint64_t g_TextureMask = 0xFFF;
+	const uint64_t g_MaterialMask = 0xFFF;
+	const uint64_t g_MeshMask = 0xF;
+}
+
+/***********************************************************
+ *  RenderQueue()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderQueue::RenderQueue()
+{
+}
+
+/***********************************************************
+ *  MakeSortKey()
+ *
+ *  This method is used for packing the state of a draw into
+ *  its sort key.  Texture and material are offset by one so
+ *  that "none" sorts first, and the depth keeps the bits of
+ *  the float, which order like an unsigned integer for
+ *  values that are not negative.
+ ***********************************************************/
+uint64_t RenderQueue::MakeSortKey(int shaderVariant, int texture, int material, int mesh, float depth)
+{
+	uint32_t depthBits = 0;
+	if (depth > 0.0f)
+	{
+		memcpy(&depthBits, &depth, sizeof(depthBits));
+	}
+
+	return (((uint64_t)shaderVariant & g_ShaderMask) << g_ShaderShift) |
+		(((uint64_t)(texture + 1) & g_TextureMask) << g_TextureShift) |
+		(((uint64_t)(material + 1) & g_MaterialMask) << g_MaterialShift) |
+		(((uint64_t)mesh & g_MeshMask) << g_MeshShift) |
+		(uint64_t)depthBits;
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing every packet before the
+ *  draws of the next frame are submitted.  The storage is
+ *  kept, so a steady scene does not allocate per frame.
+ ***********************************************************/
+void RenderQueue::Clear()
+{
+	m_packets.clear();
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method is used for adding the draw of an object.
+ ***********************************************************/
+void RenderQueue::Submit(uint64_t sortKey, uint32_t objectIndex)
+{
+	DRAW_PACKET packet;
+	packet.sortKey = sortKey;
+	packet.objectIndex = objectIndex;
+	m_packets.push_back(packet);
+}
+
+/***********************************************************
+ *  SubmitRange()
+ *
+ *  This method is used for adding a run of packets whose
+ *  keys and objects the caller writes afterwards.  The
+ *  packets returned stay valid until the next submit.
+ ***********************************************************/
+RenderQueue::DRAW_PACKET* RenderQueue::SubmitRange(int packetCount)
+{
+	const size_t firstPacket = m_packets.size();
+	m_packets.resize(firstPacket + packetCount);
+	return(m_packets.data() + firstPacket);
+}
+
+/***********************************************************
+ *  Sort()
+ *
+ *  This method is used for sorting the packets by key with a
+ *  least significant byte first radix sort.  Each of the
+ *  eight byte passes is stable, and a pass is skipped when
+ *  every key has the same value in that byte, which is
+ *  common for the upper state fields.
+ ***********************************************************/
+void RenderQueue::Sort()
+{
+	const size_t packetCount = m_packets.size();
+	if (packetCount < 2)
+	{
+		return;
+	}
+
+	// count every byte of every key in a single read of the packets
+	uint32_t counts[8][256];
+	memset(counts, 0, sizeof(counts));
+	for (size_t i = 0; i < packetCount; i++)
+	{
+		uint64_t key = m_packets[i].sortKey;
+		for (int pass = 0; pass < 8; pass++)
+		{
+			counts[pass][(key >> (pass * 8)) & 0xFF]++;
+		}
+	}
+
+	m_sortBuffer.resize(packetCount);
+	DRAW_PACKET* pSource = m_packets.data();
+	DRAW_PACKET* pDestination = m_sortBuffer.data();
+	for (int pass = 0; pass < 8; pass++)
+	{
+		const int shift = pass * 8;
+		if (counts[pass][(pSource[0].sortKey >> shift) & 0xFF] == packetCount)
+		{
+			continue;
+		}
+
+		uint32_t offsets[256];
+		uint32_t offset = 0;
+		for (int i = 0; i < 256; i++)
+		{
+			offsets[i] = offset;
+			offset += counts[pass][i];
+		}
+
+		for (size_t i = 0; i < packetCount; i++)
+		{
+			pDestination[offsets[(pSource[i].sortKey >> shift) & 0xFF]++] = pSource[i];
+		}
+
+		DRAW_PACKET* pSwap = pSource;
+		pSource = pDestination;
+		pDestination = pSwap;
+	}
+
+	// an odd number of passes leaves the result in the sort buffer
+	if (pSource != m_packets.data())
+	{
+		m_packets.swap(m_sortBuffer);
+	}
+}
+
+/***********************************************************
+ *  CountStateChanges()
+ *
+ *  This method is used for counting how often each state
+ *  field changes between consecutive packets, including
+ *  setting each one for the first packet.
+ ***********************************************************/
+RenderQueue::STATE_CHANGES RenderQueue::CountStateChanges() const
+{
+	STATE_CHANGES changes;
+	memset(&changes, 0, sizeof(changes));
+
+	for (size_t i = 0; i < m_packets.size(); i++)
+	{
+		uint64_t key = m_packets[i].sortKey;
+		uint64_t previousKey = (i > 0) ? m_packets[i - 1].sortKey : ~key;
+
+		if (((key >> g_ShaderShift) & g_ShaderMask) != ((previousKey >> g_ShaderShift) & g_ShaderMask))
+			changes.shaderChanges++;
+		if (((key >> g_TextureShift) & g_TextureMask) != ((previousKey >> g_TextureShift) & g_TextureMask))
+			changes.textureChanges++;
+		if (((key >> g_MaterialShift) & g_MaterialMask) != ((previousKey >> g_MaterialShift) & g_MaterialMask))
+			changes.materialChanges++;
+		if (((key >> g_MeshShift) & g_MeshMask) != ((previousKey >> g_MeshShift) & g_MeshMask))
+			changes.meshChanges++;
+	}
+
+	return(changes);
+}
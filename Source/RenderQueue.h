@@ -0,0 +1,70 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.h
+// ============
+// collect the draws of a frame and sort them to minimize state changes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  RenderQueue
+ *
+ *  This class collects one draw packet per object each
+ *  frame.  Every packet carries a 64 bit sort key packed,
+ *  from the most significant bits down, from the shader
+ *  variant, texture, material, mesh and depth, so sorting
+ *  the keys groups draws sharing state together and orders
+ *  each group front to back.  The keys are radix sorted,
+ *  skipping the byte passes in which every key agrees.
+ ***********************************************************/
+class RenderQueue
+{
+public:
+	// constructor
+	RenderQueue();
+
+	struct DRAW_PACKET
+	{
+		uint64_t sortKey;
+		// caller defined index of the object to draw
+		uint32_t objectIndex;
+	};
+
+	// number of state changes between consecutive packets
+	struct STATE_CHANGES
+	{
+		int shaderChanges;
+		int textureChanges;
+		int materialChanges;
+		int meshChanges;
+	};
+
+	// pack the draw state into a sort key - texture and material
+	// may be -1 for none, and depth must not be negative
+	static uint64_t MakeSortKey(int shaderVariant, int texture, int material, int mesh, float depth);
+
+	// remove every packet
+	void Clear();
+	// add the draw of an object
+	void Submit(uint64_t sortKey, uint32_t objectIndex);
+	// add a number of packets to be filled in by the caller, which
+	// may split the filling over several threads
+	DRAW_PACKET* SubmitRange(int packetCount);
+	// sort the packets by their sort keys
+	void Sort();
+
+	// get the packets, in sorted order after Sort()
+	const DRAW_PACKET* GetPackets() const { return m_packets.data(); }
+	int GetPacketCount() const { return (int)m_packets.size(); }
+	// count the state changes of drawing the packets in their current order
+	STATE_CHANGES CountStateChanges() const;
+
+private:
+	// packets of the frame and the buffer used while sorting
+	std::vector<DRAW_PACKET> m_packets;
+	std::vector<DRAW_PACKET> m_sortBuffer;
+};
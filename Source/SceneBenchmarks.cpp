@@ -0,0 +1,1104 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebenchmarks.cpp
+// ============
+// CPU microbenchmarks for the scene management code, run from the
+// command line with --benchmark [name]
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneBenchmarks.h"
+
+#include "BoundingVolumeHierarchy.h"
+#include "Frustum.h"
+#include "JobSystem.h"
+#include "LevelOfDetail.h"
+#include "MeshGeometry.h"
+#include "OcclusionBuffer.h"
+#include "RenderQueue.h"
+#include "SceneFile.h"
+#include "SceneGraph.h"
+#include "TagTable.h"
+#include "TransformBatch.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// keeps benchmark results alive so the work is not optimized out
+	volatile long long g_BenchmarkSink = 0;
+
+	// get the elapsed nanoseconds since the passed in time
+	double NanosecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+	}
+
+	// the linear scan that FindTextureSlot used to do per draw - the
+	// tag is taken by value just like the old SetShaderTexture
+	int LinearFindSlot(const std::vector<std::string>& tags, std::string tag)
+	{
+		int index = 0;
+		while (index < (int)tags.size())
+		{
+			if (tags[index].compare(tag) == 0)
+			{
+				return(index);
+			}
+			index++;
+		}
+		return(-1);
+	}
+
+	/***********************************************************
+	 *  BenchmarkTagLookup()
+	 *
+	 *  Compares the per-draw cost of resolving a texture or
+	 *  material tag with the old linear string scan, with the
+	 *  interned tag table, and with a pre-resolved handle.
+	 ***********************************************************/
+	void BenchmarkTagLookup()
+	{
+		const int tagCounts[] = { 10, 100, 1000 };
+		const int drawCount = 1000000;
+
+		std::cout << "Tag lookup cost per draw (ns):" << std::endl;
+		std::cout << std::setw(8) << "tags" << std::setw(14) << "linear scan"
+			<< std::setw(14) << "tag table" << std::setw(14) << "handle" << std::endl;
+
+		for (int tagCount : tagCounts)
+		{
+			std::vector<std::string> tags;
+			std::vector<int> slotData;
+			TagTable tagTable;
+			for (int i = 0; i < tagCount; i++)
+			{
+				tags.push_back("SceneTexture" + std::to_string(i));
+				tagTable.Intern(tags.back());
+				slotData.push_back(i * 3);
+			}
+
+			// the draws reference the tags as string literals would, so
+			// each old-style call builds a std::string from a char array
+			std::vector<const char*> drawTags;
+			std::vector<int> drawHandles;
+			for (int i = 0; i < drawCount; i++)
+			{
+				int tag = (int)(((unsigned)i * 2654435761u) % (unsigned)tagCount);
+				drawTags.push_back(tags[tag].c_str());
+				drawHandles.push_back(tagTable.Find(tags[tag]));
+			}
+
+			long long sum = 0;
+			Clock::time_point start = Clock::now();
+			for (int i = 0; i < drawCount; i++)
+			{
+				sum += slotData[LinearFindSlot(tags, drawTags[i])];
+			}
+			double linearNs = NanosecondsSince(start) / drawCount;
+
+			start = Clock::now();
+			for (int i = 0; i < drawCount; i++)
+			{
+				sum += slotData[tagTable.Find(drawTags[i])];
+			}
+			double tableNs = NanosecondsSince(start) / drawCount;
+
+			start = Clock::now();
+			for (int i = 0; i < drawCount; i++)
+			{
+				sum += slotData[drawHandles[i]];
+			}
+			double handleNs = NanosecondsSince(start) / drawCount;
+
+			g_BenchmarkSink += sum;
+
+			std::cout << std::fixed << std::setprecision(2)
+				<< std::setw(8) << tagCount << std::setw(14) << linearNs
+				<< std::setw(14) << tableNs << std::setw(14) << handleNs << std::endl;
+		}
+	}
+
+	/***********************************************************
+	 *  BenchmarkSceneLoad()
+	 *
+	 *  Generates a text scene of 100,000 objects and measures
+	 *  how long it takes to compile, and then to load from the
+	 *  compiled binary file and touch every object.
+	 ***********************************************************/
+	void BenchmarkSceneLoad()
+	{
+		const int objectCount = 100000;
+		const char* meshNames[] = { "plane", "box", "prism", "sphere", "cylinder" };
+
+		std::filesystem::path scenePath = std::filesystem::temp_directory_path() / "benchmark.scene";
+		std::string sceneFilename = scenePath.string();
+		std::string binaryFilename = SceneFile::GetBinaryFilename(sceneFilename.c_str());
+		{
+			std::ofstream file(sceneFilename.c_str(), std::ios::trunc);
+			for (int i = 0; i < 8; i++)
+			{
+				file << "texture Texture" << i << " resources/textures/Texture" << i << ".jpg\n";
+				file << "material Material" << i << " ambient 0.2 0.2 0.2 strength 0.4 diffuse 0.5 0.5 0.5"
+					<< " specular 0.6 0.5 0.4 shininess " << i << "\n";
+			}
+			file << "light position 0 5 0 ambient 0.4 0.4 0.4 diffuse 0.4 0.4 0.4 specular 0.4 0.4 0.4 focal 16 intensity 0.75\n";
+			for (int i = 0; i < objectCount; i++)
+			{
+				file << "object " << meshNames[i % 5]
+					<< " scale 1 " << (1 + i % 3) << " 1"
+					<< " rotation 0 " << (i % 360) << " 0"
+					<< " position " << (i % 400) << " 0 " << (i / 400)
+					<< " texture Texture" << (i % 8) << " material Material" << (i % 7) << "\n";
+			}
+		}
+		std::error_code error;
+		std::cout << "Text scene: " << objectCount << " objects, "
+			<< (std::filesystem::file_size(sceneFilename, error) / (1024 * 1024)) << " MB" << std::endl;
+
+		Clock::time_point start = Clock::now();
+		bool bCompiled = SceneFile::Compile(sceneFilename.c_str(), binaryFilename.c_str());
+		double compileMs = NanosecondsSince(start) / 1.0e6;
+		if (bCompiled == false)
+		{
+			return;
+		}
+
+		// loading maps the compiled file, and the objects are read in
+		// place the way RenderScene reads them
+		start = Clock::now();
+		SceneFile sceneFile;
+		bool bLoaded = sceneFile.Load(sceneFilename.c_str());
+		double sum = 0.0;
+		const SceneFile::SCENE_OBJECT* pObjects = sceneFile.GetObjects();
+		for (int i = 0; i < sceneFile.GetObjectCount(); i++)
+		{
+			sum += pObjects[i].position[0] + pObjects[i].scale[1] + pObjects[i].textureIndex;
+		}
+		double loadMs = NanosecondsSince(start) / 1.0e6;
+		g_BenchmarkSink += (long long)sum;
+
+		std::cout << std::fixed << std::setprecision(2)
+			<< "Compile text scene: " << compileMs << " ms" << std::endl
+			<< "Load compiled scene (" << (bLoaded ? sceneFile.GetObjectCount() : 0) << " objects, "
+			<< (std::filesystem::file_size(binaryFilename, error) / 1024) << " KB): " << loadMs << " ms" << std::endl;
+
+		std::filesystem::remove(sceneFilename, error);
+		std::filesystem::remove(binaryFilename, error);
+	}
+
+	// sum of the state changes counted by the render queue
+	int TotalStateChanges(const RenderQueue::STATE_CHANGES& changes)
+	{
+		return changes.shaderChanges + changes.textureChanges + changes.materialChanges + changes.meshChanges;
+	}
+
+	/***********************************************************
+	 *  BenchmarkRenderQueue()
+	 *
+	 *  Generates scenes of thousands of objects with mixed
+	 *  meshes, textures and materials and compares the state
+	 *  changes of drawing them in source order and in render
+	 *  queue order, along with the CPU time per frame to build
+	 *  the queue and to sort it with the radix sort and with
+	 *  std::stable_sort.
+	 ***********************************************************/
+	void BenchmarkRenderQueue()
+	{
+		const int objectCounts[] = { 1000, 5000, 20000 };
+		const int frameCount = 200;
+		const int textureCount = 16;
+		const int materialCount = 32;
+
+		std::cout << "State changes per frame and queue CPU time per frame:" << std::endl;
+		std::cout << std::setw(8) << "objects" << std::setw(14) << "source order"
+			<< std::setw(14) << "sorted" << std::setw(14) << "submit ms" << std::setw(14) << "radix ms"
+			<< std::setw(16) << "stable_sort ms" << std::endl;
+
+		for (int objectCount : objectCounts)
+		{
+			struct OBJECT
+			{
+				int shaderVariant;
+				int texture;
+				int material;
+				int mesh;
+				float position[3];
+			};
+
+			std::vector<OBJECT> objects(objectCount);
+			unsigned int seed = 12345;
+			for (int i = 0; i < objectCount; i++)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				OBJECT& object = objects[i];
+				// a quarter of the objects are colored rather than textured
+				object.texture = ((seed >> 8) % 4 == 0) ? -1 : (int)((seed >> 12) % textureCount);
+				object.shaderVariant = (object.texture >= 0) ? 1 : 0;
+				object.material = (int)((seed >> 16) % materialCount);
+				object.mesh = (int)((seed >> 24) % SceneFile::MESH_TYPE_COUNT);
+				object.position[0] = (float)(i % 100);
+				object.position[1] = (float)((seed >> 4) % 10);
+				object.position[2] = (float)(i / 100);
+			}
+
+			RenderQueue renderQueue;
+			RenderQueue::STATE_CHANGES sourceChanges;
+			RenderQueue::STATE_CHANGES sortedChanges;
+			double submitNs = 0.0;
+			double radixNs = 0.0;
+			double standardNs = 0.0;
+			std::vector<RenderQueue::DRAW_PACKET> packets;
+
+			for (int frame = 0; frame < frameCount; frame++)
+			{
+				// the camera moves every frame, changing every depth
+				float viewPosition[3] = { (float)(frame % 100), 5.0f, (float)(frame % 37) };
+
+				Clock::time_point start = Clock::now();
+				renderQueue.Clear();
+				for (int i = 0; i < objectCount; i++)
+				{
+					const OBJECT& object = objects[i];
+					float dx = object.position[0] - viewPosition[0];
+					float dy = object.position[1] - viewPosition[1];
+					float dz = object.position[2] - viewPosition[2];
+					renderQueue.Submit(
+						RenderQueue::MakeSortKey(object.shaderVariant, object.texture, object.material, object.mesh, dx * dx + dy * dy + dz * dz),
+						(uint32_t)i);
+				}
+				submitNs += NanosecondsSince(start);
+
+				// submitted in source order, as the scene used to draw them
+				if (frame == 0)
+				{
+					sourceChanges = renderQueue.CountStateChanges();
+				}
+				packets.assign(renderQueue.GetPackets(), renderQueue.GetPackets() + renderQueue.GetPacketCount());
+
+				start = Clock::now();
+				renderQueue.Sort();
+				radixNs += NanosecondsSince(start);
+				g_BenchmarkSink += renderQueue.GetPackets()[0].objectIndex;
+
+				// the same packets sorted by comparison
+				start = Clock::now();
+				std::stable_sort(packets.begin(), packets.end(),
+					[](const RenderQueue::DRAW_PACKET& a, const RenderQueue::DRAW_PACKET& b) { return a.sortKey < b.sortKey; });
+				standardNs += NanosecondsSince(start);
+				g_BenchmarkSink += packets[0].objectIndex;
+			}
+			sortedChanges = renderQueue.CountStateChanges();
+
+			std::cout << std::fixed << std::setprecision(3)
+				<< std::setw(8) << objectCount << std::setw(14) << TotalStateChanges(sourceChanges)
+				<< std::setw(14) << TotalStateChanges(sortedChanges)
+				<< std::setw(14) << (submitNs / frameCount / 1.0e6)
+				<< std::setw(14) << (radixNs / frameCount / 1.0e6)
+				<< std::setw(16) << (standardNs / frameCount / 1.0e6) << std::endl;
+			std::cout << "         texture " << sourceChanges.textureChanges << " -> " << sortedChanges.textureChanges
+				<< ", material " << sourceChanges.materialChanges << " -> " << sortedChanges.materialChanges
+				<< ", mesh " << sourceChanges.meshChanges << " -> " << sortedChanges.meshChanges
+				<< ", shader " << sourceChanges.shaderChanges << " -> " << sortedChanges.shaderChanges << std::endl;
+		}
+	}
+
+	/***********************************************************
+	 *  BenchmarkTransforms()
+	 *
+	 *  Builds the model matrices of scenes of random transforms
+	 *  with the chain of glm matrices that SetTransformations
+	 *  multiplies, and the model and normal matrices with the
+	 *  batch builder at each SIMD level the CPU supports, and
+	 *  compares the matrices built per second.
+	 ***********************************************************/
+	void BenchmarkTransforms()
+	{
+		const int objectCounts[] = { 1000, 10000, 100000, 1000000 };
+		// about the same number of matrices are built at every count
+		const long long matricesPerCount = 4000000;
+
+		const TransformBatch::SIMD_LEVEL savedLevel = TransformBatch::GetSimdLevel();
+		const TransformBatch::SIMD_LEVEL supportedLevel = TransformBatch::GetSupportedSimdLevel();
+
+		std::cout << "Millions of matrices built per second:" << std::endl;
+		std::cout << std::setw(8) << "objects" << std::setw(14) << "glm chain";
+		for (int level = TransformBatch::SIMD_SCALAR; level <= supportedLevel; level++)
+		{
+			std::cout << std::setw(14) << TransformBatch::GetSimdLevelName((TransformBatch::SIMD_LEVEL)level);
+		}
+		std::cout << std::endl;
+
+		for (int objectCount : objectCounts)
+		{
+			std::vector<float> components[9];
+			unsigned int seed = 12345;
+			for (int component = 0; component < 9; component++)
+			{
+				components[component].resize(objectCount);
+				for (int i = 0; i < objectCount; i++)
+				{
+					seed = seed * 1664525u + 1013904223u;
+					float unit = (float)(seed >> 8) / 16777216.0f;
+					// scale, then rotation in degrees, then position
+					if (component < 3)
+					{
+						components[component][i] = 0.1f + unit * 4.0f;
+					}
+					else if (component < 6)
+					{
+						components[component][i] = unit * 720.0f - 360.0f;
+					}
+					else
+					{
+						components[component][i] = unit * 200.0f - 100.0f;
+					}
+				}
+			}
+
+			TransformBatch::TRANSFORM_ARRAYS transforms;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				transforms.pScale[axis] = components[axis].data();
+				transforms.pRotation[axis] = components[3 + axis].data();
+				transforms.pPosition[axis] = components[6 + axis].data();
+			}
+
+			std::vector<glm::mat4> models(objectCount);
+			std::vector<glm::mat3> normals(objectCount);
+			const int passCount = (int)std::max<long long>(1, matricesPerCount / objectCount);
+			const double matrixCount = (double)passCount * objectCount;
+
+			// the current path, one matrix at a time
+			Clock::time_point start = Clock::now();
+			for (int pass = 0; pass < passCount; pass++)
+			{
+				for (int i = 0; i < objectCount; i++)
+				{
+					glm::mat4 scale = glm::scale(glm::vec3(components[0][i], components[1][i], components[2][i]));
+					glm::mat4 rotationX = glm::rotate(glm::radians(components[3][i]), glm::vec3(1.0f, 0.0f, 0.0f));
+					glm::mat4 rotationY = glm::rotate(glm::radians(components[4][i]), glm::vec3(0.0f, 1.0f, 0.0f));
+					glm::mat4 rotationZ = glm::rotate(glm::radians(components[5][i]), glm::vec3(0.0f, 0.0f, 1.0f));
+					glm::mat4 translation = glm::translate(glm::vec3(components[6][i], components[7][i], components[8][i]));
+					models[i] = translation * rotationX * rotationY * rotationZ * scale;
+				}
+				g_BenchmarkSink += (long long)models[pass % objectCount][3][0];
+			}
+			double chainNs = NanosecondsSince(start);
+
+			std::cout << std::fixed << std::setprecision(1)
+				<< std::setw(8) << objectCount << std::setw(14) << (matrixCount / chainNs * 1.0e3);
+
+			for (int level = TransformBatch::SIMD_SCALAR; level <= supportedLevel; level++)
+			{
+				TransformBatch::SetSimdLevel((TransformBatch::SIMD_LEVEL)level);
+				start = Clock::now();
+				for (int pass = 0; pass < passCount; pass++)
+				{
+					TransformBatch::Compute(transforms, objectCount, models.data(), normals.data());
+					g_BenchmarkSink += (long long)models[pass % objectCount][3][0];
+				}
+				double batchNs = NanosecondsSince(start);
+				std::cout << std::setw(14) << (matrixCount / batchNs * 1.0e3);
+			}
+			std::cout << std::endl;
+		}
+		std::cout << "The batch columns also build a normal matrix per object." << std::endl;
+
+		TransformBatch::SetSimdLevel(savedLevel);
+	}
+
+	/***********************************************************
+	 *  BenchmarkSceneGraph()
+	 *
+	 *  Builds a scene graph of 50k nodes - one root group, a
+	 *  thousand groups under it and the objects under those -
+	 *  and compares the CPU time per frame of rebuilding every
+	 *  local and world matrix, as a scene without dirty flags
+	 *  would, with updating the graph when nothing moves, when
+	 *  one group moves and when the root moves.
+	 ***********************************************************/
+	void BenchmarkSceneGraph()
+	{
+		const int groupCount = 1000;
+		const int nodeCount = 50000;
+		const int frameCount = 200;
+
+		// the same transforms as component arrays, and the parent of
+		// every node, for a full rebuild
+		std::vector<float> components[9];
+		std::vector<int> parents;
+		SceneGraph sceneGraph;
+		sceneGraph.Reserve(nodeCount);
+		auto addNode = [&](int parent, const glm::vec3& scale, const glm::vec3& rotation, const glm::vec3& position)
+			{
+				sceneGraph.AddNode(parent, scale, rotation, position);
+				parents.push_back(parent);
+				for (int axis = 0; axis < 3; axis++)
+				{
+					components[axis].push_back(scale[axis]);
+					components[3 + axis].push_back(rotation[axis]);
+					components[6 + axis].push_back(position[axis]);
+				}
+			};
+
+		addNode(-1, glm::vec3(1.0f), glm::vec3(0.0f), glm::vec3(0.0f));
+		for (int i = 1; i <= groupCount; i++)
+		{
+			addNode(0, glm::vec3(1.0f), glm::vec3(0.0f, (float)i, 0.0f),
+				glm::vec3((float)(i % 32) * 4.0f, 0.0f, (float)(i / 32) * 4.0f));
+		}
+		unsigned int seed = 12345;
+		while (sceneGraph.GetNodeCount() < nodeCount)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			int parent = 1 + (int)((seed >> 8) % groupCount);
+			addNode(parent, glm::vec3(0.5f), glm::vec3((float)(seed % 360), 0.0f, 0.0f),
+				glm::vec3((float)((seed >> 4) % 4), (float)((seed >> 6) % 4), (float)((seed >> 10) % 4)));
+		}
+		sceneGraph.Update();
+
+		TransformBatch::TRANSFORM_ARRAYS transforms;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			transforms.pScale[axis] = components[axis].data();
+			transforms.pRotation[axis] = components[3 + axis].data();
+			transforms.pPosition[axis] = components[6 + axis].data();
+		}
+		std::vector<glm::mat4> localModels(nodeCount);
+		std::vector<glm::mat3> localNormals(nodeCount);
+		std::vector<glm::mat4> worldModels(nodeCount);
+		std::vector<glm::mat3> worldNormals(nodeCount);
+
+		std::cout << "CPU time per frame for " << nodeCount << " nodes:" << std::endl;
+		std::cout << std::setw(24) << "case" << std::setw(14) << "ms" << std::setw(16) << "nodes updated" << std::endl;
+
+		Clock::time_point start = Clock::now();
+		for (int frame = 0; frame < frameCount; frame++)
+		{
+			// every parent comes before its children, so one pass in
+			// node order composes the whole hierarchy
+			TransformBatch::Compute(transforms, nodeCount, localModels.data(), localNormals.data());
+			for (int i = 0; i < nodeCount; i++)
+			{
+				if (parents[i] >= 0)
+				{
+					TransformBatch::MultiplyAffine(worldModels[parents[i]], localModels[i], worldModels[i]);
+					worldNormals[i] = worldNormals[parents[i]] * localNormals[i];
+				}
+				else
+				{
+					worldModels[i] = localModels[i];
+					worldNormals[i] = localNormals[i];
+				}
+			}
+			g_BenchmarkSink += (long long)worldModels[nodeCount - 1][3][1];
+		}
+		std::cout << std::fixed << std::setprecision(4) << std::setw(24) << "rebuild every matrix"
+			<< std::setw(14) << (NanosecondsSince(start) / frameCount / 1.0e6) << std::setw(16) << nodeCount << std::endl;
+
+		const char* caseNames[] = { "static", "one group moved", "root moved" };
+		for (int caseIndex = 0; caseIndex < 3; caseIndex++)
+		{
+			long long updatedCount = 0;
+			start = Clock::now();
+			for (int frame = 0; frame < frameCount; frame++)
+			{
+				if (caseIndex == 1)
+				{
+					int group = 1 + (frame % groupCount);
+					sceneGraph.SetLocalPosition(group, sceneGraph.GetLocalPosition(group) + glm::vec3(0.0f, 0.01f, 0.0f));
+				}
+				else if (caseIndex == 2)
+				{
+					sceneGraph.SetLocalPosition(0, glm::vec3(0.0f, (float)frame * 0.01f, 0.0f));
+				}
+				sceneGraph.Update();
+				updatedCount += sceneGraph.GetLastUpdateCount();
+				g_BenchmarkSink += (long long)sceneGraph.GetWorldMatrices()[nodeCount - 1][3][1];
+			}
+			std::cout << std::setw(24) << caseNames[caseIndex]
+				<< std::setw(14) << (NanosecondsSince(start) / frameCount / 1.0e6)
+				<< std::setw(16) << (updatedCount / frameCount) << std::endl;
+		}
+	}
+
+	/***********************************************************
+	 *  BenchmarkCulling()
+	 *
+	 *  Scatters boxes over a large square and culls them each
+	 *  frame against a camera circling the middle, with the
+	 *  bounding volume hierarchy and by testing every box.  A
+	 *  hundredth of the boxes move every frame and the
+	 *  hierarchy is refit above them.
+	 ***********************************************************/
+	void BenchmarkCulling()
+	{
+		const int objectCounts[] = { 10000, 100000, 1000000 };
+		const int frameCount = 50;
+		const float worldSize = 1000.0f;
+
+		std::cout << "Visible objects and culling CPU time per frame:" << std::endl;
+		std::cout << std::setw(8) << "objects" << std::setw(10) << "visible" << std::setw(10) << "culled"
+			<< std::setw(12) << "build ms" << std::setw(12) << "refit ms" << std::setw(12) << "bvh ms"
+			<< std::setw(14) << "each box ms" << std::endl;
+
+		for (int objectCount : objectCounts)
+		{
+			std::vector<BoundingVolumeHierarchy::BOUNDING_BOX> bounds(objectCount);
+			unsigned int seed = 12345;
+			for (int i = 0; i < objectCount; i++)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				glm::vec3 center(
+					(float)(seed >> 8) / 16777216.0f * worldSize,
+					(float)((seed >> 4) % 16),
+					(float)((seed * 2654435761u) >> 8) / 16777216.0f * worldSize);
+				float extent = 0.5f + (float)((seed >> 20) % 4);
+				bounds[i].minimum = center - glm::vec3(extent);
+				bounds[i].maximum = center + glm::vec3(extent);
+			}
+
+			BoundingVolumeHierarchy hierarchy;
+			Clock::time_point start = Clock::now();
+			hierarchy.Build(bounds.data(), objectCount);
+			double buildNs = NanosecondsSince(start);
+
+			const glm::mat4 projection = glm::perspective(glm::radians(80.0f), 1000.0f / 800.0f, 0.1f, 100.0f);
+			std::vector<uint32_t> visibleObjects;
+			long long visibleTotal = 0;
+			long long bruteTotal = 0;
+			double refitNs = 0.0;
+			double cullNs = 0.0;
+			double bruteNs = 0.0;
+			const int movedCount = objectCount / 100;
+
+			for (int frame = 0; frame < frameCount; frame++)
+			{
+				// move a different hundredth of the boxes each frame
+				start = Clock::now();
+				for (int moved = 0; moved < movedCount; moved++)
+				{
+					int i = (frame * movedCount + moved * 97) % objectCount;
+					glm::vec3 offset(0.0f, (frame % 2 == 0) ? 0.5f : -0.5f, 0.0f);
+					bounds[i].minimum += offset;
+					bounds[i].maximum += offset;
+					hierarchy.UpdateBounds(i, bounds[i]);
+				}
+				hierarchy.Refit();
+				refitNs += NanosecondsSince(start);
+
+				float angle = (float)frame * 0.1f;
+				glm::vec3 eye(worldSize * 0.5f + cosf(angle) * 50.0f, 10.0f, worldSize * 0.5f + sinf(angle) * 50.0f);
+				Frustum frustum;
+				frustum.SetViewProjection(projection * glm::lookAt(eye, glm::vec3(worldSize * 0.5f, 0.0f, worldSize * 0.5f), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+				start = Clock::now();
+				hierarchy.Cull(frustum, visibleObjects);
+				cullNs += NanosecondsSince(start);
+				visibleTotal += (long long)visibleObjects.size();
+
+				start = Clock::now();
+				int bruteVisible = 0;
+				for (int i = 0; i < objectCount; i++)
+				{
+					if (frustum.TestBox(bounds[i].minimum, bounds[i].maximum) != Frustum::TEST_OUTSIDE)
+					{
+						bruteVisible++;
+					}
+				}
+				bruteNs += NanosecondsSince(start);
+				bruteTotal += bruteVisible;
+			}
+
+			if (visibleTotal != bruteTotal)
+			{
+				std::cout << "Culling mismatch: " << visibleTotal << " visible in the hierarchy, "
+					<< bruteTotal << " testing every box" << std::endl;
+			}
+
+			std::cout << std::fixed << std::setprecision(3)
+				<< std::setw(8) << objectCount << std::setw(10) << (visibleTotal / frameCount)
+				<< std::setw(10) << (objectCount - visibleTotal / frameCount)
+				<< std::setw(12) << (buildNs / 1.0e6)
+				<< std::setw(12) << (refitNs / frameCount / 1.0e6)
+				<< std::setw(12) << (cullNs / frameCount / 1.0e6)
+				<< std::setw(14) << (bruteNs / frameCount / 1.0e6) << std::endl;
+		}
+	}
+
+	/***********************************************************
+	 *  BenchmarkOcclusion()
+	 *
+	 *  Stands a row of walls with gaps between them in front of
+	 *  a field of small boxes, and culls the boxes behind the
+	 *  walls with the CPU occlusion buffer on one thread, on
+	 *  its own worker threads and on the threads of a job
+	 *  system.  A box just in front of a wall and one in the
+	 *  middle of the field behind it check the results.
+	 ***********************************************************/
+	void BenchmarkOcclusion()
+	{
+		// no worker threads, the default of one per extra core, then
+		// no worker threads but a job system with one per core
+		const int workerCounts[] = { 0, -1, 0 };
+		const bool bUseJobSystem[] = { false, false, true };
+		const int runCount = sizeof(workerCounts) / sizeof(workerCounts[0]);
+		const int frameCount = 100;
+		const int wallCount = 8;
+		const int rowCount = 100;
+		const int columnCount = 100;
+
+		std::vector<glm::mat4> walls;
+		for (int i = 0; i < wallCount; i++)
+		{
+			float x = -35.0f + 10.0f * (float)i;
+			walls.push_back(glm::translate(glm::vec3(x, 3.0f, -20.0f)) * glm::scale(glm::vec3(8.0f, 6.0f, 1.0f)));
+		}
+
+		std::vector<BoundingVolumeHierarchy::BOUNDING_BOX> boxes;
+		for (int row = 0; row < rowCount; row++)
+		{
+			for (int column = 0; column < columnCount; column++)
+			{
+				glm::vec3 center(-50.0f + (float)column, 0.5f, -25.0f - (float)row);
+				BoundingVolumeHierarchy::BOUNDING_BOX box;
+				box.minimum = center - glm::vec3(0.4f);
+				box.maximum = center + glm::vec3(0.4f);
+				boxes.push_back(box);
+			}
+		}
+
+		const glm::mat4 projection = glm::perspective(glm::radians(80.0f), 1000.0f / 800.0f, 0.1f, 200.0f);
+		const glm::vec3 eye(0.0f, 2.0f, 0.0f);
+		const glm::mat4 viewProjection = projection * glm::lookAt(eye, glm::vec3(0.0f, 2.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+		std::cout << "Boxes hidden behind " << wallCount << " walls and occlusion CPU time per frame:" << std::endl;
+		std::cout << std::setw(8) << "threads" << std::setw(11) << "triangles" << std::setw(8) << "tested"
+			<< std::setw(8) << "hidden" << std::setw(12) << "raster ms" << std::setw(10) << "test ms" << std::endl;
+
+		JobSystem jobSystem;
+		for (int run = 0; run < runCount; run++)
+		{
+			OcclusionBuffer buffer(256, 128, workerCounts[run]);
+			if (bUseJobSystem[run] == true)
+			{
+				buffer.SetJobSystem(&jobSystem);
+			}
+			OcclusionBuffer::FRAME_STATISTICS last = {};
+			double rasterMs = 0.0;
+			double testMs = 0.0;
+			for (int frame = 0; frame < frameCount; frame++)
+			{
+				buffer.BeginFrame(viewProjection);
+				for (const glm::mat4& wall : walls)
+				{
+					buffer.AddOccluder(wall, glm::vec3(-0.5f), glm::vec3(0.5f));
+				}
+				buffer.Rasterize();
+
+				int hiddenCount = 0;
+				for (const BoundingVolumeHierarchy::BOUNDING_BOX& box : boxes)
+				{
+					if (buffer.IsOccluded(box.minimum, box.maximum) == true)
+					{
+						hiddenCount++;
+					}
+				}
+				g_BenchmarkSink = g_BenchmarkSink + hiddenCount;
+
+				if (buffer.IsOccluded(glm::vec3(-6.0f, 0.0f, -19.0f), glm::vec3(-4.0f, 2.0f, -18.0f)) == true)
+				{
+					std::cout << "Occlusion error: a box in front of a wall was hidden" << std::endl;
+				}
+				if (buffer.IsOccluded(glm::vec3(-8.0f, 0.0f, -60.0f), glm::vec3(-6.0f, 1.0f, -58.0f)) == false)
+				{
+					std::cout << "Occlusion error: a box behind a wall was not hidden" << std::endl;
+				}
+				buffer.EndFrame();
+
+				last = buffer.GetLastFrameStatistics();
+				rasterMs += last.rasterMilliseconds;
+				testMs += last.testMilliseconds;
+			}
+
+			std::cout << std::fixed << std::setprecision(3)
+				<< std::setw(8) << buffer.GetThreadCount() << std::setw(11) << last.triangleCount
+				<< std::setw(8) << last.testedCount << std::setw(8) << last.occludedCount
+				<< std::setw(12) << (rasterMs / frameCount)
+				<< std::setw(10) << (testMs / frameCount) << std::endl;
+		}
+	}
+
+	/***********************************************************
+	 *  BenchmarkLevelOfDetail()
+	 *
+	 *  Lays out a field of spheres of mixed sizes stretching
+	 *  away from the camera and counts the triangles drawn at
+	 *  full detail and with a level chosen per sphere, as the
+	 *  camera moves into the field.  A second pass sways the
+	 *  camera back and forth by a small step, where objects
+	 *  near a threshold would change level every frame
+	 *  without the hysteresis margin.
+	 ***********************************************************/
+	void BenchmarkLevelOfDetail()
+	{
+		const int rowCount = 200;
+		const int columnCount = 100;
+		const int frameCount = 100;
+
+		long long triangleCounts[MeshGeometry::LEVEL_COUNT];
+		std::vector<MeshGeometry::MESH_VERTEX> vertices;
+		std::vector<uint32_t> indices;
+		for (int level = 0; level < MeshGeometry::LEVEL_COUNT; level++)
+		{
+			MeshGeometry::Build(SceneFile::MESH_SPHERE, vertices, indices, level);
+			triangleCounts[level] = (long long)(indices.size() / 3);
+		}
+
+		std::vector<glm::vec4> spheres;
+		unsigned int seed = 12345;
+		for (int row = 0; row < rowCount; row++)
+		{
+			for (int column = 0; column < columnCount; column++)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				float radius = 0.25f + (float)((seed >> 16) % 8) * 0.25f;
+				spheres.push_back(glm::vec4(-200.0f + 4.0f * (float)column, radius, -5.0f - 4.0f * (float)row, radius));
+			}
+		}
+
+		const glm::mat4 projection = glm::perspective(glm::radians(80.0f), 1000.0f / 800.0f, 0.1f, 1000.0f);
+
+		std::cout << "Sphere triangles per frame for " << spheres.size() << " spheres:" << std::endl;
+		std::cout << std::setw(8) << "pass" << std::setw(14) << "full detail" << std::setw(14) << "with lod"
+			<< std::setw(10) << "ratio" << std::setw(14) << "changes/frame" << std::setw(12) << "select ms" << std::endl;
+
+		for (int pass = 0; pass < 2; pass++)
+		{
+			LevelOfDetail levelOfDetail;
+			levelOfDetail.Reset((int)spheres.size());
+			long long fullTriangles = 0;
+			long long lodTriangles = 0;
+			double selectNs = 0.0;
+
+			for (int frame = 0; frame < frameCount; frame++)
+			{
+				// the first pass moves into the field, the second sways
+				// over half a unit
+				float z = (pass == 0) ? -2.0f * (float)frame : ((frame % 2 == 0) ? 0.0f : -0.5f);
+				glm::vec3 eye(0.0f, 3.0f, z);
+				levelOfDetail.SetViewProjection(projection * glm::lookAt(eye, eye + glm::vec3(0.0f, -0.1f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+				Clock::time_point start = Clock::now();
+				for (size_t i = 0; i < spheres.size(); i++)
+				{
+					int level = levelOfDetail.SelectLevel((int)i, glm::vec3(spheres[i]), spheres[i].w, MeshGeometry::LEVEL_COUNT);
+					lodTriangles += triangleCounts[level];
+				}
+				selectNs += NanosecondsSince(start);
+				fullTriangles += triangleCounts[0] * (long long)spheres.size();
+			}
+
+			std::cout << std::fixed << std::setprecision(3)
+				<< std::setw(8) << ((pass == 0) ? "dolly" : "sway")
+				<< std::setw(14) << (fullTriangles / frameCount)
+				<< std::setw(14) << (lodTriangles / frameCount)
+				<< std::setw(10) << ((double)fullTriangles / (double)lodTriangles)
+				<< std::setw(14) << ((double)levelOfDetail.GetLevelChangeCount() / frameCount)
+				<< std::setw(12) << (selectNs / frameCount / 1.0e6) << std::endl;
+		}
+	}
+
+	/***********************************************************
+	 *  BenchmarkJobs()
+	 *
+	 *  Builds a scene of 100k boxes in a hundred groups and
+	 *  runs the per-frame scene update on the job system with
+	 *  one thread and with every count up to the CPU cores.
+	 *  Every frame the groups turn and a tenth of the boxes
+	 *  spin, so all the world matrices are rebuilt, then the
+	 *  moved boxes are refit, the hierarchy is culled and the
+	 *  draw packets of the visible boxes are built and sorted,
+	 *  the way SceneManager updates a frame.  The objects
+	 *  updated per second and the speedup over one thread are
+	 *  printed for each thread count.
+	 ***********************************************************/
+	void BenchmarkJobs()
+	{
+		const int groupCount = 100;
+		const int objectsPerGroup = 1000;
+		const int objectCount = groupCount * objectsPerGroup;
+		const int frameCount = 50;
+		const int objectsPerJob = 1024;
+
+		// the root, then the groups, then the boxes
+		const int firstObjectNode = 1 + groupCount;
+		BoundingVolumeHierarchy::BOUNDING_BOX meshBounds;
+		MeshGeometry::GetBounds(SceneFile::MESH_BOX, meshBounds.minimum, meshBounds.maximum);
+
+		// the camera looks across the middle of the scene
+		const glm::vec3 eye(180.0f, 40.0f, -40.0f);
+		const glm::mat4 projection = glm::perspective(glm::radians(80.0f), 1000.0f / 800.0f, 0.1f, 1000.0f);
+		Frustum frustum;
+		frustum.SetViewProjection(projection * glm::lookAt(eye, glm::vec3(180.0f, 0.0f, 180.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+		const int maxThreadCount = std::max(2, (int)std::thread::hardware_concurrency());
+		std::cout << "Scene update of " << objectCount << " objects per frame on " << std::thread::hardware_concurrency()
+			<< " cores:" << std::endl;
+		std::cout << std::setw(8) << "threads" << std::setw(10) << "graph ms" << std::setw(11) << "bounds ms"
+			<< std::setw(10) << "cull ms" << std::setw(12) << "packets ms" << std::setw(10) << "frame ms"
+			<< std::setw(14) << "Mobjects/s" << std::setw(10) << "speedup" << std::setw(10) << "stolen" << std::endl;
+
+		double singleThreadNs = 0.0;
+		long long singleThreadVisible = 0;
+		for (int threadCount = 1; threadCount <= maxThreadCount; threadCount++)
+		{
+			// every run starts from the same scene - the groups in a
+			// square under the root and the boxes in a square inside
+			// each group
+			SceneGraph sceneGraph;
+			sceneGraph.Reserve(firstObjectNode + objectCount);
+			sceneGraph.AddNode(-1, glm::vec3(1.0f), glm::vec3(0.0f), glm::vec3(0.0f));
+			for (int group = 0; group < groupCount; group++)
+			{
+				sceneGraph.AddNode(0, glm::vec3(1.0f), glm::vec3(0.0f),
+					glm::vec3((float)(group % 10) * 40.0f, 0.0f, (float)(group / 10) * 40.0f));
+			}
+			for (int i = 0; i < objectCount; i++)
+			{
+				int local = i % objectsPerGroup;
+				sceneGraph.AddNode(1 + i / objectsPerGroup, glm::vec3(0.5f), glm::vec3(0.0f, (float)(i % 90), 0.0f),
+					glm::vec3((float)(local % 32) - 16.0f, 0.25f, (float)(local / 32) - 16.0f));
+			}
+			sceneGraph.Update();
+
+			std::vector<BoundingVolumeHierarchy::BOUNDING_BOX> bounds(objectCount);
+			for (int i = 0; i < objectCount; i++)
+			{
+				bounds[i] = BoundingVolumeHierarchy::TransformBox(meshBounds, sceneGraph.GetWorldMatrices()[firstObjectNode + i]);
+			}
+			BoundingVolumeHierarchy hierarchy;
+			hierarchy.Build(bounds.data(), objectCount);
+			JobSystem jobSystem(threadCount);
+			RenderQueue renderQueue;
+			std::vector<BoundingVolumeHierarchy::BOUNDING_BOX> updatedBounds;
+			std::vector<uint32_t> visibleObjects;
+			long long visibleTotal = 0;
+			double graphNs = 0.0;
+			double boundsNs = 0.0;
+			double cullNs = 0.0;
+			double packetsNs = 0.0;
+
+			for (int frame = 0; frame < frameCount; frame++)
+			{
+				for (int group = 0; group < groupCount; group++)
+				{
+					sceneGraph.SetLocalTransform(1 + group, glm::vec3(1.0f), glm::vec3(0.0f, (float)frame, 0.0f),
+						sceneGraph.GetLocalPosition(1 + group));
+				}
+				for (int i = frame % 10; i < objectCount; i += 10)
+				{
+					sceneGraph.SetLocalTransform(firstObjectNode + i, glm::vec3(0.5f), glm::vec3(0.0f, (float)(i % 90 + frame), 0.0f),
+						sceneGraph.GetLocalPosition(firstObjectNode + i));
+				}
+
+				Clock::time_point start = Clock::now();
+				sceneGraph.Update(&jobSystem);
+				graphNs += NanosecondsSince(start);
+
+				start = Clock::now();
+				const std::vector<int>& updatedNodes = sceneGraph.GetLastUpdatedNodes();
+				const glm::mat4* pModels = sceneGraph.GetWorldMatrices();
+				updatedBounds.resize(updatedNodes.size());
+				jobSystem.ParallelFor((int)updatedNodes.size(), objectsPerJob, [&](int first, int count)
+					{
+						for (int i = first; i < first + count; i++)
+						{
+							updatedBounds[i] = BoundingVolumeHierarchy::TransformBox(meshBounds, pModels[updatedNodes[i]]);
+						}
+					});
+				for (size_t i = 0; i < updatedNodes.size(); i++)
+				{
+					if (updatedNodes[i] >= firstObjectNode)
+					{
+						hierarchy.UpdateBounds(updatedNodes[i] - firstObjectNode, updatedBounds[i]);
+					}
+				}
+				hierarchy.Refit();
+				boundsNs += NanosecondsSince(start);
+
+				start = Clock::now();
+				hierarchy.Cull(frustum, visibleObjects, &jobSystem);
+				cullNs += NanosecondsSince(start);
+				visibleTotal += (long long)visibleObjects.size();
+
+				start = Clock::now();
+				renderQueue.Clear();
+				RenderQueue::DRAW_PACKET* pPackets = renderQueue.SubmitRange((int)visibleObjects.size());
+				jobSystem.ParallelFor((int)visibleObjects.size(), objectsPerJob, [&](int first, int count)
+					{
+						for (int packet = first; packet < first + count; packet++)
+						{
+							uint32_t i = visibleObjects[packet];
+							glm::vec3 offset = glm::vec3(pModels[firstObjectNode + i][3]) - eye;
+							pPackets[packet].sortKey = RenderQueue::MakeSortKey(1, (int)(i % 8), (int)(i % 7),
+								SceneFile::MESH_BOX, glm::dot(offset, offset));
+							pPackets[packet].objectIndex = i;
+						}
+					});
+				renderQueue.Sort();
+				packetsNs += NanosecondsSince(start);
+				g_BenchmarkSink += renderQueue.GetPackets()[0].objectIndex;
+			}
+
+			const double frameNs = graphNs + boundsNs + cullNs + packetsNs;
+			if (threadCount == 1)
+			{
+				singleThreadNs = frameNs;
+				singleThreadVisible = visibleTotal;
+			}
+			else if (visibleTotal != singleThreadVisible)
+			{
+				std::cout << "Culling mismatch: " << visibleTotal << " visible on " << threadCount << " threads, "
+					<< singleThreadVisible << " on one" << std::endl;
+			}
+
+			std::cout << std::fixed << std::setprecision(3)
+				<< std::setw(8) << threadCount
+				<< std::setw(10) << (graphNs / frameCount / 1.0e6)
+				<< std::setw(11) << (boundsNs / frameCount / 1.0e6)
+				<< std::setw(10) << (cullNs / frameCount / 1.0e6)
+				<< std::setw(12) << (packetsNs / frameCount / 1.0e6)
+				<< std::setw(10) << (frameNs / frameCount / 1.0e6)
+				<< std::setw(14) << ((double)objectCount * frameCount / frameNs * 1.0e3)
+				<< std::setw(10) << (singleThreadNs / frameNs)
+				<< std::setw(10) << jobSystem.GetStealCount() << std::endl;
+		}
+		std::cout << (singleThreadVisible / frameCount) << " objects visible per frame. The hierarchy refit and the"
+			<< " packet sort stay on one thread." << std::endl;
+	}
+
+	struct BENCHMARK_INFO
+	{
+		const char* name;
+		void (*function)();
+	};
+
+	// all the available benchmarks
+	const BENCHMARK_INFO g_Benchmarks[] =
+	{
+		{ "taglookup", BenchmarkTagLookup },
+		{ "sceneload", BenchmarkSceneLoad },
+		{ "renderqueue", BenchmarkRenderQueue },
+		{ "transforms", BenchmarkTransforms },
+		{ "scenegraph", BenchmarkSceneGraph },
+		{ "culling", BenchmarkCulling },
+		{ "occlusion", BenchmarkOcclusion },
+		{ "lod", BenchmarkLevelOfDetail },
+		{ "jobs", BenchmarkJobs },
+	};
+}
+
+/***********************************************************
+ *  WriteStressScene()
+ *
+ *  This function is used for writing a text scene of the
+ *  passed in number of small boxes and spheres in a square
+ *  grid on the XZ plane, textured with the desk scene
+ *  images, so the renderer can be tested at scale.
+ ***********************************************************/
+bool WriteStressScene(const char* filename, int objectCount)
+{
+	const char* textureNames[] = { "Book", "Brick", "BrownPlastic", "Glass", "Gold", "Wood" };
+	const int textureCount = sizeof(textureNames) / sizeof(textureNames[0]);
+
+	std::ofstream file(filename, std::ios::trunc);
+	if (!file)
+	{
+		std::cout << "Could not write stress scene:" << filename << std::endl;
+		return(false);
+	}
+
+	file << "# stress scene of " << objectCount << " boxes and spheres\n";
+	for (int i = 0; i < textureCount; i++)
+	{
+		file << "texture " << textureNames[i] << " resources/textures/" << textureNames[i] << ".jpg\n";
+	}
+	file << "material Plain ambient 0.2 0.2 0.2 strength 0.4 diffuse 0.5 0.5 0.5 specular 0.3 0.3 0.3 shininess 4\n";
+	file << "light position 0 10 0 ambient 0.4 0.4 0.4 diffuse 0.6 0.6 0.6 specular 0.4 0.4 0.4 focal 16 intensity 0.5\n";
+
+	int gridSize = 1;
+	while (gridSize * gridSize < objectCount)
+	{
+		gridSize++;
+	}
+	const float spacing = 0.5f;
+	const float origin = -0.5f * spacing * (gridSize - 1);
+
+	for (int i = 0; i < objectCount; i++)
+	{
+		float x = origin + spacing * (i % gridSize);
+		float z = origin + spacing * (i / gridSize);
+		if ((i % 2) == 0)
+		{
+			file << "object box scale 0.3 0.3 0.3 rotation 0 " << (i % 90) << " 0 position " << x << " 0.15 " << z;
+		}
+		else
+		{
+			file << "object sphere scale 0.15 0.15 0.15 rotation 0 0 0 position " << x << " 0.15 " << z;
+		}
+		file << " texture " << textureNames[(i / 2) % textureCount] << " material Plain\n";
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  RunSceneBenchmarks()
+ *
+ *  This function is used for running the benchmark with the
+ *  passed in name, or all benchmarks.
+ ***********************************************************/
+bool RunSceneBenchmarks(const char* benchmarkName)
+{
+	bool bRunAll = (NULL == benchmarkName) || (strcmp(benchmarkName, "all") == 0);
+	bool bFound = false;
+
+	for (const BENCHMARK_INFO& benchmark : g_Benchmarks)
+	{
+		if ((bRunAll == true) || (strcmp(benchmarkName, benchmark.name) == 0))
+		{
+			std::cout << "=== " << benchmark.name << " ===" << std::endl;
+			benchmark.function();
+			bFound = true;
+		}
+	}
+
+	if (bFound == false)
+	{
+		std::cout << "Unknown benchmark:" << benchmarkName << ", available:";
+		for (const BENCHMARK_INFO& benchmark : g_Benchmarks)
+		{
+			std::cout << " " << benchmark.name;
+		}
+		std::cout << std::endl;
+	}
+
+	return(bFound);
+}
@@ -0,0 +1,17 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebenchmarks.h
+// ============
+// CPU microbenchmarks for the scene management code, run from the
+// command line with --benchmark [name]
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// run the named benchmark, or every benchmark when the name is
+// NULL or "all" - returns false if the name is not recognized
+bool RunSceneBenchmarks(const char* benchmarkName);
+
+// write a text scene file of the passed in number of textured boxes
+// and spheres laid out in a grid, for testing rendering at scale
+bool WriteStressScene(const char* filename, int objectCount);
@@ -0,0 +1,585 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.cpp
+// ============
+// compile text scene descriptions into binary files that are memory
+// mapped and used in place
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneFile.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	const uint32_t g_SceneMagic = 0x314E4353; // "SCN1"
+	const uint32_t g_SceneVersion = 2;
+	const size_t g_SectionAlignment = 16;
+
+	const char* g_MeshTypeNames[SceneFile::MESH_TYPE_COUNT] =
+	{
+		"plane", "box", "prism", "sphere", "cylinder"
+	};
+
+	// fixed size header at the start of every binary scene file,
+	// followed by the record sections at aligned offsets
+	struct SCENE_HEADER
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t sourceSize;
+		int64_t sourceModifiedTime;
+		uint32_t textureCount;
+		uint32_t materialCount;
+		uint32_t lightCount;
+		uint32_t groupCount;
+		uint32_t objectCount;
+		uint64_t textureOffset;
+		uint64_t materialOffset;
+		uint64_t lightOffset;
+		uint64_t groupOffset;
+		uint64_t objectOffset;
+		uint64_t stringOffset;
+		uint64_t stringByteCount;
+	};
+
+	// round an offset up to the section alignment
+	uint64_t AlignOffset(uint64_t offset)
+	{
+		return (offset + g_SectionAlignment - 1) & ~(uint64_t)(g_SectionAlignment - 1);
+	}
+
+	// append a string to the string table, returning its offset
+	uint32_t AddString(std::string& strings, const std::string& value)
+	{
+		uint32_t offset = (uint32_t)strings.size();
+		strings.append(value);
+		strings.push_back('\0');
+		return(offset);
+	}
+
+	// read the passed in number of floats from a line
+	bool ReadFloats(std::istringstream& line, float* values, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			if (!(line >> values[i]))
+			{
+				return(false);
+			}
+		}
+		return(true);
+	}
+
+	// write a record section at its aligned offset
+	template<typename T>
+	void WriteSection(std::ofstream& file, const std::vector<T>& records, uint64_t offset)
+	{
+		char padding[g_SectionAlignment] = { 0 };
+		file.write(padding, (std::streamsize)(offset - (uint64_t)file.tellp()));
+		if (records.empty() == false)
+		{
+			file.write((const char*)records.data(), (std::streamsize)(records.size() * sizeof(T)));
+		}
+	}
+}
+
+/***********************************************************
+ *  SceneFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneFile::SceneFile()
+{
+	m_textureCount = 0;
+	m_pTextures = NULL;
+	m_materialCount = 0;
+	m_pMaterials = NULL;
+	m_lightCount = 0;
+	m_pLights = NULL;
+	m_groupCount = 0;
+	m_pGroups = NULL;
+	m_objectCount = 0;
+	m_pObjects = NULL;
+	m_pStrings = NULL;
+}
+
+/***********************************************************
+ *  GetBinaryFilename()
+ *
+ *  This method is used for getting the compiled file of a
+ *  text scene file, which sits next to it.
+ ***********************************************************/
+std::string SceneFile::GetBinaryFilename(const char* textFilename)
+{
+	return std::filesystem::path(textFilename).replace_extension(".scenebin").string();
+}
+
+/***********************************************************
+ *  GetSourceInfo()
+ *
+ *  This method is used for getting the size and modification
+ *  time that a compiled file is checked against.
+ ***********************************************************/
+bool SceneFile::GetSourceInfo(const char* filename, uint64_t& size, int64_t& modifiedTime)
+{
+	std::error_code error;
+	size = (uint64_t)std::filesystem::file_size(filename, error);
+	if (error)
+	{
+		return(false);
+	}
+	std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(filename, error);
+	if (error)
+	{
+		return(false);
+	}
+	modifiedTime = (int64_t)writeTime.time_since_epoch().count();
+	return(true);
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for loading a scene.  The compiled
+ *  binary file is mapped when it is current, otherwise the
+ *  text file is compiled again first.
+ ***********************************************************/
+bool SceneFile::Load(const char* filename)
+{
+	uint64_t sourceSize = 0;
+	int64_t sourceModifiedTime = 0;
+	if (GetSourceInfo(filename, sourceSize, sourceModifiedTime) == false)
+	{
+		std::cout << "Could not find scene file:" << filename << std::endl;
+		return(false);
+	}
+
+	std::string binaryFilename = GetBinaryFilename(filename);
+	if (MapBinary(binaryFilename.c_str(), sourceSize, sourceModifiedTime) == true)
+	{
+		return(true);
+	}
+
+	if (Compile(filename, binaryFilename.c_str()) == false)
+	{
+		return(false);
+	}
+	return MapBinary(binaryFilename.c_str(), sourceSize, sourceModifiedTime);
+}
+
+/***********************************************************
+ *  MapBinary()
+ *
+ *  This method is used for mapping a binary scene file and
+ *  pointing the record arrays into it, after checking that
+ *  it was compiled from the current text file and that
+ *  every section lies within the file.
+ ***********************************************************/
+bool SceneFile::MapBinary(const char* binaryFilename, uint64_t sourceSize, int64_t sourceModifiedTime)
+{
+	m_file.Close();
+	if (m_file.Open(binaryFilename) == false)
+	{
+		return(false);
+	}
+
+	const unsigned char* pData = m_file.GetData();
+	uint64_t fileSize = (uint64_t)m_file.GetSize();
+
+	SCENE_HEADER header;
+	bool bValid = (fileSize >= sizeof(SCENE_HEADER));
+	if (bValid == true)
+	{
+		memcpy(&header, pData, sizeof(SCENE_HEADER));
+		bValid = (header.magic == g_SceneMagic) &&
+			(header.version == g_SceneVersion) &&
+			(header.sourceSize == sourceSize) &&
+			(header.sourceModifiedTime == sourceModifiedTime) &&
+			(header.textureOffset + (uint64_t)header.textureCount * sizeof(SCENE_TEXTURE) <= fileSize) &&
+			(header.materialOffset + (uint64_t)header.materialCount * sizeof(SCENE_MATERIAL) <= fileSize) &&
+			(header.lightOffset + (uint64_t)header.lightCount * sizeof(SCENE_LIGHT) <= fileSize) &&
+			(header.groupOffset + (uint64_t)header.groupCount * sizeof(SCENE_GROUP) <= fileSize) &&
+			(header.objectOffset + (uint64_t)header.objectCount * sizeof(SCENE_OBJECT) <= fileSize) &&
+			(header.stringOffset + header.stringByteCount <= fileSize) &&
+			(header.stringByteCount > 0) &&
+			(pData[header.stringOffset + header.stringByteCount - 1] == '\0');
+	}
+	if (bValid == false)
+	{
+		m_file.Close();
+		return(false);
+	}
+
+	m_textureCount = (int)header.textureCount;
+	m_pTextures = (const SCENE_TEXTURE*)(pData + header.textureOffset);
+	m_materialCount = (int)header.materialCount;
+	m_pMaterials = (const SCENE_MATERIAL*)(pData + header.materialOffset);
+	m_lightCount = (int)header.lightCount;
+	m_pLights = (const SCENE_LIGHT*)(pData + header.lightOffset);
+	m_groupCount = (int)header.groupCount;
+	m_pGroups = (const SCENE_GROUP*)(pData + header.groupOffset);
+	m_objectCount = (int)header.objectCount;
+	m_pObjects = (const SCENE_OBJECT*)(pData + header.objectOffset);
+	m_pStrings = (const char*)(pData + header.stringOffset);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Compile()
+ *
+ *  This method is used for compiling a text scene file.
+ *  Each line holds one record, starting with its kind:
+ *
+ *    texture <tag> <image file>
+ *    material <tag> ambient r g b strength s diffuse r g b
+ *             specular r g b shininess s
+ *    light position x y z ambient r g b diffuse r g b
+ *          specular r g b focal f intensity i
+ *    group <tag> [parent <tag>] [scale x y z]
+ *          [rotation x y z] [position x y z]
+ *    object <mesh> scale x y z rotation x y z position x y z
+ *           [texture <tag>] [material <tag>] [parent <tag>]
+ *           [color r g b a] [uvscale u v]
+ *
+ *  Everything after a # is a comment.  Texture, material
+ *  and group tags are resolved to indices here, so the
+ *  compiled objects refer to them by index.  The transform
+ *  of a group or object with a parent is relative to the
+ *  parent group, which must be defined before any group
+ *  that uses it.
+ ***********************************************************/
+bool SceneFile::Compile(const char* textFilename, const char* binaryFilename)
+{
+	std::ifstream input(textFilename);
+	if (!input)
+	{
+		std::cout << "Could not open scene file:" << textFilename << std::endl;
+		return(false);
+	}
+
+	std::vector<SCENE_TEXTURE> textures;
+	std::vector<SCENE_MATERIAL> materials;
+	std::vector<SCENE_LIGHT> lights;
+	std::vector<SCENE_GROUP> groups;
+	std::vector<SCENE_OBJECT> objects;
+	std::string strings;
+	std::unordered_map<std::string, int> textureIndices;
+	std::unordered_map<std::string, int> materialIndices;
+	std::unordered_map<std::string, int> groupIndices;
+	// texture and material tags of each object, resolved at the end
+	std::vector<std::pair<std::string, std::string>> objectTags;
+	std::vector<std::string> objectParents;
+	std::vector<int> objectLines;
+
+	std::string text;
+	int lineNumber = 0;
+	bool bValid = true;
+	while (std::getline(input, text))
+	{
+		lineNumber++;
+		size_t comment = text.find('#');
+		if (comment != std::string::npos)
+		{
+			text.erase(comment);
+		}
+
+		std::istringstream line(text);
+		std::string kind;
+		if (!(line >> kind))
+		{
+			continue;
+		}
+
+		std::string key;
+		bool bLineValid = true;
+		if (kind == "texture")
+		{
+			std::string tag;
+			std::string filename;
+			bLineValid = (line >> tag >> filename) && (textureIndices.count(tag) == 0);
+			if (bLineValid == true)
+			{
+				SCENE_TEXTURE texture;
+				texture.tagOffset = AddString(strings, tag);
+				texture.filenameOffset = AddString(strings, filename);
+				textureIndices[tag] = (int)textures.size();
+				textures.push_back(texture);
+			}
+		}
+		else if (kind == "material")
+		{
+			std::string tag;
+			SCENE_MATERIAL material;
+			memset(&material, 0, sizeof(material));
+			bLineValid = (line >> tag) && (materialIndices.count(tag) == 0);
+			while ((bLineValid == true) && (line >> key))
+			{
+				if (key == "ambient")
+					bLineValid = ReadFloats(line, material.ambientColor, 3);
+				else if (key == "strength")
+					bLineValid = ReadFloats(line, &material.ambientStrength, 1);
+				else if (key == "diffuse")
+					bLineValid = ReadFloats(line, material.diffuseColor, 3);
+				else if (key == "specular")
+					bLineValid = ReadFloats(line, material.specularColor, 3);
+				else if (key == "shininess")
+					bLineValid = ReadFloats(line, &material.shininess, 1);
+				else
+					bLineValid = false;
+			}
+			if (bLineValid == true)
+			{
+				material.tagOffset = AddString(strings, tag);
+				materialIndices[tag] = (int)materials.size();
+				materials.push_back(material);
+			}
+		}
+		else if (kind == "light")
+		{
+			SCENE_LIGHT light;
+			memset(&light, 0, sizeof(light));
+			bLineValid = ((int)lights.size() < MAX_LIGHTS);
+			while ((bLineValid == true) && (line >> key))
+			{
+				if (key == "position")
+					bLineValid = ReadFloats(line, light.position, 3);
+				else if (key == "ambient")
+					bLineValid = ReadFloats(line, light.ambientColor, 3);
+				else if (key == "diffuse")
+					bLineValid = ReadFloats(line, light.diffuseColor, 3);
+				else if (key == "specular")
+					bLineValid = ReadFloats(line, light.specularColor, 3);
+				else if (key == "focal")
+					bLineValid = ReadFloats(line, &light.focalStrength, 1);
+				else if (key == "intensity")
+					bLineValid = ReadFloats(line, &light.specularIntensity, 1);
+				else
+					bLineValid = false;
+			}
+			if (bLineValid == true)
+			{
+				lights.push_back(light);
+			}
+		}
+		else if (kind == "group")
+		{
+			std::string tag;
+			SCENE_GROUP group;
+			memset(&group, 0, sizeof(group));
+			group.parentIndex = -1;
+			group.scale[0] = group.scale[1] = group.scale[2] = 1.0f;
+			bLineValid = (line >> tag) && (groupIndices.count(tag) == 0);
+			while ((bLineValid == true) && (line >> key))
+			{
+				if (key == "scale")
+					bLineValid = ReadFloats(line, group.scale, 3);
+				else if (key == "rotation")
+					bLineValid = ReadFloats(line, group.rotation, 3);
+				else if (key == "position")
+					bLineValid = ReadFloats(line, group.position, 3);
+				else if (key == "parent")
+				{
+					// parents come first, so a group never moves before its parent
+					std::string parent;
+					bLineValid = (line >> parent) && (groupIndices.count(parent) != 0);
+					if (bLineValid == true)
+					{
+						group.parentIndex = groupIndices[parent];
+					}
+				}
+				else
+					bLineValid = false;
+			}
+			if (bLineValid == true)
+			{
+				group.tagOffset = AddString(strings, tag);
+				groupIndices[tag] = (int)groups.size();
+				groups.push_back(group);
+			}
+		}
+		else if (kind == "object")
+		{
+			SCENE_OBJECT object;
+			memset(&object, 0, sizeof(object));
+			object.textureIndex = -1;
+			object.materialIndex = -1;
+			object.groupIndex = -1;
+			object.scale[0] = object.scale[1] = object.scale[2] = 1.0f;
+			object.color[0] = object.color[1] = object.color[2] = object.color[3] = 1.0f;
+			object.uvScale[0] = object.uvScale[1] = 1.0f;
+
+			std::string meshName;
+			bLineValid = !!(line >> meshName);
+			object.meshType = MESH_TYPE_COUNT;
+			for (int i = 0; i < MESH_TYPE_COUNT; i++)
+			{
+				if (meshName == g_MeshTypeNames[i])
+				{
+					object.meshType = (uint32_t)i;
+				}
+			}
+			bLineValid = bLineValid && (object.meshType != MESH_TYPE_COUNT);
+
+			std::pair<std::string, std::string> tags;
+			std::string parent;
+			while ((bLineValid == true) && (line >> key))
+			{
+				if (key == "scale")
+					bLineValid = ReadFloats(line, object.scale, 3);
+				else if (key == "rotation")
+					bLineValid = ReadFloats(line, object.rotation, 3);
+				else if (key == "position")
+					bLineValid = ReadFloats(line, object.position, 3);
+				else if (key == "color")
+					bLineValid = ReadFloats(line, object.color, 4);
+				else if (key == "uvscale")
+					bLineValid = ReadFloats(line, object.uvScale, 2);
+				else if (key == "texture")
+					bLineValid = !!(line >> tags.first);
+				else if (key == "material")
+					bLineValid = !!(line >> tags.second);
+				else if (key == "parent")
+					bLineValid = !!(line >> parent);
+				else
+					bLineValid = false;
+			}
+			if (bLineValid == true)
+			{
+				objects.push_back(object);
+				objectTags.push_back(tags);
+				objectParents.push_back(parent);
+				objectLines.push_back(lineNumber);
+			}
+		}
+		else
+		{
+			bLineValid = false;
+		}
+
+		if (bLineValid == false)
+		{
+			std::cout << textFilename << "(" << lineNumber << "): invalid " << kind << " line" << std::endl;
+			bValid = false;
+		}
+	}
+
+	// objects can refer to textures, materials and groups defined after them
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		const std::pair<std::string, std::string>& tags = objectTags[i];
+		if (tags.first.empty() == false)
+		{
+			std::unordered_map<std::string, int>::const_iterator found = textureIndices.find(tags.first);
+			if (found == textureIndices.end())
+			{
+				std::cout << textFilename << "(" << objectLines[i] << "): unknown texture " << tags.first << std::endl;
+				bValid = false;
+			}
+			else
+			{
+				objects[i].textureIndex = found->second;
+			}
+		}
+		if (tags.second.empty() == false)
+		{
+			std::unordered_map<std::string, int>::const_iterator found = materialIndices.find(tags.second);
+			if (found == materialIndices.end())
+			{
+				std::cout << textFilename << "(" << objectLines[i] << "): unknown material " << tags.second << std::endl;
+				bValid = false;
+			}
+			else
+			{
+				objects[i].materialIndex = found->second;
+			}
+		}
+		if (objectParents[i].empty() == false)
+		{
+			std::unordered_map<std::string, int>::const_iterator found = groupIndices.find(objectParents[i]);
+			if (found == groupIndices.end())
+			{
+				std::cout << textFilename << "(" << objectLines[i] << "): unknown group " << objectParents[i] << std::endl;
+				bValid = false;
+			}
+			else
+			{
+				objects[i].groupIndex = found->second;
+			}
+		}
+	}
+
+	if (bValid == false)
+	{
+		return(false);
+	}
+
+	SCENE_HEADER header;
+	memset(&header, 0, sizeof(SCENE_HEADER));
+	if (GetSourceInfo(textFilename, header.sourceSize, header.sourceModifiedTime) == false)
+	{
+		return(false);
+	}
+	// the string table always holds at least its terminator
+	strings.push_back('\0');
+
+	header.magic = g_SceneMagic;
+	header.version = g_SceneVersion;
+	header.textureCount = (uint32_t)textures.size();
+	header.materialCount = (uint32_t)materials.size();
+	header.lightCount = (uint32_t)lights.size();
+	header.groupCount = (uint32_t)groups.size();
+	header.objectCount = (uint32_t)objects.size();
+	header.textureOffset = AlignOffset(sizeof(SCENE_HEADER));
+	header.materialOffset = AlignOffset(header.textureOffset + textures.size() * sizeof(SCENE_TEXTURE));
+	header.lightOffset = AlignOffset(header.materialOffset + materials.size() * sizeof(SCENE_MATERIAL));
+	header.groupOffset = AlignOffset(header.lightOffset + lights.size() * sizeof(SCENE_LIGHT));
+	header.objectOffset = AlignOffset(header.groupOffset + groups.size() * sizeof(SCENE_GROUP));
+	header.stringOffset = AlignOffset(header.objectOffset + objects.size() * sizeof(SCENE_OBJECT));
+	header.stringByteCount = strings.size();
+
+	std::string tempFilename = std::string(binaryFilename) + ".tmp";
+	{
+		std::ofstream file(tempFilename.c_str(), std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			std::cout << "Could not write scene file:" << binaryFilename << std::endl;
+			return(false);
+		}
+
+		file.write((const char*)&header, sizeof(SCENE_HEADER));
+		WriteSection(file, textures, header.textureOffset);
+		WriteSection(file, materials, header.materialOffset);
+		WriteSection(file, lights, header.lightOffset);
+		WriteSection(file, groups, header.groupOffset);
+		WriteSection(file, objects, header.objectOffset);
+		WriteSection(file, std::vector<char>(strings.begin(), strings.end()), header.stringOffset);
+		if (!file)
+		{
+			std::cout << "Could not write scene file:" << binaryFilename << std::endl;
+			return(false);
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempFilename, binaryFilename, error);
+	if (error)
+	{
+		std::filesystem::remove(tempFilename, error);
+		return(false);
+	}
+
+	std::cout << "Compiled scene " << textFilename << ": " << textures.size() << " textures, "
+		<< materials.size() << " materials, " << lights.size() << " lights, "
+		<< groups.size() << " groups, " << objects.size() << " objects" << std::endl;
+
+	return(true);
+}
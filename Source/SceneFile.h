@@ -0,0 +1,144 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.h
+// ============
+// compile text scene descriptions into binary files that are memory
+// mapped and used in place
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <string>
+
+/***********************************************************
+ *  SceneFile
+ *
+ *  This class loads the textures, materials, lights, groups
+ *  and object instances of a scene.  Scenes are authored as
+ *  text .scene files, which are compiled once into a
+ *  .scenebin file next to them.  The binary file holds
+ *  fixed size records that are memory mapped and read in
+ *  place, so loading does no per-object parsing.  It is
+ *  compiled again whenever the text file changes.
+ ***********************************************************/
+class SceneFile
+{
+public:
+	// constructor
+	SceneFile();
+
+	// mesh drawn by an object instance
+	enum MESH_TYPE
+	{
+		MESH_PLANE = 0,
+		MESH_BOX,
+		MESH_PRISM,
+		MESH_SPHERE,
+		MESH_CYLINDER,
+		MESH_TYPE_COUNT
+	};
+
+	// the largest number of lights the shader supports
+	static const int MAX_LIGHTS = 4;
+
+	struct SCENE_TEXTURE
+	{
+		uint32_t tagOffset;
+		uint32_t filenameOffset;
+	};
+
+	struct SCENE_MATERIAL
+	{
+		float ambientColor[3];
+		float ambientStrength;
+		float diffuseColor[3];
+		float specularColor[3];
+		float shininess;
+		uint32_t tagOffset;
+	};
+
+	struct SCENE_LIGHT
+	{
+		float position[3];
+		float ambientColor[3];
+		float diffuseColor[3];
+		float specularColor[3];
+		float focalStrength;
+		float specularIntensity;
+	};
+
+	// a transform that the objects and groups under it are
+	// placed relative to, so a composite object moves as one
+	struct SCENE_GROUP
+	{
+		// index of the parent group, always an earlier one, or -1
+		int32_t parentIndex;
+		float scale[3];
+		// rotation in degrees about the X, Y and Z axes
+		float rotation[3];
+		float position[3];
+		uint32_t tagOffset;
+	};
+
+	struct SCENE_OBJECT
+	{
+		uint32_t meshType;
+		// index into the scene textures, or -1 to use the color
+		int32_t textureIndex;
+		// index into the scene materials, or -1 for none
+		int32_t materialIndex;
+		// index of the group the transform is relative to, or -1
+		int32_t groupIndex;
+		float scale[3];
+		// rotation in degrees about the X, Y and Z axes
+		float rotation[3];
+		float position[3];
+		float color[4];
+		float uvScale[2];
+	};
+
+	// map the compiled form of the text scene file, compiling it first
+	// when the compiled file is missing or older than the text file
+	bool Load(const char* filename);
+	// compile a text scene file into a binary scene file
+	static bool Compile(const char* textFilename, const char* binaryFilename);
+	// get the binary file compiled from the passed in text file
+	static std::string GetBinaryFilename(const char* textFilename);
+
+	int GetTextureCount() const { return m_textureCount; }
+	const SCENE_TEXTURE* GetTextures() const { return m_pTextures; }
+	int GetMaterialCount() const { return m_materialCount; }
+	const SCENE_MATERIAL* GetMaterials() const { return m_pMaterials; }
+	int GetLightCount() const { return m_lightCount; }
+	const SCENE_LIGHT* GetLights() const { return m_pLights; }
+	int GetGroupCount() const { return m_groupCount; }
+	const SCENE_GROUP* GetGroups() const { return m_pGroups; }
+	int GetObjectCount() const { return m_objectCount; }
+	const SCENE_OBJECT* GetObjects() const { return m_pObjects; }
+	// get a tag or filename stored in the scene
+	const char* GetString(uint32_t offset) const { return m_pStrings + offset; }
+
+private:
+	// mapped binary scene file
+	MappedFile m_file;
+	// records of each kind, pointing into the mapped file
+	int m_textureCount;
+	const SCENE_TEXTURE* m_pTextures;
+	int m_materialCount;
+	const SCENE_MATERIAL* m_pMaterials;
+	int m_lightCount;
+	const SCENE_LIGHT* m_pLights;
+	int m_groupCount;
+	const SCENE_GROUP* m_pGroups;
+	int m_objectCount;
+	const SCENE_OBJECT* m_pObjects;
+	const char* m_pStrings;
+
+	// map a binary scene file compiled from a text file of the passed in size and time
+	bool MapBinary(const char* binaryFilename, uint64_t sourceSize, int64_t sourceModifiedTime);
+	// get the size and modification time of the text scene file
+	static bool GetSourceInfo(const char* filename, uint64_t& size, int64_t& modifiedTime);
+};
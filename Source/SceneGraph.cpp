@@ -0,0 +1,341 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegraph.cpp
+// ============
+// parent and child transforms kept in flat arrays, with world matrices
+// rebuilt only for the nodes that changed
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneGraph.h"
+#include "JobSystem.h"
+#include "TransformBatch.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// the fewest nodes updated by one job
+	const int g_NodesPerJob = 1024;
+}
+
+/***********************************************************
+ *  SceneGraph()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneGraph::SceneGraph()
+{
+	m_firstDirty = 0;
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing every node.
+ ***********************************************************/
+void SceneGraph::Clear()
+{
+	m_parents.clear();
+	m_depths.clear();
+	m_depthNodes.clear();
+	for (int axis = 0; axis < 3; axis++)
+	{
+		m_scale[axis].clear();
+		m_rotation[axis].clear();
+		m_position[axis].clear();
+	}
+	m_localModels.clear();
+	m_localNormals.clear();
+	m_worldModels.clear();
+	m_worldNormals.clear();
+	m_dirtyFlags.clear();
+	m_firstDirty = 0;
+	m_updatedNodes.clear();
+}
+
+/***********************************************************
+ *  Reserve()
+ *
+ *  This method is used for reserving the storage of the
+ *  passed in number of nodes, so adding them does not
+ *  reallocate.
+ ***********************************************************/
+void SceneGraph::Reserve(int nodeCount)
+{
+	m_parents.reserve(nodeCount);
+	m_depths.reserve(nodeCount);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		m_scale[axis].reserve(nodeCount);
+		m_rotation[axis].reserve(nodeCount);
+		m_position[axis].reserve(nodeCount);
+	}
+	m_localModels.reserve(nodeCount);
+	m_localNormals.reserve(nodeCount);
+	m_worldModels.reserve(nodeCount);
+	m_worldNormals.reserve(nodeCount);
+	m_dirtyFlags.reserve(nodeCount);
+}
+
+/***********************************************************
+ *  AddNode()
+ *
+ *  This method is used for adding a node under a parent
+ *  that was added before it.  The new node is dirty, so its
+ *  matrices are built by the next Update.
+ ***********************************************************/
+int SceneGraph::AddNode(
+	int parentIndex,
+	const glm::vec3& scale,
+	const glm::vec3& rotationDegrees,
+	const glm::vec3& position)
+{
+	int nodeIndex = GetNodeCount();
+	if ((parentIndex < -1) || (parentIndex >= nodeIndex))
+	{
+		return(-1);
+	}
+
+	m_parents.push_back(parentIndex);
+	int depth = (parentIndex >= 0) ? m_depths[parentIndex] + 1 : 0;
+	m_depths.push_back(depth);
+	if (depth >= (int)m_depthNodes.size())
+	{
+		m_depthNodes.resize(depth + 1);
+	}
+	m_depthNodes[depth].push_back(nodeIndex);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		m_scale[axis].push_back(scale[axis]);
+		m_rotation[axis].push_back(rotationDegrees[axis]);
+		m_position[axis].push_back(position[axis]);
+	}
+	m_localModels.push_back(glm::mat4(1.0f));
+	m_localNormals.push_back(glm::mat3(1.0f));
+	m_worldModels.push_back(glm::mat4(1.0f));
+	m_worldNormals.push_back(glm::mat3(1.0f));
+	m_dirtyFlags.push_back(0);
+	MarkDirty(nodeIndex);
+
+	return(nodeIndex);
+}
+
+/***********************************************************
+ *  MarkDirty()
+ *
+ *  This method is used for flagging a node whose local
+ *  transform changed.  Its children are found by Update.
+ ***********************************************************/
+void SceneGraph::MarkDirty(int nodeIndex)
+{
+	m_dirtyFlags[nodeIndex] |= DIRTY_LOCAL | DIRTY_WORLD;
+	if (nodeIndex < m_firstDirty)
+	{
+		m_firstDirty = nodeIndex;
+	}
+}
+
+/***********************************************************
+ *  SetLocalTransform()
+ *
+ *  This method is used for changing the scale, rotation and
+ *  position of a node relative to its parent.
+ ***********************************************************/
+void SceneGraph::SetLocalTransform(
+	int nodeIndex,
+	const glm::vec3& scale,
+	const glm::vec3& rotationDegrees,
+	const glm::vec3& position)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		m_scale[axis][nodeIndex] = scale[axis];
+		m_rotation[axis][nodeIndex] = rotationDegrees[axis];
+		m_position[axis][nodeIndex] = position[axis];
+	}
+	MarkDirty(nodeIndex);
+}
+
+/***********************************************************
+ *  SetLocalPosition()
+ *
+ *  This method is used for moving a node relative to its
+ *  parent, keeping its scale and rotation.
+ ***********************************************************/
+void SceneGraph::SetLocalPosition(int nodeIndex, const glm::vec3& position)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		m_position[axis][nodeIndex] = position[axis];
+	}
+	MarkDirty(nodeIndex);
+}
+
+/***********************************************************
+ *  GetLocalPosition()
+ *
+ *  This method is used for getting the position of a node
+ *  relative to its parent.
+ ***********************************************************/
+glm::vec3 SceneGraph::GetLocalPosition(int nodeIndex) const
+{
+	return glm::vec3(m_position[0][nodeIndex], m_position[1][nodeIndex], m_position[2][nodeIndex]);
+}
+
+/***********************************************************
+ *  ComputeLocal()
+ *
+ *  This method is used for rebuilding the local matrices of
+ *  a run of neighboring nodes with the batch builder.
+ ***********************************************************/
+void SceneGraph::ComputeLocal(int firstNode, int count)
+{
+	TransformBatch::TRANSFORM_ARRAYS transforms;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		transforms.pScale[axis] = m_scale[axis].data() + firstNode;
+		transforms.pRotation[axis] = m_rotation[axis].data() + firstNode;
+		transforms.pPosition[axis] = m_position[axis].data() + firstNode;
+	}
+
+	TransformBatch::Compute(
+		transforms,
+		count,
+		m_localModels.data() + firstNode,
+		m_localNormals.data() + firstNode);
+}
+
+/***********************************************************
+ *  ComputeDirtyLocal()
+ *
+ *  This method is used for rebuilding the local matrices of
+ *  the changed nodes in a range, one run of neighboring
+ *  changed nodes at a time.
+ ***********************************************************/
+void SceneGraph::ComputeDirtyLocal(int firstNode, int count)
+{
+	const int endNode = firstNode + count;
+	int runStart = -1;
+	for (int i = firstNode; i <= endNode; i++)
+	{
+		bool bLocalDirty = (i < endNode) && ((m_dirtyFlags[i] & DIRTY_LOCAL) != 0);
+		if ((bLocalDirty == true) && (runStart < 0))
+		{
+			runStart = i;
+		}
+		else if ((bLocalDirty == false) && (runStart >= 0))
+		{
+			ComputeLocal(runStart, i - runStart);
+			runStart = -1;
+		}
+	}
+}
+
+/***********************************************************
+ *  ComputeWorld()
+ *
+ *  This method is used for rebuilding the world matrices of
+ *  a node, which is dirty when it changed or when its
+ *  parent's world matrix changed.  The parent must already
+ *  be settled.  The normal matrix of a product is the
+ *  product of the normal matrices, so no inverse is taken.
+ ***********************************************************/
+bool SceneGraph::ComputeWorld(int nodeIndex)
+{
+	int parent = m_parents[nodeIndex];
+	if ((parent >= 0) && ((m_dirtyFlags[parent] & DIRTY_WORLD) != 0))
+	{
+		m_dirtyFlags[nodeIndex] |= DIRTY_WORLD;
+	}
+	if ((m_dirtyFlags[nodeIndex] & DIRTY_WORLD) == 0)
+	{
+		return(false);
+	}
+
+	if (parent >= 0)
+	{
+		TransformBatch::MultiplyAffine(m_worldModels[parent], m_localModels[nodeIndex], m_worldModels[nodeIndex]);
+		m_worldNormals[nodeIndex] = m_worldNormals[parent] * m_localNormals[nodeIndex];
+	}
+	else
+	{
+		m_worldModels[nodeIndex] = m_localModels[nodeIndex];
+		m_worldNormals[nodeIndex] = m_localNormals[nodeIndex];
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for bringing the world matrices up
+ *  to date.  Only the nodes from the lowest dirty one on
+ *  are visited.  The local matrices of the changed nodes
+ *  are rebuilt in runs, then the world matrices are rebuilt
+ *  with every parent before its children.  On one thread
+ *  that is the node order.  With a job system the local
+ *  matrices are rebuilt in chunks of nodes, and the world
+ *  matrices one depth at a time, since the nodes at one
+ *  depth only read the depth above.
+ ***********************************************************/
+bool SceneGraph::Update(JobSystem* pJobSystem)
+{
+	const int nodeCount = GetNodeCount();
+	m_updatedNodes.clear();
+	if (m_firstDirty >= nodeCount)
+	{
+		return(false);
+	}
+
+	const int firstDirty = m_firstDirty;
+	if (NULL == pJobSystem)
+	{
+		ComputeDirtyLocal(firstDirty, nodeCount - firstDirty);
+
+		// parents come before their children, so a parent's world
+		// matrix and dirty flag are settled before its children
+		for (int i = firstDirty; i < nodeCount; i++)
+		{
+			if (ComputeWorld(i) == true)
+			{
+				m_updatedNodes.push_back(i);
+			}
+		}
+	}
+	else
+	{
+		pJobSystem->ParallelFor(nodeCount - firstDirty, g_NodesPerJob, [this, firstDirty](int first, int count)
+			{
+				ComputeDirtyLocal(firstDirty + first, count);
+			});
+
+		for (const std::vector<int>& depthNodes : m_depthNodes)
+		{
+			// only the nodes from the lowest dirty one on can change
+			const int* pNodes = depthNodes.data() + (std::lower_bound(depthNodes.begin(), depthNodes.end(), firstDirty) - depthNodes.begin());
+			const int count = (int)(depthNodes.data() + depthNodes.size() - pNodes);
+			pJobSystem->ParallelFor(count, g_NodesPerJob, [this, pNodes](int first, int count)
+				{
+					for (int i = first; i < first + count; i++)
+					{
+						ComputeWorld(pNodes[i]);
+					}
+				});
+		}
+
+		// the world flags tell which nodes were rebuilt, in order
+		for (int i = firstDirty; i < nodeCount; i++)
+		{
+			if ((m_dirtyFlags[i] & DIRTY_WORLD) != 0)
+			{
+				m_updatedNodes.push_back(i);
+			}
+		}
+	}
+
+	memset(m_dirtyFlags.data() + firstDirty, 0, nodeCount - firstDirty);
+	m_firstDirty = nodeCount;
+
+	return(true);
+}
@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegraph.h
+// ============
+// parent and child transforms kept in flat arrays, with world matrices
+// rebuilt only for the nodes that changed
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+/***********************************************************
+ *  SceneGraph
+ *
+ *  This class holds a hierarchy of transform nodes.  Every
+ *  node has a local scale, rotation and position relative
+ *  to its parent, and the world matrix is the parent's
+ *  world matrix times the local matrix.  The nodes are
+ *  stored in flat arrays with the parent of a node always
+ *  before it, so one pass in order updates a whole tree.
+ *  Changing a node marks it dirty, and Update rebuilds the
+ *  local matrices of the dirty nodes and the world matrices
+ *  of them and everything below them.  When nothing has
+ *  changed, Update returns at once.  With a job system, the
+ *  nodes are updated in chunks on its threads, one depth of
+ *  the tree after another.
+ ***********************************************************/
+class SceneGraph
+{
+public:
+	// constructor
+	SceneGraph();
+
+	// remove every node
+	void Clear();
+	// reserve storage for the passed in number of nodes
+	void Reserve(int nodeCount);
+	// add a node under the passed in parent, which must already
+	// exist, or -1 for a root - returns the node index, or -1
+	// when the parent is not valid
+	int AddNode(
+		int parentIndex,
+		const glm::vec3& scale,
+		const glm::vec3& rotationDegrees,
+		const glm::vec3& position);
+
+	// change the local transform of a node
+	void SetLocalTransform(
+		int nodeIndex,
+		const glm::vec3& scale,
+		const glm::vec3& rotationDegrees,
+		const glm::vec3& position);
+	void SetLocalPosition(int nodeIndex, const glm::vec3& position);
+
+	// rebuild the matrices of the changed nodes and everything
+	// below them, on the threads of the job system if one is
+	// passed in - returns true when any world matrix changed
+	bool Update(JobSystem* pJobSystem = NULL);
+
+	int GetNodeCount() const { return (int)m_parents.size(); }
+	int GetParent(int nodeIndex) const { return m_parents[nodeIndex]; }
+	glm::vec3 GetLocalPosition(int nodeIndex) const;
+	// the world matrices are valid after Update
+	const glm::mat4* GetWorldMatrices() const { return m_worldModels.data(); }
+	const glm::mat3* GetWorldNormalMatrices() const { return m_worldNormals.data(); }
+	// true when nodes changed since the last Update
+	bool HasChanges() const { return m_firstDirty < GetNodeCount(); }
+	// number of world matrices rebuilt by the last Update
+	int GetLastUpdateCount() const { return (int)m_updatedNodes.size(); }
+	// nodes whose world matrices were rebuilt by the last Update
+	const std::vector<int>& GetLastUpdatedNodes() const { return m_updatedNodes; }
+
+private:
+	enum DIRTY_FLAGS
+	{
+		// the local matrix must be rebuilt
+		DIRTY_LOCAL = 1,
+		// the world matrix must be rebuilt
+		DIRTY_WORLD = 2
+	};
+
+	// parent of every node, or -1 for a root
+	std::vector<int> m_parents;
+	// depth of every node below its root, and the nodes at each
+	// depth in order, whose parents are all at the depth above
+	std::vector<int> m_depths;
+	std::vector<std::vector<int>> m_depthNodes;
+	// local transform of every node, one array per component
+	std::vector<float> m_scale[3];
+	std::vector<float> m_rotation[3];
+	std::vector<float> m_position[3];
+	// local and world model and normal matrices
+	std::vector<glm::mat4> m_localModels;
+	std::vector<glm::mat3> m_localNormals;
+	std::vector<glm::mat4> m_worldModels;
+	std::vector<glm::mat3> m_worldNormals;
+	// dirty flags of every node
+	std::vector<uint8_t> m_dirtyFlags;
+	// lowest dirty node, or the node count when none are dirty
+	int m_firstDirty;
+	// nodes rebuilt by the last update, in order
+	std::vector<int> m_updatedNodes;
+
+	// mark a node's local transform as changed
+	void MarkDirty(int nodeIndex);
+	// rebuild the local matrices of a run of nodes
+	void ComputeLocal(int firstNode, int count);
+	// rebuild the local matrices of the changed nodes in a range
+	void ComputeDirtyLocal(int firstNode, int count);
+	// rebuild the world matrices of a node when it or its parent
+	// changed - returns true when it was rebuilt
+	bool ComputeWorld(int nodeIndex);
+};
@@ -8,14 +8,22 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "MeshGeometry.h"
+#include "Profiler.h"
+#include "TextureLoader.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #endif
 
+#include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
 // declaration of global variables
 namespace
 {
@@ -24,6 +32,109 @@ namespace
 	const char* g_TextureValueName = "objectTexture";
 	const char* g_UseTextureName = "bUseTexture";
 	const char* g_UseLightingName = "bUseLighting";
+	const char* g_UseTextureArrayName = "bUseTextureArray";
+	const char* g_TextureArrayValueName = "objectTextureArray";
+	const char* g_TextureLayerName = "textureLayer";
+	const char* g_MaterialIndexName = "materialIndex";
+	const char* g_UVScaleName = "UVscale";
+	const char* g_UseInstancingName = "bUseInstancing";
+
+	// the maximum number of textures bound to individual texture units
+	const int MAX_TEXTURE_SLOTS = 16;
+	// texture unit of the texture array, past the 2D texture slots so
+	// the 2D and array samplers never share a unit
+	const int g_TextureArrayUnit = MAX_TEXTURE_SLOTS;
+	// directory of the decoded texture cache
+	const char* g_TextureCacheDirectory = "resources/texturecache";
+	// directory of the images compressed by the TextureCompressor tool
+	const char* g_CompressedTextureDirectory = "resources/textures/compressed";
+	// scene loaded when no other scene file is chosen
+	const char* g_DefaultSceneFile = "resources/scenes/desk.scene";
+	// smallest radius over distance of an object chosen as an occluder
+	const float g_MinimumOccluderSize = 0.1f;
+	// the most occluders drawn into the occlusion buffer each frame
+	const int g_MaxOccluderCount = 64;
+	// the fewest objects handled by one job of the scene update
+	const int g_ObjectsPerJob = 1024;
+
+	// get the number of chunks of g_ObjectsPerJob items in a range
+	int GetChunkCount(int itemCount)
+	{
+		return((itemCount + g_ObjectsPerJob - 1) / g_ObjectsPerJob);
+	}
+
+	/***********************************************************
+	 *  ComposeModelMatrix()
+	 *
+	 *  Builds the model matrix of an object from its scale,
+	 *  rotation in degrees about each axis, and position.
+	 ***********************************************************/
+	glm::mat4 ComposeModelMatrix(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ)
+	{
+		glm::mat4 scale = glm::scale(scaleXYZ);
+		glm::mat4 rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
+		glm::mat4 rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
+		glm::mat4 translation = glm::translate(positionXYZ);
+
+		return translation * rotationX * rotationY * rotationZ * scale;
+	}
+
+	/***********************************************************
+	 *  ResizeImageRGBA()
+	 *
+	 *  Resamples an RGB or RGBA image to a square RGBA8 image
+	 *  of the passed in size with bilinear filtering.
+	 ***********************************************************/
+	void ResizeImageRGBA(
+		const unsigned char* image,
+		int width,
+		int height,
+		int colorChannels,
+		int size,
+		unsigned char* resized)
+	{
+		float scaleX = (float)width / size;
+		float scaleY = (float)height / size;
+
+		for (int y = 0; y < size; y++)
+		{
+			float sourceY = (y + 0.5f) * scaleY - 0.5f;
+			if (sourceY < 0.0f) sourceY = 0.0f;
+			int y0 = (int)sourceY;
+			int y1 = (y0 + 1 < height) ? y0 + 1 : y0;
+			float fy = sourceY - y0;
+
+			for (int x = 0; x < size; x++)
+			{
+				float sourceX = (x + 0.5f) * scaleX - 0.5f;
+				if (sourceX < 0.0f) sourceX = 0.0f;
+				int x0 = (int)sourceX;
+				int x1 = (x0 + 1 < width) ? x0 + 1 : x0;
+				float fx = sourceX - x0;
+
+				for (int c = 0; c < 4; c++)
+				{
+					float t00 = 255.0f, t10 = 255.0f, t01 = 255.0f, t11 = 255.0f;
+					if (c < colorChannels)
+					{
+						t00 = image[(y0 * width + x0) * colorChannels + c];
+						t10 = image[(y0 * width + x1) * colorChannels + c];
+						t01 = image[(y1 * width + x0) * colorChannels + c];
+						t11 = image[(y1 * width + x1) * colorChannels + c];
+					}
+					float top = t00 + (t10 - t00) * fx;
+					float bottom = t01 + (t11 - t01) * fx;
+					resized[(y * size + x) * 4 + c] = (unsigned char)(top + (bottom - top) * fy + 0.5f);
+				}
+			}
+		}
+	}
 }
 
 /***********************************************************
@@ -35,6 +146,44 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
 {
 	m_pShaderManager = pShaderManager;
 	m_basicMeshes = new ShapeMeshes();
+	m_loadedTextures = 0;
+	m_bUseTextureArray = false;
+	m_textureArrayLayerSize = 512;
+	m_textureArrayID = 0;
+	m_pTextureStreamer = NULL;
+	m_pReloadLoader = NULL;
+	m_bTexturesStreamed = false;
+	m_bUsePixelBufferUploads = true;
+	m_bUseCompressedTextures = true;
+	m_sceneFilename = g_DefaultSceneFile;
+	m_viewPosition = glm::vec3(0.0f);
+	m_bUseFrustumCulling = true;
+	m_bHasViewFrustum = false;
+	m_cullMilliseconds = 0.0;
+	m_totalVisibleObjects = 0;
+	m_bUseOcclusionCulling = false;
+	m_viewProjection = glm::mat4(1.0f);
+	m_pOcclusionBuffer = NULL;
+	m_pJobSystem = NULL;
+	m_bUseLevelOfDetail = true;
+	memset(m_meshTriangleCounts, 0, sizeof(m_meshTriangleCounts));
+	m_totalTriangles = 0;
+	memset(m_totalLevelObjects, 0, sizeof(m_totalLevelObjects));
+	m_bUseInstancing = false;
+	m_bUseMultiDrawIndirect = false;
+	m_frameSnapshot.instanceCount = 0;
+	m_updateSceneMilliseconds = 0.0;
+	m_updateSceneFrames = 0;
+	m_renderSceneMilliseconds = 0.0;
+	m_renderSceneFrames = 0;
+	m_firstObjectNode = 0;
+
+	// evicted textures are reloaded from their image files on demand
+	m_textureResidency.SetReloadCallback(
+		[this](int residencyID, size_t& byteCount)
+		{
+			return ReloadGLTexture(residencyID, byteCount);
+		});
 }
 
 /***********************************************************
@@ -44,6 +193,27 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
  ***********************************************************/
 SceneManager::~SceneManager()
 {
+	if (NULL != m_pTextureStreamer)
+	{
+		delete m_pTextureStreamer;
+		m_pTextureStreamer = NULL;
+	}
+	if (NULL != m_pReloadLoader)
+	{
+		delete m_pReloadLoader;
+		m_pReloadLoader = NULL;
+	}
+	if (NULL != m_pOcclusionBuffer)
+	{
+		delete m_pOcclusionBuffer;
+		m_pOcclusionBuffer = NULL;
+	}
+	if (NULL != m_pJobSystem)
+	{
+		delete m_pJobSystem;
+		m_pJobSystem = NULL;
+	}
+	DestroyGLTextures();
 	m_pShaderManager = NULL;
 	delete m_basicMeshes;
 	m_basicMeshes = NULL;
@@ -62,7 +232,6 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 	int width = 0;
 	int height = 0;
 	int colorChannels = 0;
-	GLuint textureID = 0;
 
 	// indicate to always flip images vertically when loaded
 	stbi_set_flip_vertically_on_load(true);
@@ -80,41 +249,12 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 	{
 		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
 
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
-		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
-		}
-
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+		bool bReturn = UploadGLTexture(filename, image, width, height, colorChannels, tag);
 
 		// free the image data from local memory
 		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
 
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
-
-		return true;
+		return(bReturn);
 	}
 
 	std::cout << "Could not load image:" << filename << std::endl;
@@ -124,404 +264,1924 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 }
 
 /***********************************************************
- *  BindGLTextures()
+ *  UploadGLTexture()
  *
- *  This method is used for binding the loaded textures to
- *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  This method is used for uploading already decoded image
+ *  data into a new OpenGL texture and loading the texture
+ *  into the next available texture slot in memory.  The
+ *  texture is owned by the residency manager, which may
+ *  evict it and later reload it from the image file.  The
+ *  caller keeps ownership of the image data.
  ***********************************************************/
-void SceneManager::BindGLTextures()
+bool SceneManager::UploadGLTexture(
+	const char* filename,
+	const unsigned char* image,
+	int width,
+	int height,
+	int colorChannels,
+	std::string tag,
+	int mipLevels,
+	CompressedTexture::BLOCK_FORMAT compressedFormat)
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	// there are a total of 16 available slots for scene textures
+	if (m_loadedTextures >= MAX_TEXTURE_SLOTS)
 	{
-		// bind textures on corresponding texture units
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
+		std::cout << "No texture slot available for:" << tag << std::endl;
+		return false;
 	}
-}
 
-/***********************************************************
- *  DestroyGLTextures()
- *
- *  This method is used for freeing the memory in all the
- *  used texture memory slots.
- ***********************************************************/
-void SceneManager::DestroyGLTextures()
-{
-	for (int i = 0; i < m_loadedTextures; i++)
+	// the tag handle doubles as the texture slot, so tags must be unique
+	if (m_textureTags.Find(tag) != TagTable::INVALID_HANDLE)
+	{
+		std::cout << "Texture tag already loaded:" << tag << std::endl;
+		return false;
+	}
+
+	GLuint textureID = CreateGLTextureObject(image, width, height, colorChannels, mipLevels, compressedFormat);
+	if (textureID == 0)
+	{
+		return false;
+	}
+
+	size_t byteCount = TextureResidencyManager::CalculateTextureBytes(width, height, 4);
+	if (compressedFormat != CompressedTexture::FORMAT_NONE)
 	{
-		glGenTextures(1, &m_textureIDs[i].ID);
+		byteCount = CompressedTexture::GetMipChainSize(compressedFormat, width, height, mipLevels);
 	}
+
+	// register the loaded texture and associate it with the special tag string
+	TEXTURE_INFO textureInfo;
+	textureInfo.ID = textureID;
+	textureInfo.tag = tag;
+	textureInfo.filename = filename;
+	textureInfo.residencyID = m_textureResidency.Adopt(GLTexture(textureID), byteCount);
+	m_textureIDs.push_back(textureInfo);
+	m_textureTags.Intern(tag);
+	m_loadedTextures++;
+
+	return true;
 }
 
 /***********************************************************
- *  FindTextureID()
+ *  CreateGLTextureObject()
  *
- *  This method is used for getting an ID for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for configuring the texture mapping
+ *  parameters in OpenGL, uploading decoded image data and
+ *  generating the mipmaps.  When more than one mip level is
+ *  passed in, the image data holds the whole RGBA mip chain
+ *  and every level is uploaded as is.  A block compressed
+ *  mip chain is uploaded with glCompressedTexImage2D.
+ *  Returns zero if the image format is not supported.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+GLuint SceneManager::CreateGLTextureObject(
+	const unsigned char* image,
+	int width,
+	int height,
+	int colorChannels,
+	int mipLevels,
+	CompressedTexture::BLOCK_FORMAT compressedFormat)
 {
-	int textureID = -1;
-	int index = 0;
-	bool bFound = false;
+	GLuint textureID = 0;
+
+	// only RGB and RGBA images are supported
+	if ((colorChannels != 3) && (colorChannels != 4))
+	{
+		std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
+		return 0;
+	}
+
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// image rows are tightly packed, which matters for odd RGB widths
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-	while ((index < m_loadedTextures) && (bFound == false))
+	// block compressed levels are uploaded without conversion
+	if (compressedFormat != CompressedTexture::FORMAT_NONE)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
+		GLenum internalFormat = GL_COMPRESSED_RGBA_BPTC_UNORM;
+		if (compressedFormat == CompressedTexture::FORMAT_BC1)
+			internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		else if (compressedFormat == CompressedTexture::FORMAT_BC3)
+			internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+
+		const unsigned char* level = image;
+		int levelWidth = width;
+		int levelHeight = height;
+		for (int i = 0; i < mipLevels; i++)
 		{
-			textureID = m_textureIDs[index].ID;
-			bFound = true;
+			size_t levelSize = CompressedTexture::GetLevelSize(compressedFormat, levelWidth, levelHeight);
+			glCompressedTexImage2D(GL_TEXTURE_2D, i, internalFormat, levelWidth, levelHeight, 0, (GLsizei)levelSize, level);
+			level += levelSize;
+			levelWidth = (levelWidth > 1) ? levelWidth / 2 : 1;
+			levelHeight = (levelHeight > 1) ? levelHeight / 2 : 1;
 		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mipLevels - 1);
+	}
+	// if the mip chain was already generated, upload every level
+	else if (mipLevels > 1)
+	{
+		const unsigned char* level = image;
+		int levelWidth = width;
+		int levelHeight = height;
+		for (int i = 0; i < mipLevels; i++)
+		{
+			glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8, levelWidth, levelHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, level);
+			level += (size_t)levelWidth * levelHeight * 4;
+			levelWidth = (levelWidth > 1) ? levelWidth / 2 : 1;
+			levelHeight = (levelHeight > 1) ? levelHeight / 2 : 1;
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mipLevels - 1);
+	}
+	else
+	{
+		// if the loaded image is in RGB format
+		if (colorChannels == 3)
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+		// if the loaded image is in RGBA format - it supports transparency
 		else
-			index++;
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+
+		// generate the texture mipmaps for mapping textures to lower resolutions
+		glGenerateMipmap(GL_TEXTURE_2D);
 	}
 
-	return(textureID);
+	glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+
+	return textureID;
 }
 
 /***********************************************************
- *  FindTextureSlot()
+ *  ReloadGLTexture()
  *
- *  This method is used for getting a slot index for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for recreating a texture that was
+ *  evicted by the residency manager, by loading its image
+ *  file again through the texture cache.  The new texture
+ *  object is written back to the texture slot.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+GLTexture SceneManager::ReloadGLTexture(int residencyID, size_t& byteCount)
 {
-	int textureSlot = -1;
-	int index = 0;
-	bool bFound = false;
+	GLTexture texture;
 
-	while ((index < m_loadedTextures) && (bFound == false))
+	for (int i = 0; i < m_loadedTextures; i++)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
+		if (m_textureIDs[i].residencyID != residencyID)
 		{
-			textureSlot = index;
-			bFound = true;
+			continue;
 		}
-		else
-			index++;
+
+		if (NULL == m_pReloadLoader)
+		{
+			m_pReloadLoader = new TextureLoader(1);
+			m_pReloadLoader->SetCacheDirectory(g_TextureCacheDirectory);
+			EnableCompressedTextures(*m_pReloadLoader);
+			m_pReloadLoader->BeginLoading();
+		}
+
+		m_pReloadLoader->AddTexture(m_textureIDs[i].filename.c_str(), m_textureIDs[i].tag);
+		TextureLoader::DECODED_TEXTURE decoded;
+		if (m_pReloadLoader->GetDecodedTexture(decoded, true) == false)
+		{
+			break;
+		}
+		if (NULL == decoded.pixels)
+		{
+			std::cout << "Could not load image:" << m_textureIDs[i].filename << std::endl;
+			break;
+		}
+
+		GLuint textureID = CreateGLTextureObject(
+			decoded.pixels,
+			decoded.width,
+			decoded.height,
+			decoded.colorChannels,
+			decoded.mipLevels,
+			decoded.compressedFormat);
+		texture = GLTexture(textureID);
+		byteCount = TextureResidencyManager::CalculateTextureBytes(decoded.width, decoded.height, 4);
+		if (decoded.compressedFormat != CompressedTexture::FORMAT_NONE)
+		{
+			byteCount = CompressedTexture::GetMipChainSize(
+				decoded.compressedFormat, decoded.width, decoded.height, decoded.mipLevels);
+		}
+		m_pReloadLoader->ReleaseDecodedTexture(decoded);
+
+		m_textureIDs[i].ID = textureID;
+		break;
 	}
 
-	return(textureSlot);
+	return texture;
 }
 
 /***********************************************************
- *  FindMaterial()
+ *  SetTextureMemoryBudget()
  *
- *  This method is used for getting a material from the previously
- *  defined materials list that is associated with the passed in tag.
+ *  This method is used for limiting the bytes of texture
+ *  memory that may be resident at once.
+ ***********************************************************/
+void SceneManager::SetTextureMemoryBudget(size_t budgetBytes)
+{
+	m_textureResidency.SetBudget(budgetBytes);
+}
+
+/***********************************************************
+ *  PrintTextureMemoryStatistics()
+ *
+ *  This method is used for reporting the current and peak
+ *  texture memory usage of the scene.
+ ***********************************************************/
+void SceneManager::PrintTextureMemoryStatistics()
+{
+	m_textureResidency.PrintStatistics();
+}
+
+/***********************************************************
+ *  SetTextureUploadMode()
+ *
+ *  This method is used for choosing whether streamed textures
+ *  are uploaded asynchronously through pixel buffer objects
+ *  or synchronously from client memory.  It takes effect for
+ *  the first streamed texture.
+ ***********************************************************/
+void SceneManager::SetTextureUploadMode(bool bUsePixelBuffers)
+{
+	m_bUsePixelBufferUploads = bUsePixelBuffers;
+}
+
+/***********************************************************
+ *  PrintRenderStatistics()
+ *
+ *  This method is used for printing the CPU time spent
+ *  updating and submitting the scene each frame, the
+ *  objects culled and
+ *  the time spent culling them, the draw calls of the last
+ *  frame, and how many uniform uploads per frame were
+ *  issued and how many were skipped because the value had
+ *  not changed.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+void SceneManager::PrintRenderStatistics()
 {
-	if (m_objectMaterials.size() == 0)
+	if (m_updateSceneFrames > 0)
 	{
-		return(false);
+		std::cout << "Scene update CPU time per frame over " << m_updateSceneFrames << " frames: "
+			<< (m_updateSceneMilliseconds / m_updateSceneFrames) << " ms for "
+			<< m_sceneFile.GetObjectCount() << " objects" << std::endl;
 	}
-
-	int index = 0;
-	bool bFound = false;
-	while ((index < m_objectMaterials.size()) && (bFound == false))
+	if (m_renderSceneFrames > 0)
+	{
+		std::cout << "Scene submission CPU time per frame over " << m_renderSceneFrames << " frames: "
+			<< (m_renderSceneMilliseconds / m_renderSceneFrames) << " ms" << std::endl;
+	}
+	if (m_updateSceneFrames > 0)
+	{
+		double visibleObjects = (double)m_totalVisibleObjects / m_updateSceneFrames;
+		std::cout << "Frustum culling per frame: " << visibleObjects << " visible, "
+			<< (m_sceneFile.GetObjectCount() - visibleObjects) << " culled, "
+			<< (m_cullMilliseconds / m_updateSceneFrames) << " ms over "
+			<< m_objectBVH.GetNodeCount() << " hierarchy nodes" << std::endl;
+	}
+	if ((m_bUseOcclusionCulling == true) && (NULL != m_pOcclusionBuffer))
+	{
+		m_pOcclusionBuffer->PrintStatistics();
+	}
+	if (NULL != m_pJobSystem)
+	{
+		m_pJobSystem->PrintStatistics();
+	}
+	if (m_updateSceneFrames > 0)
 	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
+		std::cout << "Level of detail per frame: " << ((double)m_totalTriangles / m_updateSceneFrames)
+			<< " triangles, objects at each level:";
+		for (int level = 0; level < MeshGeometry::LEVEL_COUNT; level++)
 		{
-			bFound = true;
-			material.ambientColor = m_objectMaterials[index].ambientColor;
-			material.ambientStrength = m_objectMaterials[index].ambientStrength;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
+			std::cout << " " << ((double)m_totalLevelObjects[level] / m_updateSceneFrames);
 		}
-		else
+		std::cout << ", " << m_levelOfDetail.GetLevelChangeCount() << " level changes" << std::endl;
+	}
+	m_shaderState.PrintStatistics();
+	if (m_bUseMultiDrawIndirect == true)
+	{
+		std::cout << "Multi-draw-indirect in the last frame: " << m_meshMegaBuffer.GetSubmitCount()
+			<< " submits of " << m_meshMegaBuffer.GetCommandCount() << " commands for "
+			<< m_meshMegaBuffer.GetInstanceCount() << " objects" << std::endl;
+		if (m_meshMegaBuffer.IsPersistentRingMode() == true)
 		{
-			index++;
+			std::cout << "Frames that waited for a persistent ring region: " << m_meshMegaBuffer.GetRingWaitCount() << std::endl;
 		}
 	}
+	else if (m_bUseInstancing == true)
+	{
+		std::cout << "Instanced draws in the last frame: " << m_instancedMeshes.GetDrawCount()
+			<< " draw calls for " << m_instancedMeshes.GetInstanceCount() << " objects" << std::endl;
+	}
+}
 
-	return(true);
+/***********************************************************
+ *  SetCompressedTextureMode()
+ *
+ *  This method is used for choosing whether images that were
+ *  block compressed by the TextureCompressor tool are loaded
+ *  in place of decoding the source images.  It must be set
+ *  before the scene is prepared.
+ ***********************************************************/
+void SceneManager::SetCompressedTextureMode(bool bEnable)
+{
+	m_bUseCompressedTextures = bEnable;
 }
 
 /***********************************************************
- *  SetTransformations()
+ *  EnableCompressedTextures()
  *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  This method is used for pointing a texture loader at the
+ *  block compressed images, limited to the formats the
+ *  driver can upload.  Texture array layers are resampled
+ *  from decoded pixels, so array mode keeps decoding.
  ***********************************************************/
-void SceneManager::SetTransformations(
-	glm::vec3 scaleXYZ,
-	float XrotationDegrees,
-	float YrotationDegrees,
-	float ZrotationDegrees,
-	glm::vec3 positionXYZ)
+void SceneManager::EnableCompressedTextures(TextureLoader& textureLoader)
 {
-	// variables for this method
-	glm::mat4 modelView;
-	glm::mat4 scale;
-	glm::mat4 rotationX;
-	glm::mat4 rotationY;
-	glm::mat4 rotationZ;
-	glm::mat4 translation;
-
-	// set the scale value in the transform buffer
-	scale = glm::scale(scaleXYZ);
-	// set the rotation values in the transform buffer
-	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-	// set the translation value in the transform buffer
-	translation = glm::translate(positionXYZ);
-
-	modelView = translation * rotationX * rotationY * rotationZ * scale;
+	if ((m_bUseCompressedTextures == false) || (m_bUseTextureArray == true))
+	{
+		return;
+	}
 
-	if (NULL != m_pShaderManager)
+	unsigned int formatMask = 0;
+	if (GLEW_EXT_texture_compression_s3tc)
 	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
+		formatMask |= (1u << CompressedTexture::FORMAT_BC1) | (1u << CompressedTexture::FORMAT_BC3);
 	}
+	if (GLEW_ARB_texture_compression_bptc)
+	{
+		formatMask |= (1u << CompressedTexture::FORMAT_BC7);
+	}
+	textureLoader.SetCompressedDirectory(g_CompressedTextureDirectory, formatMask);
 }
 
 /***********************************************************
- *  SetShaderColor()
+ *  StreamTexture()
  *
- *  This method is used for setting the passed in color
- *  into the shader for the next draw command
+ *  This method is used for loading a texture while the scene
+ *  is rendering.  The image is decoded in the background and
+ *  uploaded over the following frames, then registered with
+ *  the passed in tag once the upload has finished.
  ***********************************************************/
-void SceneManager::SetShaderColor(
-	float redColorValue,
-	float greenColorValue,
-	float blueColorValue,
-	float alphaValue)
+void SceneManager::StreamTexture(const char* filename, std::string tag)
 {
-	// variables for this method
-	glm::vec4 currentColor;
-
-	currentColor.r = redColorValue;
-	currentColor.g = greenColorValue;
-	currentColor.b = blueColorValue;
-	currentColor.a = alphaValue;
-
-	if (NULL != m_pShaderManager)
+	if (NULL == m_pTextureStreamer)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
+		m_pTextureStreamer = new TextureStreamer(
+			m_bUsePixelBufferUploads ? TextureStreamer::UPLOAD_PBO : TextureStreamer::UPLOAD_SYNCHRONOUS);
+		m_pTextureStreamer->SetCacheDirectory(g_TextureCacheDirectory);
+		m_pTextureStreamer->SetCompleteCallback(
+			[this](const TextureLoader::TEXTURE_REQUEST& request, GLTexture texture, int width, int height)
+			{
+				AddStreamedTexture(request, std::move(texture), width, height);
+			});
 	}
+
+	m_pTextureStreamer->StreamTexture(filename, tag);
 }
 
 /***********************************************************
- *  SetShaderTexture()
+ *  UpdateTextureStreaming()
  *
- *  This method is used for setting the texture data
- *  associated with the passed in ID into the shader.
+ *  This method is used for advancing the texture streaming
+ *  once per frame.  Returns the number of textures that are
+ *  still loading.
  ***********************************************************/
-void SceneManager::SetShaderTexture(
-	std::string textureTag)
+int SceneManager::UpdateTextureStreaming()
 {
-	if (NULL != m_pShaderManager)
+	PROFILE_SCOPE("UpdateTextureStreaming");
+
+	if (NULL == m_pTextureStreamer)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
+		return(0);
+	}
 
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
+	m_pTextureStreamer->Update();
+	m_bTexturesStreamed = true;
+	int pendingCount = m_pTextureStreamer->GetPendingCount();
+	if (pendingCount == 0)
+	{
+		m_pTextureStreamer->PrintStatistics();
+		delete m_pTextureStreamer;
+		m_pTextureStreamer = NULL;
 	}
+
+	return(pendingCount);
 }
 
 /***********************************************************
- *  SetTextureUVScale()
+ *  NeedsRedraw()
  *
- *  This method is used for setting the texture UV scale
- *  values into the shader.
+ *  This method is used for finding whether the scene looks
+ *  different from the last frame drawn - when objects or
+ *  groups moved, or streamed textures were uploaded, since
+ *  the last RenderScene.
  ***********************************************************/
-void SceneManager::SetTextureUVScale(float u, float v)
+bool SceneManager::NeedsRedraw() const
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
-	}
+	return (m_sceneGraph.HasChanges() == true) || (m_bTexturesStreamed == true);
 }
 
 /***********************************************************
- *  SetShaderMaterial()
+ *  StartTextureStreamingTest()
  *
- *  This method is used for passing the material values
- *  into the shader.
+ *  This method is used for streaming the passed in number of
+ *  textures, cycling through the image files of the loaded
+ *  scene textures, to measure streaming during rendering.
  ***********************************************************/
-void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+void SceneManager::StartTextureStreamingTest(int textureCount)
 {
-	if (m_objectMaterials.size() > 0)
+	std::vector<std::string> filenames;
+	for (int i = 0; i < m_loadedTextures; i++)
 	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
-
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
+		if (m_textureIDs[i].filename.empty() == false)
 		{
-			m_pShaderManager->setVec3Value("material.ambientColor", material.ambientColor);
-			m_pShaderManager->setFloatValue("material.ambientStrength", material.ambientStrength);
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
+			filenames.push_back(m_textureIDs[i].filename);
 		}
 	}
-}
-
-/**************************************************************/
-/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
-/*** preparing and rendering their own 3D replicated scenes.***/
-/*** Please refer to the code in the OpenGL sample project  ***/
-/*** for assistance.                                        ***/
-/**************************************************************/
-
-void SceneManager::LoadSceneTextures()
-{
-	/*** STUDENTS - add the code BELOW for loading the textures that ***/
-	/*** will be used for mapping to objects in the 3D scene. Up to  ***/
-	/*** 16 textures can be loaded per scene. Refer to the code in   ***/
-	/*** the OpenGL Sample for help.                                 ***/
-
-	bool bReturn = false;
-	
-	//bReturn = CreateGLTexture("resources/textures/Plastic.jpg",
-	//	"ClockBase");
-	//bReturn = CreateGLTexture("resources/textures/Gems.jpg",
-	//	"Gems");
-	//bReturn = CreateGLTexture("resources/textures/Gold.jpg",
-	//	"Gold");
-	//bReturn = CreateGLTexture("resources/textures/Wood.jpg",
-	//	"Wood");
-	bReturn = CreateGLTexture("resources/textures/ExerciseTape.jpg",
-		"Ball");
-	bReturn = CreateGLTexture("resources/textures/Glass.jpg",
-		"Glass");
-	bReturn = CreateGLTexture("resources/textures/BrownPlastic.jpg",
-		"BrownPlastic");
-	bReturn = CreateGLTexture("resources/textures/GreenScreen.jpg",
-		"GreenScreen");
-	bReturn = CreateGLTexture("resources/textures/Book.jpg",
-		"Book");
-	bReturn = CreateGLTexture("resources/textures/RedPlasticTop.jpg",
-		"RedTop");
-
+	if (filenames.empty() == true)
+	{
+		return;
+	}
 
-	// after the texture image data is loaded into memory, the
-	// loaded textures need to be bound to texture slots - there
-	// are a total of 16 available slots for scene textures
-	BindGLTextures();
+	for (int i = 0; i < textureCount; i++)
+	{
+		StreamTexture(
+			filenames[i % filenames.size()].c_str(),
+			"StreamTest" + std::to_string(i));
+	}
 }
 
 /***********************************************************
- *  PrepareScene()
+ *  AddStreamedTexture()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  This method is used for registering a texture that has
+ *  finished streaming in.  It takes the next free texture
+ *  slot and is bound to it.  When there is no slot for it,
+ *  nothing could ever bind it, so it is deleted instead of
+ *  taking up memory the scene's textures need.
  ***********************************************************/
-void SceneManager::PrepareScene()
+void SceneManager::AddStreamedTexture(
+	const TextureLoader::TEXTURE_REQUEST& request,
+	GLTexture texture,
+	int width,
+	int height)
 {
-	// only one instance of a particular mesh needs to be
-	// loaded in memory no matter how many times it is drawn
-	// in the rendered 3D scene
-	LoadSceneTextures();
-	DefineObjectMaterials();
-	SetupSceneLights();
-
-	m_basicMeshes->LoadPlaneMesh();
-	//I will recreate the timer, which will require a box and prism in its most basic form
-	m_basicMeshes->LoadBoxMesh();
-	m_basicMeshes->LoadPrismMesh();
-	m_basicMeshes->LoadSphereMesh();
-	m_basicMeshes->LoadCylinderMesh();
-
+	// streamed textures cannot be added to the immutable texture array,
+	// and the GL texture is deleted along with the passed in object
+	if ((m_bUseTextureArray == true) ||
+		(m_loadedTextures >= MAX_TEXTURE_SLOTS) ||
+		(m_textureTags.Find(request.tag) != TagTable::INVALID_HANDLE))
+	{
+		std::cout << "Could not add streamed texture:" << request.tag << std::endl;
+		return;
+	}
 
+	GLuint textureID = texture.GetID();
+	int residencyID = m_textureResidency.Adopt(
+		std::move(texture),
+		TextureResidencyManager::CalculateTextureBytes(width, height, 4));
+
+	// register the loaded texture and associate it with the special tag string
+	TEXTURE_INFO textureInfo;
+	textureInfo.ID = textureID;
+	textureInfo.tag = request.tag;
+	textureInfo.filename = request.filename;
+	textureInfo.residencyID = residencyID;
+	m_textureIDs.push_back(textureInfo);
+	m_textureTags.Intern(request.tag);
+
+	// bind the texture on its texture unit like BindGLTextures does
+	glActiveTexture(GL_TEXTURE0 + m_loadedTextures);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	m_loadedTextures++;
 }
 
 /***********************************************************
-* DefineObjectMaterials()
+ *  SetTextureArrayMode()
  *
-* This method is used for configuring the various material
-* settings for all of the objects in the 3D scene.
-***********************************************************/
-void SceneManager::DefineObjectMaterials()
+ *  This method is used for choosing whether the scene
+ *  textures are packed into the layers of one texture array
+ *  instead of using one texture unit each.  Array mode lifts
+ *  the 16 texture limit, and since the array stays bound each
+ *  draw only selects a layer.
+ ***********************************************************/
+void SceneManager::SetTextureArrayMode(bool bEnable, int layerSize)
 {
-	//Base Plane object material
-	OBJECT_MATERIAL baseMaterial;
-	baseMaterial.ambientColor = glm::vec3(0.1f, 0.1f, 0.1f);
-	baseMaterial.ambientStrength = 0.4f;
-	baseMaterial.diffuseColor = glm::vec3(0.1f, 0.1f, 0.1f);
-	baseMaterial.specularColor = glm::vec3(0.0f, 0.0f, 0.0f);
-	baseMaterial.shininess = 0.0;
-	baseMaterial.tag = "Base";
-	m_objectMaterials.push_back(baseMaterial);
-
-	//Ball object material
-	OBJECT_MATERIAL tapeMaterial;
-	tapeMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.1f);
-	tapeMaterial.ambientStrength = 0.4f;
-	tapeMaterial.diffuseColor = glm::vec3(0.3f, 0.3f, 0.2f);
-	tapeMaterial.specularColor = glm::vec3(0.6f, 0.5f, 0.4f);
-	tapeMaterial.shininess = 0.0;
-	tapeMaterial.tag = "Tape";
-	m_objectMaterials.push_back(tapeMaterial);
-
-	//Plastic object material
-	//must be brown (0.259, 0.18, 0.027)
-	OBJECT_MATERIAL plasticMaterial;
-	plasticMaterial.ambientColor = glm::vec3(0.259f, 0.18f, 0.027);
-	plasticMaterial.ambientStrength = 0.4f;
-	plasticMaterial.diffuseColor = glm::vec3(0.522f, 0.369f, 0.059f);
-	plasticMaterial.specularColor = glm::vec3(0.6f, 0.5f, 0.4f);
-	plasticMaterial.shininess = 3.0;
-	plasticMaterial.tag = "Plastic";
-	m_objectMaterials.push_back(plasticMaterial);
-
-	OBJECT_MATERIAL redTopMaterial;
-	redTopMaterial.ambientColor = glm::vec3(0.259f, 0.18f, 0.027);
-	redTopMaterial.ambientStrength = 0.4f;
-	redTopMaterial.diffuseColor = glm::vec3(0.522f, 0.369f, 0.059f);
-	redTopMaterial.specularColor = glm::vec3(0.6f, 0.5f, 0.4f);
-	redTopMaterial.shininess = 3.0;
-	redTopMaterial.tag = "Red";
-	m_objectMaterials.push_back(redTopMaterial);
-
-	//Clock Screen object material(wood for now)
-	OBJECT_MATERIAL screenMaterial;
-	screenMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	screenMaterial.ambientStrength = 0.4f;
-	screenMaterial.diffuseColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	screenMaterial.specularColor = glm::vec3(0.6f, 0.5f, 0.4f);
-	screenMaterial.shininess = 1.0;
-	screenMaterial.tag = "Screen";
-	m_objectMaterials.push_back(screenMaterial);
-
-	//Book object material
-	OBJECT_MATERIAL BookMaterial;
-	BookMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.1f);
-	BookMaterial.ambientStrength = 0.4f;
-	BookMaterial.diffuseColor = glm::vec3(0.3f, 0.3f, 0.2f);
-	BookMaterial.specularColor = glm::vec3(0.6f, 0.5f, 0.4f);
-	BookMaterial.shininess = 0.0;
-	BookMaterial.tag = "BookFace";
-	m_objectMaterials.push_back(BookMaterial);
+	m_bUseTextureArray = bEnable;
+	m_textureArrayLayerSize = layerSize;
 }
 
-/*
-* SetupSceneLights()
-* 
-* This method is used for setting up scene lights by providing property values for individual
-* light sources.
-*/
-void SceneManager::SetupSceneLights()
+/***********************************************************
+ *  AddTextureLayer()
+ *
+ *  This method is used for resizing decoded image data to
+ *  the texture array layer size and staging it as the next
+ *  layer.  When a mip chain is passed in, the smallest level
+ *  that is still at least the layer size is resampled.
+ ***********************************************************/
+bool SceneManager::AddTextureLayer(
+	const unsigned char* image,
+	int width,
+	int height,
+	int colorChannels,
+	std::string tag,
+	int mipLevels)
 {
-	//First scene light, white light hovering above scene
-	m_pShaderManager->setVec3Value("lightSources[0].position", 0.0f, 5.0f, 0.0f);
-	m_pShaderManager->setVec3Value("lightSources[0].ambientColor", 0.4f, 0.4f, 0.4f);
-	m_pShaderManager->setVec3Value("lightSources[0].diffuseColor", 0.4f, 0.4f, 0.4f);
-	m_pShaderManager->setVec3Value("lightSources[0].specularColor", 0.4f, 0.4f, 0.4f);
-	m_pShaderManager->setFloatValue("lightSources[0].focalStrength", 16.0f);
-	m_pShaderManager->setFloatValue("lightSources[0].specularIntensity", 0.75f);
+	GLint maxLayers = 0;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+	if (m_loadedTextures >= maxLayers)
+	{
+		std::cout << "No texture array layer available for:" << tag << std::endl;
+		return false;
+	}
+
+	// only RGB and RGBA images are supported
+	if ((colorChannels != 3) && (colorChannels != 4))
+	{
+		std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
+		return false;
+	}
+
+	// the tag handle doubles as the array layer, so tags must be unique
+	if (m_textureTags.Find(tag) != TagTable::INVALID_HANDLE)
+	{
+		std::cout << "Texture tag already loaded:" << tag << std::endl;
+		return false;
+	}
+
+	// step down the mip chain while the next level is still large enough
+	const unsigned char* level = image;
+	for (int i = 1; i < mipLevels; i++)
+	{
+		if ((width / 2 < m_textureArrayLayerSize) || (height / 2 < m_textureArrayLayerSize))
+		{
+			break;
+		}
+		level += (size_t)width * height * colorChannels;
+		width /= 2;
+		height /= 2;
+	}
+
+	std::vector<unsigned char> layer((size_t)m_textureArrayLayerSize * m_textureArrayLayerSize * 4);
+	ResizeImageRGBA(level, width, height, colorChannels, m_textureArrayLayerSize, layer.data());
+	m_stagedTextureLayers.push_back(std::move(layer));
+
+	// register the texture layer and associate it with the special tag string
+	TEXTURE_INFO textureInfo;
+	textureInfo.ID = 0;
+	textureInfo.tag = tag;
+	textureInfo.residencyID = -1;
+	m_textureIDs.push_back(textureInfo);
+	m_textureTags.Intern(tag);
+	m_loadedTextures++;
+
+	return true;
+}
+
+/***********************************************************
+ *  CreateGLTextureArray()
+ *
+ *  This method is used for creating the OpenGL texture array,
+ *  uploading all the staged layers into it and generating
+ *  the mipmaps of every layer.
+ ***********************************************************/
+bool SceneManager::CreateGLTextureArray()
+{
+	int layerCount = (int)m_stagedTextureLayers.size();
+	if (layerCount == 0)
+	{
+		return false;
+	}
+
+	int levelCount = 1;
+	while ((m_textureArrayLayerSize >> levelCount) > 0)
+	{
+		levelCount++;
+	}
+
+	glGenTextures(1, &m_textureArrayID);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArrayID);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, levelCount, GL_RGBA8, m_textureArrayLayerSize, m_textureArrayLayerSize, layerCount);
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	for (int i = 0; i < layerCount; i++)
+	{
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i,
+			m_textureArrayLayerSize, m_textureArrayLayerSize, 1,
+			GL_RGBA, GL_UNSIGNED_BYTE, m_stagedTextureLayers[i].data());
+	}
+
+	// generate the texture mipmaps for mapping textures to lower resolutions
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	// the array holds every texture, so it is never evicted
+	int residencyID = m_textureResidency.Adopt(
+		GLTexture(m_textureArrayID),
+		TextureResidencyManager::CalculateTextureBytes(m_textureArrayLayerSize, m_textureArrayLayerSize, 4, layerCount),
+		true);
+	for (int i = 0; i < m_loadedTextures; i++)
+	{
+		m_textureIDs[i].ID = m_textureArrayID;
+		m_textureIDs[i].residencyID = residencyID;
+	}
+
+	// free the staged image data from local memory
+	m_stagedTextureLayers.clear();
+	m_stagedTextureLayers.shrink_to_fit();
+
+	std::cout << "Created texture array with " << layerCount << " layers of "
+		<< m_textureArrayLayerSize << "x" << m_textureArrayLayerSize << std::endl;
+
+	return true;
+}
+
+/***********************************************************
+ *  BindGLTextures()
+ *
+ *  This method is used for binding the loaded textures to
+ *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  In texture array mode the whole array is bound once to
+ *  its own unit after them instead.  The array sampler is
+ *  pointed at that unit in both modes, since two samplers of
+ *  different types on one unit make every draw fail.
+ ***********************************************************/
+void SceneManager::BindGLTextures()
+{
+	if (NULL != m_pShaderManager)
+	{
+		m_shaderState.SetInt(g_TextureArrayValueName, g_TextureArrayUnit);
+	}
+
+	if (m_bUseTextureArray == true)
+	{
+		glActiveTexture(GL_TEXTURE0 + g_TextureArrayUnit);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArrayID);
+
+		if (NULL != m_pShaderManager)
+		{
+			m_shaderState.SetBool(g_UseTextureArrayName, true);
+		}
+		return;
+	}
+
+	for (int i = 0; i < m_loadedTextures; i++)
+	{
+		bool bReloaded = false;
+		m_textureIDs[i].ID = m_textureResidency.Acquire(m_textureIDs[i].residencyID, bReloaded);
+
+		// bind textures on corresponding texture units
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
+	}
+}
+
+/***********************************************************
+ *  DestroyGLTextures()
+ *
+ *  This method is used for freeing the memory in all the
+ *  used texture memory slots.
+ ***********************************************************/
+void SceneManager::DestroyGLTextures()
+{
+	// the residency manager deletes every texture object it owns
+	m_textureResidency.Clear();
+	m_textureArrayID = 0;
+
+	m_textureIDs.clear();
+	m_textureTags.Clear();
+	m_loadedTextures = 0;
+}
+
+/***********************************************************
+ *  FindTextureID()
+ *
+ *  This method is used for getting an ID for the previously
+ *  loaded texture bitmap associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindTextureID(const std::string& tag)
+{
+	int textureSlot = FindTextureSlot(tag);
+	if (textureSlot < 0)
+	{
+		return(-1);
+	}
+
+	return(m_textureIDs[textureSlot].ID);
+}
+
+/***********************************************************
+ *  FindTextureSlot()
+ *
+ *  This method is used for getting a slot index for the previously
+ *  loaded texture bitmap associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindTextureSlot(const std::string& tag)
+{
+	return(m_textureTags.Find(tag));
+}
+
+/***********************************************************
+ *  FindMaterial()
+ *
+ *  This method is used for getting a material from the previously
+ *  defined materials list that is associated with the passed in tag.
+ ***********************************************************/
+bool SceneManager::FindMaterial(const std::string& tag, OBJECT_MATERIAL& material)
+{
+	int index = FindMaterialIndex(tag);
+	if (index < 0)
+	{
+		return(false);
+	}
+
+	material = m_objectMaterials[index];
+	return(true);
+}
+
+/***********************************************************
+ *  FindMaterialIndex()
+ *
+ *  This method is used for getting the index of the defined
+ *  material that is associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindMaterialIndex(const std::string& tag)
+{
+	// materials added since the last indexing are picked up here
+	if (m_materialTags.GetCount() != (int)m_objectMaterials.size())
+	{
+		IndexObjectMaterials();
+	}
+
+	return(m_materialTags.Find(tag));
+}
+
+/***********************************************************
+ *  IndexObjectMaterials()
+ *
+ *  This method is used for assigning every defined material
+ *  the handle of its tag.  The handle of each material is
+ *  its index in the defined materials list.
+ ***********************************************************/
+void SceneManager::IndexObjectMaterials()
+{
+	m_materialTags.Clear();
+	for (size_t i = 0; i < m_objectMaterials.size(); i++)
+	{
+		if (m_materialTags.Intern(m_objectMaterials[i].tag) != (int)i)
+		{
+			std::cout << "Duplicate material tag:" << m_objectMaterials[i].tag << std::endl;
+			// keep the handles in step with the material indexes
+			m_materialTags.Intern(m_objectMaterials[i].tag + "#" + std::to_string(i));
+		}
+	}
+}
+
+/***********************************************************
+ *  CreateMaterialBuffer()
+ *
+ *  This method is used for uploading every defined material
+ *  into the material uniform buffer, in material index
+ *  order, so the shader can look them up by index.
+ ***********************************************************/
+void SceneManager::CreateMaterialBuffer()
+{
+	m_materialBuffer.Destroy();
+	for (size_t i = 0; i < m_objectMaterials.size(); i++)
+	{
+		const OBJECT_MATERIAL& material = m_objectMaterials[i];
+		m_materialBuffer.AddMaterial(
+			material.ambientColor,
+			material.ambientStrength,
+			material.diffuseColor,
+			material.specularColor,
+			material.shininess);
+	}
+	m_materialBuffer.Upload();
+}
+
+/***********************************************************
+ *  SetTransformations()
+ *
+ *  This method is used for setting the transform buffer
+ *  using the passed in transformation values.
+ ***********************************************************/
+void SceneManager::SetTransformations(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	// variables for this method
+	glm::mat4 modelView;
+
+	// scale, then rotate about X, Y and Z, then translate
+	modelView = ComposeModelMatrix(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
+
+	if (NULL != m_pShaderManager)
+	{
+		m_shaderState.SetMat4(g_ModelName, modelView);
+	}
+}
+
+/***********************************************************
+ *  SetTransformations()
+ *
+ *  This method is used for setting the transform buffer to
+ *  a model matrix that was already built.
+ ***********************************************************/
+void SceneManager::SetTransformations(
+	const glm::mat4& model)
+{
+	if (NULL != m_pShaderManager)
+	{
+		m_shaderState.SetMat4(g_ModelName, model);
+	}
+}
+
+/***********************************************************
+ *  SetShaderColor()
+ *
+ *  This method is used for setting the passed in color
+ *  into the shader for the next draw command
+ ***********************************************************/
+void SceneManager::SetShaderColor(
+	float redColorValue,
+	float greenColorValue,
+	float blueColorValue,
+	float alphaValue)
+{
+	// variables for this method
+	glm::vec4 currentColor;
+
+	currentColor.r = redColorValue;
+	currentColor.g = greenColorValue;
+	currentColor.b = blueColorValue;
+	currentColor.a = alphaValue;
+
+	if (NULL != m_pShaderManager)
+	{
+		m_shaderState.SetBool(g_UseTextureName, false);
+		m_shaderState.SetVec4(g_ColorValueName, currentColor);
+	}
+}
+
+/***********************************************************
+ *  SetShaderTexture()
+ *
+ *  This method is used for setting the texture data
+ *  associated with the passed in ID into the shader.
+ ***********************************************************/
+void SceneManager::SetShaderTexture(
+	const std::string& textureTag)
+{
+	SetShaderTexture(FindTextureSlot(textureTag));
+}
+
+/***********************************************************
+ *  SetShaderTexture()
+ *
+ *  This method is used for setting the texture data in the
+ *  passed in texture slot into the shader.  The slot is the
+ *  handle of the texture tag, and in texture array mode it
+ *  is the array layer to sample.
+ ***********************************************************/
+void SceneManager::SetShaderTexture(
+	int textureSlot)
+{
+	if (NULL != m_pShaderManager)
+	{
+		m_shaderState.SetBool(g_UseTextureName, true);
+
+		if (m_bUseTextureArray == true)
+		{
+			m_shaderState.SetInt(g_TextureLayerName, textureSlot);
+		}
+		else
+		{
+			// a texture evicted over the memory budget is reloaded
+			// here and bound again to its texture unit
+			if ((textureSlot >= 0) && (textureSlot < m_loadedTextures))
+			{
+				bool bReloaded = false;
+				GLuint textureID = m_textureResidency.Acquire(m_textureIDs[textureSlot].residencyID, bReloaded);
+				m_textureIDs[textureSlot].ID = textureID;
+				if (bReloaded == true)
+				{
+					glActiveTexture(GL_TEXTURE0 + textureSlot);
+					glBindTexture(GL_TEXTURE_2D, textureID);
+				}
+			}
+			m_shaderState.SetInt(g_TextureValueName, textureSlot);
+		}
+	}
+}
+
+/***********************************************************
+ *  SetTextureUVScale()
+ *
+ *  This method is used for setting the texture UV scale
+ *  values into the shader.
+ ***********************************************************/
+void SceneManager::SetTextureUVScale(float u, float v)
+{
+	if (NULL != m_pShaderManager)
+	{
+		m_shaderState.SetVec2(g_UVScaleName, glm::vec2(u, v));
+	}
+}
+
+/***********************************************************
+ *  SetShaderMaterial()
+ *
+ *  This method is used for passing the material values
+ *  into the shader.
+ ***********************************************************/
+void SceneManager::SetShaderMaterial(
+	const std::string& materialTag)
+{
+	SetShaderMaterial(FindMaterialIndex(materialTag));
+}
+
+/***********************************************************
+ *  SetShaderMaterial()
+ *
+ *  This method is used for selecting the material at the
+ *  passed in index in the shader.  The index is the handle
+ *  of the material tag, and the material values are read
+ *  from the material uniform buffer.
+ ***********************************************************/
+void SceneManager::SetShaderMaterial(
+	int materialIndex)
+{
+	// materials defined after the buffer was built are uploaded now
+	if (m_materialBuffer.GetMaterialCount() != (int)m_objectMaterials.size())
+	{
+		CreateMaterialBuffer();
+	}
+
+	int indexInPage = m_materialBuffer.BindMaterial(materialIndex);
+	if (indexInPage >= 0)
+	{
+		m_shaderState.SetInt(g_MaterialIndexName, indexInPage);
+	}
+}
+
+/**************************************************************/
+/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
+/*** preparing and rendering their own 3D replicated scenes.***/
+/*** Please refer to the code in the OpenGL sample project  ***/
+/*** for assistance.                                        ***/
+/**************************************************************/
+
+void SceneManager::LoadSceneTextures()
+{
+	// the image files are decoded on worker threads and each one
+	// is uploaded on this thread as soon as its decode finishes -
+	// decoded mip chains are cached so later launches skip decoding,
+	// and block compressed images skip decoding altogether
+	TextureLoader textureLoader;
+	textureLoader.SetCacheDirectory(g_TextureCacheDirectory);
+	EnableCompressedTextures(textureLoader);
+
+	// the textures are listed in the scene file
+	const SceneFile::SCENE_TEXTURE* pTextures = m_sceneFile.GetTextures();
+	for (int i = 0; i < m_sceneFile.GetTextureCount(); i++)
+	{
+		textureLoader.AddTexture(
+			m_sceneFile.GetString(pTextures[i].filenameOffset),
+			m_sceneFile.GetString(pTextures[i].tagOffset));
+	}
+
+	textureLoader.LoadTextures(
+		[this](const TextureLoader::TEXTURE_REQUEST& request, const TextureLoader::DECODED_TEXTURE& texture)
+		{
+			if (m_bUseTextureArray == true)
+			{
+				return AddTextureLayer(
+					texture.pixels,
+					texture.width,
+					texture.height,
+					texture.colorChannels,
+					request.tag,
+					texture.mipLevels);
+			}
+			return UploadGLTexture(
+				request.filename.c_str(),
+				texture.pixels,
+				texture.width,
+				texture.height,
+				texture.colorChannels,
+				request.tag,
+				texture.mipLevels,
+				texture.compressedFormat);
+		});
+
+	// in texture array mode the layers are uploaded all at once
+	if (m_bUseTextureArray == true)
+	{
+		CreateGLTextureArray();
+	}
+
+	// after the texture image data is loaded into memory, the
+	// loaded textures need to be bound to texture slots - there
+	// are a total of 16 available slots for scene textures, or
+	// one slot for the texture array
+	BindGLTextures();
+}
+
+/***********************************************************
+ *  SetSceneFile()
+ *
+ *  This method is used for choosing the text scene file that
+ *  PrepareScene loads.
+ ***********************************************************/
+void SceneManager::SetSceneFile(const char* filename)
+{
+	m_sceneFilename = filename;
+}
+
+/***********************************************************
+ *  SetInstancingMode()
+ *
+ *  This method is used for choosing whether all the objects
+ *  that share a mesh are drawn with one instanced draw call,
+ *  taking their transform, color, texture layer and material
+ *  from a per-instance buffer.  It must be set before the
+ *  scene is prepared.  Without texture array mode, objects
+ *  are also batched by texture.
+ ***********************************************************/
+void SceneManager::SetInstancingMode(bool bEnable)
+{
+	m_bUseInstancing = bEnable;
+}
+
+/***********************************************************
+ *  SetMultiDrawIndirectMode()
+ *
+ *  This method is used for choosing whether the instance
+ *  batches are drawn from one shared vertex and index buffer
+ *  with multi-draw-indirect, so batches that share a texture
+ *  and material page are submitted with one call.  It must
+ *  be set before the scene is prepared, and falls back to
+ *  instanced draws when the context does not support it.
+ ***********************************************************/
+void SceneManager::SetMultiDrawIndirectMode(bool bEnable)
+{
+	m_bUseMultiDrawIndirect = bEnable;
+}
+
+/***********************************************************
+ *  SetPersistentRingMode()
+ *
+ *  This method is used for choosing whether the per-draw
+ *  data of the multi-draw-indirect path - the model and
+ *  normal matrices, color, texture layer and material index
+ *  of every object, and the draw commands - is written
+ *  straight into a triple buffered, persistently mapped
+ *  ring buffer.  It turns on multi-draw-indirect, and must
+ *  be set before the scene is prepared.
+ ***********************************************************/
+void SceneManager::SetPersistentRingMode(bool bEnable)
+{
+	m_meshMegaBuffer.SetPersistentRingMode(bEnable);
+	if (bEnable == true)
+	{
+		m_bUseMultiDrawIndirect = true;
+	}
+}
+
+/***********************************************************
+ *  SetViewPosition()
+ *
+ *  This method is used for setting the camera position that
+ *  the draws of the next frame are ordered by, nearest first
+ *  among draws that share the same state.
+ ***********************************************************/
+void SceneManager::SetViewPosition(glm::vec3 viewPosition)
+{
+	m_viewPosition = viewPosition;
+}
+
+/***********************************************************
+ *  SetViewProjection()
+ *
+ *  This method is used for setting the combined projection
+ *  and view matrix of the next frame, whose frustum the
+ *  scene objects are culled against.
+ ***********************************************************/
+void SceneManager::SetViewProjection(const glm::mat4& viewProjection)
+{
+	m_viewFrustum.SetViewProjection(viewProjection);
+	m_viewProjection = viewProjection;
+	m_levelOfDetail.SetViewProjection(viewProjection);
+	m_bHasViewFrustum = true;
+}
+
+/***********************************************************
+ *  SetFrustumCullingMode()
+ *
+ *  This method is used for choosing whether the objects
+ *  outside the view frustum are skipped.  Culling is on by
+ *  default, and only takes effect once a view is set.
+ ***********************************************************/
+void SceneManager::SetFrustumCullingMode(bool bEnable)
+{
+	m_bUseFrustumCulling = bEnable;
+}
+
+/***********************************************************
+ *  SetOcclusionCullingMode()
+ *
+ *  This method is used for choosing whether the objects
+ *  hidden behind the largest objects in view are skipped.
+ *  The test runs on the CPU, so the buffer is only created
+ *  when it is turned on.  With a job system the buffer
+ *  rasterizes on its threads and starts none of its own.
+ ***********************************************************/
+void SceneManager::SetOcclusionCullingMode(bool bEnable)
+{
+	m_bUseOcclusionCulling = bEnable;
+	if ((m_bUseOcclusionCulling == true) && (NULL == m_pOcclusionBuffer))
+	{
+		if (NULL != m_pJobSystem)
+		{
+			m_pOcclusionBuffer = new OcclusionBuffer(256, 128, 0);
+			m_pOcclusionBuffer->SetJobSystem(m_pJobSystem);
+		}
+		else
+		{
+			m_pOcclusionBuffer = new OcclusionBuffer();
+		}
+	}
+}
+
+/***********************************************************
+ *  SetLevelOfDetailMode()
+ *
+ *  This method is used for choosing whether spheres and
+ *  cylinders are drawn with fewer slices the smaller they
+ *  look.  It is on by default.
+ ***********************************************************/
+void SceneManager::SetLevelOfDetailMode(bool bEnable)
+{
+	m_bUseLevelOfDetail = bEnable;
+}
+
+/***********************************************************
+ *  SetJobThreadCount()
+ *
+ *  This method is used for splitting the scene update over
+ *  several threads.  The scene graph, the refit bounds, the
+ *  culling, the occlusion buffer, the levels of detail, the
+ *  instance batches and the draw packets are worked out in
+ *  jobs over chunks of objects, which the threads steal from
+ *  each other.  The calling thread is one of the threads.
+ ***********************************************************/
+void SceneManager::SetJobThreadCount(int threadCount)
+{
+	if (NULL != m_pJobSystem)
+	{
+		delete m_pJobSystem;
+		m_pJobSystem = NULL;
+	}
+	m_pJobSystem = new JobSystem(threadCount);
+	if (NULL != m_pOcclusionBuffer)
+	{
+		m_pOcclusionBuffer->SetJobSystem(m_pJobSystem);
+	}
+}
+
+/***********************************************************
+ *  PrepareScene()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene 
+ *  rendering
+ ***********************************************************/
+void SceneManager::PrepareScene()
+{
+	// the textures, materials, lights and objects all come from
+	// the scene file, which is compiled the first time it is used
+	if (m_sceneFile.Load(m_sceneFilename.c_str()) == false)
+	{
+		std::cout << "Could not load scene:" << m_sceneFilename << std::endl;
+	}
+
+	// only one instance of a particular mesh needs to be
+	// loaded in memory no matter how many times it is drawn
+	// in the rendered 3D scene
+	LoadSceneTextures();
+	DefineObjectMaterials();
+	IndexObjectMaterials();
+	CreateMaterialBuffer();
+	SetupSceneLights();
+	ResolveSceneHandles();
+	LoadObjectTransforms();
+	BuildObjectBVH();
+
+	m_basicMeshes->LoadPlaneMesh();
+	m_basicMeshes->LoadBoxMesh();
+	m_basicMeshes->LoadPrismMesh();
+	m_basicMeshes->LoadSphereMesh();
+	m_basicMeshes->LoadCylinderMesh();
+
+	if (m_bUseMultiDrawIndirect == true)
+	{
+		// instanced draws are used when indirect draws are not supported
+		if (m_meshMegaBuffer.Create() == false)
+		{
+			m_bUseMultiDrawIndirect = false;
+			m_bUseInstancing = true;
+		}
+	}
+	if (m_bUseInstancing == true)
+	{
+		m_instancedMeshes.Create();
+	}
+	// the instanced draws hold every level of detail already, while
+	// the single draws need their own meshes for the coarser levels
+	else if ((m_bUseMultiDrawIndirect == false) && (m_bUseLevelOfDetail == true))
+	{
+		m_detailMeshes.Create();
+	}
+
+	// the triangles drawn each frame are counted from the geometry
+	// of every mesh level
+	std::vector<MeshGeometry::MESH_VERTEX> vertices;
+	std::vector<uint32_t> indices;
+	for (int meshType = 0; meshType < SceneFile::MESH_TYPE_COUNT; meshType++)
+	{
+		for (int level = 0; level < MeshGeometry::GetLevelCount((SceneFile::MESH_TYPE)meshType); level++)
+		{
+			MeshGeometry::Build((SceneFile::MESH_TYPE)meshType, vertices, indices, level);
+			m_meshTriangleCounts[meshType][level] = (int)(indices.size() / 3);
+		}
+	}
+	m_levelOfDetail.Reset(m_sceneFile.GetObjectCount());
+}
+
+/***********************************************************
+ *  LoadObjectTransforms()
+ *
+ *  This method is used for adding the scene groups, then
+ *  the scene objects, to the scene graph.  Groups only refer
+ *  to earlier groups, so every parent is added before its
+ *  children.
+ ***********************************************************/
+void SceneManager::LoadObjectTransforms()
+{
+	const SceneFile::SCENE_GROUP* pGroups = m_sceneFile.GetGroups();
+	const int groupCount = m_sceneFile.GetGroupCount();
+	const SceneFile::SCENE_OBJECT* pObjects = m_sceneFile.GetObjects();
+	const int objectCount = m_sceneFile.GetObjectCount();
+
+	m_sceneGraph.Clear();
+	m_sceneGraph.Reserve(groupCount + objectCount);
+	for (int i = 0; i < groupCount; i++)
+	{
+		m_sceneGraph.AddNode(
+			pGroups[i].parentIndex,
+			glm::make_vec3(pGroups[i].scale),
+			glm::make_vec3(pGroups[i].rotation),
+			glm::make_vec3(pGroups[i].position));
+	}
+
+	m_firstObjectNode = groupCount;
+	for (int i = 0; i < objectCount; i++)
+	{
+		m_sceneGraph.AddNode(
+			pObjects[i].groupIndex,
+			glm::make_vec3(pObjects[i].scale),
+			glm::make_vec3(pObjects[i].rotation),
+			glm::make_vec3(pObjects[i].position));
+	}
+}
+
+/***********************************************************
+ *  GetObjectBounds()
+ *
+ *  This method is used for getting the world box around a
+ *  scene object, from the box of its mesh and its current
+ *  world matrix.
+ ***********************************************************/
+BoundingVolumeHierarchy::BOUNDING_BOX SceneManager::GetObjectBounds(int objectIndex) const
+{
+	const SceneFile::SCENE_OBJECT& object = m_sceneFile.GetObjects()[objectIndex];
+
+	BoundingVolumeHierarchy::BOUNDING_BOX meshBounds;
+	MeshGeometry::GetBounds((SceneFile::MESH_TYPE)object.meshType, meshBounds.minimum, meshBounds.maximum);
+
+	return BoundingVolumeHierarchy::TransformBox(
+		meshBounds,
+		m_sceneGraph.GetWorldMatrices()[m_firstObjectNode + objectIndex]);
+}
+
+/***********************************************************
+ *  BuildObjectBVH()
+ *
+ *  This method is used for building the bounding volume
+ *  hierarchy over the world boxes of the scene objects,
+ *  once their world matrices are known.
+ ***********************************************************/
+void SceneManager::BuildObjectBVH()
+{
+	const int objectCount = m_sceneFile.GetObjectCount();
+
+	m_sceneGraph.Update();
+
+	std::vector<BoundingVolumeHierarchy::BOUNDING_BOX> bounds(objectCount);
+	for (int i = 0; i < objectCount; i++)
+	{
+		bounds[i] = GetObjectBounds(i);
+	}
+	m_objectBVH.Build(bounds.data(), objectCount);
+}
+
+/***********************************************************
+ *  UpdateVisibleObjects()
+ *
+ *  This method is used for bringing the world matrices up to
+ *  date, refitting the hierarchy above the objects that
+ *  moved, and culling it against the view frustum.  Without
+ *  culling every object is visible.
+ ***********************************************************/
+void SceneManager::UpdateVisibleObjects()
+{
+	PROFILE_SCOPE("UpdateVisibleObjects");
+
+	const int objectCount = m_sceneFile.GetObjectCount();
+
+	// only the objects that moved, or whose group moved, have their
+	// matrices rebuilt, so a still scene costs almost nothing here
+	if (m_sceneGraph.Update(m_pJobSystem) == true)
+	{
+		// the new boxes are worked out in jobs, and written into the
+		// hierarchy in order, since the leaves are shared
+		const std::vector<int>& updatedNodes = m_sceneGraph.GetLastUpdatedNodes();
+		m_updatedBounds.resize(updatedNodes.size());
+		ParallelFor((int)updatedNodes.size(), [this, &updatedNodes](int first, int count)
+			{
+				for (int i = first; i < first + count; i++)
+				{
+					if (updatedNodes[i] >= m_firstObjectNode)
+					{
+						m_updatedBounds[i] = GetObjectBounds(updatedNodes[i] - m_firstObjectNode);
+					}
+				}
+			});
+		for (size_t i = 0; i < updatedNodes.size(); i++)
+		{
+			if (updatedNodes[i] >= m_firstObjectNode)
+			{
+				m_objectBVH.UpdateBounds(updatedNodes[i] - m_firstObjectNode, m_updatedBounds[i]);
+			}
+		}
+		m_objectBVH.Refit();
+	}
+
+	if ((m_bUseFrustumCulling == true) && (m_bHasViewFrustum == true))
+	{
+		PROFILE_SCOPE("FrustumCull");
+		std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		m_objectBVH.Cull(m_viewFrustum, m_visibleObjects, m_pJobSystem);
+		m_cullMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	}
+	else if ((int)m_visibleObjects.size() != objectCount)
+	{
+		m_visibleObjects.resize(objectCount);
+		for (int i = 0; i < objectCount; i++)
+		{
+			m_visibleObjects[i] = (uint32_t)i;
+		}
+	}
+	m_totalVisibleObjects += (long long)m_visibleObjects.size();
+
+	if ((m_bUseOcclusionCulling == true) && (m_bHasViewFrustum == true))
+	{
+		CullOccludedObjects();
+	}
+
+	SelectObjectLevels();
+}
+
+/***********************************************************
+ *  ParallelFor()
+ *
+ *  This method is used for running the scene update over a
+ *  range of items in chunks on the threads of the job
+ *  system, or over the whole range on this thread when
+ *  there is none.
+ ***********************************************************/
+void SceneManager::ParallelFor(int itemCount, const JobSystem::RangeFunction& function)
+{
+	if (NULL != m_pJobSystem)
+	{
+		m_pJobSystem->ParallelFor(itemCount, g_ObjectsPerJob, function);
+	}
+	else if (itemCount > 0)
+	{
+		function(0, itemCount);
+	}
+}
+
+/***********************************************************
+ *  ParallelForChunks()
+ *
+ *  This method is used for running the scene update over a
+ *  range of items in chunks of g_ObjectsPerJob, whatever the
+ *  number of threads.  Each chunk is given its index, so it
+ *  can keep its own counts and results to be put together
+ *  in chunk order once every chunk is done.
+ ***********************************************************/
+void SceneManager::ParallelForChunks(int itemCount, const ChunkFunction& function)
+{
+	const int chunkCount = GetChunkCount(itemCount);
+	JobSystem::RangeFunction runChunks = [itemCount, &function](int first, int count)
+		{
+			for (int chunk = first; chunk < first + count; chunk++)
+			{
+				int firstItem = chunk * g_ObjectsPerJob;
+				function(chunk, firstItem, std::min(g_ObjectsPerJob, itemCount - firstItem));
+			}
+		};
+
+	if (NULL != m_pJobSystem)
+	{
+		m_pJobSystem->ParallelFor(chunkCount, 1, runChunks);
+	}
+	else if (chunkCount > 0)
+	{
+		runChunks(0, chunkCount);
+	}
+}
+
+/***********************************************************
+ *  SelectObjectLevels()
+ *
+ *  This method is used for choosing the level of detail of
+ *  every visible object from the sphere around its mesh,
+ *  and counting the triangles the frame will draw.  Objects
+ *  keep level 0 without a view, or when the mode is off.
+ *  The chunks of objects count into their own totals, which
+ *  are added up afterwards.
+ ***********************************************************/
+void SceneManager::SelectObjectLevels()
+{
+	PROFILE_SCOPE("SelectObjectLevels");
+
+	const SceneFile::SCENE_OBJECT* pObjects = m_sceneFile.GetObjects();
+	const glm::mat4* pModels = m_sceneGraph.GetWorldMatrices() + m_firstObjectNode;
+	const bool bSelectLevels = (m_bUseLevelOfDetail == true) && (m_bHasViewFrustum == true);
+
+	m_chunkLevelCounts.resize(GetChunkCount((int)m_visibleObjects.size()));
+	ParallelForChunks((int)m_visibleObjects.size(), [this, pObjects, pModels, bSelectLevels](int chunk, int first, int count)
+		{
+			LEVEL_COUNTS& counts = m_chunkLevelCounts[chunk];
+			memset(&counts, 0, sizeof(counts));
+
+			for (int visible = first; visible < first + count; visible++)
+			{
+				const uint32_t i = m_visibleObjects[visible];
+				const SceneFile::MESH_TYPE meshType = (SceneFile::MESH_TYPE)pObjects[i].meshType;
+				const int levelCount = MeshGeometry::GetLevelCount(meshType);
+
+				int level = 0;
+				if ((bSelectLevels == true) && (levelCount > 1))
+				{
+					glm::vec3 meshMin;
+					glm::vec3 meshMax;
+					MeshGeometry::GetBounds(meshType, meshMin, meshMax);
+
+					const glm::mat4& model = pModels[i];
+					glm::vec3 center = glm::vec3(model * glm::vec4((meshMin + meshMax) * 0.5f, 1.0f));
+					float scale = std::max(glm::length(glm::vec3(model[0])),
+						std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+					float radius = glm::length(meshMax - meshMin) * 0.5f * scale;
+					level = m_levelOfDetail.SelectLevel((int)i, center, radius, levelCount, &counts.levelChanges);
+				}
+
+				counts.triangles += m_meshTriangleCounts[meshType][level];
+				counts.levelObjects[level]++;
+			}
+		});
+
+	for (const LEVEL_COUNTS& counts : m_chunkLevelCounts)
+	{
+		m_totalTriangles += counts.triangles;
+		for (int level = 0; level < MeshGeometry::LEVEL_COUNT; level++)
+		{
+			m_totalLevelObjects[level] += counts.levelObjects[level];
+		}
+		m_levelOfDetail.AddLevelChanges(counts.levelChanges);
+	}
+}
+
+/***********************************************************
+ *  CullOccludedObjects()
+ *
+ *  This method is used for removing the visible objects
+ *  that are hidden behind others.  The objects that look
+ *  largest from the camera are chosen as occluders, and the
+ *  boxes inside their meshes are rasterized into the
+ *  occlusion buffer.  Every visible object is then tested by
+ *  its world box, which always reaches nearer than the inner
+ *  box of its own mesh, so an occluder is only dropped when
+ *  another one hides it.  The boxes and the tests are
+ *  worked out in jobs, and only the hidden objects found are
+ *  compacted out here.
+ ***********************************************************/
+void SceneManager::CullOccludedObjects()
+{
+	PROFILE_SCOPE("CullOccludedObjects");
+
+	const SceneFile::SCENE_OBJECT* pObjects = m_sceneFile.GetObjects();
+	const glm::mat4* pModels = m_sceneGraph.GetWorldMatrices() + m_firstObjectNode;
+	const int visibleCount = (int)m_visibleObjects.size();
+
+	m_visibleBounds.resize(visibleCount);
+	ParallelFor(visibleCount, [this](int first, int count)
+		{
+			for (int i = first; i < first + count; i++)
+			{
+				m_visibleBounds[i] = GetObjectBounds(m_visibleObjects[i]);
+			}
+		});
+
+	m_occluders.clear();
+	for (int i = 0; i < visibleCount; i++)
+	{
+		const BoundingVolumeHierarchy::BOUNDING_BOX& box = m_visibleBounds[i];
+		float radius = glm::length(box.maximum - box.minimum) * 0.5f;
+		float distance = glm::length((box.minimum + box.maximum) * 0.5f - m_viewPosition);
+		float size = radius / std::max(distance, 0.001f);
+		if (size >= g_MinimumOccluderSize)
+		{
+			m_occluders.push_back(std::make_pair(size, m_visibleObjects[i]));
+		}
+	}
+	if (m_occluders.size() > (size_t)g_MaxOccluderCount)
+	{
+		std::partial_sort(m_occluders.begin(), m_occluders.begin() + g_MaxOccluderCount, m_occluders.end(),
+			[](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b)
+			{
+				return a.first > b.first;
+			});
+		m_occluders.resize(g_MaxOccluderCount);
+	}
+
+	m_pOcclusionBuffer->BeginFrame(m_viewProjection);
+	for (const std::pair<float, uint32_t>& occluder : m_occluders)
+	{
+		glm::vec3 innerMin;
+		glm::vec3 innerMax;
+		MeshGeometry::GetInnerBounds((SceneFile::MESH_TYPE)pObjects[occluder.second].meshType, innerMin, innerMax);
+		m_pOcclusionBuffer->AddOccluder(pModels[occluder.second], innerMin, innerMax);
+	}
+	m_pOcclusionBuffer->Rasterize();
+
+	m_occludedObjects.resize(visibleCount);
+	m_pOcclusionBuffer->BeginTests();
+	ParallelFor(visibleCount, [this](int first, int count)
+		{
+			for (int i = first; i < first + count; i++)
+			{
+				m_occludedObjects[i] = (m_pOcclusionBuffer->TestBox(m_visibleBounds[i].minimum, m_visibleBounds[i].maximum) == true) ? 1 : 0;
+			}
+		});
+
+	int keptCount = 0;
+	for (int i = 0; i < visibleCount; i++)
+	{
+		if (m_occludedObjects[i] == 0)
+		{
+			m_visibleObjects[keptCount++] = m_visibleObjects[i];
+		}
+	}
+	m_visibleObjects.resize(keptCount);
+	m_pOcclusionBuffer->CountTests(visibleCount, visibleCount - keptCount);
+	m_pOcclusionBuffer->EndFrame();
+}
+
+/***********************************************************
+ *  SetGroupPosition()
+ *
+ *  This method is used for moving a scene group relative to
+ *  its parent.  Its world matrix and those of everything
+ *  under it are rebuilt by the next frame.
+ ***********************************************************/
+bool SceneManager::SetGroupPosition(const char* tag, glm::vec3 position)
+{
+	const SceneFile::SCENE_GROUP* pGroups = m_sceneFile.GetGroups();
+	const int groupCount = m_sceneFile.GetGroupCount();
+
+	for (int i = 0; i < groupCount; i++)
+	{
+		if (strcmp(m_sceneFile.GetString(pGroups[i].tagOffset), tag) == 0)
+		{
+			m_sceneGraph.SetLocalPosition(i, position);
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  BuildInstanceBatches()
+ *
+ *  This method is used for batching the visible objects for
+ *  the instanced draws.  Each object becomes an instance in
+ *  the batch of its mesh, texture and material page, and
+ *  each batch is drawn with one call, so the draw calls no
+ *  longer grow with the number of objects.  The chunks of
+ *  objects first count the instances of each batch in jobs,
+ *  the batches are sized to hold them in chunk order, and
+ *  the chunks then write their instances straight into
+ *  their places, so the batches come out as if built in
+ *  one pass.
+ ***********************************************************/
+void SceneManager::BuildInstanceBatches(FRAME_SNAPSHOT& snapshot)
+{
+	PROFILE_SCOPE("BuildInstanceBatches");
+
+	const SceneFile::SCENE_OBJECT* pObjects = m_sceneFile.GetObjects();
+	const glm::mat4* pModels = m_sceneGraph.GetWorldMatrices() + m_firstObjectNode;
+	const glm::mat3* pNormals = m_sceneGraph.GetWorldNormalMatrices() + m_firstObjectNode;
+	const int visibleCount = (int)m_visibleObjects.size();
+
+	// only the objects that survived culling become instances
+	m_instanceKeys.resize(visibleCount);
+	m_chunkBatches.resize(GetChunkCount(visibleCount));
+	ParallelForChunks(visibleCount, [this, pObjects](int chunk, int first, int count)
+		{
+			// the batches of a chunk keep their nodes from frame to frame
+			std::map<uint32_t, CHUNK_BATCH>& batches = m_chunkBatches[chunk];
+			for (auto& batch : batches)
+			{
+				batch.second.count = 0;
+			}
+
+			for (int visible = first; visible < first + count; visible++)
+			{
+				const uint32_t i = m_visibleObjects[visible];
+				const SceneFile::SCENE_OBJECT& object = pObjects[i];
+
+				int textureSlot = (object.textureIndex >= 0) ? m_sceneTextureSlots[object.textureIndex] : -1;
+				int materialIndex = (object.materialIndex >= 0) ? object.materialIndex : 0;
+
+				// only the texture array lets one draw sample different textures
+				uint32_t batchTexture = (m_bUseTextureArray == true) ? 0 : (uint32_t)(textureSlot + 1);
+				// the low byte holds the mesh type and its level of detail
+				uint32_t batchKey = (object.meshType & 0xF) |
+					(((uint32_t)m_levelOfDetail.GetLevel((int)i) & 0xF) << 4) |
+					((batchTexture & 0xFFF) << 8) |
+					((uint32_t)(materialIndex / MaterialBuffer::MATERIALS_PER_PAGE) << 20);
+				m_instanceKeys[visible] = batchKey;
+
+				auto batch = batches.find(batchKey);
+				if (batch == batches.end())
+				{
+					CHUNK_BATCH newBatch = { 0, 0, NULL };
+					batch = batches.insert(std::make_pair(batchKey, newBatch)).first;
+				}
+				batch->second.count++;
+			}
+		});
+
+	// the batches keep their storage from frame to frame, and each
+	// chunk takes the next instances of its batches in chunk order
+	for (auto& batch : snapshot.instanceBatches)
+	{
+		batch.second.clear();
+	}
+	for (std::map<uint32_t, CHUNK_BATCH>& batches : m_chunkBatches)
+	{
+		for (auto& batch : batches)
+		{
+			if (batch.second.count > 0)
+			{
+				std::vector<InstancedMeshes::INSTANCE_DATA>& instances = snapshot.instanceBatches[batch.first];
+				batch.second.first = (int)instances.size();
+				instances.resize(instances.size() + batch.second.count);
+			}
+		}
+	}
+	for (std::map<uint32_t, CHUNK_BATCH>& batches : m_chunkBatches)
+	{
+		for (auto& batch : batches)
+		{
+			if (batch.second.count > 0)
+			{
+				batch.second.pNext = snapshot.instanceBatches[batch.first].data() + batch.second.first;
+			}
+		}
+	}
+
+	ParallelForChunks(visibleCount, [this, pObjects, pModels, pNormals](int chunk, int first, int count)
+		{
+			std::map<uint32_t, CHUNK_BATCH>& batches = m_chunkBatches[chunk];
+			for (int visible = first; visible < first + count; visible++)
+			{
+				const uint32_t i = m_visibleObjects[visible];
+				const SceneFile::SCENE_OBJECT& object = pObjects[i];
+
+				int textureSlot = (object.textureIndex >= 0) ? m_sceneTextureSlots[object.textureIndex] : -1;
+				int materialIndex = (object.materialIndex >= 0) ? object.materialIndex : 0;
+
+				InstancedMeshes::INSTANCE_DATA& instance = *(batches[m_instanceKeys[visible]].pNext++);
+				instance.model = pModels[i];
+				instance.normalMatrix = pNormals[i];
+				instance.color = glm::make_vec4(object.color);
+				instance.uvScale = glm::make_vec2(object.uvScale);
+				// any layer that is not negative selects the bound texture
+				// when textures are not in an array
+				instance.textureLayer = textureSlot;
+				instance.materialIndex = materialIndex % MaterialBuffer::MATERIALS_PER_PAGE;
+			}
+		});
+	snapshot.instanceCount = visibleCount;
+}
+
+/***********************************************************
+ *  RenderSceneInstanced()
+ *
+ *  This method is used for drawing the instance batches of
+ *  a snapshot, with multi-draw-indirect from the shared
+ *  mesh buffer or with one instanced draw per batch.
+ ***********************************************************/
+void SceneManager::RenderSceneInstanced(const FRAME_SNAPSHOT& snapshot)
+{
+	m_shaderState.SetBool(g_UseInstancingName, true);
+
+	if (m_bUseMultiDrawIndirect == true)
+	{
+		// every batch becomes one command in the indirect buffer, and
+		// a batch that could not be added is left out of the draws
+		m_meshMegaBuffer.BeginFrame(snapshot.instanceCount, (int)snapshot.instanceBatches.size());
+		m_batchCommands.clear();
+		for (const auto& batch : snapshot.instanceBatches)
+		{
+			m_batchCommands.push_back(m_meshMegaBuffer.AddDraw(
+				(SceneFile::MESH_TYPE)(batch.first & 0xF),
+				(int)((batch.first >> 4) & 0xF),
+				batch.second.data(),
+				(int)batch.second.size()));
+		}
+		m_meshMegaBuffer.Upload();
+
+		// the batches are ordered by texture and material page, so
+		// neighboring commands that only differ by mesh are submitted
+		// together with one call
+		int firstCommand = 0;
+		int commandCount = 0;
+		uint32_t batchState = 0;
+		int batchIndex = 0;
+		for (const auto& batch : snapshot.instanceBatches)
+		{
+			if (m_batchCommands[batchIndex++] < 0)
+			{
+				continue;
+			}
+
+			if ((commandCount > 0) && ((batch.first >> 8) != batchState))
+			{
+				m_meshMegaBuffer.Draw(firstCommand, commandCount);
+				firstCommand += commandCount;
+				commandCount = 0;
+			}
+			if (commandCount == 0)
+			{
+				batchState = batch.first >> 8;
+				SetBatchState(batch.first);
+			}
+			commandCount++;
+		}
+		m_meshMegaBuffer.Draw(firstCommand, commandCount);
+		m_meshMegaBuffer.EndFrame();
+		return;
+	}
+
+	m_instancedMeshes.ResetCounts();
+	for (const auto& batch : snapshot.instanceBatches)
+	{
+		if (batch.second.empty() == true)
+		{
+			continue;
+		}
+
+		SetBatchState(batch.first);
+		m_instancedMeshes.Draw(
+			(SceneFile::MESH_TYPE)(batch.first & 0xF),
+			(int)((batch.first >> 4) & 0xF),
+			batch.second.data(),
+			(int)batch.second.size());
+	}
+}
+
+/***********************************************************
+ *  SetBatchState()
+ *
+ *  This method is used for binding the texture and material
+ *  page shared by every instance of a batch.
+ ***********************************************************/
+void SceneManager::SetBatchState(uint32_t batchKey)
+{
+	int textureSlot = (int)((batchKey >> 8) & 0xFFF) - 1;
+	if (textureSlot >= 0)
+	{
+		SetShaderTexture(textureSlot);
+	}
+	// binds the material page the instance material indices are in
+	SetShaderMaterial((int)(batchKey >> 20) * MaterialBuffer::MATERIALS_PER_PAGE);
+}
+
+/***********************************************************
+ *  ResolveSceneHandles()
+ *
+ *  This method is used for looking up the texture slot of
+ *  every scene texture once, after they are loaded, since
+ *  textures are given slots in the order they finish
+ *  loading rather than the order of the scene file.
+ ***********************************************************/
+void SceneManager::ResolveSceneHandles()
+{
+	const SceneFile::SCENE_TEXTURE* pTextures = m_sceneFile.GetTextures();
+	m_sceneTextureSlots.resize(m_sceneFile.GetTextureCount());
+	for (int i = 0; i < m_sceneFile.GetTextureCount(); i++)
+	{
+		m_sceneTextureSlots[i] = FindTextureSlot(m_sceneFile.GetString(pTextures[i].tagOffset));
+	}
+}
+
+/***********************************************************
+* DefineObjectMaterials()
+ *
+* This method is used for configuring the various material
+* settings for all of the objects in the 3D scene, from the
+* materials in the scene file.  The material index of each
+* one matches its index in the scene file.
+***********************************************************/
+void SceneManager::DefineObjectMaterials()
+{
+	const SceneFile::SCENE_MATERIAL* pMaterials = m_sceneFile.GetMaterials();
+	for (int i = 0; i < m_sceneFile.GetMaterialCount(); i++)
+	{
+		OBJECT_MATERIAL material;
+		material.ambientColor = glm::make_vec3(pMaterials[i].ambientColor);
+		material.ambientStrength = pMaterials[i].ambientStrength;
+		material.diffuseColor = glm::make_vec3(pMaterials[i].diffuseColor);
+		material.specularColor = glm::make_vec3(pMaterials[i].specularColor);
+		material.shininess = pMaterials[i].shininess;
+		material.tag = m_sceneFile.GetString(pMaterials[i].tagOffset);
+		m_objectMaterials.push_back(material);
+	}
+}
 
-	m_pShaderManager->setBoolValue("bUseLighting", true);
+/*
+* SetupSceneLights()
+* 
+* This method is used for setting up scene lights by providing property values for individual
+* light sources.  The lights come from the scene file, and the unused shader lights are turned off.
+*/
+void SceneManager::SetupSceneLights()
+{
+	const SceneFile::SCENE_LIGHT* pLights = m_sceneFile.GetLights();
+	for (int i = 0; i < SceneFile::MAX_LIGHTS; i++)
+	{
+		SceneFile::SCENE_LIGHT light;
+		memset(&light, 0, sizeof(light));
+		if (i < m_sceneFile.GetLightCount())
+		{
+			light = pLights[i];
+		}
 
+		std::string lightName = "lightSources[" + std::to_string(i) + "].";
+		m_shaderState.SetVec3((lightName + "position").c_str(), glm::make_vec3(light.position));
+		m_shaderState.SetVec3((lightName + "ambientColor").c_str(), glm::make_vec3(light.ambientColor));
+		m_shaderState.SetVec3((lightName + "diffuseColor").c_str(), glm::make_vec3(light.diffuseColor));
+		m_shaderState.SetVec3((lightName + "specularColor").c_str(), glm::make_vec3(light.specularColor));
+		m_shaderState.SetFloat((lightName + "focalStrength").c_str(), light.focalStrength);
+		m_shaderState.SetFloat((lightName + "specularIntensity").c_str(), light.specularIntensity);
+	}
 
+	m_shaderState.SetBool(g_UseLightingName, true);
 }
 
 
@@ -529,240 +2189,179 @@ void SceneManager::SetupSceneLights()
  *  RenderScene()
  *
  *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
+ *  updating it for the current view and drawing the result
+ *  straight away, on the one thread.
  ***********************************************************/
 void SceneManager::RenderScene()
 {
-	//Plane that the items sit on
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(20.0f, 1.0f, 10.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	SetShaderTexture("Glass");
-	SetShaderMaterial("Base");
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawPlaneMesh();
-
-/*CLOCK START*/
-	// The box is a rectangle whos long side faces the camera, so augment size respectivly
-	scaleXYZ = glm::vec3(6.0f, 2.0f, 2.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	//The timer is the object closest to the camera in the sceene, so place it slightly forward on the z
-	positionXYZ = glm::vec3(0.0f, 1.0f, 5.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	//most of the timer is blue, so apply color accordingly
-	//SetShaderColor(0, 0, 1, 1);
-	SetShaderTexture("BrownPlastic");
-	SetShaderMaterial("Plastic");
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawBoxMesh();
-
-	// The prism must match the lengh of the box, which is they coordiante. the edge needs to make a 90 degree angle with the ground, because this cant be done with the prism at the current 
-	//moment i will elongate the edge to make it appear as if it touches the ground at a slant from the cameras perspective
-	scaleXYZ = glm::vec3(1.2f, 6.0f, 1.9f);
-
-	// set the XYZ rotation for the mesh
-	//we need to rotate the prism so it juts out toward the camera. this will require a 90 degree rotation on the Zto get it sideways, and a -115 degree roation on the x to face the edge
-	XrotationDegrees = -105.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 90.0f;
-
-	//The timer is the object closest to the camera in the sceene, so place it slightly forward on the z
-	positionXYZ = glm::vec3(0.0f, 1.10f, 6.25f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	//make the prism a slightly lighter blue to differentiate the shapes
-	SetShaderTexture("BrownPlastic");
-	SetShaderMaterial("Plastic");
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawPrismMesh();
-
-
-	//The screen for the ball will be a box that clips into the prism and textured to look like the clock screen
-
-	//clock screen should fit within the prism
-	scaleXYZ = glm::vec3(3.0f, 1.5f, 0.5f);
-
-	//Make the rotation fit the prism surface
-	XrotationDegrees = 60.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	//Set the screen slightly inside the clock
-	positionXYZ = glm::vec3(0.0f, 1.10f, 6.25f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	//set teh screen texture and material
-	SetShaderTexture("GreenScreen");
-	SetShaderMaterial("Screen");
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawBoxMesh();
-	/*CLOCK END*/
-
-	/*
-	* EXCERCISE BALL START
-	*/
-	scaleXYZ = glm::vec3(2.0f, 2.0f, 2.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	//Set the ball behind the timer and adjust for scale 
-	positionXYZ = glm::vec3(-1.0f, 2.0f, 1.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-	//set mesh shader texture and material
-	SetShaderTexture("Ball");
-	SetShaderMaterial("Tape");
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawSphereMesh();
-	//EXCERCISE BALL END
-
-	/*BOOK START*/
-	//The book should be the largest element
-	scaleXYZ = glm::vec3(7.0f, 7.0f, 2.0f);
-
-	//Book should lay flat and have 90 rotation on x
-	XrotationDegrees = 90.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	//Place the book in the back right of the scene
-	positionXYZ = glm::vec3(6.0f, 1.0f, 0.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	//set teh screen texture and material
-	SetShaderTexture("Book");
-	SetShaderMaterial("BookFace");
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawBoxMesh();
-	/*BOOK END*/
-
-	/*PEANUT BUTTER JAR START*/
-	//peanut butter jar Base
-	scaleXYZ = glm::vec3(2.0f, 3.0f, 2.0f);
-
-	//Book should lay flat and have 90 rotation on x
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	//Place the book in the back right of the scene
-	positionXYZ = glm::vec3(-6.5f, 0.0f, 0.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	//set teh screen texture and material
-	SetShaderTexture("BrownPlastic");
-	SetShaderMaterial("Plastic");
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawCylinderMesh();
-
-//peanut butter jar Top
-	scaleXYZ = glm::vec3(2.0f, 1.0f, 2.0f);
-
-	//Book should lay flat and have 90 rotation on x
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	//Place the book in the back right of the scene
-	positionXYZ = glm::vec3(-6.5f, 3.0f, 0.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	//set teh screen texture and material
-	SetShaderTexture("RedTop");
-	SetShaderMaterial("Plastic");
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawCylinderMesh();
-	/*PEANUT BUTTER JAR END*/
+	UpdateScene(m_frameSnapshot);
+	RenderSnapshot(m_frameSnapshot);
+}
+
+/***********************************************************
+ *  UpdateScene()
+ *
+ *  This method is used for working out what the frame
+ *  draws.  The scene graph and hierarchy are updated and
+ *  culled, then a draw packet is submitted for each visible
+ *  object and the packets are sorted by their state, so
+ *  objects sharing a texture, material and mesh are drawn
+ *  one after another.  The sorted draws are copied into the
+ *  snapshot with their world matrix and level of detail,
+ *  since both change as soon as the scene is updated again.
+ ***********************************************************/
+void SceneManager::UpdateScene(FRAME_SNAPSHOT& snapshot)
+{
+	PROFILE_SCOPE("UpdateScene");
+
+	const SceneFile::SCENE_OBJECT* pObjects = m_sceneFile.GetObjects();
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	UpdateVisibleObjects();
+
+	snapshot.draws.clear();
+	if ((m_bUseInstancing == true) || (m_bUseMultiDrawIndirect == true))
+	{
+		BuildInstanceBatches(snapshot);
+		m_updateSceneMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+		m_updateSceneFrames++;
+		return;
+	}
+
+	const glm::mat4* pModels = m_sceneGraph.GetWorldMatrices() + m_firstObjectNode;
+
+	// every visible object fills in its own packet, so the packets
+	// are built in jobs over chunks of the visible objects
+	m_renderQueue.Clear();
+	RenderQueue::DRAW_PACKET* pNewPackets = m_renderQueue.SubmitRange((int)m_visibleObjects.size());
+	ParallelFor((int)m_visibleObjects.size(), [this, pObjects, pModels, pNewPackets](int first, int count)
+		{
+			for (int packet = first; packet < first + count; packet++)
+			{
+				const uint32_t i = m_visibleObjects[packet];
+				const SceneFile::SCENE_OBJECT& object = pObjects[i];
+
+				// textured and colored objects use different shader paths
+				int shaderVariant = 0;
+				int textureSlot = -1;
+				if (object.textureIndex >= 0)
+				{
+					shaderVariant = 1;
+					textureSlot = m_sceneTextureSlots[object.textureIndex];
+				}
+
+				glm::vec3 offset = glm::vec3(pModels[i][3]) - m_viewPosition;
+				float depth = glm::dot(offset, offset);
+				// each level of detail sorts as a mesh of its own
+				int mesh = object.meshType * MeshGeometry::LEVEL_COUNT + m_levelOfDetail.GetLevel((int)i);
+
+				pNewPackets[packet].sortKey = RenderQueue::MakeSortKey(shaderVariant, textureSlot, object.materialIndex, mesh, depth);
+				pNewPackets[packet].objectIndex = i;
+			}
+		});
+	m_renderQueue.Sort();
+
+	const RenderQueue::DRAW_PACKET* pPackets = m_renderQueue.GetPackets();
+	const int packetCount = m_renderQueue.GetPacketCount();
+	snapshot.draws.resize(packetCount);
+	ParallelFor(packetCount, [this, &snapshot, pModels, pPackets](int first, int count)
+		{
+			for (int i = first; i < first + count; i++)
+			{
+				SNAPSHOT_DRAW& draw = snapshot.draws[i];
+				draw.objectIndex = pPackets[i].objectIndex;
+				draw.model = pModels[draw.objectIndex];
+				draw.level = m_levelOfDetail.GetLevel((int)draw.objectIndex);
+			}
+		});
+
+	m_updateSceneMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	m_updateSceneFrames++;
+}
+
+/***********************************************************
+ *  RenderSnapshot()
+ *
+ *  This method is used for drawing the basic 3D shapes of
+ *  the objects in a snapshot, in the order it holds them.
+ *  Only the snapshot and the scene file, which does not
+ *  change after loading, are read, so the update thread is
+ *  free to work on the next frame meanwhile.
+ ***********************************************************/
+void SceneManager::RenderSnapshot(const FRAME_SNAPSHOT& snapshot)
+{
+	PROFILE_SCOPE("RenderSnapshot");
+	PROFILE_GPU_SCOPE("RenderSnapshot");
+
+	const SceneFile::SCENE_OBJECT* pObjects = m_sceneFile.GetObjects();
+
+	// uniforms that keep their value from the last draw are not
+	// uploaded again, and the uploads are counted per frame
+	m_shaderState.BeginFrame();
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	if ((m_bUseInstancing == true) || (m_bUseMultiDrawIndirect == true))
+	{
+		RenderSceneInstanced(snapshot);
+		m_renderSceneMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+		m_renderSceneFrames++;
+		m_bTexturesStreamed = false;
+		return;
+	}
+
+	for (const SNAPSHOT_DRAW& draw : snapshot.draws)
+	{
+		const SceneFile::SCENE_OBJECT& object = pObjects[draw.objectIndex];
+
+		// set the transformations into memory to be used on the drawn meshes
+		SetTransformations(draw.model);
+
+		if (object.textureIndex >= 0)
+		{
+			SetShaderTexture(m_sceneTextureSlots[object.textureIndex]);
+			SetTextureUVScale(object.uvScale[0], object.uvScale[1]);
+		}
+		else
+		{
+			SetShaderColor(object.color[0], object.color[1], object.color[2], object.color[3]);
+		}
+		if (object.materialIndex >= 0)
+		{
+			SetShaderMaterial(object.materialIndex);
+		}
+
+		// draw the mesh with transformation values
+		switch (object.meshType)
+		{
+		case SceneFile::MESH_PLANE:
+			m_basicMeshes->DrawPlaneMesh();
+			break;
+		case SceneFile::MESH_BOX:
+			m_basicMeshes->DrawBoxMesh();
+			break;
+		case SceneFile::MESH_PRISM:
+			m_basicMeshes->DrawPrismMesh();
+			break;
+		// the curved meshes are drawn at their level of detail when
+		// the detail meshes were created
+		case SceneFile::MESH_SPHERE:
+			if (m_detailMeshes.Draw(SceneFile::MESH_SPHERE, draw.level) == false)
+			{
+				m_basicMeshes->DrawSphereMesh();
+			}
+			break;
+		case SceneFile::MESH_CYLINDER:
+			if (m_detailMeshes.Draw(SceneFile::MESH_CYLINDER, draw.level) == false)
+			{
+				m_basicMeshes->DrawCylinderMesh();
+			}
+			break;
+		}
+	}
+
+	m_renderSceneMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	m_renderSceneFrames++;
+	m_bTexturesStreamed = false;
 }
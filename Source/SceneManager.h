@@ -9,10 +9,30 @@
 
 #pragma once
 
+#include "BoundingVolumeHierarchy.h"
+#include "DetailMeshes.h"
+#include "Frustum.h"
+#include "InstancedMeshes.h"
+#include "JobSystem.h"
+#include "LevelOfDetail.h"
+#include "MaterialBuffer.h"
+#include "MeshGeometry.h"
+#include "MeshMegaBuffer.h"
+#include "OcclusionBuffer.h"
+#include "RenderQueue.h"
+#include "SceneFile.h"
+#include "SceneGraph.h"
 #include "ShaderManager.h"
+#include "ShaderStateCache.h"
 #include "ShapeMeshes.h"
+#include "TagTable.h"
+#include "TextureResidency.h"
+#include "TextureStreamer.h"
 
+#include <functional>
+#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 /***********************************************************
@@ -33,6 +53,10 @@ public:
 	{
 		std::string tag;
 		uint32_t ID;
+		// source image file, used to reload an evicted texture
+		std::string filename;
+		// ID of the texture in the residency manager
+		int residencyID;
 	};
 
 	struct OBJECT_MATERIAL
@@ -45,6 +69,31 @@ public:
 		std::string tag;
 	};
 
+	// a scene object to draw on its own, with what it is drawn
+	// with this frame
+	struct SNAPSHOT_DRAW
+	{
+		glm::mat4 model;
+		uint32_t objectIndex;
+		int level;
+	};
+
+	// everything needed to draw one frame, so the scene can move
+	// on while the frame is drawn - the scene fills in the draws,
+	// the caller the camera
+	struct FRAME_SNAPSHOT
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec3 viewPosition;
+		// objects drawn one by one, in their sorted order
+		std::vector<SNAPSHOT_DRAW> draws;
+		// instances batched by mesh, level, texture and material
+		// page, when instancing
+		std::map<uint32_t, std::vector<InstancedMeshes::INSTANCE_DATA>> instanceBatches;
+		int instanceCount;
+	};
+
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
@@ -53,21 +102,222 @@ private:
 	// total number of loaded textures
 	int m_loadedTextures;
 	// loaded textures info
-	TEXTURE_INFO m_textureIDs[16];
+	std::vector<TEXTURE_INFO> m_textureIDs;
+	// true when textures are layers of one texture array
+	bool m_bUseTextureArray;
+	// width and height of every texture array layer
+	int m_textureArrayLayerSize;
+	// OpenGL texture array holding all the loaded textures
+	GLuint m_textureArrayID;
+	// layer image data waiting to be uploaded to the array
+	std::vector<std::vector<unsigned char>> m_stagedTextureLayers;
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// owner of all texture objects and their memory budget
+	TextureResidencyManager m_textureResidency;
+	// loader of textures requested while the scene renders
+	TextureStreamer* m_pTextureStreamer;
+	// loader of evicted textures, kept for every reload so its
+	// decode thread is only started once
+	TextureLoader* m_pReloadLoader;
+	// true when streamed textures may have arrived since the last frame
+	bool m_bTexturesStreamed;
+	// true when streamed textures upload through pixel buffers
+	bool m_bUsePixelBufferUploads;
+	// true when block compressed images are preferred over decoding
+	bool m_bUseCompressedTextures;
+	// texture tag handles, equal to the texture slot
+	TagTable m_textureTags;
+	// material tag handles, equal to the material index
+	TagTable m_materialTags;
+	// uniform buffer holding every defined object material
+	MaterialBuffer m_materialBuffer;
+	// shadow copy of the uniforms set by the scene, to skip
+	// uploading values that have not changed
+	ShaderStateCache m_shaderState;
+	// draws of the frame, sorted to group those sharing state
+	RenderQueue m_renderQueue;
+	// camera position used to order the draws front to back
+	glm::vec3 m_viewPosition;
+	// true when objects outside the view frustum are not drawn
+	bool m_bUseFrustumCulling;
+	// true once the view frustum has been set
+	bool m_bHasViewFrustum;
+	// volume the camera sees this frame
+	Frustum m_viewFrustum;
+	// world bounds of the scene objects
+	BoundingVolumeHierarchy m_objectBVH;
+	// objects that may be seen this frame, drawn in place of all
+	std::vector<uint32_t> m_visibleObjects;
+	// culling time and visible objects over every frame
+	double m_cullMilliseconds;
+	long long m_totalVisibleObjects;
+	// true when objects hidden behind large objects are not drawn
+	bool m_bUseOcclusionCulling;
+	// projection * view matrix of the frame, for occlusion culling
+	glm::mat4 m_viewProjection;
+	// CPU depth buffer the occluders are drawn into, created when
+	// occlusion culling is turned on
+	OcclusionBuffer* m_pOcclusionBuffer;
+	// world boxes of the visible objects and the objects chosen to
+	// hide others, by how large they look from the camera
+	std::vector<BoundingVolumeHierarchy::BOUNDING_BOX> m_visibleBounds;
+	std::vector<std::pair<float, uint32_t>> m_occluders;
+	// 1 for each visible object the occlusion buffer hides, tested
+	// in jobs before the visible objects are compacted
+	std::vector<uint8_t> m_occludedObjects;
+	// threads the scene update is split over as jobs, created when
+	// a thread count is set - without it the update runs in place
+	JobSystem* m_pJobSystem;
+	// new world boxes of the objects moved this frame, by updated node
+	std::vector<BoundingVolumeHierarchy::BOUNDING_BOX> m_updatedBounds;
+	// true when curved objects are drawn with fewer triangles the
+	// smaller they are on screen
+	bool m_bUseLevelOfDetail;
+	// level of detail each object is drawn with
+	LevelOfDetail m_levelOfDetail;
+	// every level of the curved meshes, for the single draws
+	DetailMeshes m_detailMeshes;
+	// triangles of each mesh type at each level of detail
+	int m_meshTriangleCounts[SceneFile::MESH_TYPE_COUNT][MeshGeometry::LEVEL_COUNT];
+	// triangles and objects at each level drawn over every frame
+	long long m_totalTriangles;
+	long long m_totalLevelObjects[MeshGeometry::LEVEL_COUNT];
+	// counts of one chunk of the visible objects choosing levels,
+	// added to the totals once every chunk is done
+	struct LEVEL_COUNTS
+	{
+		long long triangles;
+		long long levelObjects[MeshGeometry::LEVEL_COUNT];
+		long long levelChanges;
+	};
+	std::vector<LEVEL_COUNTS> m_chunkLevelCounts;
+	// true when objects sharing a mesh are drawn in one instanced draw
+	bool m_bUseInstancing;
+	// meshes with per-instance buffers for the instanced draws
+	InstancedMeshes m_instancedMeshes;
+	// true when the batches are drawn from one shared mesh buffer
+	// with multi-draw-indirect
+	bool m_bUseMultiDrawIndirect;
+	// every mesh in one vertex and index buffer, for indirect draws
+	MeshMegaBuffer m_meshMegaBuffer;
+	// command index of each instance batch of the frame, or -1 when
+	// the batch could not be added
+	std::vector<int> m_batchCommands;
+	// the instances of one batch in a chunk of the visible objects,
+	// and where the chunk writes them in the batch
+	struct CHUNK_BATCH
+	{
+		int count;
+		int first;
+		InstancedMeshes::INSTANCE_DATA* pNext;
+	};
+	// batch key of each visible object and the batches of each chunk
+	std::vector<uint32_t> m_instanceKeys;
+	std::vector<std::map<uint32_t, CHUNK_BATCH>> m_chunkBatches;
+	// snapshot RenderScene updates and draws on the one thread
+	FRAME_SNAPSHOT m_frameSnapshot;
+	// CPU time spent updating and submitting the scene, for the
+	// render statistics - each counted on the thread doing it
+	double m_updateSceneMilliseconds;
+	int m_updateSceneFrames;
+	double m_renderSceneMilliseconds;
+	int m_renderSceneFrames;
+
+	// text scene file loaded by PrepareScene
+	std::string m_sceneFilename;
+	// compiled scene holding the textures, materials, lights and objects
+	SceneFile m_sceneFile;
+	// texture slot of each scene file texture, so drawing does no
+	// string lookups
+	std::vector<int> m_sceneTextureSlots;
+	// transforms of the scene groups followed by the scene objects
+	SceneGraph m_sceneGraph;
+	// node of the first scene object, after the groups
+	int m_firstObjectNode;
 
 	// load texture images and convert to OpenGL texture data
 	bool CreateGLTexture(const char* filename, std::string tag);
+	// convert decoded image data to OpenGL texture data
+	bool UploadGLTexture(
+		const char* filename,
+		const unsigned char* image,
+		int width,
+		int height,
+		int colorChannels,
+		std::string tag,
+		int mipLevels = 1,
+		CompressedTexture::BLOCK_FORMAT compressedFormat = CompressedTexture::FORMAT_NONE);
+	// create an OpenGL texture object from decoded image data
+	GLuint CreateGLTextureObject(
+		const unsigned char* image,
+		int width,
+		int height,
+		int colorChannels,
+		int mipLevels,
+		CompressedTexture::BLOCK_FORMAT compressedFormat = CompressedTexture::FORMAT_NONE);
+	// prepare a loader to use block compressed images, if enabled
+	void EnableCompressedTextures(TextureLoader& textureLoader);
+	// register a texture that finished streaming in
+	void AddStreamedTexture(
+		const TextureLoader::TEXTURE_REQUEST& request,
+		GLTexture texture,
+		int width,
+		int height);
+	// reload an evicted texture from its image file
+	GLTexture ReloadGLTexture(int residencyID, size_t& byteCount);
+	// resize decoded image data into the next texture array layer
+	bool AddTextureLayer(
+		const unsigned char* image,
+		int width,
+		int height,
+		int colorChannels,
+		std::string tag,
+		int mipLevels = 1);
+	// upload all the added layers into one OpenGL texture array
+	bool CreateGLTextureArray();
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
 	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
+	int FindTextureID(const std::string& tag);
+	int FindTextureSlot(const std::string& tag);
 	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	bool FindMaterial(const std::string& tag, OBJECT_MATERIAL& material);
+	int FindMaterialIndex(const std::string& tag);
+	// assign handles to the defined object materials
+	void IndexObjectMaterials();
+	// upload the defined materials into the material uniform buffer
+	void CreateMaterialBuffer();
+	// resolve the texture slots of the scene file textures
+	void ResolveSceneHandles();
+	// add the scene groups and objects to the scene graph
+	void LoadObjectTransforms();
+	// get the world box of a scene object from its world matrix
+	BoundingVolumeHierarchy::BOUNDING_BOX GetObjectBounds(int objectIndex) const;
+	// build the bounding volume hierarchy over the scene objects
+	void BuildObjectBVH();
+	// update the scene graph, refit the moved objects and find the
+	// objects to draw this frame
+	void UpdateVisibleObjects();
+	// drop the visible objects hidden behind the largest ones
+	void CullOccludedObjects();
+	// choose the level of detail of every visible object
+	void SelectObjectLevels();
+	// run a function over chunks of a range of items, as jobs when
+	// there is a job system and in one call when there is not
+	void ParallelFor(int itemCount, const JobSystem::RangeFunction& function);
+	// run a function over fixed chunks of a range of items, given the
+	// chunk index, the first item and the item count of each chunk
+	typedef std::function<void(int, int, int)> ChunkFunction;
+	void ParallelForChunks(int itemCount, const ChunkFunction& function);
+	// batch the visible objects by mesh, texture and material page
+	void BuildInstanceBatches(FRAME_SNAPSHOT& snapshot);
+	// draw the scene file objects with one instanced draw per batch
+	void RenderSceneInstanced(const FRAME_SNAPSHOT& snapshot);
+	// set the texture and material page shared by a batch of instances
+	void SetBatchState(uint32_t batchKey);
 
 	// set the transformation values 
 	// into the transform buffer
@@ -77,6 +327,8 @@ private:
 		float YrotationDegrees,
 		float ZrotationDegrees,
 		glm::vec3 positionXYZ);
+	void SetTransformations(
+		const glm::mat4& model);
 
 	// set the color values into the shader
 	void SetShaderColor(
@@ -87,7 +339,9 @@ private:
 
 	// set the texture data into the shader
 	void SetShaderTexture(
-		std::string textureTag);
+		const std::string& textureTag);
+	void SetShaderTexture(
+		int textureSlot);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
@@ -95,15 +349,79 @@ private:
 
 	// set the object material into the shader
 	void SetShaderMaterial(
-		std::string materialTag);
+		const std::string& materialTag);
+	void SetShaderMaterial(
+		int materialIndex);
 
 public:
 
+	// pack all scene textures into the layers of one texture array,
+	// resizing them to the layer size - must be set before PrepareScene
+	void SetTextureArrayMode(bool bEnable, int layerSize = 512);
+	// limit the resident texture memory, evicting the least recently
+	// used textures when over the budget - zero means unlimited
+	void SetTextureMemoryBudget(size_t budgetBytes);
+	// print the current and peak texture memory usage
+	void PrintTextureMemoryStatistics();
+	// print the CPU time, draw calls and uniform uploads per frame
+	void PrintRenderStatistics();
+	// choose whether block compressed images replace decoded ones
+	void SetCompressedTextureMode(bool bEnable);
+
+	// choose pixel buffer or synchronous uploads for streamed textures
+	void SetTextureUploadMode(bool bUsePixelBuffers);
+	// queue an image file to be loaded while the scene renders
+	void StreamTexture(const char* filename, std::string tag);
+	// advance the texture streaming, returning the textures still pending
+	int UpdateTextureStreaming();
+	// true when the scene changed since the last RenderScene, so the
+	// frame on screen is out of date
+	bool NeedsRedraw() const;
+	// stream the scene's image files in repeatedly, as a load test
+	void StartTextureStreamingTest(int textureCount);
+
+	// choose the text scene file loaded by PrepareScene
+	void SetSceneFile(const char* filename);
+	// set the camera position the draws are ordered by each frame
+	void SetViewPosition(glm::vec3 viewPosition);
+	// set the projection * view matrix the objects are culled against
+	void SetViewProjection(const glm::mat4& viewProjection);
+	// choose whether objects outside the view are skipped
+	void SetFrustumCullingMode(bool bEnable);
+	// choose whether objects hidden behind large objects are skipped,
+	// tested on the CPU against their rasterized boxes
+	void SetOcclusionCullingMode(bool bEnable);
+	// choose whether curved objects far from the camera are drawn
+	// with fewer triangles - must be set before PrepareScene
+	void SetLevelOfDetailMode(bool bEnable);
+	// split the scene update into jobs run on this many threads,
+	// zero meaning one per CPU core
+	void SetJobThreadCount(int threadCount);
+	// move a scene group, and everything under it, relative to its
+	// parent - returns false when the scene has no such group
+	bool SetGroupPosition(const char* tag, glm::vec3 position);
+	// draw all objects sharing a mesh with one instanced draw call -
+	// must be set before PrepareScene
+	void SetInstancingMode(bool bEnable);
+	// draw the instance batches from one shared mesh buffer with
+	// multi-draw-indirect - must be set before PrepareScene
+	void SetMultiDrawIndirectMode(bool bEnable);
+	// write the per-draw data into a persistently mapped ring buffer
+	// instead of uploading it - must be set before PrepareScene
+	void SetPersistentRingMode(bool bEnable);
+
 	// The following methods are for the students to 
 	// customize for their own 3D scene
 	void PrepareScene();
 	void RenderScene();
 
+	// cull the scene for the view and record what to draw into the
+	// snapshot - touches no OpenGL state, so it can run on its own
+	// thread while the render thread draws an earlier snapshot
+	void UpdateScene(FRAME_SNAPSHOT& snapshot);
+	// draw a snapshot made by UpdateScene, on the OpenGL thread
+	void RenderSnapshot(const FRAME_SNAPSHOT& snapshot);
+
 	// loads textures from image files
 	void LoadSceneTextures();
 
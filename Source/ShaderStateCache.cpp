@@ -0,0 +1,247 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderstatecache.cpp
+// ============
+// skip shader uniform uploads that would not change the current value
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderStateCache.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+/***********************************************************
+ *  ShaderStateCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderStateCache::ShaderStateCache()
+{
+	m_programID = 0;
+	m_currentFrame.issuedCalls = 0;
+	m_currentFrame.skippedCalls = 0;
+	m_lastFrame = m_currentFrame;
+	m_totalIssuedCalls = 0;
+	m_totalSkippedCalls = 0;
+	m_frameCount = 0;
+	m_bFrameStarted = false;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for closing the counts of the last
+ *  frame and starting new ones.  The current program is
+ *  checked once here rather than on every upload.
+ ***********************************************************/
+void ShaderStateCache::BeginFrame()
+{
+	// uploads made before the first frame, while the scene is
+	// prepared, are not counted as a frame
+	if (m_bFrameStarted == true)
+	{
+		m_lastFrame = m_currentFrame;
+		m_totalIssuedCalls += m_currentFrame.issuedCalls;
+		m_totalSkippedCalls += m_currentFrame.skippedCalls;
+		m_frameCount++;
+	}
+	m_currentFrame.issuedCalls = 0;
+	m_currentFrame.skippedCalls = 0;
+	m_bFrameStarted = true;
+
+	GLint programID = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &programID);
+	if ((GLuint)programID != m_programID)
+	{
+		Invalidate();
+		m_programID = (GLuint)programID;
+	}
+}
+
+/***********************************************************
+ *  Invalidate()
+ *
+ *  This method is used for forgetting every cached value and
+ *  uniform location, so the next upload of every uniform is
+ *  issued.
+ ***********************************************************/
+void ShaderStateCache::Invalidate()
+{
+	m_uniformIndices.clear();
+	m_uniforms.clear();
+	m_names.clear();
+	m_programID = 0;
+}
+
+/***********************************************************
+ *  GetUniform()
+ *
+ *  This method is used for finding the state of a uniform,
+ *  looking its location up the first time it is used.
+ ***********************************************************/
+ShaderStateCache::UNIFORM_STATE& ShaderStateCache::GetUniform(const char* name)
+{
+	std::unordered_map<std::string_view, int>::const_iterator found = m_uniformIndices.find(std::string_view(name));
+	if (found != m_uniformIndices.end())
+	{
+		return m_uniforms[found->second];
+	}
+
+	// the program is needed for the lookup, even before the first frame
+	if (m_programID == 0)
+	{
+		GLint programID = 0;
+		glGetIntegerv(GL_CURRENT_PROGRAM, &programID);
+		m_programID = (GLuint)programID;
+	}
+
+	UNIFORM_STATE uniform;
+	uniform.location = glGetUniformLocation(m_programID, name);
+	uniform.bHasValue = false;
+	memset(uniform.value, 0, sizeof(uniform.value));
+
+	m_names.push_back(name);
+	m_uniformIndices[std::string_view(m_names.back())] = (int)m_uniforms.size();
+	m_uniforms.push_back(uniform);
+	return m_uniforms.back();
+}
+
+/***********************************************************
+ *  SetValue()
+ *
+ *  This method is used for uploading a uniform value when it
+ *  differs from the last uploaded one.  Uniforms that the
+ *  program does not use are never uploaded.
+ ***********************************************************/
+void ShaderStateCache::SetValue(const char* name, UNIFORM_TYPE type, const void* pValue, size_t byteCount)
+{
+	UNIFORM_STATE& uniform = GetUniform(name);
+	if ((uniform.location < 0) ||
+		((uniform.bHasValue == true) && (memcmp(uniform.value, pValue, byteCount) == 0)))
+	{
+		m_currentFrame.skippedCalls++;
+		return;
+	}
+
+	memcpy(uniform.value, pValue, byteCount);
+	uniform.bHasValue = true;
+	m_currentFrame.issuedCalls++;
+
+	switch (type)
+	{
+	case UNIFORM_INT:
+		glUniform1i(uniform.location, *(const int*)pValue);
+		break;
+	case UNIFORM_FLOAT:
+		glUniform1f(uniform.location, *(const float*)pValue);
+		break;
+	case UNIFORM_VEC2:
+		glUniform2fv(uniform.location, 1, (const float*)pValue);
+		break;
+	case UNIFORM_VEC3:
+		glUniform3fv(uniform.location, 1, (const float*)pValue);
+		break;
+	case UNIFORM_VEC4:
+		glUniform4fv(uniform.location, 1, (const float*)pValue);
+		break;
+	case UNIFORM_MAT4:
+		glUniformMatrix4fv(uniform.location, 1, GL_FALSE, (const float*)pValue);
+		break;
+	}
+}
+
+/***********************************************************
+ *  SetBool()
+ *
+ *  This method is used for setting a bool uniform, which
+ *  OpenGL stores as an int.
+ ***********************************************************/
+void ShaderStateCache::SetBool(const char* name, bool value)
+{
+	SetInt(name, value ? 1 : 0);
+}
+
+/***********************************************************
+ *  SetInt()
+ *
+ *  This method is used for setting an int or sampler uniform.
+ ***********************************************************/
+void ShaderStateCache::SetInt(const char* name, int value)
+{
+	SetValue(name, UNIFORM_INT, &value, sizeof(value));
+}
+
+/***********************************************************
+ *  SetFloat()
+ *
+ *  This method is used for setting a float uniform.
+ ***********************************************************/
+void ShaderStateCache::SetFloat(const char* name, float value)
+{
+	SetValue(name, UNIFORM_FLOAT, &value, sizeof(value));
+}
+
+/***********************************************************
+ *  SetVec2()
+ *
+ *  This method is used for setting a vec2 uniform.
+ ***********************************************************/
+void ShaderStateCache::SetVec2(const char* name, const glm::vec2& value)
+{
+	SetValue(name, UNIFORM_VEC2, glm::value_ptr(value), sizeof(float) * 2);
+}
+
+/***********************************************************
+ *  SetVec3()
+ *
+ *  This method is used for setting a vec3 uniform.
+ ***********************************************************/
+void ShaderStateCache::SetVec3(const char* name, const glm::vec3& value)
+{
+	SetValue(name, UNIFORM_VEC3, glm::value_ptr(value), sizeof(float) * 3);
+}
+
+/***********************************************************
+ *  SetVec4()
+ *
+ *  This method is used for setting a vec4 uniform.
+ ***********************************************************/
+void ShaderStateCache::SetVec4(const char* name, const glm::vec4& value)
+{
+	SetValue(name, UNIFORM_VEC4, glm::value_ptr(value), sizeof(float) * 4);
+}
+
+/***********************************************************
+ *  SetMat4()
+ *
+ *  This method is used for setting a mat4 uniform.
+ ***********************************************************/
+void ShaderStateCache::SetMat4(const char* name, const glm::mat4& value)
+{
+	SetValue(name, UNIFORM_MAT4, glm::value_ptr(value), sizeof(float) * 16);
+}
+
+/***********************************************************
+ *  PrintStatistics()
+ *
+ *  This method is used for printing how many uniform uploads
+ *  were issued and skipped per frame.
+ ***********************************************************/
+void ShaderStateCache::PrintStatistics() const
+{
+	if (m_frameCount == 0)
+	{
+		return;
+	}
+
+	long long totalCalls = m_totalIssuedCalls + m_totalSkippedCalls;
+	std::cout << std::fixed << std::setprecision(1)
+		<< "Uniform uploads per frame over " << m_frameCount << " frames: "
+		<< ((double)m_totalIssuedCalls / m_frameCount) << " issued, "
+		<< ((double)m_totalSkippedCalls / m_frameCount) << " skipped ("
+		<< (totalCalls > 0 ? 100.0 * m_totalSkippedCalls / totalCalls : 0.0) << "% filtered), last frame "
+		<< m_lastFrame.issuedCalls << " issued, " << m_lastFrame.skippedCalls << " skipped" << std::endl;
+}
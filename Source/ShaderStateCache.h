@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderstatecache.h
+// ============
+// skip shader uniform uploads that would not change the current value
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************
+ *  ShaderStateCache
+ *
+ *  This class keeps a shadow copy of the uniforms that the
+ *  scene sets on the current shader program, along with
+ *  their uniform locations, which are looked up once.  A
+ *  uniform is only uploaded when its value differs from the
+ *  shadow copy, and every issued and skipped upload is
+ *  counted per frame.  Uniforms set through the cache must
+ *  not also be set through the ShaderManager, or the shadow
+ *  copy would go stale.
+ ***********************************************************/
+class ShaderStateCache
+{
+public:
+	// constructor
+	ShaderStateCache();
+
+	struct FRAME_STATISTICS
+	{
+		int issuedCalls;
+		int skippedCalls;
+	};
+
+	// start counting a new frame, forgetting every value if the
+	// current shader program has changed
+	void BeginFrame();
+	// forget every cached value and location
+	void Invalidate();
+
+	// set uniform values, skipping the upload when nothing changes
+	void SetBool(const char* name, bool value);
+	void SetInt(const char* name, int value);
+	void SetFloat(const char* name, float value);
+	void SetVec2(const char* name, const glm::vec2& value);
+	void SetVec3(const char* name, const glm::vec3& value);
+	void SetVec4(const char* name, const glm::vec4& value);
+	void SetMat4(const char* name, const glm::mat4& value);
+
+	// get the counts of the last completed frame
+	FRAME_STATISTICS GetLastFrameStatistics() const { return m_lastFrame; }
+	// print the average issued and skipped uploads per frame
+	void PrintStatistics() const;
+
+private:
+	enum UNIFORM_TYPE
+	{
+		UNIFORM_INT,
+		UNIFORM_FLOAT,
+		UNIFORM_VEC2,
+		UNIFORM_VEC3,
+		UNIFORM_VEC4,
+		UNIFORM_MAT4
+	};
+
+	struct UNIFORM_STATE
+	{
+		GLint location;
+		bool bHasValue;
+		// last uploaded value, as raw bytes
+		float value[16];
+	};
+
+	// shader program the cached locations belong to
+	GLuint m_programID;
+	// uniform names, kept alive for the views used as lookup keys
+	std::deque<std::string> m_names;
+	// index of each uniform's state, by name
+	std::unordered_map<std::string_view, int> m_uniformIndices;
+	std::vector<UNIFORM_STATE> m_uniforms;
+
+	// counts of the frame in progress and the last completed one
+	FRAME_STATISTICS m_currentFrame;
+	FRAME_STATISTICS m_lastFrame;
+	// totals over every completed frame
+	long long m_totalIssuedCalls;
+	long long m_totalSkippedCalls;
+	int m_frameCount;
+	// true once the first frame has begun
+	bool m_bFrameStarted;
+
+	// find or create the state of the named uniform
+	UNIFORM_STATE& GetUniform(const char* name);
+	// compare the value with the shadow copy and upload it if it differs
+	void SetValue(const char* name, UNIFORM_TYPE type, const void* pValue, size_t byteCount);
+};
@@ -0,0 +1,55 @@
+///////////////////////////////////////////////////////////////////////////////
+// tagtable.cpp
+// ============
+// intern tag strings into small integer handles
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TagTable.h"
+
+/***********************************************************
+ *  Intern()
+ *
+ *  This method is used for getting the handle of the passed
+ *  in tag.  A tag that was not added yet gets the next handle.
+ ***********************************************************/
+int TagTable::Intern(const std::string& tag)
+{
+	std::unordered_map<std::string, int>::iterator found = m_handles.find(tag);
+	if (found != m_handles.end())
+	{
+		return(found->second);
+	}
+
+	int handle = (int)m_tags.size();
+	m_tags.push_back(tag);
+	m_handles[tag] = handle;
+	return(handle);
+}
+
+/***********************************************************
+ *  Find()
+ *
+ *  This method is used for getting the handle of a tag that
+ *  was previously added.
+ ***********************************************************/
+int TagTable::Find(const std::string& tag) const
+{
+	std::unordered_map<std::string, int>::const_iterator found = m_handles.find(tag);
+	if (found == m_handles.end())
+	{
+		return(INVALID_HANDLE);
+	}
+	return(found->second);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all the added tags.
+ ***********************************************************/
+void TagTable::Clear()
+{
+	m_handles.clear();
+	m_tags.clear();
+}
@@ -0,0 +1,45 @@
+///////////////////////////////////////////////////////////////////////////////
+// tagtable.h
+// ============
+// intern tag strings into small integer handles
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************
+ *  TagTable
+ *
+ *  This class assigns each distinct tag string a handle in
+ *  the order the tags are added, so the handles can be used
+ *  directly as indexes into arrays of tagged objects.  Tags
+ *  are resolved through a hash map once, after which only
+ *  the integer handle needs to be passed around.
+ ***********************************************************/
+class TagTable
+{
+public:
+	// handle returned for tags that have not been added
+	static const int INVALID_HANDLE = -1;
+
+	// get the handle of the tag, adding the tag if it is new
+	int Intern(const std::string& tag);
+	// get the handle of the tag, or INVALID_HANDLE if not added
+	int Find(const std::string& tag) const;
+	// get the tag string of a valid handle
+	const std::string& GetTag(int handle) const { return m_tags[handle]; }
+	// get the number of tags added
+	int GetCount() const { return (int)m_tags.size(); }
+	// remove all the tags
+	void Clear();
+
+private:
+	// handle of each added tag
+	std::unordered_map<std::string, int> m_handles;
+	// tag of each handle
+	std::vector<std::string> m_tags;
+};
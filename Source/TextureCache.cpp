@@ -0,0 +1,316 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecache.cpp
+// ============
+// store decoded and mipmapped texture images on disk so they can be
+// memory mapped and uploaded without decoding the source image again
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	const uint32_t g_CacheMagic = 0x31435854; // "TXC1"
+	const uint32_t g_CacheVersion = 1;
+	const size_t g_PixelAlignment = 16;
+
+	// fixed size header at the start of every cache file, followed by
+	// the source path and then the mip chain at an aligned offset
+	struct CACHE_HEADER
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t sourceSize;
+		int64_t sourceModifiedTime;
+		uint32_t width;
+		uint32_t height;
+		uint32_t levelCount;
+		uint32_t pathLength;
+		uint64_t pixelOffset;
+		uint64_t pixelByteCount;
+	};
+
+	// get the offset of the mip chain following the header and path
+	uint64_t GetPixelOffset(size_t pathLength)
+	{
+		size_t offset = sizeof(CACHE_HEADER) + pathLength;
+		return (offset + g_PixelAlignment - 1) & ~(uint64_t)(g_PixelAlignment - 1);
+	}
+}
+
+/***********************************************************
+ *  TextureCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureCache::TextureCache(const char* directory)
+{
+	m_directory = directory;
+}
+
+/***********************************************************
+ *  ~TextureCache()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureCache::~TextureCache()
+{
+}
+
+/***********************************************************
+ *  GetCachePath()
+ *
+ *  This method is used for getting the cache file name that
+ *  is used for the passed in source image path.
+ ***********************************************************/
+std::string TextureCache::GetCachePath(const std::string& sourcePath) const
+{
+	std::string name = sourcePath;
+	for (size_t i = 0; i < name.size(); i++)
+	{
+		if ((name[i] == '/') || (name[i] == '\\') || (name[i] == ':'))
+		{
+			name[i] = '_';
+		}
+	}
+	return m_directory + "/" + name + ".texcache";
+}
+
+/***********************************************************
+ *  GetSourceInfo()
+ *
+ *  This method is used for getting the size and modification
+ *  time that key the cache file of a source image.
+ ***********************************************************/
+bool TextureCache::GetSourceInfo(const std::string& sourcePath, uint64_t& size, int64_t& modifiedTime)
+{
+	std::error_code error;
+	size = (uint64_t)std::filesystem::file_size(sourcePath, error);
+	if (error)
+	{
+		return(false);
+	}
+	std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(sourcePath, error);
+	if (error)
+	{
+		return(false);
+	}
+	modifiedTime = (int64_t)writeTime.time_since_epoch().count();
+	return(true);
+}
+
+/***********************************************************
+ *  GetMipChainSize()
+ *
+ *  This method is used for getting the number of bytes in
+ *  an RGBA8 mip chain with the passed in size.
+ ***********************************************************/
+size_t TextureCache::GetMipChainSize(int width, int height, int levelCount)
+{
+	size_t byteCount = 0;
+	for (int level = 0; level < levelCount; level++)
+	{
+		byteCount += (size_t)width * height * 4;
+		width = (width > 1) ? width / 2 : 1;
+		height = (height > 1) ? height / 2 : 1;
+	}
+	return(byteCount);
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for mapping the cache file of the
+ *  passed in source image into memory.  Returns false when
+ *  there is no cache file or it no longer matches the path,
+ *  size or modification time of the source image.
+ ***********************************************************/
+bool TextureCache::Load(const std::string& sourcePath, MIP_CHAIN& mipChain)
+{
+	uint64_t sourceSize = 0;
+	int64_t sourceModifiedTime = 0;
+	if (GetSourceInfo(sourcePath, sourceSize, sourceModifiedTime) == false)
+	{
+		return(false);
+	}
+
+	std::string cachePath = GetCachePath(sourcePath);
+	if (mipChain.mappedFile.Open(cachePath.c_str()) == false)
+	{
+		return(false);
+	}
+
+	const unsigned char* pData = mipChain.mappedFile.GetData();
+	size_t fileSize = mipChain.mappedFile.GetSize();
+
+	CACHE_HEADER header;
+	bool bValid = (fileSize >= sizeof(CACHE_HEADER));
+	if (bValid == true)
+	{
+		memcpy(&header, pData, sizeof(CACHE_HEADER));
+		bValid = (header.magic == g_CacheMagic) &&
+			(header.version == g_CacheVersion) &&
+			(header.sourceSize == sourceSize) &&
+			(header.sourceModifiedTime == sourceModifiedTime) &&
+			(header.pathLength == sourcePath.size()) &&
+			(header.pixelOffset == GetPixelOffset(header.pathLength)) &&
+			(header.pixelByteCount == GetMipChainSize(header.width, header.height, header.levelCount)) &&
+			(header.pixelOffset + header.pixelByteCount <= fileSize);
+	}
+	if (bValid == true)
+	{
+		bValid = (memcmp(pData + sizeof(CACHE_HEADER), sourcePath.data(), sourcePath.size()) == 0);
+	}
+	if (bValid == false)
+	{
+		mipChain.mappedFile.Close();
+		return(false);
+	}
+
+	mipChain.width = (int)header.width;
+	mipChain.height = (int)header.height;
+	mipChain.levelCount = (int)header.levelCount;
+	mipChain.pixels = pData + header.pixelOffset;
+	mipChain.byteCount = (size_t)header.pixelByteCount;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Store()
+ *
+ *  This method is used for writing the mip chain into the
+ *  cache file of the passed in source image.  The file is
+ *  written under a temporary name and then renamed so that
+ *  a partially written file is never loaded.
+ ***********************************************************/
+bool TextureCache::Store(const std::string& sourcePath, const MIP_CHAIN& mipChain)
+{
+	CACHE_HEADER header;
+	memset(&header, 0, sizeof(CACHE_HEADER));
+	if (GetSourceInfo(sourcePath, header.sourceSize, header.sourceModifiedTime) == false)
+	{
+		return(false);
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(m_directory, error);
+
+	header.magic = g_CacheMagic;
+	header.version = g_CacheVersion;
+	header.width = (uint32_t)mipChain.width;
+	header.height = (uint32_t)mipChain.height;
+	header.levelCount = (uint32_t)mipChain.levelCount;
+	header.pathLength = (uint32_t)sourcePath.size();
+	header.pixelOffset = GetPixelOffset(sourcePath.size());
+	header.pixelByteCount = (uint64_t)mipChain.byteCount;
+
+	std::string cachePath = GetCachePath(sourcePath);
+	std::string tempPath = cachePath + ".tmp";
+	{
+		std::ofstream file(tempPath.c_str(), std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			std::cout << "Could not write texture cache:" << cachePath << std::endl;
+			return(false);
+		}
+
+		char padding[g_PixelAlignment] = { 0 };
+		file.write((const char*)&header, sizeof(CACHE_HEADER));
+		file.write(sourcePath.data(), sourcePath.size());
+		file.write(padding, (std::streamsize)(header.pixelOffset - sizeof(CACHE_HEADER) - sourcePath.size()));
+		file.write((const char*)mipChain.pixels, (std::streamsize)mipChain.byteCount);
+		if (!file)
+		{
+			std::cout << "Could not write texture cache:" << cachePath << std::endl;
+			return(false);
+		}
+	}
+
+	std::filesystem::rename(tempPath, cachePath, error);
+	if (error)
+	{
+		std::filesystem::remove(tempPath, error);
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  BuildMipChain()
+ *
+ *  This method is used for converting a decoded RGB or RGBA
+ *  image into RGBA8 and generating every mip level down to
+ *  1x1 with a 2x2 box filter.
+ ***********************************************************/
+void TextureCache::BuildMipChain(
+	const unsigned char* image,
+	int width,
+	int height,
+	int colorChannels,
+	MIP_CHAIN& mipChain)
+{
+	int levelCount = 1;
+	while ((width >> (levelCount - 1)) > 1 || (height >> (levelCount - 1)) > 1)
+	{
+		levelCount++;
+	}
+
+	mipChain.width = width;
+	mipChain.height = height;
+	mipChain.levelCount = levelCount;
+	mipChain.byteCount = GetMipChainSize(width, height, levelCount);
+	mipChain.ownedPixels.resize(mipChain.byteCount);
+
+	// the base level is a straight copy expanded to four channels
+	unsigned char* pLevel = mipChain.ownedPixels.data();
+	for (int i = 0; i < width * height; i++)
+	{
+		pLevel[i * 4 + 0] = image[i * colorChannels + 0];
+		pLevel[i * 4 + 1] = image[i * colorChannels + 1];
+		pLevel[i * 4 + 2] = image[i * colorChannels + 2];
+		pLevel[i * 4 + 3] = (colorChannels == 4) ? image[i * colorChannels + 3] : 255;
+	}
+
+	// each following level averages 2x2 texels of the previous one
+	int levelWidth = width;
+	int levelHeight = height;
+	for (int level = 1; level < levelCount; level++)
+	{
+		const unsigned char* pSource = pLevel;
+		pLevel += (size_t)levelWidth * levelHeight * 4;
+
+		int nextWidth = (levelWidth > 1) ? levelWidth / 2 : 1;
+		int nextHeight = (levelHeight > 1) ? levelHeight / 2 : 1;
+		for (int y = 0; y < nextHeight; y++)
+		{
+			int y0 = y * 2;
+			int y1 = (y0 + 1 < levelHeight) ? y0 + 1 : y0;
+			for (int x = 0; x < nextWidth; x++)
+			{
+				int x0 = x * 2;
+				int x1 = (x0 + 1 < levelWidth) ? x0 + 1 : x0;
+				for (int c = 0; c < 4; c++)
+				{
+					int sum = pSource[(y0 * levelWidth + x0) * 4 + c] +
+						pSource[(y0 * levelWidth + x1) * 4 + c] +
+						pSource[(y1 * levelWidth + x0) * 4 + c] +
+						pSource[(y1 * levelWidth + x1) * 4 + c];
+					pLevel[(y * nextWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+
+		levelWidth = nextWidth;
+		levelHeight = nextHeight;
+	}
+
+	mipChain.pixels = mipChain.ownedPixels.data();
+}
@@ -0,0 +1,71 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecache.h
+// ============
+// store decoded and mipmapped texture images on disk so they can be
+// memory mapped and uploaded without decoding the source image again
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  TextureCache
+ *
+ *  This class manages a directory of cache files, one per
+ *  source image.  Each cache file holds the full RGBA8 mip
+ *  chain of the image and is keyed by the source path, size
+ *  and modification time, so editing the source image makes
+ *  its cache file stale.
+ ***********************************************************/
+class TextureCache
+{
+public:
+	// constructor
+	TextureCache(const char* directory);
+	// destructor
+	~TextureCache();
+
+	struct MIP_CHAIN
+	{
+		int width;
+		int height;
+		int levelCount;
+		// all levels, largest first, tightly packed RGBA8
+		const unsigned char* pixels;
+		size_t byteCount;
+		// backing storage for the pixels
+		MappedFile mappedFile;
+		std::vector<unsigned char> ownedPixels;
+	};
+
+	// map the cache file of the source image, if it is current
+	bool Load(const std::string& sourcePath, MIP_CHAIN& mipChain);
+	// write the mip chain into the cache file of the source image
+	bool Store(const std::string& sourcePath, const MIP_CHAIN& mipChain);
+
+	// build the RGBA8 mip chain of a decoded RGB or RGBA image
+	static void BuildMipChain(
+		const unsigned char* image,
+		int width,
+		int height,
+		int colorChannels,
+		MIP_CHAIN& mipChain);
+	// get the number of bytes in a mip chain of the passed in size
+	static size_t GetMipChainSize(int width, int height, int levelCount);
+	// get the size and modification time that mark a source image as
+	// changed, shared with the block compressed files
+	static bool GetSourceInfo(const std::string& sourcePath, uint64_t& size, int64_t& modifiedTime);
+
+private:
+	// directory holding the cache files
+	std::string m_directory;
+
+	// get the cache file used for the source image
+	std::string GetCachePath(const std::string& sourcePath) const;
+};
@@ -0,0 +1,497 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.cpp
+// ============
+// decode texture image files on worker threads so that the thread
+// owning the OpenGL context only has to upload the decoded pixels
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureLoader.h"
+
+#include "Profiler.h"
+
+#include "stb_image.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// get the elapsed milliseconds since the passed in time
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+}
+
+/***********************************************************
+ *  TextureLoader()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureLoader::TextureLoader(int workerCount)
+{
+	m_workerCount = workerCount;
+	if (m_workerCount <= 0)
+	{
+		m_workerCount = (int)std::thread::hardware_concurrency();
+	}
+	if (m_workerCount <= 0)
+	{
+		m_workerCount = 1;
+	}
+	m_pCache = NULL;
+	m_compressedFormatMask = 0;
+	m_nextRequest = 0;
+	m_handedOutCount = 0;
+	m_bStopping = false;
+}
+
+/***********************************************************
+ *  ~TextureLoader()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureLoader::~TextureLoader()
+{
+	FinishLoading();
+
+	// free any decoded images that were never handed out
+	DECODED_TEXTURE decoded;
+	while (m_readyTextures.empty() == false)
+	{
+		decoded = m_readyTextures.front();
+		m_readyTextures.pop_front();
+		ReleaseDecodedTexture(decoded);
+	}
+
+	m_requests.clear();
+	if (NULL != m_pCache)
+	{
+		delete m_pCache;
+		m_pCache = NULL;
+	}
+}
+
+/***********************************************************
+ *  SetCacheDirectory()
+ *
+ *  This method is used for enabling the on-disk cache of
+ *  decoded mip chains.  Cached images are memory mapped and
+ *  uploaded level by level instead of being decoded.
+ ***********************************************************/
+void TextureLoader::SetCacheDirectory(const char* directory)
+{
+	if (NULL != m_pCache)
+	{
+		delete m_pCache;
+		m_pCache = NULL;
+	}
+	if ((NULL != directory) && (directory[0] != 0))
+	{
+		m_pCache = new TextureCache(directory);
+	}
+}
+
+/***********************************************************
+ *  SetCompressedDirectory()
+ *
+ *  This method is used for enabling block compressed images
+ *  written by the offline TextureCompressor tool.  An image
+ *  with a current .bctex file in the directory, in a format
+ *  the driver supports, is mapped and uploaded compressed
+ *  instead of being decoded.
+ ***********************************************************/
+void TextureLoader::SetCompressedDirectory(const char* directory, unsigned int formatMask)
+{
+	m_compressedDirectory = (NULL != directory) ? directory : "";
+	m_compressedFormatMask = formatMask;
+}
+
+/***********************************************************
+ *  AddTexture()
+ *
+ *  This method is used for queueing an image file to be
+ *  decoded the next time LoadTextures() is called.
+ ***********************************************************/
+void TextureLoader::AddTexture(const char* filename, std::string tag)
+{
+	TEXTURE_REQUEST request;
+	request.filename = filename;
+	request.tag = tag;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_requests.push_back(request);
+	}
+	m_requestCondition.notify_one();
+}
+
+/***********************************************************
+ *  BeginLoading()
+ *
+ *  This method is used for starting the worker threads.
+ *  They decode every queued image and then wait for more
+ *  images to be added until FinishLoading is called.
+ ***********************************************************/
+void TextureLoader::BeginLoading()
+{
+	if (m_workers.empty() == false)
+	{
+		return;
+	}
+
+	// indicate to always flip images vertically when loaded - this
+	// is set before any worker starts since it is shared by stb_image
+	stbi_set_flip_vertically_on_load(true);
+
+	m_bStopping = false;
+	for (int i = 0; i < m_workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&TextureLoader::DecodeWorker, this));
+	}
+}
+
+/***********************************************************
+ *  FinishLoading()
+ *
+ *  This method is used for stopping the worker threads once
+ *  they finish the images they are decoding.
+ ***********************************************************/
+void TextureLoader::FinishLoading()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+	m_requestCondition.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+}
+
+/***********************************************************
+ *  DecodeWorker()
+ *
+ *  This method runs on each worker thread, decoding the next
+ *  undecoded request and queueing the result for the
+ *  loading thread.
+ ***********************************************************/
+void TextureLoader::DecodeWorker()
+{
+	PROFILE_THREAD_NAME("Texture decoder");
+
+	while (true)
+	{
+		int index = 0;
+		std::string filename;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_requestCondition.wait(lock, [this]()
+				{
+					return m_bStopping || (m_nextRequest < (int)m_requests.size());
+				});
+			if (m_nextRequest >= (int)m_requests.size())
+			{
+				return;
+			}
+			index = m_nextRequest++;
+			filename = m_requests[index].filename;
+		}
+
+		DECODED_TEXTURE decoded;
+		Clock::time_point decodeStart = Clock::now();
+		DecodeTexture(index, filename, decoded);
+		decoded.decodeMilliseconds = MillisecondsSince(decodeStart);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_readyTextures.push_back(decoded);
+		}
+		m_readyCondition.notify_one();
+	}
+}
+
+/***********************************************************
+ *  GetDecodedTexture()
+ *
+ *  This method is used for taking the next decoded image
+ *  off the ready queue.  Without waiting it returns false
+ *  right away when nothing is ready, so it can be polled
+ *  every frame.
+ ***********************************************************/
+bool TextureLoader::GetDecodedTexture(DECODED_TEXTURE& decoded, bool bWait)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (bWait == true)
+	{
+		if (m_handedOutCount >= (int)m_requests.size())
+		{
+			return(false);
+		}
+		m_readyCondition.wait(lock, [this]() { return !m_readyTextures.empty(); });
+	}
+	else if (m_readyTextures.empty() == true)
+	{
+		return(false);
+	}
+
+	decoded = m_readyTextures.front();
+	m_readyTextures.pop_front();
+	m_handedOutCount++;
+	return(true);
+}
+
+/***********************************************************
+ *  ReleaseDecodedTexture()
+ *
+ *  This method is used for freeing the image data of a
+ *  decoded image once it has been uploaded.
+ ***********************************************************/
+void TextureLoader::ReleaseDecodedTexture(DECODED_TEXTURE& decoded)
+{
+	if (NULL != decoded.pMipChain)
+	{
+		delete decoded.pMipChain;
+		decoded.pMipChain = NULL;
+	}
+	if (NULL != decoded.pCompressed)
+	{
+		delete decoded.pCompressed;
+		decoded.pCompressed = NULL;
+	}
+	if (NULL != decoded.pImage)
+	{
+		stbi_image_free(decoded.pImage);
+		decoded.pImage = NULL;
+	}
+	decoded.pixels = NULL;
+}
+
+/***********************************************************
+ *  GetPendingCount()
+ *
+ *  This method is used for getting the number of added
+ *  images that have not been handed out as decoded yet.
+ ***********************************************************/
+int TextureLoader::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return (int)m_requests.size() - m_handedOutCount;
+}
+
+/***********************************************************
+ *  DecodeTexture()
+ *
+ *  This method is used for decoding one queued image file.
+ *  When the cache is enabled a current cache file is mapped
+ *  instead, and a freshly decoded image has its mip chain
+ *  built and written to the cache for the next launch.
+ ***********************************************************/
+void TextureLoader::DecodeTexture(int requestIndex, const std::string& filename, DECODED_TEXTURE& decoded)
+{
+	PROFILE_SCOPE("DecodeTexture");
+
+	decoded.requestIndex = requestIndex;
+	decoded.pixels = NULL;
+	decoded.width = 0;
+	decoded.height = 0;
+	decoded.colorChannels = 0;
+	decoded.mipLevels = 1;
+	decoded.bFromCache = false;
+	decoded.compressedFormat = CompressedTexture::FORMAT_NONE;
+	decoded.pImage = NULL;
+	decoded.pMipChain = NULL;
+	decoded.pCompressed = NULL;
+
+	if ((m_compressedDirectory.empty() == false) && (LoadCompressedTexture(filename, decoded) == true))
+	{
+		return;
+	}
+
+	if (NULL != m_pCache)
+	{
+		TextureCache::MIP_CHAIN* pMipChain = new TextureCache::MIP_CHAIN();
+		if (m_pCache->Load(filename, *pMipChain) == true)
+		{
+			decoded.bFromCache = true;
+		}
+		else
+		{
+			unsigned char* image = stbi_load(
+				filename.c_str(),
+				&decoded.width,
+				&decoded.height,
+				&decoded.colorChannels,
+				0);
+			if ((NULL != image) && ((decoded.colorChannels == 3) || (decoded.colorChannels == 4)))
+			{
+				TextureCache::BuildMipChain(image, decoded.width, decoded.height, decoded.colorChannels, *pMipChain);
+				m_pCache->Store(filename, *pMipChain);
+				stbi_image_free(image);
+			}
+			else
+			{
+				// leave unsupported images to the uncached upload path
+				decoded.pImage = image;
+				decoded.pixels = image;
+				delete pMipChain;
+				return;
+			}
+		}
+
+		decoded.pMipChain = pMipChain;
+		decoded.pixels = pMipChain->pixels;
+		decoded.width = pMipChain->width;
+		decoded.height = pMipChain->height;
+		decoded.colorChannels = 4;
+		decoded.mipLevels = pMipChain->levelCount;
+		return;
+	}
+
+	decoded.pImage = stbi_load(
+		filename.c_str(),
+		&decoded.width,
+		&decoded.height,
+		&decoded.colorChannels,
+		0);
+	decoded.pixels = decoded.pImage;
+}
+
+/***********************************************************
+ *  LoadCompressedTexture()
+ *
+ *  This method is used for mapping the block compressed file
+ *  of an image.  The file is only used when its format can
+ *  be uploaded and it was compressed from a source image of
+ *  the current size and modification time, otherwise the
+ *  image is decoded.
+ ***********************************************************/
+bool TextureLoader::LoadCompressedTexture(const std::string& filename, DECODED_TEXTURE& decoded)
+{
+	uint64_t sourceSize = 0;
+	int64_t sourceModifiedTime = 0;
+	if (TextureCache::GetSourceInfo(filename, sourceSize, sourceModifiedTime) == false)
+	{
+		return(false);
+	}
+
+	std::filesystem::path sourcePath(filename);
+
+	std::filesystem::path compressedPath = std::filesystem::path(m_compressedDirectory) /
+		sourcePath.stem().concat(".bctex");
+	CompressedTexture* pCompressed = new CompressedTexture();
+	if ((pCompressed->Open(compressedPath.string().c_str()) == false) ||
+		((m_compressedFormatMask & (1u << pCompressed->GetFormat())) == 0) ||
+		(pCompressed->GetSourceSize() != sourceSize) ||
+		(pCompressed->GetSourceModifiedTime() != sourceModifiedTime))
+	{
+		delete pCompressed;
+		return(false);
+	}
+
+	decoded.pCompressed = pCompressed;
+	decoded.compressedFormat = pCompressed->GetFormat();
+	decoded.pixels = pCompressed->GetBlocks();
+	decoded.width = pCompressed->GetWidth();
+	decoded.height = pCompressed->GetHeight();
+	decoded.colorChannels = (decoded.compressedFormat == CompressedTexture::FORMAT_BC1) ? 3 : 4;
+	decoded.mipLevels = pCompressed->GetLevelCount();
+	decoded.bFromCache = false;
+	return(true);
+}
+
+/***********************************************************
+ *  LoadTextures()
+ *
+ *  This method is used for decoding all the queued image
+ *  files on the worker threads.  The calling thread waits
+ *  for decoded images and passes each one to the upload
+ *  callback in the order they finish, then frees the image
+ *  data.  The decode and upload time of every texture is
+ *  reported along with the total load time.  Returns the
+ *  number of textures that were successfully uploaded.
+ ***********************************************************/
+int TextureLoader::LoadTextures(const UploadCallback& uploadTexture)
+{
+	const int requestCount = GetPendingCount();
+	if (requestCount == 0)
+	{
+		return(0);
+	}
+
+	Clock::time_point loadStart = Clock::now();
+	BeginLoading();
+
+	// upload each decoded image on this thread as soon as it is ready
+	int uploadedTextures = 0;
+	int cacheHits = 0;
+	int compressedCount = 0;
+	double totalDecodeMilliseconds = 0.0;
+	double totalUploadMilliseconds = 0.0;
+	DECODED_TEXTURE decoded;
+	while (GetDecodedTexture(decoded, true) == true)
+	{
+		const TEXTURE_REQUEST& request = m_requests[decoded.requestIndex];
+		totalDecodeMilliseconds += decoded.decodeMilliseconds;
+
+		if (NULL == decoded.pixels)
+		{
+			std::cout << "Could not load image:" << request.filename << std::endl;
+			continue;
+		}
+
+		Clock::time_point uploadStart = Clock::now();
+		bool bUploaded = uploadTexture(request, decoded);
+		double uploadMilliseconds = MillisecondsSince(uploadStart);
+		totalUploadMilliseconds += uploadMilliseconds;
+
+		// free the image data from local memory
+		ReleaseDecodedTexture(decoded);
+
+		if (bUploaded == true)
+		{
+			uploadedTextures++;
+		}
+		const char* source = "decode ";
+		if (decoded.compressedFormat != CompressedTexture::FORMAT_NONE)
+		{
+			compressedCount++;
+			source = "compressed map ";
+		}
+		else if (decoded.bFromCache == true)
+		{
+			cacheHits++;
+			source = "cache map ";
+		}
+
+		std::cout << std::fixed << std::setprecision(2)
+			<< "Texture " << request.tag << ": " << source
+			<< decoded.decodeMilliseconds << " ms, upload " << uploadMilliseconds << " ms" << std::endl;
+	}
+
+	FinishLoading();
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< "Loaded " << uploadedTextures << " of " << requestCount << " textures in "
+		<< MillisecondsSince(loadStart) << " ms using " << m_workerCount << " decode threads (decode total "
+		<< totalDecodeMilliseconds << " ms, upload total " << totalUploadMilliseconds << " ms)" << std::endl;
+	if (m_compressedDirectory.empty() == false)
+	{
+		std::cout << "Block compressed textures: " << compressedCount << " of " << requestCount << std::endl;
+	}
+	if (NULL != m_pCache)
+	{
+		std::cout << "Texture cache: " << cacheHits << " hits, " << (requestCount - compressedCount - cacheHits)
+			<< " misses (" << ((cacheHits + compressedCount == requestCount) ? "warm" : "cold") << " start)" << std::endl;
+	}
+
+	return(uploadedTextures);
+}
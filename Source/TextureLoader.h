@@ -0,0 +1,123 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.h
+// ============
+// decode texture image files on worker threads so that the thread
+// owning the OpenGL context only has to upload the decoded pixels
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "CompressedTexture.h"
+#include "TextureCache.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  TextureLoader
+ *
+ *  This class decodes a list of texture image files on a
+ *  pool of worker threads.  As each image finishes decoding
+ *  it is handed back to the calling (OpenGL context) thread
+ *  for uploading, so decoding and uploading overlap.  Images
+ *  can be loaded all at once with LoadTextures, or streamed
+ *  by adding them while the workers run and polling for the
+ *  decoded results every frame.
+ ***********************************************************/
+class TextureLoader
+{
+public:
+	// constructor - zero worker threads means one per CPU core
+	TextureLoader(int workerCount = 0);
+	// destructor
+	~TextureLoader();
+
+	struct TEXTURE_REQUEST
+	{
+		std::string filename;
+		std::string tag;
+	};
+
+	struct DECODED_TEXTURE
+	{
+		int requestIndex;
+		// base level pixels, followed by the rest of the mip
+		// chain when mipLevels is greater than one
+		const unsigned char* pixels;
+		int width;
+		int height;
+		int colorChannels;
+		int mipLevels;
+		bool bFromCache;
+		double decodeMilliseconds;
+		// block compression format of the pixels, or FORMAT_NONE
+		// when they are uncompressed
+		CompressedTexture::BLOCK_FORMAT compressedFormat;
+		// decoded image data that is freed after uploading
+		unsigned char* pImage;
+		TextureCache::MIP_CHAIN* pMipChain;
+		CompressedTexture* pCompressed;
+	};
+
+	// called on the loading thread for every decoded image
+	typedef std::function<bool(const TEXTURE_REQUEST&, const DECODED_TEXTURE&)> UploadCallback;
+
+	// keep decoded mip chains in the passed in cache directory
+	void SetCacheDirectory(const char* directory);
+	// prefer the block compressed files in the passed in directory
+	// for images whose format is in the mask (1 << BLOCK_FORMAT)
+	void SetCompressedDirectory(const char* directory, unsigned int formatMask);
+	// queue an image file to be decoded and associated with the tag
+	void AddTexture(const char* filename, std::string tag);
+	// decode all queued images and upload them as they become ready
+	int LoadTextures(const UploadCallback& uploadTexture);
+
+	// start the worker threads decoding queued and later added images
+	void BeginLoading();
+	// get the next decoded image, if one is ready - when waiting, this
+	// only returns false once every added image has been handed out
+	bool GetDecodedTexture(DECODED_TEXTURE& decoded, bool bWait);
+	// free the image data of a decoded image after it is uploaded
+	void ReleaseDecodedTexture(DECODED_TEXTURE& decoded);
+	// stop and join the worker threads
+	void FinishLoading();
+	// get the request that a decoded image belongs to
+	const TEXTURE_REQUEST& GetRequest(int requestIndex) const { return m_requests[requestIndex]; }
+	// get the number of added images not yet handed out as decoded
+	int GetPendingCount();
+
+private:
+	// number of worker threads used for decoding
+	int m_workerCount;
+	// every image file added, indexed by request index
+	std::deque<TEXTURE_REQUEST> m_requests;
+	// cache of decoded mip chains, if enabled
+	TextureCache* m_pCache;
+	// directory of block compressed images and the formats the
+	// driver can upload, if enabled
+	std::string m_compressedDirectory;
+	unsigned int m_compressedFormatMask;
+
+	// worker threads and the state they share with the loading thread
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_requestCondition;
+	std::condition_variable m_readyCondition;
+	std::deque<DECODED_TEXTURE> m_readyTextures;
+	int m_nextRequest;
+	int m_handedOutCount;
+	bool m_bStopping;
+
+	// decode queued images until the loader is stopped
+	void DecodeWorker();
+	// decode one image, using the cache when it is enabled
+	void DecodeTexture(int requestIndex, const std::string& filename, DECODED_TEXTURE& decoded);
+	// map the block compressed file of the image, if it is usable
+	bool LoadCompressedTexture(const std::string& filename, DECODED_TEXTURE& decoded);
+};
@@ -0,0 +1,309 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureresidency.cpp
+// ============
+// own the OpenGL texture objects and keep their memory within a budget
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureResidency.h"
+
+#include <iomanip>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// convert bytes to megabytes for reporting
+	double ToMegabytes(size_t byteCount)
+	{
+		return (double)byteCount / (1024.0 * 1024.0);
+	}
+}
+
+/***********************************************************
+ *  GLTexture()
+ *
+ *  The move constructor takes over the other texture object.
+ ***********************************************************/
+GLTexture::GLTexture(GLTexture&& other) noexcept
+{
+	m_textureID = other.m_textureID;
+	other.m_textureID = 0;
+}
+
+/***********************************************************
+ *  operator=()
+ *
+ *  Move assignment deletes the current texture object and
+ *  takes over the other one.
+ ***********************************************************/
+GLTexture& GLTexture::operator=(GLTexture&& other) noexcept
+{
+	if (this != &other)
+	{
+		Reset();
+		m_textureID = other.m_textureID;
+		other.m_textureID = 0;
+	}
+	return *this;
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used for deleting the owned texture object.
+ ***********************************************************/
+void GLTexture::Reset()
+{
+	if (m_textureID != 0)
+	{
+		glDeleteTextures(1, &m_textureID);
+		m_textureID = 0;
+	}
+}
+
+/***********************************************************
+ *  TextureResidencyManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureResidencyManager::TextureResidencyManager()
+{
+	m_budgetBytes = 0;
+	m_currentBytes = 0;
+	m_peakBytes = 0;
+	m_evictionCount = 0;
+	m_reloadCount = 0;
+}
+
+/***********************************************************
+ *  ~TextureResidencyManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureResidencyManager::~TextureResidencyManager()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  SetBudget()
+ *
+ *  This method is used for setting the most bytes of texture
+ *  memory that may be resident.  Textures are evicted right
+ *  away if the current usage is over the new budget.
+ ***********************************************************/
+void TextureResidencyManager::SetBudget(size_t budgetBytes)
+{
+	m_budgetBytes = budgetBytes;
+	EnforceBudget(-1);
+}
+
+/***********************************************************
+ *  SetReloadCallback()
+ *
+ *  This method is used for setting the callback that reloads
+ *  an evicted texture when it is needed again.
+ ***********************************************************/
+void TextureResidencyManager::SetReloadCallback(const ReloadCallback& reloadTexture)
+{
+	m_reloadTexture = reloadTexture;
+}
+
+/***********************************************************
+ *  MakeResident()
+ *
+ *  This method is used for storing a loaded texture object
+ *  and recording it as the most recently used texture.
+ ***********************************************************/
+void TextureResidencyManager::MakeResident(int residencyID, GLTexture texture, size_t byteCount)
+{
+	RESIDENT_TEXTURE& resident = m_textures[residencyID];
+	resident.texture = std::move(texture);
+	resident.byteCount = byteCount;
+	resident.bResident = true;
+	if (resident.bPinned == false)
+	{
+		m_lruList.push_front(residencyID);
+		resident.lruPosition = m_lruList.begin();
+	}
+
+	m_currentBytes += byteCount;
+	if (m_currentBytes > m_peakBytes)
+	{
+		m_peakBytes = m_currentBytes;
+	}
+}
+
+/***********************************************************
+ *  Adopt()
+ *
+ *  This method is used for taking ownership of a loaded
+ *  texture object.  The returned residency ID is assigned in
+ *  adoption order and is used to acquire the texture later.
+ ***********************************************************/
+int TextureResidencyManager::Adopt(GLTexture texture, size_t byteCount, bool bPinned)
+{
+	int residencyID = (int)m_textures.size();
+	m_textures.push_back(RESIDENT_TEXTURE());
+	m_textures[residencyID].bResident = false;
+	m_textures[residencyID].bPinned = bPinned;
+	m_textures[residencyID].byteCount = 0;
+
+	MakeResident(residencyID, std::move(texture), byteCount);
+	EnforceBudget(residencyID);
+
+	return(residencyID);
+}
+
+/***********************************************************
+ *  Acquire()
+ *
+ *  This method is used for getting the texture object with
+ *  the passed in residency ID and marking it as the most
+ *  recently used.  An evicted texture is reloaded first, in
+ *  which case bReloaded is set since its object has changed.
+ ***********************************************************/
+GLuint TextureResidencyManager::Acquire(int residencyID, bool& bReloaded)
+{
+	bReloaded = false;
+	if ((residencyID < 0) || (residencyID >= (int)m_textures.size()))
+	{
+		return(0);
+	}
+
+	RESIDENT_TEXTURE& resident = m_textures[residencyID];
+	if (resident.bResident == true)
+	{
+		// move the texture to the front of the used list
+		if ((resident.bPinned == false) && (resident.lruPosition != m_lruList.begin()))
+		{
+			m_lruList.splice(m_lruList.begin(), m_lruList, resident.lruPosition);
+		}
+		return(resident.texture.GetID());
+	}
+
+	if (!m_reloadTexture)
+	{
+		return(0);
+	}
+
+	size_t byteCount = 0;
+	GLTexture texture = m_reloadTexture(residencyID, byteCount);
+	if (texture.GetID() == 0)
+	{
+		return(0);
+	}
+
+	m_reloadCount++;
+	bReloaded = true;
+	MakeResident(residencyID, std::move(texture), byteCount);
+	EnforceBudget(residencyID);
+
+	return(m_textures[residencyID].texture.GetID());
+}
+
+/***********************************************************
+ *  EnforceBudget()
+ *
+ *  This method is used for deleting the least recently used
+ *  textures until the resident textures fit in the budget.
+ *  The texture with the passed in ID is never evicted, so a
+ *  texture that was just acquired stays usable.
+ ***********************************************************/
+void TextureResidencyManager::EnforceBudget(int keepResidencyID)
+{
+	if (m_budgetBytes == 0)
+	{
+		return;
+	}
+
+	while ((m_currentBytes > m_budgetBytes) && (m_lruList.empty() == false))
+	{
+		int residencyID = m_lruList.back();
+		if (residencyID == keepResidencyID)
+		{
+			// only the kept texture is left to evict
+			if (m_lruList.size() == 1)
+			{
+				break;
+			}
+			m_lruList.splice(m_lruList.begin(), m_lruList, std::prev(m_lruList.end()));
+			continue;
+		}
+
+		RESIDENT_TEXTURE& resident = m_textures[residencyID];
+		m_lruList.pop_back();
+		resident.texture.Reset();
+		resident.bResident = false;
+		m_currentBytes -= resident.byteCount;
+		m_evictionCount++;
+	}
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for deleting every owned texture.
+ ***********************************************************/
+void TextureResidencyManager::Clear()
+{
+	m_lruList.clear();
+	m_textures.clear();
+	m_currentBytes = 0;
+}
+
+/***********************************************************
+ *  PrintStatistics()
+ *
+ *  This method is used for reporting the texture memory usage
+ *  so deployments can be sized.
+ ***********************************************************/
+void TextureResidencyManager::PrintStatistics() const
+{
+	int residentCount = 0;
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		if (m_textures[i].bResident == true)
+		{
+			residentCount++;
+		}
+	}
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< "Texture memory: " << ToMegabytes(m_currentBytes) << " MB current, "
+		<< ToMegabytes(m_peakBytes) << " MB peak, budget ";
+	if (m_budgetBytes == 0)
+	{
+		std::cout << "unlimited";
+	}
+	else
+	{
+		std::cout << ToMegabytes(m_budgetBytes) << " MB";
+	}
+	std::cout << " (" << residentCount << " of " << m_textures.size() << " textures resident, "
+		<< m_evictionCount << " evictions, " << m_reloadCount << " reloads)" << std::endl;
+}
+
+/***********************************************************
+ *  CalculateTextureBytes()
+ *
+ *  This method is used for getting the bytes used by a
+ *  texture with the passed in size, including every level
+ *  of its mip chain.
+ ***********************************************************/
+size_t TextureResidencyManager::CalculateTextureBytes(int width, int height, int bytesPerTexel, int layers)
+{
+	size_t byteCount = 0;
+	while (true)
+	{
+		byteCount += (size_t)width * height * bytesPerTexel;
+		if ((width == 1) && (height == 1))
+		{
+			break;
+		}
+		width = (width > 1) ? width / 2 : 1;
+		height = (height > 1) ? height / 2 : 1;
+	}
+	return(byteCount * layers);
+}
@@ -0,0 +1,123 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureresidency.h
+// ============
+// own the OpenGL texture objects and keep their memory within a budget
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <vector>
+
+/***********************************************************
+ *  GLTexture
+ *
+ *  This class owns one OpenGL texture object and deletes it
+ *  when it goes out of scope.  It can be moved but not copied.
+ ***********************************************************/
+class GLTexture
+{
+public:
+	// constructor - takes ownership of the texture object
+	explicit GLTexture(GLuint textureID = 0) { m_textureID = textureID; }
+	// destructor
+	~GLTexture() { Reset(); }
+
+	GLTexture(GLTexture&& other) noexcept;
+	GLTexture& operator=(GLTexture&& other) noexcept;
+
+	// get the owned texture object
+	GLuint GetID() const { return m_textureID; }
+	// delete the owned texture object
+	void Reset();
+
+private:
+	// texture objects cannot be copied
+	GLTexture(const GLTexture&);
+	GLTexture& operator=(const GLTexture&);
+
+	// owned OpenGL texture object
+	GLuint m_textureID;
+};
+
+/***********************************************************
+ *  TextureResidencyManager
+ *
+ *  This class owns every texture object of the scene and
+ *  tracks how much texture memory each one uses, including
+ *  its mipmaps.  When a budget is set and the resident
+ *  textures exceed it, the least recently used textures are
+ *  deleted.  An evicted texture is reloaded through the
+ *  reload callback the next time it is acquired.
+ ***********************************************************/
+class TextureResidencyManager
+{
+public:
+	// constructor
+	TextureResidencyManager();
+	// destructor
+	~TextureResidencyManager();
+
+	// called to recreate an evicted texture, setting its size in bytes
+	typedef std::function<GLTexture(int residencyID, size_t& byteCount)> ReloadCallback;
+
+	// set the maximum bytes of resident textures - zero means unlimited
+	void SetBudget(size_t budgetBytes);
+	// set the callback used for reloading evicted textures
+	void SetReloadCallback(const ReloadCallback& reloadTexture);
+
+	// take ownership of a texture, returning its residency ID - pinned
+	// textures are never evicted but still count against the budget
+	int Adopt(GLTexture texture, size_t byteCount, bool bPinned = false);
+	// get the texture object, reloading it if it was evicted
+	GLuint Acquire(int residencyID, bool& bReloaded);
+	// delete every texture
+	void Clear();
+
+	// get the bytes of texture memory currently resident
+	size_t GetCurrentBytes() const { return m_currentBytes; }
+	// get the most bytes of texture memory that were ever resident
+	size_t GetPeakBytes() const { return m_peakBytes; }
+	// print the memory usage, eviction and reload counts
+	void PrintStatistics() const;
+
+	// get the bytes used by a texture and its complete mip chain
+	static size_t CalculateTextureBytes(int width, int height, int bytesPerTexel, int layers = 1);
+
+private:
+	struct RESIDENT_TEXTURE
+	{
+		GLTexture texture;
+		size_t byteCount;
+		bool bResident;
+		bool bPinned;
+		// position in the least recently used list
+		std::list<int>::iterator lruPosition;
+	};
+
+	// every adopted texture, indexed by residency ID
+	std::vector<RESIDENT_TEXTURE> m_textures;
+	// resident evictable textures, most recently used first
+	std::list<int> m_lruList;
+	// callback used for reloading evicted textures
+	ReloadCallback m_reloadTexture;
+
+	// memory budget and usage in bytes
+	size_t m_budgetBytes;
+	size_t m_currentBytes;
+	size_t m_peakBytes;
+	// number of evictions and reloads
+	int m_evictionCount;
+	int m_reloadCount;
+
+	// record the texture as resident and used most recently
+	void MakeResident(int residencyID, GLTexture texture, size_t byteCount);
+	// evict least recently used textures until within the budget
+	void EnforceBudget(int keepResidencyID);
+};
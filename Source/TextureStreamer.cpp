@@ -0,0 +1,386 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreamer.cpp
+// ============
+// stream textures in while the scene renders, uploading the decoded
+// pixels asynchronously through a ring of pixel buffer objects
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureStreamer.h"
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+/***********************************************************
+ *  TextureStreamer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureStreamer::TextureStreamer(
+	UPLOAD_MODE uploadMode,
+	int pixelBufferCount,
+	size_t bytesPerFrame) :
+	m_loader(2)
+{
+	m_uploadMode = uploadMode;
+	m_bytesPerFrame = bytesPerFrame;
+	m_nextPixelBuffer = 0;
+	m_requestedCount = 0;
+	m_completedCount = 0;
+	m_uploadedBytes = 0;
+
+	if (m_uploadMode == UPLOAD_PBO)
+	{
+		m_pixelBuffers.resize(pixelBufferCount);
+		for (int i = 0; i < pixelBufferCount; i++)
+		{
+			glGenBuffers(1, &m_pixelBuffers[i].bufferID);
+			m_pixelBuffers[i].capacity = 0;
+			m_pixelBuffers[i].fence = 0;
+			m_pixelBuffers[i].textureID = 0;
+			m_pixelBuffers[i].width = 0;
+			m_pixelBuffers[i].height = 0;
+			m_pixelBuffers[i].requestIndex = -1;
+		}
+	}
+
+	m_loader.BeginLoading();
+}
+
+/***********************************************************
+ *  ~TextureStreamer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureStreamer::~TextureStreamer()
+{
+	m_loader.FinishLoading();
+
+	for (size_t i = 0; i < m_pixelBuffers.size(); i++)
+	{
+		if (0 != m_pixelBuffers[i].fence)
+		{
+			glDeleteSync(m_pixelBuffers[i].fence);
+			glDeleteTextures(1, &m_pixelBuffers[i].textureID);
+		}
+		glDeleteBuffers(1, &m_pixelBuffers[i].bufferID);
+	}
+	m_pixelBuffers.clear();
+}
+
+/***********************************************************
+ *  SetCacheDirectory()
+ *
+ *  This method is used for enabling the decoded texture
+ *  cache for the streamed image files.
+ ***********************************************************/
+void TextureStreamer::SetCacheDirectory(const char* directory)
+{
+	m_loader.SetCacheDirectory(directory);
+}
+
+/***********************************************************
+ *  SetCompleteCallback()
+ *
+ *  This method is used for setting the callback that takes
+ *  ownership of each texture once its upload has finished.
+ ***********************************************************/
+void TextureStreamer::SetCompleteCallback(const CompleteCallback& textureComplete)
+{
+	m_textureComplete = textureComplete;
+}
+
+/***********************************************************
+ *  StreamTexture()
+ *
+ *  This method is used for queueing an image file to be
+ *  decoded in the background and uploaded over the next
+ *  frames.
+ ***********************************************************/
+void TextureStreamer::StreamTexture(const char* filename, std::string tag)
+{
+	m_loader.AddTexture(filename, tag);
+	m_requestedCount++;
+}
+
+/***********************************************************
+ *  GetPendingCount()
+ *
+ *  This method is used for getting the number of queued
+ *  textures that have not reached the completion callback.
+ ***********************************************************/
+int TextureStreamer::GetPendingCount()
+{
+	return(m_requestedCount - m_completedCount);
+}
+
+/***********************************************************
+ *  GetImageBytes()
+ *
+ *  This method is used for getting the size of the image
+ *  data in a decoded image, including its mip chain.
+ ***********************************************************/
+size_t TextureStreamer::GetImageBytes(const TextureLoader::DECODED_TEXTURE& decoded)
+{
+	if (decoded.mipLevels > 1)
+	{
+		return TextureCache::GetMipChainSize(decoded.width, decoded.height, decoded.mipLevels);
+	}
+	return (size_t)decoded.width * decoded.height * decoded.colorChannels;
+}
+
+/***********************************************************
+ *  CreateTexture()
+ *
+ *  This method is used for allocating the texture storage
+ *  and uploading the image data.  The pixels are either a
+ *  client memory pointer or an offset into the bound pixel
+ *  unpack buffer.  A single level image has its mipmaps
+ *  generated on the GPU.
+ ***********************************************************/
+GLuint TextureStreamer::CreateTexture(const TextureLoader::DECODED_TEXTURE& decoded, const unsigned char* pixels)
+{
+	GLuint textureID = 0;
+	GLenum format = (decoded.colorChannels == 4) ? GL_RGBA : GL_RGB;
+	GLenum internalFormat = (decoded.colorChannels == 4) ? GL_RGBA8 : GL_RGB8;
+
+	int levelCount = 1;
+	while (((decoded.width >> levelCount) > 0) || ((decoded.height >> levelCount) > 0))
+	{
+		levelCount++;
+	}
+
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glTexStorage2D(GL_TEXTURE_2D, levelCount, internalFormat, decoded.width, decoded.height);
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	if (decoded.mipLevels > 1)
+	{
+		const unsigned char* level = pixels;
+		int levelWidth = decoded.width;
+		int levelHeight = decoded.height;
+		for (int i = 0; (i < decoded.mipLevels) && (i < levelCount); i++)
+		{
+			glTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, levelWidth, levelHeight, format, GL_UNSIGNED_BYTE, level);
+			level += (size_t)levelWidth * levelHeight * decoded.colorChannels;
+			levelWidth = (levelWidth > 1) ? levelWidth / 2 : 1;
+			levelHeight = (levelHeight > 1) ? levelHeight / 2 : 1;
+		}
+	}
+	else
+	{
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, decoded.width, decoded.height, format, GL_UNSIGNED_BYTE, pixels);
+		// generate the texture mipmaps for mapping textures to lower resolutions
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	return(textureID);
+}
+
+/***********************************************************
+ *  StartUpload()
+ *
+ *  This method is used for copying decoded image data into
+ *  a free pixel buffer and starting the texture upload from
+ *  it.  A fence is placed after the upload so its completion
+ *  can be polled later.  Returns the bytes uploaded.
+ ***********************************************************/
+size_t TextureStreamer::StartUpload(PIXEL_BUFFER& pixelBuffer, TextureLoader::DECODED_TEXTURE& decoded)
+{
+	size_t byteCount = GetImageBytes(decoded);
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer.bufferID);
+	if (pixelBuffer.capacity < byteCount)
+	{
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, byteCount, NULL, GL_STREAM_DRAW);
+		pixelBuffer.capacity = byteCount;
+	}
+
+	// the buffer's previous upload has finished, so it can be
+	// overwritten without waiting on the driver
+	void* pMapped = glMapBufferRange(
+		GL_PIXEL_UNPACK_BUFFER,
+		0,
+		byteCount,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (NULL == pMapped)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return(0);
+	}
+	memcpy(pMapped, decoded.pixels, byteCount);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	// with a pixel unpack buffer bound the pixel pointer is a buffer offset
+	pixelBuffer.textureID = CreateTexture(decoded, (const unsigned char*)0);
+	pixelBuffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	pixelBuffer.width = decoded.width;
+	pixelBuffer.height = decoded.height;
+	pixelBuffer.requestIndex = decoded.requestIndex;
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	return(byteCount);
+}
+
+/***********************************************************
+ *  UploadSynchronous()
+ *
+ *  This method is used for uploading decoded image data
+ *  straight from client memory, which waits for the driver
+ *  to copy it.  Returns the bytes uploaded.
+ ***********************************************************/
+size_t TextureStreamer::UploadSynchronous(TextureLoader::DECODED_TEXTURE& decoded)
+{
+	GLuint textureID = CreateTexture(decoded, decoded.pixels);
+
+	m_completedCount++;
+	if (m_textureComplete)
+	{
+		m_textureComplete(m_loader.GetRequest(decoded.requestIndex), GLTexture(textureID), decoded.width, decoded.height);
+	}
+	else
+	{
+		glDeleteTextures(1, &textureID);
+	}
+
+	return GetImageBytes(decoded);
+}
+
+/***********************************************************
+ *  RetireUploads()
+ *
+ *  This method is used for checking the fences of the uploads
+ *  in flight without blocking, and passing every finished
+ *  texture to the completion callback.
+ ***********************************************************/
+void TextureStreamer::RetireUploads()
+{
+	for (size_t i = 0; i < m_pixelBuffers.size(); i++)
+	{
+		PIXEL_BUFFER& pixelBuffer = m_pixelBuffers[i];
+		if (0 == pixelBuffer.fence)
+		{
+			continue;
+		}
+
+		GLenum status = glClientWaitSync(pixelBuffer.fence, 0, 0);
+		if ((status != GL_ALREADY_SIGNALED) && (status != GL_CONDITION_SATISFIED))
+		{
+			continue;
+		}
+
+		glDeleteSync(pixelBuffer.fence);
+		pixelBuffer.fence = 0;
+		m_completedCount++;
+
+		if (m_textureComplete)
+		{
+			m_textureComplete(
+				m_loader.GetRequest(pixelBuffer.requestIndex),
+				GLTexture(pixelBuffer.textureID),
+				pixelBuffer.width,
+				pixelBuffer.height);
+		}
+		else
+		{
+			glDeleteTextures(1, &pixelBuffer.textureID);
+		}
+		pixelBuffer.textureID = 0;
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for advancing the streaming once per
+ *  frame.  Finished uploads are retired, then decoded images
+ *  are uploaded until the per-frame byte limit is reached or
+ *  no pixel buffer is free.
+ ***********************************************************/
+void TextureStreamer::Update()
+{
+	RetireUploads();
+
+	size_t frameBytes = 0;
+	while (frameBytes < m_bytesPerFrame)
+	{
+		PIXEL_BUFFER* pPixelBuffer = NULL;
+		if (m_uploadMode == UPLOAD_PBO)
+		{
+			// find the next pixel buffer with no upload in flight
+			for (size_t i = 0; (i < m_pixelBuffers.size()) && (NULL == pPixelBuffer); i++)
+			{
+				int index = (m_nextPixelBuffer + (int)i) % (int)m_pixelBuffers.size();
+				if (0 == m_pixelBuffers[index].fence)
+				{
+					pPixelBuffer = &m_pixelBuffers[index];
+					m_nextPixelBuffer = (index + 1) % (int)m_pixelBuffers.size();
+				}
+			}
+			if (NULL == pPixelBuffer)
+			{
+				break;
+			}
+		}
+
+		TextureLoader::DECODED_TEXTURE decoded;
+		if (m_loader.GetDecodedTexture(decoded, false) == false)
+		{
+			break;
+		}
+
+		if ((NULL == decoded.pixels) || ((decoded.colorChannels != 3) && (decoded.colorChannels != 4)))
+		{
+			std::cout << "Could not stream image:" << m_loader.GetRequest(decoded.requestIndex).filename << std::endl;
+			m_loader.ReleaseDecodedTexture(decoded);
+			m_completedCount++;
+			continue;
+		}
+
+		size_t byteCount = 0;
+		if (NULL != pPixelBuffer)
+		{
+			byteCount = StartUpload(*pPixelBuffer, decoded);
+		}
+		else
+		{
+			byteCount = UploadSynchronous(decoded);
+		}
+		if (byteCount == 0)
+		{
+			std::cout << "Could not map pixel buffer for:" << m_loader.GetRequest(decoded.requestIndex).filename << std::endl;
+			m_completedCount++;
+		}
+
+		m_loader.ReleaseDecodedTexture(decoded);
+		frameBytes += byteCount;
+		m_uploadedBytes += byteCount;
+	}
+}
+
+/***********************************************************
+ *  PrintStatistics()
+ *
+ *  This method is used for reporting how many textures and
+ *  bytes have been streamed.
+ ***********************************************************/
+void TextureStreamer::PrintStatistics() const
+{
+	std::cout << std::fixed << std::setprecision(2)
+		<< "Texture streaming (" << ((m_uploadMode == UPLOAD_PBO) ? "PBO" : "synchronous") << "): "
+		<< m_completedCount << " of " << m_requestedCount << " textures, "
+		<< (double)m_uploadedBytes / (1024.0 * 1024.0) << " MB uploaded" << std::endl;
+}
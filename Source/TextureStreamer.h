@@ -0,0 +1,111 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreamer.h
+// ============
+// stream textures in while the scene renders, uploading the decoded
+// pixels asynchronously through a ring of pixel buffer objects
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureLoader.h"
+#include "TextureResidency.h"
+
+#include <GL/glew.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  TextureStreamer
+ *
+ *  This class loads textures during the render loop.  Image
+ *  files are decoded on worker threads, and every frame a
+ *  limited number of bytes is copied into free pixel buffer
+ *  objects and handed to glTexSubImage2D from there, so the
+ *  driver copies the data without stalling the frame.  A
+ *  fence marks when each upload has finished, after which
+ *  the texture is passed to the completion callback.  The
+ *  synchronous mode uploads straight from client memory for
+ *  comparison.
+ ***********************************************************/
+class TextureStreamer
+{
+public:
+	enum UPLOAD_MODE
+	{
+		UPLOAD_SYNCHRONOUS,
+		UPLOAD_PBO
+	};
+
+	// constructor
+	TextureStreamer(
+		UPLOAD_MODE uploadMode = UPLOAD_PBO,
+		int pixelBufferCount = 4,
+		size_t bytesPerFrame = 8 * 1024 * 1024);
+	// destructor
+	~TextureStreamer();
+
+	// called when a streamed texture is ready for drawing
+	typedef std::function<void(const TextureLoader::TEXTURE_REQUEST& request, GLTexture texture, int width, int height)> CompleteCallback;
+
+	// keep decoded mip chains in the passed in cache directory
+	void SetCacheDirectory(const char* directory);
+	// set the callback that receives finished textures
+	void SetCompleteCallback(const CompleteCallback& textureComplete);
+	// queue an image file to be streamed in
+	void StreamTexture(const char* filename, std::string tag);
+	// retire finished uploads and start new ones - call once per frame
+	void Update();
+
+	// get the number of textures not yet passed to the callback
+	int GetPendingCount();
+	// get the upload mode
+	UPLOAD_MODE GetUploadMode() const { return m_uploadMode; }
+	// print the number of streamed textures and bytes
+	void PrintStatistics() const;
+
+private:
+	struct PIXEL_BUFFER
+	{
+		GLuint bufferID;
+		size_t capacity;
+		// fence of the upload in flight, or zero when free
+		GLsync fence;
+		// texture being uploaded from the buffer
+		GLuint textureID;
+		int width;
+		int height;
+		int requestIndex;
+	};
+
+	// decoder of the streamed image files
+	TextureLoader m_loader;
+	// ring of pixel buffer objects used for uploads
+	std::vector<PIXEL_BUFFER> m_pixelBuffers;
+	// next pixel buffer to try
+	int m_nextPixelBuffer;
+	// how textures are uploaded
+	UPLOAD_MODE m_uploadMode;
+	// upper limit of bytes uploaded per frame
+	size_t m_bytesPerFrame;
+	// callback that receives finished textures
+	CompleteCallback m_textureComplete;
+	// number of textures queued and completed
+	int m_requestedCount;
+	int m_completedCount;
+	// total bytes uploaded
+	size_t m_uploadedBytes;
+
+	// create and fill a texture from decoded image data
+	GLuint CreateTexture(const TextureLoader::DECODED_TEXTURE& decoded, const unsigned char* pixels);
+	// pass finished uploads to the completion callback
+	void RetireUploads();
+	// start an upload through a free pixel buffer
+	size_t StartUpload(PIXEL_BUFFER& pixelBuffer, TextureLoader::DECODED_TEXTURE& decoded);
+	// upload straight from client memory
+	size_t UploadSynchronous(TextureLoader::DECODED_TEXTURE& decoded);
+	// get the bytes of image data in a decoded image
+	static size_t GetImageBytes(const TextureLoader::DECODED_TEXTURE& decoded);
+};
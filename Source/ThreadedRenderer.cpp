@@ -0,0 +1,184 @@
+///////////////////////////////////////////////////////////////////////////////
+// threadedrenderer.cpp
+// ============
+// update the scene on the main thread and draw it on a render thread,
+// handing frames between them through a triple buffer
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ThreadedRenderer.h"
+
+#include "FrameCapture.h"
+#include "Profiler.h"
+#include "ViewManager.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// get the elapsed milliseconds since the passed in time
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+}
+
+/***********************************************************
+ *  ThreadedRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ThreadedRenderer::ThreadedRenderer(GLFWwindow* pWindow, SceneManager* pSceneManager, ViewManager* pViewManager, FrameCapture* pFrameCapture)
+{
+	m_pWindow = pWindow;
+	m_pSceneManager = pSceneManager;
+	m_pViewManager = pViewManager;
+	m_pFrameCapture = pFrameCapture;
+	for (int i = 0; i < TripleBuffer::SLOT_COUNT; i++)
+	{
+		m_snapshots[i].instanceCount = 0;
+		m_framebufferWidths[i] = 0;
+		m_framebufferHeights[i] = 0;
+	}
+	m_updateFrames = 0;
+	m_renderFrames = 0;
+	m_updateMilliseconds = 0.0;
+	m_renderMilliseconds = 0.0;
+	m_runSeconds = 0.0;
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for running the update loop.  The
+ *  context is handed to the render thread, then each pass
+ *  polls the events, moves the camera and updates the scene
+ *  into the write slot, and publishes it once the render
+ *  thread has taken the previous one.  Closing the window
+ *  stops both threads and takes the context back.
+ ***********************************************************/
+void ThreadedRenderer::Run()
+{
+	Clock::time_point runStart = Clock::now();
+
+	// a context can only be current on one thread at a time
+	glfwMakeContextCurrent(NULL);
+	m_renderThread = std::thread(&ThreadedRenderer::RenderWorker, this);
+
+	while (!glfwWindowShouldClose(m_pWindow))
+	{
+		glfwPollEvents();
+
+		PROFILE_SCOPE("UpdateFrame");
+		Clock::time_point updateStart = Clock::now();
+		const int slot = m_snapshotBuffer.GetWriteSlot();
+		SceneManager::FRAME_SNAPSHOT& snapshot = m_snapshots[slot];
+
+		m_pViewManager->UpdateSceneView();
+		snapshot.view = m_pViewManager->GetViewMatrix();
+		snapshot.projection = m_pViewManager->GetProjectionMatrix();
+		snapshot.viewPosition = m_pViewManager->GetViewPosition();
+		glfwGetFramebufferSize(m_pWindow, &m_framebufferWidths[slot], &m_framebufferHeights[slot]);
+
+		m_pSceneManager->SetViewPosition(snapshot.viewPosition);
+		m_pSceneManager->SetViewProjection(snapshot.projection * snapshot.view);
+		m_pSceneManager->UpdateScene(snapshot);
+		m_updateMilliseconds += MillisecondsSince(updateStart);
+
+		if (m_snapshotBuffer.WaitForReader() == false)
+		{
+			break;
+		}
+		m_snapshotBuffer.Publish();
+		m_updateFrames++;
+	}
+
+	m_snapshotBuffer.Stop();
+	m_renderThread.join();
+	glfwMakeContextCurrent(m_pWindow);
+
+	m_runSeconds = MillisecondsSince(runStart) / 1000.0;
+}
+
+/***********************************************************
+ *  RenderWorker()
+ *
+ *  This method runs on the render thread, drawing each
+ *  snapshot it takes with the view it was made with.  The
+ *  texture streaming uploads here too, since it needs the
+ *  context, and the frame is captured before the swap.
+ ***********************************************************/
+void ThreadedRenderer::RenderWorker()
+{
+	glfwMakeContextCurrent(m_pWindow);
+	PROFILE_THREAD_NAME("Render");
+
+	while (m_snapshotBuffer.Acquire(true) == true)
+	{
+		PROFILE_SCOPE("RenderFrame");
+		Clock::time_point renderStart = Clock::now();
+		const int slot = m_snapshotBuffer.GetReadSlot();
+		const SceneManager::FRAME_SNAPSHOT& snapshot = m_snapshots[slot];
+
+		m_pSceneManager->UpdateTextureStreaming();
+
+		{
+			PROFILE_GPU_SCOPE("Frame");
+
+			// Enable z-depth
+			glEnable(GL_DEPTH_TEST);
+
+			// Clear the frame and z buffers
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			m_pViewManager->ApplyView(snapshot.view, snapshot.projection, snapshot.viewPosition);
+			m_pSceneManager->RenderSnapshot(snapshot);
+
+			if ((NULL != m_pFrameCapture) && (m_pFrameCapture->IsCapturing() == true))
+			{
+				m_pFrameCapture->CaptureFrame(m_framebufferWidths[slot], m_framebufferHeights[slot]);
+			}
+		}
+		m_renderMilliseconds += MillisecondsSince(renderStart);
+
+		// Flips the the back buffer with the front buffer every frame.
+		{
+			PROFILE_SCOPE("SwapBuffers");
+			glfwSwapBuffers(m_pWindow);
+		}
+		PROFILE_GPU_FRAME();
+		m_renderFrames++;
+	}
+
+	glfwMakeContextCurrent(NULL);
+}
+
+/***********************************************************
+ *  PrintStatistics()
+ *
+ *  This method is used for printing the frames drawn and,
+ *  per frame, the time each thread was busy and the time it
+ *  waited for the other.  The render thread's time outside
+ *  of both is spent in the swap.
+ ***********************************************************/
+void ThreadedRenderer::PrintStatistics() const
+{
+	if ((m_updateFrames == 0) || (m_renderFrames == 0) || (m_runSeconds <= 0.0))
+	{
+		return;
+	}
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< "Threaded rendering over " << m_runSeconds << " s on " << std::thread::hardware_concurrency() << " cores: "
+		<< m_renderFrames << " frames drawn, " << (m_renderFrames / m_runSeconds) << " frames per second" << std::endl;
+	std::cout << "  update thread " << (m_updateMilliseconds / m_updateFrames) << " ms busy and "
+		<< (m_snapshotBuffer.GetWriterWaitMilliseconds() / m_updateFrames) << " ms waiting per frame" << std::endl;
+	std::cout << "  render thread " << (m_renderMilliseconds / m_renderFrames) << " ms busy and "
+		<< (m_snapshotBuffer.GetReaderWaitMilliseconds() / m_renderFrames) << " ms waiting per frame" << std::endl;
+}
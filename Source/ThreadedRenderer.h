@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////////////
+// threadedrenderer.h
+// ============
+// update the scene on the main thread and draw it on a render thread,
+// handing frames between them through a triple buffer
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+#include "TripleBuffer.h"
+
+// GLFW library
+#include "GLFW/glfw3.h"
+
+#include <thread>
+
+class FrameCapture;
+class ViewManager;
+
+/***********************************************************
+ *  ThreadedRenderer
+ *
+ *  This class runs the render loop on two threads.  The
+ *  main thread, which GLFW needs for its events, polls the
+ *  input, moves the camera and updates and culls the scene
+ *  into a frame snapshot.  A render thread holding the
+ *  OpenGL context takes the newest snapshot, draws it and
+ *  swaps, so the scene work of one frame overlaps the
+ *  submission of the last.  The busy and waiting time of
+ *  both threads is kept, so how the frame splits between
+ *  them and what a second core gains can be measured.
+ ***********************************************************/
+class ThreadedRenderer
+{
+public:
+	// constructor - the frame capture is optional
+	ThreadedRenderer(GLFWwindow* pWindow, SceneManager* pSceneManager, ViewManager* pViewManager, FrameCapture* pFrameCapture);
+
+	// run the update loop on this thread and draw on the render
+	// thread until the window is closed - the context is current on
+	// this thread again when it returns
+	void Run();
+	// print the frames of both threads and where their time went
+	void PrintStatistics() const;
+
+private:
+	GLFWwindow* m_pWindow;
+	SceneManager* m_pSceneManager;
+	ViewManager* m_pViewManager;
+	FrameCapture* m_pFrameCapture;
+
+	// snapshots the update thread fills and the render thread draws
+	SceneManager::FRAME_SNAPSHOT m_snapshots[TripleBuffer::SLOT_COUNT];
+	// framebuffer size when each snapshot was made, since GLFW only
+	// answers on the main thread
+	int m_framebufferWidths[TripleBuffer::SLOT_COUNT];
+	int m_framebufferHeights[TripleBuffer::SLOT_COUNT];
+	TripleBuffer m_snapshotBuffer;
+	std::thread m_renderThread;
+
+	// frames and busy time of each thread, and the time of the run
+	long long m_updateFrames;
+	long long m_renderFrames;
+	double m_updateMilliseconds;
+	double m_renderMilliseconds;
+	double m_runSeconds;
+
+	// draw the newest snapshots until the update loop stops
+	void RenderWorker();
+
+	// threaded renderers cannot be copied
+	ThreadedRenderer(const ThreadedRenderer&);
+	ThreadedRenderer& operator=(const ThreadedRenderer&);
+};
@@ -0,0 +1,491 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformbatch.cpp
+// ============
+// build the model and normal matrices of many objects at once from
+// arrays of scale, rotation and position
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TransformBatch.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define TRANSFORM_BATCH_SSE2
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
+
+// AVX2 code is compiled for its own functions only and chosen at run time
+#if defined(TRANSFORM_BATCH_SSE2) && (defined(_MSC_VER) || defined(__GNUC__))
+#define TRANSFORM_BATCH_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TRANSFORM_BATCH_AVX2_FUNCTION
+#else
+#define TRANSFORM_BATCH_AVX2_FUNCTION __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+static_assert(sizeof(glm::mat4) == 16 * sizeof(float), "mat4 must be 16 packed floats");
+static_assert(sizeof(glm::mat3) == 9 * sizeof(float), "mat3 must be 9 packed floats");
+
+// declaration of global variables
+namespace
+{
+	const float g_DegreesToRadians = 0.017453292519943295f;
+
+	// pi / 2 split in three parts, so subtracting whole quarter turns
+	// from an angle loses no precision
+	const float g_HalfPiPart1 = 1.5703125f;
+	const float g_HalfPiPart2 = 4.837512969970703125e-4f;
+	const float g_HalfPiPart3 = 7.54978995489188216e-8f;
+	const float g_TwoOverPi = 0.63661977236758134f;
+
+	// minimax polynomials of sine and cosine within a quarter turn
+	const float g_Sin1 = -1.6666654611e-1f;
+	const float g_Sin2 = 8.3321608736e-3f;
+	const float g_Sin3 = -1.9515295891e-4f;
+	const float g_Cos1 = 4.166664568298827e-2f;
+	const float g_Cos2 = -1.388731625493765e-3f;
+	const float g_Cos3 = 2.443315711809948e-5f;
+
+	TransformBatch::SIMD_LEVEL g_SimdLevel = TransformBatch::GetSupportedSimdLevel();
+
+	/***********************************************************
+	 *  ComputeOne()
+	 *
+	 *  Builds the matrices of one object with the closed form
+	 *  of translation * Rx * Ry * Rz * scale.  The normal
+	 *  matrix of a rotation times a scale is the rotation
+	 *  divided by the scale.
+	 ***********************************************************/
+	void ComputeOne(const TransformBatch::TRANSFORM_ARRAYS& transforms, int i, glm::mat4* pModels, glm::mat3* pNormals)
+	{
+		float ax = transforms.pRotation[0][i] * g_DegreesToRadians;
+		float ay = transforms.pRotation[1][i] * g_DegreesToRadians;
+		float az = transforms.pRotation[2][i] * g_DegreesToRadians;
+		float sinX = sinf(ax), cosX = cosf(ax);
+		float sinY = sinf(ay), cosY = cosf(ay);
+		float sinZ = sinf(az), cosZ = cosf(az);
+
+		// rotation[row][column]
+		float rotation[3][3] =
+		{
+			{ cosY * cosZ, -cosY * sinZ, sinY },
+			{ cosX * sinZ + sinX * sinY * cosZ, cosX * cosZ - sinX * sinY * sinZ, -sinX * cosY },
+			{ sinX * sinZ - cosX * sinY * cosZ, sinX * cosZ + cosX * sinY * sinZ, cosX * cosY },
+		};
+
+		float* pModel = (float*)(pModels + i);
+		for (int column = 0; column < 3; column++)
+		{
+			float scale = transforms.pScale[column][i];
+			pModel[column * 4 + 0] = rotation[0][column] * scale;
+			pModel[column * 4 + 1] = rotation[1][column] * scale;
+			pModel[column * 4 + 2] = rotation[2][column] * scale;
+			pModel[column * 4 + 3] = 0.0f;
+		}
+		pModel[12] = transforms.pPosition[0][i];
+		pModel[13] = transforms.pPosition[1][i];
+		pModel[14] = transforms.pPosition[2][i];
+		pModel[15] = 1.0f;
+
+		if (NULL != pNormals)
+		{
+			float* pNormal = (float*)(pNormals + i);
+			for (int column = 0; column < 3; column++)
+			{
+				float inverseScale = 1.0f / transforms.pScale[column][i];
+				pNormal[column * 3 + 0] = rotation[0][column] * inverseScale;
+				pNormal[column * 3 + 1] = rotation[1][column] * inverseScale;
+				pNormal[column * 3 + 2] = rotation[2][column] * inverseScale;
+			}
+		}
+	}
+
+#ifdef TRANSFORM_BATCH_SSE2
+	/***********************************************************
+	 *  SinCos4()
+	 *
+	 *  Computes the sine and cosine of four angles in radians,
+	 *  reducing each to within a quarter turn of zero and
+	 *  swapping and negating the results by quadrant.
+	 ***********************************************************/
+	void SinCos4(__m128 angle, __m128& sine, __m128& cosine)
+	{
+		__m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(angle, _mm_set1_ps(g_TwoOverPi)));
+		__m128 turns = _mm_cvtepi32_ps(quadrant);
+		__m128 x = _mm_sub_ps(angle, _mm_mul_ps(turns, _mm_set1_ps(g_HalfPiPart1)));
+		x = _mm_sub_ps(x, _mm_mul_ps(turns, _mm_set1_ps(g_HalfPiPart2)));
+		x = _mm_sub_ps(x, _mm_mul_ps(turns, _mm_set1_ps(g_HalfPiPart3)));
+		__m128 x2 = _mm_mul_ps(x, x);
+
+		__m128 s = _mm_add_ps(_mm_mul_ps(x2, _mm_set1_ps(g_Sin3)), _mm_set1_ps(g_Sin2));
+		s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(g_Sin1));
+		s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, x2), x), x);
+
+		__m128 c = _mm_add_ps(_mm_mul_ps(x2, _mm_set1_ps(g_Cos3)), _mm_set1_ps(g_Cos2));
+		c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(g_Cos1));
+		c = _mm_mul_ps(_mm_mul_ps(c, x2), x2);
+		c = _mm_add_ps(_mm_sub_ps(c, _mm_mul_ps(x2, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+		// odd quadrants swap sine and cosine
+		__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+		__m128 sineValue = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+		__m128 cosineValue = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+
+		// move bit 1 of the quadrant into the sign bit
+		__m128i sineSign = _mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30);
+		__m128i cosineSign = _mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30);
+		sine = _mm_xor_ps(sineValue, _mm_castsi128_ps(sineSign));
+		cosine = _mm_xor_ps(cosineValue, _mm_castsi128_ps(cosineSign));
+	}
+
+	/***********************************************************
+	 *  StoreColumns4()
+	 *
+	 *  Writes one column of four matrices, given as one
+	 *  register per row with a lane per matrix.
+	 ***********************************************************/
+	void StoreColumns4(__m128 row0, __m128 row1, __m128 row2, __m128 row3, float* pFirst, int matrixFloats, int columnFloats)
+	{
+		_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+		if (columnFloats == 4)
+		{
+			_mm_storeu_ps(pFirst, row0);
+			_mm_storeu_ps(pFirst + matrixFloats, row1);
+			_mm_storeu_ps(pFirst + matrixFloats * 2, row2);
+			_mm_storeu_ps(pFirst + matrixFloats * 3, row3);
+		}
+		else
+		{
+			// a mat3 column is three floats, and a four float store
+			// would write past the last matrix
+			float columns[4][4];
+			_mm_storeu_ps(columns[0], row0);
+			_mm_storeu_ps(columns[1], row1);
+			_mm_storeu_ps(columns[2], row2);
+			_mm_storeu_ps(columns[3], row3);
+			for (int k = 0; k < 4; k++)
+			{
+				memcpy(pFirst + matrixFloats * k, columns[k], columnFloats * sizeof(float));
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  StoreRotationScale4()
+	 *
+	 *  Builds the rotation and scale columns, and optionally
+	 *  the normal matrix columns, of four matrices from their
+	 *  sines, cosines and scales.
+	 ***********************************************************/
+	void StoreRotationScale4(
+		__m128 sinX, __m128 cosX, __m128 sinY, __m128 cosY, __m128 sinZ, __m128 cosZ,
+		__m128 scaleX, __m128 scaleY, __m128 scaleZ,
+		float* pModel, float* pNormal)
+	{
+		__m128 sinXsinY = _mm_mul_ps(sinX, sinY);
+		__m128 cosXsinY = _mm_mul_ps(cosX, sinY);
+		__m128 zero = _mm_setzero_ps();
+
+		// rotation columns, one register per row
+		__m128 r00 = _mm_mul_ps(cosY, cosZ);
+		__m128 r10 = _mm_add_ps(_mm_mul_ps(cosX, sinZ), _mm_mul_ps(sinXsinY, cosZ));
+		__m128 r20 = _mm_sub_ps(_mm_mul_ps(sinX, sinZ), _mm_mul_ps(cosXsinY, cosZ));
+		__m128 r01 = _mm_sub_ps(zero, _mm_mul_ps(cosY, sinZ));
+		__m128 r11 = _mm_sub_ps(_mm_mul_ps(cosX, cosZ), _mm_mul_ps(sinXsinY, sinZ));
+		__m128 r21 = _mm_add_ps(_mm_mul_ps(sinX, cosZ), _mm_mul_ps(cosXsinY, sinZ));
+		__m128 r02 = sinY;
+		__m128 r12 = _mm_sub_ps(zero, _mm_mul_ps(sinX, cosY));
+		__m128 r22 = _mm_mul_ps(cosX, cosY);
+
+		StoreColumns4(_mm_mul_ps(r00, scaleX), _mm_mul_ps(r10, scaleX), _mm_mul_ps(r20, scaleX), zero, pModel, 16, 4);
+		StoreColumns4(_mm_mul_ps(r01, scaleY), _mm_mul_ps(r11, scaleY), _mm_mul_ps(r21, scaleY), zero, pModel + 4, 16, 4);
+		StoreColumns4(_mm_mul_ps(r02, scaleZ), _mm_mul_ps(r12, scaleZ), _mm_mul_ps(r22, scaleZ), zero, pModel + 8, 16, 4);
+
+		if (NULL != pNormal)
+		{
+			__m128 one = _mm_set1_ps(1.0f);
+			__m128 inverseX = _mm_div_ps(one, scaleX);
+			__m128 inverseY = _mm_div_ps(one, scaleY);
+			__m128 inverseZ = _mm_div_ps(one, scaleZ);
+			StoreColumns4(_mm_mul_ps(r00, inverseX), _mm_mul_ps(r10, inverseX), _mm_mul_ps(r20, inverseX), zero, pNormal, 9, 3);
+			StoreColumns4(_mm_mul_ps(r01, inverseY), _mm_mul_ps(r11, inverseY), _mm_mul_ps(r21, inverseY), zero, pNormal + 3, 9, 3);
+			StoreColumns4(_mm_mul_ps(r02, inverseZ), _mm_mul_ps(r12, inverseZ), _mm_mul_ps(r22, inverseZ), zero, pNormal + 6, 9, 3);
+		}
+	}
+
+	/***********************************************************
+	 *  ComputeSSE2()
+	 *
+	 *  Builds the matrices of four objects at a time from the
+	 *  passed in first object, returning the index after the
+	 *  last object done.
+	 ***********************************************************/
+	int ComputeSSE2(const TransformBatch::TRANSFORM_ARRAYS& transforms, int first, int count, glm::mat4* pModels, glm::mat3* pNormals)
+	{
+		const __m128 toRadians = _mm_set1_ps(g_DegreesToRadians);
+		int i = first;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 sinX, cosX, sinY, cosY, sinZ, cosZ;
+			SinCos4(_mm_mul_ps(_mm_loadu_ps(transforms.pRotation[0] + i), toRadians), sinX, cosX);
+			SinCos4(_mm_mul_ps(_mm_loadu_ps(transforms.pRotation[1] + i), toRadians), sinY, cosY);
+			SinCos4(_mm_mul_ps(_mm_loadu_ps(transforms.pRotation[2] + i), toRadians), sinZ, cosZ);
+
+			float* pModel = (float*)(pModels + i);
+			StoreRotationScale4(sinX, cosX, sinY, cosY, sinZ, cosZ,
+				_mm_loadu_ps(transforms.pScale[0] + i),
+				_mm_loadu_ps(transforms.pScale[1] + i),
+				_mm_loadu_ps(transforms.pScale[2] + i),
+				pModel,
+				(NULL != pNormals) ? (float*)(pNormals + i) : NULL);
+			StoreColumns4(
+				_mm_loadu_ps(transforms.pPosition[0] + i),
+				_mm_loadu_ps(transforms.pPosition[1] + i),
+				_mm_loadu_ps(transforms.pPosition[2] + i),
+				_mm_set1_ps(1.0f),
+				pModel + 12, 16, 4);
+		}
+		return(i);
+	}
+#endif
+
+#ifdef TRANSFORM_BATCH_AVX2
+	/***********************************************************
+	 *  SinCos8()
+	 *
+	 *  Computes the sine and cosine of eight angles in radians
+	 *  the same way as SinCos4, with fused multiply-adds.
+	 ***********************************************************/
+	TRANSFORM_BATCH_AVX2_FUNCTION
+	void SinCos8(__m256 angle, __m256& sine, __m256& cosine)
+	{
+		__m256i quadrant = _mm256_cvtps_epi32(_mm256_mul_ps(angle, _mm256_set1_ps(g_TwoOverPi)));
+		__m256 turns = _mm256_cvtepi32_ps(quadrant);
+		__m256 x = _mm256_fnmadd_ps(turns, _mm256_set1_ps(g_HalfPiPart1), angle);
+		x = _mm256_fnmadd_ps(turns, _mm256_set1_ps(g_HalfPiPart2), x);
+		x = _mm256_fnmadd_ps(turns, _mm256_set1_ps(g_HalfPiPart3), x);
+		__m256 x2 = _mm256_mul_ps(x, x);
+
+		__m256 s = _mm256_fmadd_ps(x2, _mm256_set1_ps(g_Sin3), _mm256_set1_ps(g_Sin2));
+		s = _mm256_fmadd_ps(s, x2, _mm256_set1_ps(g_Sin1));
+		s = _mm256_fmadd_ps(_mm256_mul_ps(s, x2), x, x);
+
+		__m256 c = _mm256_fmadd_ps(x2, _mm256_set1_ps(g_Cos3), _mm256_set1_ps(g_Cos2));
+		c = _mm256_fmadd_ps(c, x2, _mm256_set1_ps(g_Cos1));
+		c = _mm256_mul_ps(_mm256_mul_ps(c, x2), x2);
+		c = _mm256_add_ps(_mm256_fnmadd_ps(x2, _mm256_set1_ps(0.5f), c), _mm256_set1_ps(1.0f));
+
+		__m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(quadrant, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+		__m256 sineValue = _mm256_blendv_ps(s, c, swap);
+		__m256 cosineValue = _mm256_blendv_ps(c, s, swap);
+
+		__m256i sineSign = _mm256_slli_epi32(_mm256_and_si256(quadrant, _mm256_set1_epi32(2)), 30);
+		__m256i cosineSign = _mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(quadrant, _mm256_set1_epi32(1)), _mm256_set1_epi32(2)), 30);
+		sine = _mm256_xor_ps(sineValue, _mm256_castsi256_ps(sineSign));
+		cosine = _mm256_xor_ps(cosineValue, _mm256_castsi256_ps(cosineSign));
+	}
+
+	/***********************************************************
+	 *  ComputeAVX2()
+	 *
+	 *  Builds the matrices of eight objects at a time from the
+	 *  passed in first object, returning the index after the
+	 *  last object done.  The sines and cosines are computed
+	 *  eight wide, and each half is stored with the four wide
+	 *  column writes.
+	 ***********************************************************/
+	TRANSFORM_BATCH_AVX2_FUNCTION
+	int ComputeAVX2(const TransformBatch::TRANSFORM_ARRAYS& transforms, int first, int count, glm::mat4* pModels, glm::mat3* pNormals)
+	{
+		const __m256 toRadians = _mm256_set1_ps(g_DegreesToRadians);
+		int i = first;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 sinX, cosX, sinY, cosY, sinZ, cosZ;
+			SinCos8(_mm256_mul_ps(_mm256_loadu_ps(transforms.pRotation[0] + i), toRadians), sinX, cosX);
+			SinCos8(_mm256_mul_ps(_mm256_loadu_ps(transforms.pRotation[1] + i), toRadians), sinY, cosY);
+			SinCos8(_mm256_mul_ps(_mm256_loadu_ps(transforms.pRotation[2] + i), toRadians), sinZ, cosZ);
+
+			for (int half = 0; half < 2; half++)
+			{
+				int quad = i + half * 4;
+				float* pModel = (float*)(pModels + quad);
+				__m128 lowSinX = (half == 0) ? _mm256_castps256_ps128(sinX) : _mm256_extractf128_ps(sinX, 1);
+				__m128 lowCosX = (half == 0) ? _mm256_castps256_ps128(cosX) : _mm256_extractf128_ps(cosX, 1);
+				__m128 lowSinY = (half == 0) ? _mm256_castps256_ps128(sinY) : _mm256_extractf128_ps(sinY, 1);
+				__m128 lowCosY = (half == 0) ? _mm256_castps256_ps128(cosY) : _mm256_extractf128_ps(cosY, 1);
+				__m128 lowSinZ = (half == 0) ? _mm256_castps256_ps128(sinZ) : _mm256_extractf128_ps(sinZ, 1);
+				__m128 lowCosZ = (half == 0) ? _mm256_castps256_ps128(cosZ) : _mm256_extractf128_ps(cosZ, 1);
+
+				StoreRotationScale4(lowSinX, lowCosX, lowSinY, lowCosY, lowSinZ, lowCosZ,
+					_mm_loadu_ps(transforms.pScale[0] + quad),
+					_mm_loadu_ps(transforms.pScale[1] + quad),
+					_mm_loadu_ps(transforms.pScale[2] + quad),
+					pModel,
+					(NULL != pNormals) ? (float*)(pNormals + quad) : NULL);
+				StoreColumns4(
+					_mm_loadu_ps(transforms.pPosition[0] + quad),
+					_mm_loadu_ps(transforms.pPosition[1] + quad),
+					_mm_loadu_ps(transforms.pPosition[2] + quad),
+					_mm_set1_ps(1.0f),
+					pModel + 12, 16, 4);
+			}
+		}
+		return(i);
+	}
+
+	/***********************************************************
+	 *  IsAVX2Supported()
+	 *
+	 *  Checks that the processor and operating system support
+	 *  AVX2 and FMA.
+	 ***********************************************************/
+	bool IsAVX2Supported()
+	{
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+		{
+			return(false);
+		}
+		__cpuid(info, 1);
+		bool bFma = (info[2] & (1 << 12)) != 0;
+		bool bOsSaves = ((info[2] & (1 << 27)) != 0) && ((_xgetbv(0) & 0x6) == 0x6);
+		__cpuidex(info, 7, 0);
+		bool bAvx2 = (info[1] & (1 << 5)) != 0;
+		return(bFma && bOsSaves && bAvx2);
+#else
+		__builtin_cpu_init();
+		return (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) ? true : false;
+#endif
+	}
+#endif
+}
+
+/***********************************************************
+ *  Compute()
+ *
+ *  This method is used for building the model matrix, and
+ *  the normal matrix when asked for, of every object.  The
+ *  objects left over after the groups of eight and four are
+ *  built with the scalar path.
+ ***********************************************************/
+void TransformBatch::Compute(
+	const TRANSFORM_ARRAYS& transforms,
+	int count,
+	glm::mat4* pModels,
+	glm::mat3* pNormals)
+{
+	int done = 0;
+
+#ifdef TRANSFORM_BATCH_AVX2
+	if (g_SimdLevel == SIMD_AVX2)
+	{
+		done = ComputeAVX2(transforms, done, count, pModels, pNormals);
+	}
+#endif
+#ifdef TRANSFORM_BATCH_SSE2
+	if (g_SimdLevel >= SIMD_SSE2)
+	{
+		done = ComputeSSE2(transforms, done, count, pModels, pNormals);
+	}
+#endif
+
+	for (int i = done; i < count; i++)
+	{
+		ComputeOne(transforms, i, pModels, pNormals);
+	}
+}
+
+/***********************************************************
+ *  MultiplyAffine()
+ *
+ *  This method is used for multiplying two model matrices
+ *  whose last rows are 0 0 0 1, skipping the products with
+ *  that row.
+ ***********************************************************/
+void TransformBatch::MultiplyAffine(const glm::mat4& parent, const glm::mat4& local, glm::mat4& world)
+{
+	for (int column = 0; column < 4; column++)
+	{
+		glm::vec4 result = parent[0] * local[column][0] + parent[1] * local[column][1] + parent[2] * local[column][2];
+		if (column == 3)
+		{
+			result += parent[3];
+		}
+		world[column] = result;
+	}
+}
+
+/***********************************************************
+ *  SetSimdLevel()
+ *
+ *  This method is used for choosing the instruction set of
+ *  the batch, to compare the paths against each other.  A
+ *  level the processor does not have is lowered to the best
+ *  one it has.
+ ***********************************************************/
+void TransformBatch::SetSimdLevel(SIMD_LEVEL level)
+{
+	SIMD_LEVEL supported = GetSupportedSimdLevel();
+	g_SimdLevel = (level > supported) ? supported : level;
+}
+
+/***********************************************************
+ *  GetSimdLevel()
+ *
+ *  This method is used for getting the instruction set the
+ *  batch uses.
+ ***********************************************************/
+TransformBatch::SIMD_LEVEL TransformBatch::GetSimdLevel()
+{
+	return(g_SimdLevel);
+}
+
+/***********************************************************
+ *  GetSupportedSimdLevel()
+ *
+ *  This method is used for getting the best instruction set
+ *  that was compiled in and that the processor supports.
+ ***********************************************************/
+TransformBatch::SIMD_LEVEL TransformBatch::GetSupportedSimdLevel()
+{
+#ifdef TRANSFORM_BATCH_AVX2
+	static const bool bAVX2 = IsAVX2Supported();
+	if (bAVX2 == true)
+	{
+		return(SIMD_AVX2);
+	}
+#endif
+#ifdef TRANSFORM_BATCH_SSE2
+	return(SIMD_SSE2);
+#else
+	return(SIMD_SCALAR);
+#endif
+}
+
+/***********************************************************
+ *  GetSimdLevelName()
+ *
+ *  This method is used for getting the printable name of an
+ *  instruction set.
+ ***********************************************************/
+const char* TransformBatch::GetSimdLevelName(SIMD_LEVEL level)
+{
+	switch (level)
+	{
+	case SIMD_AVX2:
+		return("AVX2");
+	case SIMD_SSE2:
+		return("SSE2");
+	default:
+		return("scalar");
+	}
+}
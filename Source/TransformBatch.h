@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformbatch.h
+// ============
+// build the model and normal matrices of many objects at once from
+// arrays of scale, rotation and position
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  TransformBatch
+ *
+ *  This class builds model matrices in the same convention
+ *  as SetTransformations - translation * rotationX *
+ *  rotationY * rotationZ * scale - and their normal
+ *  matrices, for arrays of objects.  The inputs are laid
+ *  out as a structure of arrays, and each matrix is written
+ *  directly from the closed form product of the rotations
+ *  instead of multiplying five matrices.  The sines and
+ *  cosines of four or eight objects are computed at once
+ *  with SSE2 or AVX2, with a scalar path for the remainder
+ *  and for processors without them.
+ ***********************************************************/
+class TransformBatch
+{
+public:
+	enum SIMD_LEVEL
+	{
+		SIMD_SCALAR = 0,
+		SIMD_SSE2,
+		SIMD_AVX2
+	};
+
+	// the transforms of the objects, one array per component
+	struct TRANSFORM_ARRAYS
+	{
+		const float* pScale[3];
+		// rotation in degrees about the X, Y and Z axes
+		const float* pRotation[3];
+		const float* pPosition[3];
+	};
+
+	// build the matrices of the objects - the normal matrices are
+	// skipped when pNormals is NULL
+	static void Compute(
+		const TRANSFORM_ARRAYS& transforms,
+		int count,
+		glm::mat4* pModels,
+		glm::mat3* pNormals);
+	// multiply two model matrices whose last rows are 0 0 0 1
+	static void MultiplyAffine(const glm::mat4& parent, const glm::mat4& local, glm::mat4& world);
+
+	// choose the instruction set, limited to what the processor has
+	static void SetSimdLevel(SIMD_LEVEL level);
+	static SIMD_LEVEL GetSimdLevel();
+	// get the best instruction set the processor and build support
+	static SIMD_LEVEL GetSupportedSimdLevel();
+	static const char* GetSimdLevelName(SIMD_LEVEL level);
+};
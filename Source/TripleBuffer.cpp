@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+// triplebuffer.cpp
+// ============
+// hand whole frames of state from one thread to another through three
+// slots, so neither thread works on a slot the other is using
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TripleBuffer.h"
+
+#include <chrono>
+#include <utility>
+
+// declaration of global variables
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// get the elapsed milliseconds since the passed in time
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+}
+
+/***********************************************************
+ *  TripleBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TripleBuffer::TripleBuffer()
+{
+	m_writeSlot = 0;
+	m_readySlot = 1;
+	m_readSlot = 2;
+	m_bReadyIsNew = false;
+	m_bStopping = false;
+	m_publishCount = 0;
+	m_writerWaitMilliseconds = 0.0;
+	m_readerWaitMilliseconds = 0.0;
+}
+
+/***********************************************************
+ *  WaitForReader()
+ *
+ *  This method is used for holding the writer back until
+ *  the reader has taken the slot published last.
+ ***********************************************************/
+bool TripleBuffer::WaitForReader()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if ((m_bReadyIsNew == true) && (m_bStopping == false))
+	{
+		Clock::time_point waitStart = Clock::now();
+		m_takenCondition.wait(lock, [this]()
+			{
+				return m_bStopping || (m_bReadyIsNew == false);
+			});
+		m_writerWaitMilliseconds += MillisecondsSince(waitStart);
+	}
+	return(m_bStopping == false);
+}
+
+/***********************************************************
+ *  Publish()
+ *
+ *  This method is used for making the written slot the
+ *  newest.  The ready slot it replaces, which the reader is
+ *  not using, becomes the next one written.  The writer
+ *  waits for the reader first, so no published slot is
+ *  replaced before it is taken.
+ ***********************************************************/
+void TripleBuffer::Publish()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::swap(m_writeSlot, m_readySlot);
+		m_bReadyIsNew = true;
+		m_publishCount++;
+	}
+	m_publishedCondition.notify_one();
+}
+
+/***********************************************************
+ *  Acquire()
+ *
+ *  This method is used for swapping the reader's slot for
+ *  the newest published one.
+ ***********************************************************/
+bool TripleBuffer::Acquire(bool bWait)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if ((bWait == true) && (m_bReadyIsNew == false) && (m_bStopping == false))
+		{
+			Clock::time_point waitStart = Clock::now();
+			m_publishedCondition.wait(lock, [this]()
+				{
+					return m_bStopping || m_bReadyIsNew;
+				});
+			m_readerWaitMilliseconds += MillisecondsSince(waitStart);
+		}
+		if ((m_bReadyIsNew == false) || ((bWait == true) && (m_bStopping == true)))
+		{
+			return(false);
+		}
+		std::swap(m_readSlot, m_readySlot);
+		m_bReadyIsNew = false;
+	}
+	m_takenCondition.notify_one();
+	return(true);
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for ending the hand over, waking a
+ *  thread blocked on the other.
+ ***********************************************************/
+void TripleBuffer::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+	m_publishedCondition.notify_all();
+	m_takenCondition.notify_all();
+}
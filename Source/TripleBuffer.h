@@ -0,0 +1,79 @@
+///////////////////////////////////////////////////////////////////////////////
+// triplebuffer.h
+// ============
+// hand whole frames of state from one thread to another through three
+// slots, so neither thread works on a slot the other is using
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+/***********************************************************
+ *  TripleBuffer
+ *
+ *  This class hands the index of a slot from a writer
+ *  thread to a reader thread.  The caller keeps an array of
+ *  SLOT_COUNT slots.  The writer fills its slot and
+ *  publishes it, which swaps it with the ready slot, and
+ *  the reader takes the ready slot in exchange for the one
+ *  it has drawn, so the two never share a slot and only the
+ *  swaps are locked.  The reader always gets the newest
+ *  slot published.  The writer may wait for the reader to
+ *  take the last slot before publishing another, so it
+ *  runs at most one frame ahead and nothing it builds is
+ *  thrown away unread.
+ ***********************************************************/
+class TripleBuffer
+{
+public:
+	static const int SLOT_COUNT = 3;
+
+	// constructor
+	TripleBuffer();
+
+	// get the slot the writer fills
+	int GetWriteSlot() const { return m_writeSlot; }
+	// wait until the reader has taken the last published slot -
+	// returns false once stopped
+	bool WaitForReader();
+	// make the written slot the newest and write into the slot it replaces
+	void Publish();
+
+	// take the newest published slot, waiting for one when there is
+	// none yet - returns false when there is none and, if waiting,
+	// once stopped
+	bool Acquire(bool bWait);
+	// get the slot the reader has taken
+	int GetReadSlot() const { return m_readSlot; }
+
+	// wake both threads and make every wait return false
+	void Stop();
+
+	// get the number of slots published
+	long long GetPublishCount() const { return m_publishCount; }
+	// get the time each side spent waiting for the other
+	double GetWriterWaitMilliseconds() const { return m_writerWaitMilliseconds; }
+	double GetReaderWaitMilliseconds() const { return m_readerWaitMilliseconds; }
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_publishedCondition;
+	std::condition_variable m_takenCondition;
+	int m_writeSlot;
+	int m_readySlot;
+	int m_readSlot;
+	// true when the ready slot was published after the reader last took one
+	bool m_bReadyIsNew;
+	bool m_bStopping;
+
+	long long m_publishCount;
+	double m_writerWaitMilliseconds;
+	double m_readerWaitMilliseconds;
+
+	// triple buffers cannot be copied
+	TripleBuffer(const TripleBuffer&);
+	TripleBuffer& operator=(const TripleBuffer&);
+};
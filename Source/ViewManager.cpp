@@ -8,12 +8,15 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "ViewManager.h"
+#include "Profiler.h"
 
 // GLM Math Header inclusions
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>    
 
+#include <cstring>
+
 // declaration of the global variables and defines
 namespace
 {
@@ -46,6 +49,9 @@ namespace
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
 	bool bOrthographicProjection = false;
+
+	// true when the window asked for its contents to be drawn again
+	bool g_bWindowNeedsRedraw = true;
 }
 
 /***********************************************************
@@ -58,6 +64,11 @@ ViewManager::ViewManager(
 {
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_bViewChanged = true;
+	m_bMoving = false;
+	m_bTraceKeyDown = false;
 	m_pWindow = NULL;
 	g_pCamera = new Camera();
 	// default camera view parameters
@@ -99,6 +110,19 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 		WINDOW_HEIGHT,
 		windowTitle,
 		NULL, NULL);
+#ifndef __APPLE__
+	// Mesa's software renderer supports OpenGL 4.5 at most, which
+	// still covers every shader and draw call used by the scene
+	if (window == NULL)
+	{
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+		window = glfwCreateWindow(
+			WINDOW_WIDTH,
+			WINDOW_HEIGHT,
+			windowTitle,
+			NULL, NULL);
+	}
+#endif
 	if (window == NULL)
 	{
 		std::cout << "Failed to create GLFW window" << std::endl;
@@ -116,6 +140,11 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 	//set a callback for scrollwheel
 	glfwSetScrollCallback(window, &ViewManager::scroll_callback);
 
+	// these callbacks are used to redraw the window when it is
+	// exposed or resized while the scene is drawn on demand
+	glfwSetWindowRefreshCallback(window, &ViewManager::Window_Refresh_Callback);
+	glfwSetFramebufferSizeCallback(window, &ViewManager::Framebuffer_Size_Callback);
+
 	// enable blending for supporting tranparent rendering
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -134,6 +163,29 @@ void ViewManager::scroll_callback(GLFWwindow* window, double xoffset, double yof
 }
 
 
+/***********************************************************
+ *  Window_Refresh_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the contents of the window were damaged and need to be
+ *  drawn again.
+ ***********************************************************/
+void ViewManager::Window_Refresh_Callback(GLFWwindow* window)
+{
+	g_bWindowNeedsRedraw = true;
+}
+
+/***********************************************************
+ *  Framebuffer_Size_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the size of the window's framebuffer changes.
+ ***********************************************************/
+void ViewManager::Framebuffer_Size_Callback(GLFWwindow* window, int width, int height)
+{
+	g_bWindowNeedsRedraw = true;
+}
+
 /***********************************************************
  *  Mouse_Position_Callback()
  *
@@ -178,6 +230,25 @@ void ViewManager::ProcessKeyboardEvents()
 		glfwSetWindowShouldClose(m_pWindow, true);
 	}
 
+	// write the profile recorded so far once per press of F12
+	bool bTraceKeyDown = (glfwGetKey(m_pWindow, GLFW_KEY_F12) == GLFW_PRESS);
+	if ((bTraceKeyDown == true) && (m_bTraceKeyDown == false))
+	{
+		PROFILE_WRITE_TRACE();
+	}
+	m_bTraceKeyDown = bTraceKeyDown;
+
+	// the scene keeps being drawn while the camera is moved by a key
+	const int movementKeys[] = { GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_Q, GLFW_KEY_E };
+	m_bMoving = false;
+	for (int key : movementKeys)
+	{
+		if (glfwGetKey(m_pWindow, key) == GLFW_PRESS)
+		{
+			m_bMoving = true;
+		}
+	}
+
 	//setup WASD and QE controls with xy directional movement and z movement respectivly
 	//W(Forward)A(Left)S(Backward)D(Right)
 	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
@@ -233,6 +304,23 @@ void ViewManager::ProcessKeyboardEvents()
  ***********************************************************/
 void ViewManager::PrepareSceneView()
 {
+	UpdateSceneView();
+	ApplyView(m_viewMatrix, m_projectionMatrix, g_pCamera->Position);
+}
+
+/***********************************************************
+ *  UpdateSceneView()
+ *
+ *  This method is used for moving the camera by the waiting
+ *  keyboard events and working out the matrices of the
+ *  frame, without touching the shader.  It is the part of
+ *  PrepareSceneView that the update thread runs when the
+ *  frame is drawn by a render thread.
+ ***********************************************************/
+void ViewManager::UpdateSceneView()
+{
+	PROFILE_SCOPE("UpdateSceneView");
+
 	glm::mat4 view;
 	glm::mat4 projection;
 
@@ -251,6 +339,58 @@ void ViewManager::PrepareSceneView()
 	// define the current projection matrix
 	projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
 
+	SetViewMatrices(view, projection);
+}
+
+/***********************************************************
+ *  PrepareCameraView()
+ *
+ *  This method is used for preparing the scene view from a
+ *  camera placed by the caller, such as the cameras of a
+ *  headless batch render.  The keyboard and the frame timer
+ *  are left alone, and the camera is moved to the position
+ *  so the scene orders its draws from there.
+ ***********************************************************/
+void ViewManager::PrepareCameraView(const glm::vec3& position, const glm::vec3& target, float fieldOfView, float aspectRatio)
+{
+	g_pCamera->Position = position;
+	g_pCamera->Zoom = fieldOfView;
+
+	glm::mat4 view = glm::lookAt(position, target, glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(fieldOfView), aspectRatio, 0.1f, 100.0f);
+
+	SetViewMatrices(view, projection);
+	ApplyView(view, projection, position);
+}
+
+/***********************************************************
+ *  SetViewMatrices()
+ *
+ *  This method is used for keeping the matrices of the frame.
+ ***********************************************************/
+void ViewManager::SetViewMatrices(const glm::mat4& view, const glm::mat4& projection)
+{
+	// kept for the scene to cull against, and compared with the
+	// last frame's to find whether anything on screen moved
+	m_bViewChanged =
+		(memcmp(&view, &m_viewMatrix, sizeof(view)) != 0) ||
+		(memcmp(&projection, &m_projectionMatrix, sizeof(projection)) != 0);
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
+}
+
+/***********************************************************
+ *  ApplyView()
+ *
+ *  This method is used for setting the matrices and camera
+ *  position of a frame into the shader.  It reads nothing
+ *  but its arguments, so the render thread can set the
+ *  view of a snapshot while the camera moves on.
+ ***********************************************************/
+void ViewManager::ApplyView(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPosition) const
+{
+	PROFILE_SCOPE("ApplyView");
+
 	// if the shader manager object is valid
 	if (NULL != m_pShaderManager)
 	{
@@ -259,6 +399,44 @@ void ViewManager::PrepareSceneView()
 		// set the view matrix into the shader for proper rendering
 		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
 		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		m_pShaderManager->setVec3Value("viewPosition", viewPosition);
 	}
+}
+
+/***********************************************************
+ *  GetViewPosition()
+ *
+ *  This method is used for getting the world position of the
+ *  camera, so the scene can order its draws by distance.
+ ***********************************************************/
+glm::vec3 ViewManager::GetViewPosition() const
+{
+	return(g_pCamera->Position);
+}
+
+/***********************************************************
+ *  HasViewChanged()
+ *
+ *  This method is used for finding whether the scene has to
+ *  be drawn again for the view - when the camera moved in
+ *  the last PrepareSceneView, is being moved by a key, or
+ *  the window was exposed or resized.  The window's request
+ *  is answered once.
+ ***********************************************************/
+bool ViewManager::HasViewChanged()
+{
+	bool bChanged = (m_bViewChanged == true) || (m_bMoving == true) || (g_bWindowNeedsRedraw == true);
+	g_bWindowNeedsRedraw = false;
+	return(bChanged);
+}
+
+/***********************************************************
+ *  ResetFrameTimer()
+ *
+ *  This method is used for restarting the time the camera
+ *  moves by, after the render loop waited for events.
+ ***********************************************************/
+void ViewManager::ResetFrameTimer()
+{
+	gLastFrame = glfwGetTime();
 }
\ No newline at end of file
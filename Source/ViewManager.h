@@ -30,15 +30,30 @@ public:
 	//decalration for scroll callbac
 	static void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 
+	// window callbacks for when the contents must be drawn again
+	static void Window_Refresh_Callback(GLFWwindow* window);
+	static void Framebuffer_Size_Callback(GLFWwindow* window, int width, int height);
+
 
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// view and projection matrices of the current frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	// true when the matrices differ from the last frame's
+	bool m_bViewChanged;
+	// true while a key that moves the camera is held
+	bool m_bMoving;
+	// true while the key that writes the profile trace is held
+	bool m_bTraceKeyDown;
 
 	// process keyboard events for interaction with the 3D scene
 	void ProcessKeyboardEvents();
+	// keep the matrices of the frame
+	void SetViewMatrices(const glm::mat4& view, const glm::mat4& projection);
 
 public:
 	// create the initial OpenGL display window
@@ -46,4 +61,24 @@ public:
 	
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
+	// move the camera and work out the matrices of the frame without
+	// setting them into the shader
+	void UpdateSceneView();
+	// set the matrices and camera position of a frame into the shader
+	void ApplyView(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPosition) const;
+	// prepare the view from a camera placed by the caller instead of
+	// the keyboard and mouse, with the field of view in degrees
+	void PrepareCameraView(const glm::vec3& position, const glm::vec3& target, float fieldOfView, float aspectRatio);
+
+	// get the world position of the camera
+	glm::vec3 GetViewPosition() const;
+	// get the view and projection matrices of the current frame
+	const glm::mat4& GetViewMatrix() const { return m_viewMatrix; }
+	const glm::mat4& GetProjectionMatrix() const { return m_projectionMatrix; }
+	// true when the view moved in the last PrepareSceneView, a
+	// movement key is held or the window needs to be drawn again
+	bool HasViewChanged();
+	// restart the frame timer, after the loop slept, so the camera
+	// does not jump by the time spent waiting
+	void ResetFrameTimer();
 };
\ No newline at end of file
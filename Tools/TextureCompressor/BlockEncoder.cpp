@@ -0,0 +1,748 @@
+///////////////////////////////////////////////////////////////////////////////
+// blockencoder.cpp
+// ============
+// encode RGBA8 images into BC1, BC3 and BC7 (mode 6) blocks
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BlockEncoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define BLOCK_ENCODER_SSE2
+#include <emmintrin.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+#ifdef BLOCK_ENCODER_SSE2
+	bool g_bUseSimd = true;
+#else
+	bool g_bUseSimd = false;
+#endif
+
+	// interpolation weights of the 4 bit BC7 indices, out of 64
+	const int g_BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// the 16 texels of a block, one array per channel so that
+	// four texels fill one SSE register
+	struct BLOCK_TEXELS
+	{
+		alignas(16) float channel[4][16];
+	};
+
+	// the colors a block can decode to, with the position of
+	// each one between the two endpoints
+	struct BLOCK_PALETTE
+	{
+		float color[16][4];
+		float weight[16];
+		int count;
+	};
+
+	/***********************************************************
+	 *  LoadBlock()
+	 *
+	 *  Splits 16 RGBA8 texels into their channels.
+	 ***********************************************************/
+	void LoadBlock(const unsigned char* texels, BLOCK_TEXELS& block)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				block.channel[c][i] = texels[i * 4 + c];
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  FitEndpoints()
+	 *
+	 *  Finds the line through the block colors along their
+	 *  principal axis, and returns the extent of the colors
+	 *  on that line as the two endpoints.
+	 ***********************************************************/
+	void FitEndpoints(const BLOCK_TEXELS& block, int channels, float endpoint0[4], float endpoint1[4])
+	{
+		float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float minimum[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+		float maximum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int c = 0; c < channels; c++)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				mean[c] += block.channel[c][i];
+				minimum[c] = std::min(minimum[c], block.channel[c][i]);
+				maximum[c] = std::max(maximum[c], block.channel[c][i]);
+			}
+			mean[c] /= 16.0f;
+		}
+
+		float covariance[4][4] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			for (int a = 0; a < channels; a++)
+			{
+				for (int b = a; b < channels; b++)
+				{
+					covariance[a][b] += (block.channel[a][i] - mean[a]) * (block.channel[b][i] - mean[b]);
+				}
+			}
+		}
+		for (int a = 0; a < channels; a++)
+		{
+			for (int b = 0; b < a; b++)
+			{
+				covariance[a][b] = covariance[b][a];
+			}
+		}
+
+		// power iteration from the diagonal of the bounding box
+		float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int c = 0; c < channels; c++)
+		{
+			axis[c] = maximum[c] - minimum[c];
+		}
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			float length = 0.0f;
+			for (int a = 0; a < channels; a++)
+			{
+				for (int b = 0; b < channels; b++)
+				{
+					next[a] += covariance[a][b] * axis[b];
+				}
+				length = std::max(length, std::fabs(next[a]));
+			}
+			if (length < 1e-6f)
+			{
+				break;
+			}
+			for (int c = 0; c < channels; c++)
+			{
+				axis[c] = next[c] / length;
+			}
+		}
+
+		float lengthSquared = 0.0f;
+		for (int c = 0; c < channels; c++)
+		{
+			lengthSquared += axis[c] * axis[c];
+		}
+
+		// a flat block collapses both endpoints onto its color
+		if (lengthSquared < 1e-6f)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				endpoint0[c] = mean[c];
+				endpoint1[c] = mean[c];
+			}
+			return;
+		}
+
+		float lowest = 0.0f;
+		float highest = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			float t = 0.0f;
+			for (int c = 0; c < channels; c++)
+			{
+				t += (block.channel[c][i] - mean[c]) * axis[c];
+			}
+			t /= lengthSquared;
+			lowest = std::min(lowest, t);
+			highest = std::max(highest, t);
+		}
+
+		for (int c = 0; c < 4; c++)
+		{
+			endpoint0[c] = std::min(std::max(mean[c] + lowest * axis[c], 0.0f), 255.0f);
+			endpoint1[c] = std::min(std::max(mean[c] + highest * axis[c], 0.0f), 255.0f);
+		}
+	}
+
+	/***********************************************************
+	 *  FindClosestIndices()
+	 *
+	 *  Chooses the palette entry with the smallest weighted
+	 *  squared error for every texel, and returns the total
+	 *  error of the block.
+	 ***********************************************************/
+	float FindClosestIndices(
+		const BLOCK_TEXELS& block,
+		const BLOCK_PALETTE& palette,
+		const float channelWeights[4],
+		int indices[16])
+	{
+#ifdef BLOCK_ENCODER_SSE2
+		if (g_bUseSimd == true)
+		{
+			__m128 totalError = _mm_setzero_ps();
+			for (int group = 0; group < 16; group += 4)
+			{
+				__m128 texel[4];
+				for (int c = 0; c < 4; c++)
+				{
+					texel[c] = _mm_load_ps(&block.channel[c][group]);
+				}
+
+				__m128 bestError = _mm_set1_ps(3.0e38f);
+				__m128i bestIndex = _mm_setzero_si128();
+				for (int p = 0; p < palette.count; p++)
+				{
+					__m128 error = _mm_setzero_ps();
+					for (int c = 0; c < 4; c++)
+					{
+						__m128 difference = _mm_sub_ps(texel[c], _mm_set1_ps(palette.color[p][c]));
+						error = _mm_add_ps(error, _mm_mul_ps(_mm_mul_ps(difference, difference), _mm_set1_ps(channelWeights[c])));
+					}
+					__m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+					bestError = _mm_min_ps(error, bestError);
+					bestIndex = _mm_or_si128(
+						_mm_and_si128(closer, _mm_set1_epi32(p)),
+						_mm_andnot_si128(closer, bestIndex));
+				}
+
+				alignas(16) int32_t groupIndices[4];
+				_mm_store_si128((__m128i*)groupIndices, bestIndex);
+				for (int i = 0; i < 4; i++)
+				{
+					indices[group + i] = groupIndices[i];
+				}
+				totalError = _mm_add_ps(totalError, bestError);
+			}
+
+			alignas(16) float errors[4];
+			_mm_store_ps(errors, totalError);
+			return errors[0] + errors[1] + errors[2] + errors[3];
+		}
+#endif
+
+		float totalError = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			float bestError = 3.0e38f;
+			int bestIndex = 0;
+			for (int p = 0; p < palette.count; p++)
+			{
+				float error = 0.0f;
+				for (int c = 0; c < 4; c++)
+				{
+					float difference = block.channel[c][i] - palette.color[p][c];
+					error += difference * difference * channelWeights[c];
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = p;
+				}
+			}
+			indices[i] = bestIndex;
+			totalError += bestError;
+		}
+		return(totalError);
+	}
+
+	/***********************************************************
+	 *  RefineEndpoints()
+	 *
+	 *  Solves for the endpoints that best reproduce the block
+	 *  by least squares, keeping the chosen palette positions
+	 *  of the texels.  Returns false when every texel uses
+	 *  the same position and there is nothing to solve.
+	 ***********************************************************/
+	bool RefineEndpoints(
+		const BLOCK_TEXELS& block,
+		const BLOCK_PALETTE& palette,
+		const int indices[16],
+		float endpoint0[4],
+		float endpoint1[4])
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float bx[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			float b = palette.weight[indices[i]];
+			float a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int c = 0; c < 4; c++)
+			{
+				ax[c] += a * block.channel[c][i];
+				bx[c] += b * block.channel[c][i];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) < 1e-6f)
+		{
+			return(false);
+		}
+
+		for (int c = 0; c < 4; c++)
+		{
+			endpoint0[c] = std::min(std::max((ax[c] * bb - bx[c] * ab) / determinant, 0.0f), 255.0f);
+			endpoint1[c] = std::min(std::max((bx[c] * aa - ax[c] * ab) / determinant, 0.0f), 255.0f);
+		}
+		return(true);
+	}
+
+	/***********************************************************
+	 *  PackColor565()
+	 *
+	 *  Rounds an RGB color to 5:6:5 bits.
+	 ***********************************************************/
+	uint16_t PackColor565(const float color[4])
+	{
+		int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+		int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+		int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	/***********************************************************
+	 *  UnpackColor565()
+	 *
+	 *  Expands a 5:6:5 color back to 8 bits per channel the
+	 *  way the hardware decodes it.
+	 ***********************************************************/
+	void UnpackColor565(uint16_t packed, float color[4])
+	{
+		int r = (packed >> 11) & 31;
+		int g = (packed >> 5) & 63;
+		int b = packed & 31;
+		color[0] = (float)((r << 3) | (r >> 2));
+		color[1] = (float)((g << 2) | (g >> 4));
+		color[2] = (float)((b << 3) | (b >> 2));
+		color[3] = 255.0f;
+	}
+
+	/***********************************************************
+	 *  BuildBC1Palette()
+	 *
+	 *  Builds the four color palette of a pair of 5:6:5
+	 *  endpoints, in the order of the block indices.
+	 ***********************************************************/
+	void BuildBC1Palette(uint16_t color0, uint16_t color1, BLOCK_PALETTE& palette)
+	{
+		UnpackColor565(color0, palette.color[0]);
+		UnpackColor565(color1, palette.color[1]);
+		for (int c = 0; c < 4; c++)
+		{
+			palette.color[2][c] = (2.0f * palette.color[0][c] + palette.color[1][c]) / 3.0f;
+			palette.color[3][c] = (palette.color[0][c] + 2.0f * palette.color[1][c]) / 3.0f;
+		}
+		palette.weight[0] = 0.0f;
+		palette.weight[1] = 1.0f;
+		palette.weight[2] = 1.0f / 3.0f;
+		palette.weight[3] = 2.0f / 3.0f;
+		palette.count = 4;
+	}
+
+	/***********************************************************
+	 *  EncodeColorBlock()
+	 *
+	 *  Encodes the RGB channels of a block into the 8 byte
+	 *  BC1 layout, always in the four color mode.  Returns
+	 *  the error of the block.
+	 ***********************************************************/
+	float EncodeColorBlock(const BLOCK_TEXELS& block, unsigned char* output)
+	{
+		const float channelWeights[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+
+		float endpoint0[4];
+		float endpoint1[4];
+		FitEndpoints(block, 3, endpoint0, endpoint1);
+
+		uint16_t bestColor0 = 0;
+		uint16_t bestColor1 = 0;
+		int bestIndices[16] = {};
+		float bestError = 3.0e38f;
+		for (int pass = 0; pass < 2; pass++)
+		{
+			uint16_t color0 = PackColor565(endpoint1);
+			uint16_t color1 = PackColor565(endpoint0);
+			// the four color mode needs the first color to be larger
+			if (color0 < color1)
+			{
+				std::swap(color0, color1);
+			}
+
+			int indices[16] = {};
+			float error = 0.0f;
+			BLOCK_PALETTE palette;
+			BuildBC1Palette(color0, color1, palette);
+			if (color0 == color1)
+			{
+				// equal colors select the three color mode, where
+				// index zero still decodes to the first color
+				palette.count = 1;
+			}
+			error = FindClosestIndices(block, palette, channelWeights, indices);
+
+			if (error < bestError)
+			{
+				bestError = error;
+				bestColor0 = color0;
+				bestColor1 = color1;
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+
+			if ((pass == 1) || (color0 == color1) ||
+				(RefineEndpoints(block, palette, indices, endpoint1, endpoint0) == false))
+			{
+				break;
+			}
+		}
+
+		uint32_t packedIndices = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			packedIndices |= (uint32_t)bestIndices[i] << (i * 2);
+		}
+		output[0] = (unsigned char)(bestColor0 & 0xFF);
+		output[1] = (unsigned char)(bestColor0 >> 8);
+		output[2] = (unsigned char)(bestColor1 & 0xFF);
+		output[3] = (unsigned char)(bestColor1 >> 8);
+		for (int i = 0; i < 4; i++)
+		{
+			output[4 + i] = (unsigned char)(packedIndices >> (i * 8));
+		}
+
+		return(bestError);
+	}
+
+	/***********************************************************
+	 *  EncodeAlphaBlock()
+	 *
+	 *  Encodes the alpha channel of a block into the 8 byte
+	 *  BC3 alpha layout, using the eight value mode between
+	 *  the smallest and largest alpha.
+	 ***********************************************************/
+	void EncodeAlphaBlock(const BLOCK_TEXELS& block, unsigned char* output)
+	{
+		const float channelWeights[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+		float minimum = 255.0f;
+		float maximum = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			minimum = std::min(minimum, block.channel[3][i]);
+			maximum = std::max(maximum, block.channel[3][i]);
+		}
+		int alpha0 = (int)maximum;
+		int alpha1 = (int)minimum;
+
+		int indices[16] = {};
+		if (alpha0 > alpha1)
+		{
+			BLOCK_PALETTE palette;
+			memset(&palette, 0, sizeof(palette));
+			palette.color[0][3] = (float)alpha0;
+			palette.color[1][3] = (float)alpha1;
+			for (int i = 2; i < 8; i++)
+			{
+				palette.color[i][3] = (float)(((8 - i) * alpha0 + (i - 1) * alpha1) / 7);
+			}
+			palette.count = 8;
+			FindClosestIndices(block, palette, channelWeights, indices);
+		}
+
+		uint64_t packedIndices = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			packedIndices |= (uint64_t)indices[i] << (i * 3);
+		}
+		output[0] = (unsigned char)alpha0;
+		output[1] = (unsigned char)alpha1;
+		for (int i = 0; i < 6; i++)
+		{
+			output[2 + i] = (unsigned char)(packedIndices >> (i * 8));
+		}
+	}
+
+	/***********************************************************
+	 *  QuantizeBC7Endpoint()
+	 *
+	 *  Rounds an RGBA endpoint to 7 bits per channel plus the
+	 *  shared low bit that gives the smallest error.
+	 ***********************************************************/
+	void QuantizeBC7Endpoint(const float endpoint[4], int quantized[4], int& pBit)
+	{
+		float bestError = 3.0e38f;
+		for (int p = 0; p < 2; p++)
+		{
+			int candidate[4];
+			float error = 0.0f;
+			for (int c = 0; c < 4; c++)
+			{
+				int value = (int)std::floor((endpoint[c] - p) / 2.0f + 0.5f);
+				candidate[c] = std::min(std::max(value, 0), 127);
+				float difference = (float)((candidate[c] << 1) | p) - endpoint[c];
+				error += difference * difference;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				pBit = p;
+				memcpy(quantized, candidate, sizeof(candidate));
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  BuildBC7Palette()
+	 *
+	 *  Builds the sixteen color palette of a pair of quantized
+	 *  mode 6 endpoints.
+	 ***********************************************************/
+	void BuildBC7Palette(const int quantized0[4], int pBit0, const int quantized1[4], int pBit1, BLOCK_PALETTE& palette)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				int value0 = (quantized0[c] << 1) | pBit0;
+				int value1 = (quantized1[c] << 1) | pBit1;
+				palette.color[i][c] = (float)(((64 - g_BC7Weights[i]) * value0 + g_BC7Weights[i] * value1 + 32) >> 6);
+			}
+			palette.weight[i] = g_BC7Weights[i] / 64.0f;
+		}
+		palette.count = 16;
+	}
+
+	// writes fields into a 128 bit block from the lowest bit up
+	struct BIT_WRITER
+	{
+		unsigned char* output;
+		int position;
+
+		void Write(uint32_t value, int bitCount)
+		{
+			for (int i = 0; i < bitCount; i++, position++)
+			{
+				if ((value >> i) & 1)
+				{
+					output[position >> 3] |= (unsigned char)(1 << (position & 7));
+				}
+			}
+		}
+	};
+}
+
+/***********************************************************
+ *  SetSimdEnabled()
+ *
+ *  This method is used for switching to the scalar palette
+ *  search, to compare it against the SSE2 one.
+ ***********************************************************/
+void BlockEncoder::SetSimdEnabled(bool bEnable)
+{
+#ifdef BLOCK_ENCODER_SSE2
+	g_bUseSimd = bEnable;
+#else
+	(void)bEnable;
+#endif
+}
+
+/***********************************************************
+ *  IsSimdEnabled()
+ *
+ *  This method is used for checking which palette search
+ *  the encoder is using.
+ ***********************************************************/
+bool BlockEncoder::IsSimdEnabled()
+{
+	return(g_bUseSimd);
+}
+
+/***********************************************************
+ *  EncodeBC1()
+ *
+ *  This method is used for encoding the RGB channels of one
+ *  block into 8 bytes.
+ ***********************************************************/
+void BlockEncoder::EncodeBC1(const unsigned char* texels, unsigned char* block)
+{
+	BLOCK_TEXELS blockTexels;
+	LoadBlock(texels, blockTexels);
+	EncodeColorBlock(blockTexels, block);
+}
+
+/***********************************************************
+ *  EncodeBC3()
+ *
+ *  This method is used for encoding one block into 16 bytes,
+ *  the alpha channel followed by the RGB channels.
+ ***********************************************************/
+void BlockEncoder::EncodeBC3(const unsigned char* texels, unsigned char* block)
+{
+	BLOCK_TEXELS blockTexels;
+	LoadBlock(texels, blockTexels);
+	EncodeAlphaBlock(blockTexels, block);
+	EncodeColorBlock(blockTexels, block + 8);
+}
+
+/***********************************************************
+ *  EncodeBC7()
+ *
+ *  This method is used for encoding one block into 16 bytes
+ *  with BC7 mode 6 - one RGBA endpoint pair with 7 bit
+ *  channels, a low bit per endpoint and 4 bit indices.
+ ***********************************************************/
+void BlockEncoder::EncodeBC7(const unsigned char* texels, unsigned char* block)
+{
+	const float channelWeights[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+	BLOCK_TEXELS blockTexels;
+	LoadBlock(texels, blockTexels);
+
+	float endpoint0[4];
+	float endpoint1[4];
+	FitEndpoints(blockTexels, 4, endpoint0, endpoint1);
+
+	int bestQuantized0[4] = {};
+	int bestQuantized1[4] = {};
+	int bestPBit0 = 0;
+	int bestPBit1 = 0;
+	int bestIndices[16] = {};
+	float bestError = 3.0e38f;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		int quantized0[4];
+		int quantized1[4];
+		int pBit0 = 0;
+		int pBit1 = 0;
+		QuantizeBC7Endpoint(endpoint0, quantized0, pBit0);
+		QuantizeBC7Endpoint(endpoint1, quantized1, pBit1);
+
+		BLOCK_PALETTE palette;
+		BuildBC7Palette(quantized0, pBit0, quantized1, pBit1, palette);
+		int indices[16];
+		float error = FindClosestIndices(blockTexels, palette, channelWeights, indices);
+
+		if (error < bestError)
+		{
+			bestError = error;
+			memcpy(bestQuantized0, quantized0, sizeof(quantized0));
+			memcpy(bestQuantized1, quantized1, sizeof(quantized1));
+			bestPBit0 = pBit0;
+			bestPBit1 = pBit1;
+			memcpy(bestIndices, indices, sizeof(indices));
+		}
+
+		if ((pass == 1) || (RefineEndpoints(blockTexels, palette, indices, endpoint0, endpoint1) == false))
+		{
+			break;
+		}
+	}
+
+	// the top bit of the first index is implied to be zero, so
+	// swap the endpoints when the first texel is nearer the second
+	if (bestIndices[0] >= 8)
+	{
+		std::swap(bestQuantized0, bestQuantized1);
+		std::swap(bestPBit0, bestPBit1);
+		for (int i = 0; i < 16; i++)
+		{
+			bestIndices[i] = 15 - bestIndices[i];
+		}
+	}
+
+	memset(block, 0, 16);
+	BIT_WRITER writer = { block, 0 };
+	writer.Write(1 << 6, 7);
+	for (int c = 0; c < 4; c++)
+	{
+		writer.Write(bestQuantized0[c], 7);
+		writer.Write(bestQuantized1[c], 7);
+	}
+	writer.Write(bestPBit0, 1);
+	writer.Write(bestPBit1, 1);
+	writer.Write(bestIndices[0], 3);
+	for (int i = 1; i < 16; i++)
+	{
+		writer.Write(bestIndices[i], 4);
+	}
+}
+
+/***********************************************************
+ *  EncodeImage()
+ *
+ *  This method is used for encoding a whole RGBA8 image.
+ *  Texels past the right and bottom edges repeat the edge
+ *  texels, and the block rows are shared out between the
+ *  passed in number of threads (zero means one per core).
+ ***********************************************************/
+void BlockEncoder::EncodeImage(
+	CompressedTexture::BLOCK_FORMAT format,
+	const unsigned char* image,
+	int width,
+	int height,
+	unsigned char* blocks,
+	int threadCount)
+{
+	const int blocksWide = (width + 3) / 4;
+	const int blocksHigh = (height + 3) / 4;
+	const int blockBytes = CompressedTexture::GetBlockBytes(format);
+
+	void (*encodeBlock)(const unsigned char*, unsigned char*) = EncodeBC7;
+	if (format == CompressedTexture::FORMAT_BC1)
+		encodeBlock = EncodeBC1;
+	else if (format == CompressedTexture::FORMAT_BC3)
+		encodeBlock = EncodeBC3;
+
+	auto encodeRows = [=](int firstRow, int rowStep)
+		{
+			unsigned char texels[64];
+			for (int blockY = firstRow; blockY < blocksHigh; blockY += rowStep)
+			{
+				for (int blockX = 0; blockX < blocksWide; blockX++)
+				{
+					for (int y = 0; y < 4; y++)
+					{
+						int imageY = std::min(blockY * 4 + y, height - 1);
+						for (int x = 0; x < 4; x++)
+						{
+							int imageX = std::min(blockX * 4 + x, width - 1);
+							memcpy(&texels[(y * 4 + x) * 4], &image[((size_t)imageY * width + imageX) * 4], 4);
+						}
+					}
+					encodeBlock(texels, &blocks[((size_t)blockY * blocksWide + blockX) * blockBytes]);
+				}
+			}
+		};
+
+	if (threadCount <= 0)
+	{
+		threadCount = (int)std::thread::hardware_concurrency();
+	}
+	threadCount = std::max(1, std::min(threadCount, blocksHigh));
+	if (threadCount == 1)
+	{
+		encodeRows(0, 1);
+		return;
+	}
+
+	std::vector<std::thread> workers;
+	for (int i = 0; i < threadCount; i++)
+	{
+		workers.push_back(std::thread(encodeRows, i, threadCount));
+	}
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+}
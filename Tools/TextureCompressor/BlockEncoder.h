@@ -0,0 +1,43 @@
+///////////////////////////////////////////////////////////////////////////////
+// blockencoder.h
+// ============
+// encode RGBA8 images into BC1, BC3 and BC7 (mode 6) blocks
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "CompressedTexture.h"
+
+/***********************************************************
+ *  BlockEncoder
+ *
+ *  This class compresses RGBA8 images one 4x4 block at a
+ *  time.  Endpoints are fitted along the principal axis of
+ *  the block colors and refined once by least squares, and
+ *  the closest palette entry of every texel is searched four
+ *  texels at a time with SSE2 when it is available.  Block
+ *  rows of an image are split across worker threads.
+ ***********************************************************/
+class BlockEncoder
+{
+public:
+	// encode one RGBA8 image into the blocks of the passed in format
+	static void EncodeImage(
+		CompressedTexture::BLOCK_FORMAT format,
+		const unsigned char* image,
+		int width,
+		int height,
+		unsigned char* blocks,
+		int threadCount = 0);
+
+	// encode one block of 16 RGBA8 texels, in rows of four
+	static void EncodeBC1(const unsigned char* texels, unsigned char* block);
+	static void EncodeBC3(const unsigned char* texels, unsigned char* block);
+	static void EncodeBC7(const unsigned char* texels, unsigned char* block);
+
+	// choose between the SSE2 and scalar palette searches
+	static void SetSimdEnabled(bool bEnable);
+	// true when the SSE2 palette search is compiled in and enabled
+	static bool IsSimdEnabled();
+};
@@ -0,0 +1,248 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecompressor.cpp
+// ============
+// offline tool that block compresses the scene texture images
+//
+// The tool only needs a C++17 compiler, so it can run on any build
+// machine.  From this directory, with stb_image.h on the include path:
+//
+//   g++ -std=c++17 -O2 -msse2 -I../../Source -I<path to stb_image.h>
+//       TextureCompressor.cpp BlockEncoder.cpp ../../Source/CompressedTexture.cpp
+//       ../../Source/TextureCache.cpp ../../Source/MappedFile.cpp
+//       -o TextureCompressor -pthread
+//
+// and from the project directory:
+//
+//   TextureCompressor resources/textures/*.jpg
+//
+// writes resources/textures/compressed/<image name>.bctex, which the
+// scene loads in place of decoding the image whenever the driver
+// supports the format.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BlockEncoder.h"
+#include "CompressedTexture.h"
+#include "TextureCache.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	const char* g_DefaultOutputDirectory = "resources/textures/compressed";
+
+	/***********************************************************
+	 *  PrintUsage()
+	 *
+	 *  Prints the command line options of the tool.
+	 ***********************************************************/
+	void PrintUsage()
+	{
+		std::cout << "usage: TextureCompressor [options] image..." << std::endl
+			<< "  --format auto|bc1|bc3|bc7  block format (auto: bc1 for RGB, bc7 for RGBA images)" << std::endl
+			<< "  --output <directory>       output directory (default " << g_DefaultOutputDirectory << ")" << std::endl
+			<< "  --threads <count>          encoding threads (default one per core)" << std::endl
+			<< "  --scalar                   use the scalar palette search instead of SSE2" << std::endl;
+	}
+
+	/***********************************************************
+	 *  ParseFormat()
+	 *
+	 *  Converts a format name from the command line.
+	 ***********************************************************/
+	bool ParseFormat(const char* name, CompressedTexture::BLOCK_FORMAT& format)
+	{
+		if (strcmp(name, "auto") == 0)
+			format = CompressedTexture::FORMAT_NONE;
+		else if (strcmp(name, "bc1") == 0)
+			format = CompressedTexture::FORMAT_BC1;
+		else if (strcmp(name, "bc3") == 0)
+			format = CompressedTexture::FORMAT_BC3;
+		else if (strcmp(name, "bc7") == 0)
+			format = CompressedTexture::FORMAT_BC7;
+		else
+			return(false);
+		return(true);
+	}
+
+	/***********************************************************
+	 *  GetFormatName()
+	 *
+	 *  Gets the display name of a block format.
+	 ***********************************************************/
+	const char* GetFormatName(CompressedTexture::BLOCK_FORMAT format)
+	{
+		switch (format)
+		{
+		case CompressedTexture::FORMAT_BC1:
+			return "BC1";
+		case CompressedTexture::FORMAT_BC3:
+			return "BC3";
+		case CompressedTexture::FORMAT_BC7:
+			return "BC7";
+		default:
+			return "none";
+		}
+	}
+}
+
+/***********************************************************
+ *  main()
+ *
+ *  Compresses every image named on the command line into
+ *  the output directory and reports the memory saved and
+ *  the encoding throughput.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	CompressedTexture::BLOCK_FORMAT requestedFormat = CompressedTexture::FORMAT_NONE;
+	std::string outputDirectory = g_DefaultOutputDirectory;
+	int threadCount = 0;
+	std::vector<std::string> images;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "--format") == 0) && (i + 1 < argc))
+		{
+			if (ParseFormat(argv[++i], requestedFormat) == false)
+			{
+				PrintUsage();
+				return(EXIT_FAILURE);
+			}
+		}
+		else if ((strcmp(argv[i], "--output") == 0) && (i + 1 < argc))
+		{
+			outputDirectory = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--threads") == 0) && (i + 1 < argc))
+		{
+			threadCount = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--scalar") == 0)
+		{
+			BlockEncoder::SetSimdEnabled(false);
+		}
+		else if (argv[i][0] == '-')
+		{
+			PrintUsage();
+			return(EXIT_FAILURE);
+		}
+		else
+		{
+			images.push_back(argv[i]);
+		}
+	}
+
+	if (images.empty() == true)
+	{
+		PrintUsage();
+		return(EXIT_FAILURE);
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(outputDirectory, error);
+
+	// images are flipped the same way the scene loads them
+	stbi_set_flip_vertically_on_load(true);
+
+	std::cout << "Palette search: " << (BlockEncoder::IsSimdEnabled() ? "SSE2" : "scalar") << std::endl;
+
+	int compressedCount = 0;
+	size_t totalUncompressedBytes = 0;
+	size_t totalCompressedBytes = 0;
+	double totalTexels = 0.0;
+	double totalEncodeMilliseconds = 0.0;
+	for (size_t i = 0; i < images.size(); i++)
+	{
+		int width = 0;
+		int height = 0;
+		int colorChannels = 0;
+		unsigned char* image = stbi_load(images[i].c_str(), &width, &height, &colorChannels, 0);
+		if ((NULL == image) || ((colorChannels != 3) && (colorChannels != 4)))
+		{
+			std::cout << "Could not load image:" << images[i] << std::endl;
+			if (NULL != image)
+			{
+				stbi_image_free(image);
+			}
+			continue;
+		}
+
+		CompressedTexture::BLOCK_FORMAT format = requestedFormat;
+		if (format == CompressedTexture::FORMAT_NONE)
+		{
+			format = (colorChannels == 3) ? CompressedTexture::FORMAT_BC1 : CompressedTexture::FORMAT_BC7;
+		}
+
+		// the mip chain is filtered the same way as the texture cache
+		TextureCache::MIP_CHAIN mipChain;
+		TextureCache::BuildMipChain(image, width, height, colorChannels, mipChain);
+		stbi_image_free(image);
+
+		std::vector<unsigned char> blocks(
+			CompressedTexture::GetMipChainSize(format, width, height, mipChain.levelCount));
+
+		Clock::time_point encodeStart = Clock::now();
+		const unsigned char* level = mipChain.ownedPixels.data();
+		size_t blockOffset = 0;
+		int levelWidth = width;
+		int levelHeight = height;
+		for (int levelIndex = 0; levelIndex < mipChain.levelCount; levelIndex++)
+		{
+			BlockEncoder::EncodeImage(format, level, levelWidth, levelHeight, &blocks[blockOffset], threadCount);
+			level += (size_t)levelWidth * levelHeight * 4;
+			blockOffset += CompressedTexture::GetLevelSize(format, levelWidth, levelHeight);
+			levelWidth = (levelWidth > 1) ? levelWidth / 2 : 1;
+			levelHeight = (levelHeight > 1) ? levelHeight / 2 : 1;
+		}
+		double encodeMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - encodeStart).count();
+
+		std::filesystem::path sourcePath(images[i]);
+		std::filesystem::path outputPath = std::filesystem::path(outputDirectory) / sourcePath.stem().concat(".bctex");
+		uint64_t sourceSize = 0;
+		int64_t sourceModifiedTime = 0;
+		TextureCache::GetSourceInfo(images[i], sourceSize, sourceModifiedTime);
+		if (CompressedTexture::Write(outputPath.string().c_str(), format, width, height, mipChain.levelCount, sourceSize, sourceModifiedTime, blocks) == false)
+		{
+			std::cout << "Could not write compressed texture:" << outputPath.string() << std::endl;
+			continue;
+		}
+
+		double texels = (double)mipChain.byteCount / 4.0;
+		compressedCount++;
+		totalUncompressedBytes += mipChain.byteCount;
+		totalCompressedBytes += blocks.size();
+		totalTexels += texels;
+		totalEncodeMilliseconds += encodeMilliseconds;
+
+		std::cout << std::fixed << std::setprecision(2)
+			<< sourcePath.filename().string() << ": " << width << "x" << height << " " << mipChain.levelCount << " levels "
+			<< GetFormatName(format) << ", " << (mipChain.byteCount / 1024.0) << " KB RGBA8 -> "
+			<< (blocks.size() / 1024.0) << " KB (" << ((double)mipChain.byteCount / blocks.size()) << ":1), "
+			<< encodeMilliseconds << " ms, " << (texels / (encodeMilliseconds * 1000.0)) << " Mtexels/s" << std::endl;
+	}
+
+	if (compressedCount > 0)
+	{
+		std::cout << std::fixed << std::setprecision(2)
+			<< "Compressed " << compressedCount << " of " << images.size() << " images: "
+			<< (totalUncompressedBytes / (1024.0 * 1024.0)) << " MB RGBA8 -> "
+			<< (totalCompressedBytes / (1024.0 * 1024.0)) << " MB, saving "
+			<< ((totalUncompressedBytes - totalCompressedBytes) / (1024.0 * 1024.0)) << " MB of texture memory, "
+			<< (totalTexels / (totalEncodeMilliseconds * 1000.0)) << " Mtexels/s" << std::endl;
+	}
+
+	return (compressedCount == (int)images.size()) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
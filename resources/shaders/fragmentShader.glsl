@@ -0,0 +1,113 @@
+#version 440 core
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+in vec4 fragmentObjectColor;
+in vec2 fragmentUVScale;
+flat in int fragmentTextureLayer;
+flat in int fragmentMaterialIndex;
+
+out vec4 outFragmentColor;
+
+struct Material
+{
+	vec3 ambientColor;
+	float ambientStrength;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float shininess;
+};
+
+struct LightSource
+{
+	vec3 position;
+	vec3 ambientColor;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float focalStrength;
+	float specularIntensity;
+};
+
+#define TOTAL_LIGHTS 4
+
+// the object color, UV scale, texture layer and material index come
+// from the vertex shader, which takes them from uniforms for single
+// draws and from instance attributes for instanced draws
+uniform bool bUseLighting = false;
+uniform sampler2D objectTexture;
+uniform vec3 viewPosition;
+uniform LightSource lightSources[TOTAL_LIGHTS];
+
+// every material lives in one uniform buffer, bound a page at a
+// time, and each draw only selects its index within the page
+#define MATERIALS_PER_PAGE 256
+layout(std140, binding = 0) uniform MaterialBlock
+{
+	Material materials[MATERIALS_PER_PAGE];
+};
+
+// material of the object being drawn
+Material material;
+
+// texture array mode - every scene texture is a layer of one array
+// that stays bound, and each draw only selects its layer
+uniform bool bUseTextureArray = false;
+uniform sampler2DArray objectTextureArray;
+
+// get the surface color of the fragment
+vec4 GetObjectColor()
+{
+	if (fragmentTextureLayer < 0)
+	{
+		return fragmentObjectColor;
+	}
+
+	vec2 textureCoordinate = fragmentTextureCoordinate * fragmentUVScale;
+	if (bUseTextureArray == true)
+	{
+		return texture(objectTextureArray, vec3(textureCoordinate, float(fragmentTextureLayer)));
+	}
+	return texture(objectTexture, textureCoordinate);
+}
+
+// calculate the phong lighting contributed by one light source
+vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+{
+	vec3 lightDirection = normalize(light.position - vertexPosition);
+
+	vec3 ambient = light.ambientColor * material.ambientColor * material.ambientStrength;
+
+	float impact = max(dot(lightNormal, lightDirection), 0.0f);
+	vec3 diffuse = impact * light.diffuseColor * material.diffuseColor;
+
+	vec3 reflectDirection = reflect(-lightDirection, lightNormal);
+	float specularComponent = pow(max(dot(viewDirection, reflectDirection), 0.0f), max(light.focalStrength, 1.0f));
+	vec3 specular = light.specularIntensity * specularComponent * light.specularColor * material.specularColor;
+
+	return ambient + diffuse + specular;
+}
+
+void main()
+{
+	material = materials[fragmentMaterialIndex];
+	vec4 surfaceColor = GetObjectColor();
+
+	if (bUseLighting == true)
+	{
+		vec3 lightNormal = normalize(fragmentVertexNormal);
+		vec3 viewDirection = normalize(viewPosition - fragmentPosition);
+
+		vec3 phongResult = vec3(0.0f);
+		for (int i = 0; i < TOTAL_LIGHTS; i++)
+		{
+			phongResult += CalcLightSource(lightSources[i], lightNormal, fragmentPosition, viewDirection);
+		}
+
+		outFragmentColor = vec4(phongResult * surfaceColor.xyz, surfaceColor.w);
+	}
+	else
+	{
+		outFragmentColor = surfaceColor;
+	}
+}
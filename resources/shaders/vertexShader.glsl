@@ -0,0 +1,64 @@
+#version 440 core
+
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+
+// instanced draws read the per-object values from these attributes,
+// which advance once per instance
+layout (location = 3) in mat4 inInstanceModel;
+layout (location = 7) in vec4 inInstanceColor;
+layout (location = 8) in vec2 inInstanceUVScale;
+layout (location = 9) in ivec2 inInstanceTextureMaterial;
+layout (location = 10) in mat3 inInstanceNormalMatrix;
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+out vec4 fragmentObjectColor;
+out vec2 fragmentUVScale;
+// texture array layer, or -1 when the object uses its color
+flat out int fragmentTextureLayer;
+flat out int fragmentMaterialIndex;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+// per-object values of single draws
+uniform bool bUseInstancing = false;
+uniform bool bUseTexture = false;
+uniform vec4 objectColor = vec4(1.0f);
+uniform vec2 UVscale = vec2(1.0f, 1.0f);
+uniform int textureLayer = 0;
+uniform int materialIndex = 0;
+
+void main()
+{
+	mat4 objectModel = model;
+	mat3 normalMatrix;
+	if (bUseInstancing == true)
+	{
+		objectModel = inInstanceModel;
+		normalMatrix = inInstanceNormalMatrix;
+		fragmentObjectColor = inInstanceColor;
+		fragmentUVScale = inInstanceUVScale;
+		fragmentTextureLayer = inInstanceTextureMaterial.x;
+		fragmentMaterialIndex = inInstanceTextureMaterial.y;
+	}
+	else
+	{
+		normalMatrix = mat3(transpose(inverse(model)));
+		fragmentObjectColor = objectColor;
+		fragmentUVScale = UVscale;
+		fragmentTextureLayer = (bUseTexture == true) ? textureLayer : -1;
+		fragmentMaterialIndex = materialIndex;
+	}
+
+	// transform the vertex into world space for lighting
+	fragmentPosition = vec3(objectModel * vec4(inVertexPosition, 1.0f));
+	fragmentVertexNormal = normalMatrix * inVertexNormal;
+	fragmentTextureCoordinate = inTextureCoordinate;
+
+	gl_Position = projection * view * vec4(fragmentPosition, 1.0f);
+}